@@ -0,0 +1,1096 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/definitions.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+/**
+ * A read-only contiguous array that either owns its elements or refers to memory
+ * that is owned by another object, such as a memory-mapped file. The owner is kept
+ * alive as long as any array refers to it.
+ */
+template <class T> class FlatArray {
+public:
+    /// Constructs an empty array
+    FlatArray() = default;
+
+    /// Takes ownership of the elements
+    FlatArray(vector<T> values)
+        : storage(move(values)), first(storage.data()), count(storage.size()) {}
+
+    /**
+     * Refers to external memory without copying it.
+     *
+     * @param first Pointer to the first element
+     * @param count Number of elements
+     * @param owner Object that owns the memory
+     */
+    FlatArray(const T* first, size_t count, shared_ptr<const void> owner)
+        : owner(move(owner)), first(first), count(count) {}
+
+    FlatArray(const FlatArray& other)
+        : storage(other.storage), owner(other.owner),
+          first(other.owns() ? storage.data() : other.first), count(other.count) {}
+
+    // the buffer of a moved vector does not change
+    FlatArray(FlatArray&& other) = default;
+
+    FlatArray& operator=(FlatArray other) {
+        swap(storage, other.storage);
+        swap(owner, other.owner);
+        swap(first, other.first);
+        swap(count, other.count);
+        return *this;
+    }
+
+    /// Whether the elements are owned by the array (and not external memory)
+    bool owns() const { return !owner; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return first[i]; }
+    const T& back() const { return first[count - 1]; }
+    const T* data() const { return first; }
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    const T* cbegin() const { return first; }
+    const T* cend() const { return first + count; }
+
+protected:
+    /// Elements when they are owned by the array
+    vector<T> storage;
+    /// Owner of the elements when they are not owned by the array
+    shared_ptr<const void> owner;
+    /// Pointer to the first element
+    const T* first = nullptr;
+    /// Number of elements
+    size_t count = 0;
+};
+
+// **************************************************************************************
+//  Compiled MDP
+// **************************************************************************************
+
+namespace internal {
+/// Checks that the indices of all states can be stored in the index type
+template <class Index> inline void check_index_range(size_t statecount) {
+    if (statecount > size_t(numeric_limits<Index>::max()))
+        throw ModelError("Too many states (" + std::to_string(statecount) +
+                         ") for the index type of the compiled model.");
+}
+} // namespace internal
+
+/**
+ * An immutable, flat representation of an MDP. The transitions are stored
+ * in a compressed sparse row (CSR) format: state offsets point to the rows of
+ * state-action pairs and the action offsets point to contiguous arrays of
+ * target indices, probabilities, and rewards.
+ *
+ * A state-action pair is identified by a single index, see sa_index. The
+ * state-action indices of a state are consecutive, which makes a Bellman
+ * update over all states a single streaming pass over the arrays.
+ *
+ * The model is meant to be built once from an MDP (that is checked for
+ * validity when compiled) and then solved many times. It cannot be modified
+ * once it is constructed.
+ *
+ * The storage precision is a parameter. Storing the probabilities and rewards
+ * as float and the target states as 32-bit integers (CompiledMDPf) halves the
+ * memory traffic of the Bellman updates, which are usually limited by the memory
+ * bandwidth for large models. The values are always accumulated in prec_t.
+ *
+ * @tparam Real Type of the stored probabilities and rewards
+ * @tparam Index Type of the stored target state indices
+ */
+template <class Real = prec_t, class Index = int64_t> class BasicCompiledMDP {
+protected:
+    /// Position of the first state-action of each state, the last element is
+    /// the total number of state-action pairs (length: states + 1)
+    FlatArray<size_t> state_offsets;
+    /// Position of the first transition of each state-action pair, the last
+    /// element is the total number of transitions (length: state-actions + 1)
+    FlatArray<size_t> action_offsets;
+    /// Target states for all transitions
+    FlatArray<Index> indices;
+    /// Transition probabilities for all transitions
+    FlatArray<Real> probabilities;
+    /// Rewards for all transitions
+    FlatArray<Real> rewards;
+
+public:
+    /** Constructs an empty model with no states */
+    BasicCompiledMDP() : state_offsets(sizvec(1, 0)), action_offsets(sizvec(1, 0)) {}
+
+    /**
+     * Constructs the model from the flat arrays, which may refer to external
+     * memory. Only the consistency of the lengths and of the last offsets is
+     * checked, not the values of the offsets and indices.
+     */
+    BasicCompiledMDP(FlatArray<size_t> state_offsets, FlatArray<size_t> action_offsets,
+                     FlatArray<Index> indices, FlatArray<Real> probabilities,
+                     FlatArray<Real> rewards)
+        : state_offsets(move(state_offsets)), action_offsets(move(action_offsets)),
+          indices(move(indices)), probabilities(move(probabilities)),
+          rewards(move(rewards)) {
+        if (this->state_offsets.empty() || this->action_offsets.empty() ||
+            this->state_offsets.back() != this->action_offsets.size() - 1 ||
+            this->action_offsets.back() != this->indices.size() ||
+            this->probabilities.size() != this->indices.size() ||
+            this->rewards.size() != this->indices.size())
+            throw ModelError("Inconsistent sizes of the compiled MDP arrays.");
+    }
+
+    /**
+     * Compiles the MDP. The model is checked first and ModelError is thrown
+     * when it is not valid.
+     *
+     * @param mdp The model to compile, it is not referenced after the
+     *            construction
+     */
+    explicit BasicCompiledMDP(const MDP& mdp) {
+        check_model(mdp);
+        internal::check_index_range<Index>(mdp.size());
+
+        // count everything first to allocate the memory only once
+        size_t nstateactions = 0, ntransitions = 0;
+        for (const State& s : mdp) {
+            nstateactions += s.size();
+            for (const Action& a : s.get_actions())
+                ntransitions += a.size();
+        }
+
+        sizvec state_offsets, action_offsets;
+        vector<Index> indices;
+        vector<Real> probabilities, rewards;
+
+        state_offsets.reserve(mdp.size() + 1);
+        action_offsets.reserve(nstateactions + 1);
+        indices.reserve(ntransitions);
+        probabilities.reserve(ntransitions);
+        rewards.reserve(ntransitions);
+
+        state_offsets.push_back(0);
+        action_offsets.push_back(0);
+        for (const State& s : mdp) {
+            for (const Action& a : s.get_actions()) {
+                indices.insert(indices.end(), a.get_indices().cbegin(),
+                               a.get_indices().cend());
+                probabilities.insert(probabilities.end(), a.get_probabilities().cbegin(),
+                                     a.get_probabilities().cend());
+                rewards.insert(rewards.end(), a.get_rewards().cbegin(),
+                               a.get_rewards().cend());
+                action_offsets.push_back(indices.size());
+            }
+            state_offsets.push_back(action_offsets.size() - 1);
+        }
+        assert(indices.size() == ntransitions);
+        assert(action_offsets.size() == nstateactions + 1);
+
+        this->state_offsets = move(state_offsets);
+        this->action_offsets = move(action_offsets);
+        this->indices = move(indices);
+        this->probabilities = move(probabilities);
+        this->rewards = move(rewards);
+    }
+
+    /// Number of states
+    size_t size() const { return state_offsets.size() - 1; }
+
+    /// Number of state-action pairs
+    size_t stateaction_count() const { return action_offsets.size() - 1; }
+
+    /// Number of transitions (with non-zero probabilities) over all state-actions
+    size_t transition_count() const { return indices.size(); }
+
+    /// Number of actions in the state
+    size_t action_count(long stateid) const {
+        assert(stateid >= 0 && size_t(stateid) < size());
+        return state_offsets[stateid + 1] - state_offsets[stateid];
+    }
+
+    /// A state with no actions is terminal
+    bool is_terminal(long stateid) const { return action_count(stateid) == 0; }
+
+    /**
+     * Index of the state-action pair. Throws ModelError when the action is
+     * not valid.
+     */
+    size_t sa_index(long stateid, long actionid) const {
+        if (actionid < 0 || size_t(actionid) >= action_count(stateid))
+            throw ModelError("invalid actionid: " + std::to_string(actionid) +
+                                 " for action count: " +
+                                 std::to_string(action_count(stateid)),
+                             stateid, actionid);
+        return state_offsets[stateid] + size_t(actionid);
+    }
+
+    /// Position of the first transition of the state-action
+    size_t sa_begin(size_t saindex) const { return action_offsets[saindex]; }
+
+    /// Position after the last transition of the state-action
+    size_t sa_end(size_t saindex) const { return action_offsets[saindex + 1]; }
+
+    /// Number of transitions of the state-action
+    size_t sa_size(size_t saindex) const { return sa_end(saindex) - sa_begin(saindex); }
+
+    /// Position of the first transition of the state
+    size_t state_begin(long stateid) const {
+        return action_offsets[state_offsets[stateid]];
+    }
+
+    /// Position after the last transition of the state
+    size_t state_end(long stateid) const {
+        return action_offsets[state_offsets[stateid + 1]];
+    }
+
+    /// Target states of all transitions
+    const FlatArray<Index>& get_indices() const { return indices; }
+
+    /// Probabilities of all transitions
+    const FlatArray<Real>& get_probabilities() const { return probabilities; }
+
+    /// Rewards of all transitions
+    const FlatArray<Real>& get_rewards() const { return rewards; }
+
+    /// Offsets of states into the state-action pairs
+    const FlatArray<size_t>& get_state_offsets() const { return state_offsets; }
+
+    /// Offsets of state-action pairs into the transitions
+    const FlatArray<size_t>& get_action_offsets() const { return action_offsets; }
+
+    /**
+     * Computes the value of the state-action for the value function.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     */
+    prec_t value(size_t saindex, const numvec& valuefunction, prec_t discount) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        prec_t value = 0.0;
+#pragma omp simd reduction(+ : value)
+        for (size_t c = b; c < e; c++)
+            value += prec_t(probabilities[c]) *
+                     (prec_t(rewards[c]) + discount * valuefunction[indices[c]]);
+        return value;
+    }
+
+    /**
+     * Computes the value of the state-action with a custom distribution over
+     * the transitions with non-zero nominal probabilities.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param distribution New distribution, its length must be sa_size(saindex)
+     */
+    prec_t value(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 const numvec& distribution) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(distribution.size() == e - b);
+        prec_t value = 0.0;
+#pragma omp simd reduction(+ : value)
+        for (size_t c = b; c < e; c++)
+            value += distribution[c - b] *
+                     (prec_t(rewards[c]) + discount * valuefunction[indices[c]]);
+        return value;
+    }
+
+    /**
+     * Computes the value of each transition of the state-action (the reward plus
+     * the discounted value of the target state).
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param zvalues Output, resized to sa_size(saindex)
+     */
+    void zvalues(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 numvec& zvalues) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        zvalues.resize(e - b);
+#pragma omp simd
+        for (size_t c = b; c < e; c++)
+            zvalues[c - b] = prec_t(rewards[c]) + discount * valuefunction[indices[c]];
+    }
+
+    /// Nominal transition probabilities of the state-action as a new vector
+    numvec sa_probabilities(size_t saindex) const {
+        return numvec(probabilities.cbegin() + sa_begin(saindex),
+                      probabilities.cbegin() + sa_end(saindex));
+    }
+
+    /// Nominal transition probabilities of the state-action copied into the output
+    void sa_probabilities(size_t saindex, numvec& probs) const {
+        probs.assign(probabilities.cbegin() + sa_begin(saindex),
+                     probabilities.cbegin() + sa_end(saindex));
+    }
+
+    /// Mean reward of the state-action for the nominal probabilities
+    prec_t mean_reward(size_t saindex) const {
+        return inner_product(probabilities.cbegin() + sa_begin(saindex),
+                             probabilities.cbegin() + sa_end(saindex),
+                             rewards.cbegin() + sa_begin(saindex), 0.0);
+    }
+
+    /// Mean reward of the state-action for a custom distribution
+    prec_t mean_reward(size_t saindex, const numvec& distribution) const {
+        assert(distribution.size() == sa_size(saindex));
+        return inner_product(distribution.cbegin(), distribution.cend(),
+                             rewards.cbegin() + sa_begin(saindex), 0.0);
+    }
+
+    /**
+     * Adds the transition probabilities of the state-action, multiplied by
+     * scale, to the transition.
+     *
+     * @param saindex Index of the state-action pair
+     * @param scale Multiplier for the probabilities
+     * @param transition Transition to add the probabilities to
+     * @param distribution Optional custom distribution over the transitions
+     */
+    void probabilities_addto(size_t saindex, prec_t scale, Transition& transition,
+                             const numvec& distribution = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(distribution.empty() || distribution.size() == e - b);
+        for (size_t c = b; c < e; c++)
+            transition.add_sample(indices[c],
+                                  scale * (distribution.empty() ? prec_t(probabilities[c])
+                                                                : distribution[c - b]),
+                                  0.0);
+    }
+
+    /**
+     * Constructs the transition probabilities of the state-action. Rewards are
+     * not included.
+     *
+     * @param saindex Index of the state-action pair
+     * @param distribution Optional custom distribution over the transitions
+     */
+    Transition transition(size_t saindex, const numvec& distribution = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(distribution.empty() || distribution.size() == e - b);
+        return Transition(indvec(indices.cbegin() + b, indices.cbegin() + e),
+                          distribution.empty()
+                              ? numvec(probabilities.cbegin() + b,
+                                       probabilities.cbegin() + e)
+                              : distribution,
+                          numvec(e - b, 0.0));
+    }
+};
+
+/// Compiled MDP with double precision and 64-bit indices
+using CompiledMDP = BasicCompiledMDP<>;
+
+/// Compiled MDP with single precision probabilities and rewards and 32-bit indices
+using CompiledMDPf = BasicCompiledMDP<float, int32_t>;
+
+// **************************************************************************************
+//  Compiled MDPO
+// **************************************************************************************
+
+/**
+ * An immutable, flat representation of an MDPO. This is the same layout as
+ * CompiledMDP with an additional level of outcomes: state offsets point to
+ * state-action pairs, action offsets point to outcomes, and outcome offsets
+ * point to the contiguous arrays of target indices, probabilities, and rewards.
+ * The nominal distribution over outcomes is stored with one value per outcome.
+ *
+ * @tparam Real Type of the stored probabilities and rewards
+ * @tparam Index Type of the stored target state indices
+ * @see BasicCompiledMDP
+ */
+template <class Real = prec_t, class Index = int64_t> class BasicCompiledMDPO {
+protected:
+    /// Position of the first state-action of each state (length: states + 1)
+    FlatArray<size_t> state_offsets;
+    /// Position of the first outcome of each state-action (length: state-actions + 1)
+    FlatArray<size_t> action_offsets;
+    /// Position of the first transition of each outcome (length: outcomes + 1)
+    FlatArray<size_t> outcome_offsets;
+    /// Nominal probability of each outcome
+    FlatArray<Real> distribution;
+    /// Target states for all transitions
+    FlatArray<Index> indices;
+    /// Transition probabilities for all transitions
+    FlatArray<Real> probabilities;
+    /// Rewards for all transitions
+    FlatArray<Real> rewards;
+
+public:
+    /** Constructs an empty model with no states */
+    BasicCompiledMDPO()
+        : state_offsets(sizvec(1, 0)), action_offsets(sizvec(1, 0)),
+          outcome_offsets(sizvec(1, 0)) {}
+
+    /**
+     * Constructs the model from the flat arrays, which may refer to external
+     * memory. Only the consistency of the lengths and of the last offsets is
+     * checked, not the values of the offsets and indices.
+     */
+    BasicCompiledMDPO(FlatArray<size_t> state_offsets, FlatArray<size_t> action_offsets,
+                      FlatArray<size_t> outcome_offsets, FlatArray<Real> distribution,
+                      FlatArray<Index> indices, FlatArray<Real> probabilities,
+                      FlatArray<Real> rewards)
+        : state_offsets(move(state_offsets)), action_offsets(move(action_offsets)),
+          outcome_offsets(move(outcome_offsets)), distribution(move(distribution)),
+          indices(move(indices)), probabilities(move(probabilities)),
+          rewards(move(rewards)) {
+        if (this->state_offsets.empty() || this->action_offsets.empty() ||
+            this->outcome_offsets.empty() ||
+            this->state_offsets.back() != this->action_offsets.size() - 1 ||
+            this->action_offsets.back() != this->outcome_offsets.size() - 1 ||
+            this->distribution.size() != this->outcome_offsets.size() - 1 ||
+            this->outcome_offsets.back() != this->indices.size() ||
+            this->probabilities.size() != this->indices.size() ||
+            this->rewards.size() != this->indices.size())
+            throw ModelError("Inconsistent sizes of the compiled MDPO arrays.");
+    }
+
+    /**
+     * Compiles the MDPO. The model is checked first and ModelError is thrown
+     * when it is not valid.
+     *
+     * @param mdpo The model to compile, it is not referenced after the
+     *            construction
+     */
+    explicit BasicCompiledMDPO(const MDPO& mdpo) {
+        check_model(mdpo);
+        internal::check_index_range<Index>(mdpo.size());
+
+        size_t nstateactions = 0, noutcomes = 0, ntransitions = 0;
+        for (const StateO& s : mdpo) {
+            nstateactions += s.size();
+            for (const ActionO& a : s.get_actions()) {
+                noutcomes += a.size();
+                for (const Transition& t : a.get_outcomes())
+                    ntransitions += t.size();
+            }
+        }
+
+        sizvec state_offsets, action_offsets, outcome_offsets;
+        vector<Real> distribution, probabilities, rewards;
+        vector<Index> indices;
+
+        state_offsets.reserve(mdpo.size() + 1);
+        action_offsets.reserve(nstateactions + 1);
+        outcome_offsets.reserve(noutcomes + 1);
+        distribution.reserve(noutcomes);
+        indices.reserve(ntransitions);
+        probabilities.reserve(ntransitions);
+        rewards.reserve(ntransitions);
+
+        state_offsets.push_back(0);
+        action_offsets.push_back(0);
+        outcome_offsets.push_back(0);
+        for (const StateO& s : mdpo) {
+            for (const ActionO& a : s.get_actions()) {
+                for (const Transition& t : a.get_outcomes()) {
+                    indices.insert(indices.end(), t.get_indices().cbegin(),
+                                   t.get_indices().cend());
+                    probabilities.insert(probabilities.end(),
+                                         t.get_probabilities().cbegin(),
+                                         t.get_probabilities().cend());
+                    rewards.insert(rewards.end(), t.get_rewards().cbegin(),
+                                   t.get_rewards().cend());
+                    outcome_offsets.push_back(indices.size());
+                }
+                distribution.insert(distribution.end(), a.get_distribution().cbegin(),
+                                    a.get_distribution().cend());
+                action_offsets.push_back(outcome_offsets.size() - 1);
+            }
+            state_offsets.push_back(action_offsets.size() - 1);
+        }
+        assert(distribution.size() == noutcomes);
+        assert(indices.size() == ntransitions);
+
+        this->state_offsets = move(state_offsets);
+        this->action_offsets = move(action_offsets);
+        this->outcome_offsets = move(outcome_offsets);
+        this->distribution = move(distribution);
+        this->indices = move(indices);
+        this->probabilities = move(probabilities);
+        this->rewards = move(rewards);
+    }
+
+    /// Number of states
+    size_t size() const { return state_offsets.size() - 1; }
+
+    /// Number of state-action pairs
+    size_t stateaction_count() const { return action_offsets.size() - 1; }
+
+    /// Number of outcomes over all state-actions
+    size_t outcome_count() const { return outcome_offsets.size() - 1; }
+
+    /// Number of transitions (with non-zero probabilities) over all outcomes
+    size_t transition_count() const { return indices.size(); }
+
+    /// Number of actions in the state
+    size_t action_count(long stateid) const {
+        assert(stateid >= 0 && size_t(stateid) < size());
+        return state_offsets[stateid + 1] - state_offsets[stateid];
+    }
+
+    /// A state with no actions is terminal
+    bool is_terminal(long stateid) const { return action_count(stateid) == 0; }
+
+    /**
+     * Index of the state-action pair. Throws ModelError when the action is
+     * not valid.
+     */
+    size_t sa_index(long stateid, long actionid) const {
+        if (actionid < 0 || size_t(actionid) >= action_count(stateid))
+            throw ModelError("invalid actionid: " + std::to_string(actionid) +
+                                 " for action count: " +
+                                 std::to_string(action_count(stateid)),
+                             stateid, actionid);
+        return state_offsets[stateid] + size_t(actionid);
+    }
+
+    /// Position of the first outcome of the state-action
+    size_t sa_begin(size_t saindex) const { return action_offsets[saindex]; }
+
+    /// Position after the last outcome of the state-action
+    size_t sa_end(size_t saindex) const { return action_offsets[saindex + 1]; }
+
+    /// Number of outcomes of the state-action
+    size_t sa_size(size_t saindex) const { return sa_end(saindex) - sa_begin(saindex); }
+
+    /// Position of the first transition (over all outcomes) of the state
+    size_t state_begin(long stateid) const {
+        return outcome_offsets[action_offsets[state_offsets[stateid]]];
+    }
+
+    /// Position after the last transition (over all outcomes) of the state
+    size_t state_end(long stateid) const {
+        return outcome_offsets[action_offsets[state_offsets[stateid + 1]]];
+    }
+
+    /// Nominal distribution over the outcomes of the state-action as a new vector
+    numvec sa_distribution(size_t saindex) const {
+        return numvec(distribution.cbegin() + sa_begin(saindex),
+                      distribution.cbegin() + sa_end(saindex));
+    }
+
+    /// Nominal distribution over the outcomes of the state-action copied into the output
+    void sa_distribution(size_t saindex, numvec& dist) const {
+        dist.assign(distribution.cbegin() + sa_begin(saindex),
+                    distribution.cbegin() + sa_end(saindex));
+    }
+
+    /// Target states of all transitions
+    const FlatArray<Index>& get_indices() const { return indices; }
+
+    /// Probabilities of all transitions
+    const FlatArray<Real>& get_probabilities() const { return probabilities; }
+
+    /// Rewards of all transitions
+    const FlatArray<Real>& get_rewards() const { return rewards; }
+
+    /// Nominal probabilities of all outcomes
+    const FlatArray<Real>& get_distribution() const { return distribution; }
+
+    /// Offsets of states into the state-action pairs
+    const FlatArray<size_t>& get_state_offsets() const { return state_offsets; }
+
+    /// Offsets of state-action pairs into the outcomes
+    const FlatArray<size_t>& get_action_offsets() const { return action_offsets; }
+
+    /// Offsets of outcomes into the transitions
+    const FlatArray<size_t>& get_outcome_offsets() const { return outcome_offsets; }
+
+    /**
+     * Computes the value of a single outcome
+     *
+     * @param outcomeindex Global index of the outcome (not relative to the action)
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     */
+    prec_t outcome_value(size_t outcomeindex, const numvec& valuefunction,
+                         prec_t discount) const {
+        const size_t b = outcome_offsets[outcomeindex],
+                     e = outcome_offsets[outcomeindex + 1];
+        prec_t value = 0.0;
+#pragma omp simd reduction(+ : value)
+        for (size_t c = b; c < e; c++)
+            value += prec_t(probabilities[c]) *
+                     (prec_t(rewards[c]) + discount * valuefunction[indices[c]]);
+        return value;
+    }
+
+    /**
+     * Computes the value of each outcome of the state-action.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param zvalues Output, resized to sa_size(saindex)
+     */
+    void zvalues(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 numvec& zvalues) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        zvalues.resize(e - b);
+        for (size_t o = b; o < e; o++)
+            zvalues[o - b] = outcome_value(o, valuefunction, discount);
+    }
+
+    /**
+     * Computes the value of the state-action for a distribution over outcomes.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    prec_t value(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        prec_t result = 0.0;
+        for (size_t o = b; o < e; o++)
+            result +=
+                (outcomedist.empty() ? prec_t(distribution[o]) : outcomedist[o - b]) *
+                outcome_value(o, valuefunction, discount);
+        return result;
+    }
+
+    /**
+     * Mean reward of the state-action for a distribution over outcomes.
+     *
+     * @param saindex Index of the state-action pair
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    prec_t mean_reward(size_t saindex, const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        prec_t result = 0.0;
+        for (size_t o = b; o < e; o++) {
+            const prec_t weight = outcomedist.empty() ? distribution[o] : outcomedist[o - b];
+            result += weight * inner_product(probabilities.cbegin() + outcome_offsets[o],
+                                             probabilities.cbegin() + outcome_offsets[o + 1],
+                                             rewards.cbegin() + outcome_offsets[o], 0.0);
+        }
+        return result;
+    }
+
+    /**
+     * Constructs the mean transition probabilities of the state-action for the
+     * distribution over outcomes. Rewards are not included.
+     *
+     * @param saindex Index of the state-action pair
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    Transition transition(size_t saindex, const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        Transition result;
+        for (size_t o = b; o < e; o++) {
+            const prec_t weight = outcomedist.empty() ? distribution[o] : outcomedist[o - b];
+            // skip outcomes that cannot happen
+            if (weight <= 0) continue;
+            for (size_t c = outcome_offsets[o]; c < outcome_offsets[o + 1]; c++)
+                result.add_sample(indices[c], weight * probabilities[c], 0.0);
+        }
+        return result;
+    }
+};
+
+/// Compiled MDPO with double precision and 64-bit indices
+using CompiledMDPO = BasicCompiledMDPO<>;
+
+/// Compiled MDPO with single precision probabilities and rewards and 32-bit indices
+using CompiledMDPOf = BasicCompiledMDPO<float, int32_t>;
+
+// **************************************************************************************
+//  Shared-support MDPO
+// **************************************************************************************
+
+/**
+ * A flat representation of an MDPO in which all outcomes of a state-action share a
+ * single support: the union of the target states of its outcomes. This is the case
+ * for MDPOs built from posterior samples, in which each outcome is a sample of the
+ * transition probabilities to the same set of states.
+ *
+ * The support of each state-action is stored once, and the transition probabilities
+ * are stored as a dense row-major matrix with a row for each outcome and a column
+ * for each state in the support. The rewards are folded into the expected reward of
+ * each outcome. The z-values of all outcomes are then a single matrix-vector
+ * product:
+ * \f[ z = \bar{r} + \gamma P v_{\mathrm{support}}. \f]
+ *
+ * Compared to CompiledMDPO, this saves the index and reward of every transition,
+ * which reduces the memory by about 3x when the supports are shared. States that
+ * are missing from the support of an outcome are stored as zeros, so the layout is
+ * not efficient when the supports of the outcomes differ significantly.
+ *
+ * @see CompiledMDPO
+ */
+class SharedSupportMDPO {
+protected:
+    /// Position of the first state-action of each state (length: states + 1)
+    sizvec state_offsets;
+    /// Position of the first outcome of each state-action (length: state-actions + 1)
+    sizvec action_offsets;
+    /// Position of the support of each state-action (length: state-actions + 1)
+    sizvec support_offsets;
+    /// Position of the probability matrix of each state-action (length:
+    /// state-actions + 1)
+    sizvec matrix_offsets;
+    /// Target states of each state-action, sorted
+    indvec support;
+    /// Support-major matrices of transition probabilities (support x outcomes), so
+    /// that the probabilities of a target state in all outcomes are contiguous
+    numvec probabilities;
+    /// Expected reward of each outcome
+    numvec outcome_rewards;
+    /// Nominal probability of each outcome
+    numvec distribution;
+
+public:
+    /** Constructs an empty model with no states */
+    SharedSupportMDPO()
+        : state_offsets(1, 0), action_offsets(1, 0), support_offsets(1, 0),
+          matrix_offsets(1, 0) {}
+
+    /**
+     * Compiles the MDPO. The model is checked first and ModelError is thrown
+     * when it is not valid.
+     *
+     * @param mdpo The model to compile, it is not referenced after the
+     *            construction
+     */
+    explicit SharedSupportMDPO(const MDPO& mdpo) : SharedSupportMDPO() {
+        check_model(mdpo);
+
+        for (const StateO& s : mdpo) {
+            for (const ActionO& a : s.get_actions()) {
+                // the union of the supports of all outcomes
+                const size_t sb = support.size();
+                for (const Transition& t : a.get_outcomes())
+                    support.insert(support.end(), t.get_indices().cbegin(),
+                                   t.get_indices().cend());
+                sort(support.begin() + sb, support.end());
+                support.erase(unique(support.begin() + sb, support.end()), support.end());
+                const size_t k = support.size() - sb;
+
+                const size_t mb = probabilities.size();
+                probabilities.resize(mb + a.size() * k, 0.0);
+                for (size_t o = 0; o < a.size(); o++) {
+                    const Transition& t = a[o];
+                    const indvec& ind = t.get_indices();
+                    prec_t reward = 0.0;
+                    // both the outcome indices and the support are sorted
+                    size_t j = 0;
+                    for (size_t l = 0; l < t.size(); l++) {
+                        while (support[sb + j] != ind[l])
+                            j++;
+                        probabilities[mb + j * a.size() + o] = t.get_probabilities()[l];
+                        reward += t.get_probabilities()[l] * t.get_rewards()[l];
+                    }
+                    outcome_rewards.push_back(reward);
+                }
+                distribution.insert(distribution.end(), a.get_distribution().cbegin(),
+                                    a.get_distribution().cend());
+                action_offsets.push_back(outcome_rewards.size());
+                support_offsets.push_back(support.size());
+                matrix_offsets.push_back(probabilities.size());
+            }
+            state_offsets.push_back(action_offsets.size() - 1);
+        }
+    }
+
+    /// Number of states
+    size_t size() const { return state_offsets.size() - 1; }
+
+    /// Number of state-action pairs
+    size_t stateaction_count() const { return action_offsets.size() - 1; }
+
+    /// Number of outcomes over all state-actions
+    size_t outcome_count() const { return outcome_rewards.size(); }
+
+    /// Number of stored transition probabilities, including zeros
+    size_t matrix_size() const { return probabilities.size(); }
+
+    /// Number of actions in the state
+    size_t action_count(long stateid) const {
+        assert(stateid >= 0 && size_t(stateid) < size());
+        return state_offsets[stateid + 1] - state_offsets[stateid];
+    }
+
+    /// A state with no actions is terminal
+    bool is_terminal(long stateid) const { return action_count(stateid) == 0; }
+
+    /**
+     * Index of the state-action pair. Throws ModelError when the action is
+     * not valid.
+     */
+    size_t sa_index(long stateid, long actionid) const {
+        if (actionid < 0 || size_t(actionid) >= action_count(stateid))
+            throw ModelError("invalid actionid: " + std::to_string(actionid) +
+                                 " for action count: " +
+                                 std::to_string(action_count(stateid)),
+                             stateid, actionid);
+        return state_offsets[stateid] + size_t(actionid);
+    }
+
+    /// Position of the first outcome of the state-action
+    size_t sa_begin(size_t saindex) const { return action_offsets[saindex]; }
+
+    /// Position after the last outcome of the state-action
+    size_t sa_end(size_t saindex) const { return action_offsets[saindex + 1]; }
+
+    /// Number of outcomes of the state-action
+    size_t sa_size(size_t saindex) const { return sa_end(saindex) - sa_begin(saindex); }
+
+    /// Target states of the state-action as a new vector
+    indvec sa_support(size_t saindex) const {
+        return indvec(support.cbegin() + support_offsets[saindex],
+                      support.cbegin() + support_offsets[saindex + 1]);
+    }
+
+    /// Nominal distribution over the outcomes of the state-action as a new vector
+    numvec sa_distribution(size_t saindex) const {
+        return numvec(distribution.cbegin() + sa_begin(saindex),
+                      distribution.cbegin() + sa_end(saindex));
+    }
+
+    /// Nominal distribution over the outcomes of the state-action copied into the output
+    void sa_distribution(size_t saindex, numvec& dist) const {
+        dist.assign(distribution.cbegin() + sa_begin(saindex),
+                    distribution.cbegin() + sa_end(saindex));
+    }
+
+    /// Nominal probabilities of all outcomes
+    const numvec& get_distribution() const { return distribution; }
+
+    /**
+     * Computes the value of each outcome of the state-action as a single
+     * matrix-vector product.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param zvalues Output, resized to sa_size(saindex)
+     */
+    void zvalues(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 numvec& zvalues) const {
+        const size_t ob = sa_begin(saindex), m = sa_size(saindex);
+        const size_t sb = support_offsets[saindex],
+                     k = support_offsets[saindex + 1] - sb;
+
+        zvalues.assign(m, 0.0);
+        prec_t* const out = zvalues.data();
+        const prec_t* column = probabilities.data() + matrix_offsets[saindex];
+        for (size_t j = 0; j < k; j++, column += m) {
+            const prec_t value = valuefunction[support[sb + j]];
+#pragma omp simd
+            for (size_t o = 0; o < m; o++)
+                out[o] += column[o] * value;
+        }
+#pragma omp simd
+        for (size_t o = 0; o < m; o++)
+            out[o] = outcome_rewards[ob + o] + discount * out[o];
+    }
+
+    /**
+     * Computes the value of each outcome of the state-action, each with respect to
+     * its own value function. This is the kernel of the evaluation of a policy
+     * for all outcomes at once.
+     *
+     * The value functions are stored in a state-major matrix with one column per
+     * outcome: the value of state s for outcome o is values[s * sa_size(saindex) + o].
+     * The matrix is traversed one target state at a time and the loop over the
+     * outcomes, which reads both the probabilities and the values contiguously, is
+     * vectorized.
+     *
+     * @param saindex Index of the state-action pair
+     * @param values State-major matrix of value functions, one for each outcome
+     * @param discount Discount factor
+     * @param zvalues Output, resized to sa_size(saindex)
+     */
+    void zvalues_batch(size_t saindex, const numvec& values, prec_t discount,
+                       numvec& zvalues) const {
+        const size_t ob = sa_begin(saindex), m = sa_size(saindex);
+        const size_t sb = support_offsets[saindex],
+                     k = support_offsets[saindex + 1] - sb;
+        assert(values.size() % std::max(m, size_t(1)) == 0);
+
+        zvalues.assign(m, 0.0);
+        prec_t* const out = zvalues.data();
+        const prec_t* column = probabilities.data() + matrix_offsets[saindex];
+        for (size_t j = 0; j < k; j++, column += m) {
+            const prec_t* const row = values.data() + size_t(support[sb + j]) * m;
+#pragma omp simd
+            for (size_t o = 0; o < m; o++)
+                out[o] += column[o] * row[o];
+        }
+#pragma omp simd
+        for (size_t o = 0; o < m; o++)
+            out[o] = outcome_rewards[ob + o] + discount * out[o];
+    }
+
+    /**
+     * Computes the value of the state-action for a distribution over outcomes.
+     *
+     * @param saindex Index of the state-action pair
+     * @param valuefunction Value function over all states
+     * @param discount Discount factor
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    prec_t value(size_t saindex, const numvec& valuefunction, prec_t discount,
+                 const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        thread_local numvec z;
+        zvalues(saindex, valuefunction, discount, z);
+        prec_t result = 0.0;
+        for (size_t o = b; o < e; o++)
+            result += (outcomedist.empty() ? distribution[o] : outcomedist[o - b]) *
+                      z[o - b];
+        return result;
+    }
+
+    /**
+     * Mean reward of the state-action for a distribution over outcomes.
+     *
+     * @param saindex Index of the state-action pair
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    prec_t mean_reward(size_t saindex, const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        prec_t result = 0.0;
+        for (size_t o = b; o < e; o++)
+            result += (outcomedist.empty() ? distribution[o] : outcomedist[o - b]) *
+                      outcome_rewards[o];
+        return result;
+    }
+
+    /**
+     * Constructs the mean transition probabilities of the state-action for the
+     * distribution over outcomes. Rewards are not included.
+     *
+     * @param saindex Index of the state-action pair
+     * @param outcomedist Distribution over the outcomes, the nominal one
+     *                    when empty
+     */
+    Transition transition(size_t saindex, const numvec& outcomedist = numvec(0)) const {
+        const size_t b = sa_begin(saindex), e = sa_end(saindex);
+        assert(outcomedist.empty() || outcomedist.size() == e - b);
+        const size_t sb = support_offsets[saindex],
+                     k = support_offsets[saindex + 1] - sb;
+
+        const prec_t* const weights =
+            outcomedist.empty() ? distribution.data() + b : outcomedist.data();
+        const size_t m = e - b;
+        const prec_t* column = probabilities.data() + matrix_offsets[saindex];
+        Transition result;
+        for (size_t j = 0; j < k; j++, column += m) {
+            prec_t mean = 0.0;
+            for (size_t o = 0; o < m; o++)
+                mean += weights[o] * column[o];
+            result.add_sample(support[sb + j], mean, 0.0);
+        }
+        return result;
+    }
+
+    /**
+     * Computes the states that can be reached from each state in one step under
+     * any action and outcome. Each list is sorted and has no duplicates.
+     */
+    vector<indvec> successors() const {
+        vector<indvec> result(size());
+        for (size_t s = 0; s < size(); s++) {
+            indvec& succ = result[s];
+            succ.assign(support.cbegin() + support_offsets[state_offsets[s]],
+                        support.cbegin() + support_offsets[state_offsets[s + 1]]);
+            sort(succ.begin(), succ.end());
+            succ.erase(unique(succ.begin(), succ.end()), succ.end());
+        }
+        return result;
+    }
+};
+
+namespace internal {
+/// Successors of each state of a compiled model, see state_successors
+template <class Compiled>
+inline vector<indvec> compiled_successors(const Compiled& model) {
+    vector<indvec> successors(model.size());
+    const auto& indices = model.get_indices();
+    for (size_t s = 0; s < model.size(); s++) {
+        indvec& succ = successors[s];
+        succ.assign(indices.cbegin() + model.state_begin(s),
+                    indices.cbegin() + model.state_end(s));
+        sort(succ.begin(), succ.end());
+        succ.erase(unique(succ.begin(), succ.end()), succ.end());
+    }
+    return successors;
+}
+} // namespace internal
+
+/**
+ * Computes the states that can be reached from each state in one step under any
+ * action. Each list is sorted and has no duplicates.
+ */
+template <class Real, class Index>
+inline vector<indvec> state_successors(const BasicCompiledMDP<Real, Index>& mdp) {
+    return internal::compiled_successors(mdp);
+}
+
+/**
+ * Computes the states that can be reached from each state in one step under any
+ * action and outcome. Each list is sorted and has no duplicates.
+ */
+template <class Real, class Index>
+inline vector<indvec> state_successors(const BasicCompiledMDPO<Real, Index>& mdpo) {
+    return internal::compiled_successors(mdpo);
+}
+
+/**
+ * Computes the states that can be reached from each state in one step under any
+ * action and outcome. Each list is sorted and has no duplicates.
+ */
+inline vector<indvec> state_successors(const SharedSupportMDPO& mdpo) {
+    return mdpo.successors();
+}
+
+} // namespace craam
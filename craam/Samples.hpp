@@ -24,17 +24,26 @@
 #pragma once
 
 #include "craam/MDP.hpp"
+#include "craam/builder.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <rm/range.hpp>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace craam {
 
 /// A namespace for handling sampling and simulation
@@ -228,6 +237,223 @@ using DiscreteSamples = Samples<long, long>;
 /** Integral sample */
 using DiscreteSample = Sample<long, long>;
 
+/// Statistics of the occupancy and collisions of a FlatHashMap
+struct HashMapStats {
+    /// Number of keys
+    size_t size = 0;
+    /// Number of slots
+    size_t capacity = 0;
+    /// Fraction of the slots that are occupied
+    prec_t load_factor = 0;
+    /// Number of keys that are not stored in the slot of their hash (collisions)
+    size_t displaced = 0;
+    /// Mean number of slots probed to find a key
+    prec_t mean_probes = 0;
+    /// Maximal number of slots probed to find a key
+    size_t max_probes = 0;
+};
+
+/**
+Open-addressing hash map from keys to long values, such as the ids of states and
+actions. Keys are stored contiguously in the order of insertion, and the slots of
+the table store only the hash and the position of the key. Collisions are resolved
+by linear probing, and the table doubles when it becomes 3/4 full.
+
+The hash of a key can be computed once by hash and passed to find and emplace,
+which avoids hashing the same key repeatedly. Concurrent calls of const methods
+are safe.
+
+\tparam Key Type of the keys
+\tparam Hash Hash function for the keys
+\tparam KeyEqual Equality comparison of the keys
+*/
+template <typename Key, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    /** Constructs an empty map */
+    FlatHashMap(Hash hasher = Hash(), KeyEqual equal = KeyEqual())
+        : hasher(move(hasher)), equal(move(equal)), slots(min_capacity) {}
+
+    /** Number of keys */
+    size_t size() const { return keys.size(); }
+
+    /** Whether there are no keys */
+    bool empty() const { return keys.empty(); }
+
+    /** Computes the hash of the key as used by the map */
+    size_t hash(const Key& key) const {
+        // mixes the bits to avoid clustering of hash functions such as identity
+        uint64_t h = uint64_t(hasher(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return size_t(h);
+    }
+
+    /** Returns the value of the key, or nullptr if the key is not present */
+    const long* find(const Key& key, size_t keyhash) const {
+        const long index = find_index(key, keyhash);
+        return index < 0 ? nullptr : &values[index];
+    }
+
+    /** Returns the value of the key, or nullptr if the key is not present */
+    long* find(const Key& key, size_t keyhash) {
+        const long index = find_index(key, keyhash);
+        return index < 0 ? nullptr : &values[index];
+    }
+
+    /** Returns the value of the key, or nullptr if the key is not present */
+    const long* find(const Key& key) const { return find(key, hash(key)); }
+
+    /**
+     * Inserts the key with the value if it is not present.
+     *
+     * @param key Key to insert
+     * @param keyhash Hash of the key computed by hash
+     * @param value Value of the key if it is inserted
+     * @return Pointer to the value of the key, which is valid until the next
+     *         insertion, and whether the key was inserted
+     */
+    pair<long*, bool> emplace(const Key& key, size_t keyhash, long value) {
+        const long index = find_index(key, keyhash);
+        if (index >= 0) return {&values[index], false};
+        if (4 * (keys.size() + 1) > 3 * slots.size()) rehash(2 * slots.size());
+        const size_t mask = slots.size() - 1;
+        size_t slot = keyhash & mask;
+        while (slots[slot].index >= 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = {keyhash, long(keys.size())};
+        keys.push_back(key);
+        values.push_back(value);
+        return {&values.back(), true};
+    }
+
+    /** Inserts the key with the value if it is not present; see emplace */
+    pair<long*, bool> emplace(const Key& key, long value) {
+        return emplace(key, hash(key), value);
+    }
+
+    /** Computes the statistics of the occupancy and collisions of the table */
+    HashMapStats stats() const {
+        HashMapStats result;
+        result.size = keys.size();
+        result.capacity = slots.size();
+        result.load_factor = prec_t(keys.size()) / prec_t(slots.size());
+        const size_t mask = slots.size() - 1;
+        size_t total = 0;
+        for (size_t slot = 0; slot < slots.size(); ++slot) {
+            if (slots[slot].index < 0) continue;
+            const size_t probes = ((slot - slots[slot].hash) & mask) + 1;
+            total += probes;
+            result.max_probes = max(result.max_probes, probes);
+            if (probes > 1) ++result.displaced;
+        }
+        result.mean_probes = keys.empty() ? 0.0 : prec_t(total) / prec_t(keys.size());
+        return result;
+    }
+
+protected:
+    /// Slot of the table
+    struct Slot {
+        /// Hash of the key
+        size_t hash = 0;
+        /// Position of the key, or -1 if the slot is empty
+        long index = -1;
+    };
+
+    /// Initial number of slots, must be a power of 2
+    static constexpr size_t min_capacity = 16;
+
+    Hash hasher;
+    KeyEqual equal;
+    /// Table with a power of 2 slots
+    vector<Slot> slots;
+    /// Keys in the order of insertion
+    vector<Key> keys;
+    /// Values of the keys
+    vector<long> values;
+
+    /// Returns the position of the key, or -1 if it is not present
+    long find_index(const Key& key, size_t keyhash) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = keyhash & mask;; slot = (slot + 1) & mask) {
+            const Slot& sl = slots[slot];
+            if (sl.index < 0) return -1;
+            if (sl.hash == keyhash && equal(keys[sl.index], key)) return sl.index;
+        }
+    }
+
+    /// Resizes the table and reinserts the keys using the stored hashes
+    void rehash(size_t capacity) {
+        vector<Slot> newslots(capacity);
+        const size_t mask = capacity - 1;
+        for (const Slot& sl : slots) {
+            if (sl.index < 0) continue;
+            size_t slot = sl.hash & mask;
+            while (newslots[slot].index >= 0)
+                slot = (slot + 1) & mask;
+            newslots[slot] = sl;
+        }
+        slots = move(newslots);
+    }
+};
+
+namespace internal {
+
+/**
+ * Finds the keys at positions [first, last) that are not in the map. Each thread
+ * deduplicates the new keys in a contiguous block of positions, and the blocks are
+ * returned in the order of the positions. Concatenating the blocks therefore lists
+ * the first occurrence of every new key in the order of the positions, although a
+ * key may be repeated in several blocks.
+ *
+ * @param map Map of the existing keys, which is not modified
+ * @param first First position
+ * @param last Last position (exclusive)
+ * @param key_at Function that returns the key at a position
+ * @return For each block, the positions and hashes of the new keys
+ */
+template <typename Key, typename Hash, typename KeyEqual, typename KeyAt>
+vector<vector<pair<long, size_t>>>
+find_new_keys(const FlatHashMap<Key, Hash, KeyEqual>& map, long first, long last,
+              const KeyAt& key_at) {
+    long maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = omp_get_max_threads();
+#endif
+    vector<vector<pair<long, size_t>>> blocks(maxthreads);
+    bool openmp_error = false;
+#pragma omp parallel
+    {
+        long nthreads = 1, thread = 0;
+#ifdef _OPENMP
+        nthreads = omp_get_num_threads();
+        thread = omp_get_thread_num();
+#endif
+        try {
+            const long begin = first + (last - first) * thread / nthreads;
+            const long end = first + (last - first) * (thread + 1) / nthreads;
+            FlatHashMap<Key, Hash, KeyEqual> local;
+            vector<pair<long, size_t>>& block = blocks[thread];
+            for (long i = begin; i < end; ++i) {
+                const auto& key = key_at(i);
+                const size_t keyhash = map.hash(key);
+                if (map.find(key, keyhash) == nullptr &&
+                    local.emplace(key, keyhash, i).second)
+                    block.emplace_back(i, keyhash);
+            }
+        } catch (const exception& e) {
+            craam::internal::openmp_exception_handler(e, "find_new_keys");
+            openmp_error = true;
+        }
+    }
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+    return blocks;
+}
+
+} // namespace internal
+
 /**
 Turns arbitrary samples to discrete ones assuming that actions are
 \b state \b independent. That is the actions must have consistent names
@@ -269,57 +495,104 @@ public:
     SampleDiscretizerSI()
         : discretesamples(make_shared<DiscreteSamples>()), action_map(), state_map(){};
 
-    /** Adds samples to the discrete samples */
-    void add_samples(const Samples<State, Action>& samples) {
+    /**
+     * Adds samples to the discrete samples.
+     *
+     * The samples are processed in chunks. The states and actions that are new in
+     * a chunk are found and deduplicated in parallel, then only the unique new ones
+     * are assigned indexes sequentially in the order of their first occurrence in
+     * the samples (the state from, the action, and the state to), and finally the
+     * indexes of all samples in the chunk are looked up in parallel. The result does
+     * not depend on the number of threads or on the chunk size.
+     *
+     * @param samples Samples to add
+     * @param chunk_size Number of samples processed at once, which bounds the size
+     *                   of the temporary buffers
+     */
+    void add_samples(const Samples<State, Action>& samples, long chunk_size = 1 << 16) {
+        assert(chunk_size > 0);
 
         // initial states
         for (const State& ins : samples.get_initial()) {
             discretesamples->add_initial(add_state(ins));
         }
 
-        // samples
-        for (auto si : indices(samples)) {
-            const auto ds = samples.get_sample(si);
-            discretesamples->add_sample(add_state(ds.state_from()),
-                                        add_action(ds.action()), add_state(ds.state_to()),
-                                        ds.reward(), ds.weight(), ds.step(), ds.run());
+        const vector<State> &states_from = samples.get_states_from(),
+                            &states_to = samples.get_states_to();
+        const vector<Action>& actions = samples.get_actions();
+        const numvec &rewards = samples.get_rewards(), &weights = samples.get_weights();
+        const indvec &steps = samples.get_steps(), &runs = samples.get_runs();
+        const long n = long(samples.size());
+
+        // position 2i is the state from and 2i+1 the state to of the sample i
+        const auto state_at = [&](long k) -> const State& {
+            return k % 2 == 0 ? states_from[k / 2] : states_to[k / 2];
+        };
+        const auto action_at = [&](long i) -> const Action& { return actions[i]; };
+
+        indvec id_from, id_action, id_to;
+        for (long first = 0; first < n; first += chunk_size) {
+            const long last = min(n, first + chunk_size);
+
+            // 1. unique new states and actions of the chunk in parallel
+            const auto new_states =
+                internal::find_new_keys(state_map, 2 * first, 2 * last, state_at);
+            const auto new_actions =
+                internal::find_new_keys(action_map, first, last, action_at);
+
+            // 2. new states and actions are numbered in the order of the samples
+            for (const auto& block : new_states)
+                for (const auto& [k, keyhash] : block)
+                    state_map.emplace(state_at(k), keyhash, state_map.size());
+            for (const auto& block : new_actions)
+                for (const auto& [i, keyhash] : block)
+                    action_map.emplace(actions[i], keyhash, action_map.size());
+
+            // 3. indexes of the samples in parallel
+            const long m = last - first;
+            id_from.resize(m);
+            id_action.resize(m);
+            id_to.resize(m);
+#pragma omp parallel for schedule(static)
+            for (long j = 0; j < m; ++j) {
+                id_from[j] = *state_map.find(states_from[first + j]);
+                id_action[j] = *action_map.find(actions[first + j]);
+                id_to[j] = *state_map.find(states_to[first + j]);
+            }
+
+            // samples
+            for (long j = 0; j < m; ++j) {
+                const long i = first + j;
+                discretesamples->add_sample(id_from[j], id_action[j], id_to[j],
+                                            rewards[i], weights[i], steps[i], runs[i]);
+            }
         }
     }
 
     /** Returns a state index, and creates a new one if it does not exists */
     long add_state(const State& dstate) {
-        auto iter = state_map.find(dstate);
-        long index;
-        if (iter == state_map.end()) {
-            index = state_map.size();
-            state_map[dstate] = index;
-        } else {
-            index = iter->second;
-        }
-        return index;
+        return *state_map.emplace(dstate, state_map.size()).first;
     }
 
     /** Returns a action index, and creates a new one if it does not exists */
     long add_action(const Action& action) {
-        auto iter = action_map.find(action);
-        long index;
-        if (iter == action_map.end()) {
-            index = action_map.size();
-            action_map[action] = index;
-        } else {
-            index = iter->second;
-        }
-        return index;
+        return *action_map.emplace(action, action_map.size()).first;
     }
 
     /** Returns a shared pointer to the discrete samples */
     shared_ptr<DiscreteSamples> get_discrete() { return discretesamples; };
 
+    /** Statistics of the hash map of states */
+    HashMapStats state_map_stats() const { return state_map.stats(); }
+
+    /** Statistics of the hash map of actions */
+    HashMapStats action_map_stats() const { return action_map.stats(); }
+
 protected:
     shared_ptr<DiscreteSamples> discretesamples;
 
-    unordered_map<Action, long, AHash> action_map;
-    unordered_map<State, long, SHash> state_map;
+    FlatHashMap<Action, AHash> action_map;
+    FlatHashMap<State, SHash> state_map;
 };
 
 /**
@@ -362,63 +635,295 @@ public:
         : discretesamples(make_shared<DiscreteSamples>()), action_map(), action_count(),
           state_map(){};
 
-    /** Adds samples to the discrete samples */
-    void add_samples(const Samples<State, Action>& samples) {
+    /**
+     * Adds samples to the discrete samples.
+     *
+     * The samples are processed in chunks. The states and actions that are new in
+     * a chunk are found and deduplicated in parallel, then only the unique new ones
+     * are assigned indexes sequentially in the order of their first occurrence in
+     * the samples (the state from, the action, and the state to), and finally the
+     * indexes of all samples in the chunk are looked up in parallel. The result does
+     * not depend on the number of threads or on the chunk size.
+     *
+     * @param samples Samples to add
+     * @param chunk_size Number of samples processed at once, which bounds the size
+     *                   of the temporary buffers
+     */
+    void add_samples(const Samples<State, Action>& samples, long chunk_size = 1 << 16) {
+        assert(chunk_size > 0);
 
         // initial states
-        for (const auto& ins : samples.get_initial()) {
+        for (const State& ins : samples.get_initial()) {
             discretesamples->add_initial(add_state(ins));
         }
 
-        // transition samples
-        for (auto si : indices(samples)) {
+        const vector<State> &states_from = samples.get_states_from(),
+                            &states_to = samples.get_states_to();
+        const vector<Action>& actions = samples.get_actions();
+        const numvec &rewards = samples.get_rewards(), &weights = samples.get_weights();
+        const indvec &steps = samples.get_steps(), &runs = samples.get_runs();
+        const long n = long(samples.size());
 
-            const auto es = samples.get_sample(si);
+        // position 2i is the state from and 2i+1 the state to of the sample i
+        const auto state_at = [&](long k) -> const State& {
+            return k % 2 == 0 ? states_from[k / 2] : states_to[k / 2];
+        };
+        const auto action_at = [&](long i) {
+            return make_pair(states_from[i], actions[i]);
+        };
 
-            discretesamples->add_sample(
-                add_state(es.state_from()), add_action(es.state_from(), es.action()),
-                add_state(es.state_to()), es.reward(), es.weight(), es.step(), es.run());
+        indvec id_from, id_action, id_to;
+        for (long first = 0; first < n; first += chunk_size) {
+            const long last = min(n, first + chunk_size);
+
+            // 1. unique new states and actions of the chunk in parallel
+            const auto new_states =
+                internal::find_new_keys(state_map, 2 * first, 2 * last, state_at);
+            const auto new_actions =
+                internal::find_new_keys(action_map, first, last, action_at);
+
+            // 2. new states and actions are numbered in the order of the samples
+            for (const auto& block : new_states)
+                for (const auto& [k, keyhash] : block)
+                    state_map.emplace(state_at(k), keyhash, state_map.size());
+            for (const auto& block : new_actions)
+                for (const auto& [i, keyhash] : block)
+                    add_action(states_from[i], actions[i],
+                               state_map.hash(states_from[i]), keyhash);
+
+            // 3. indexes of the samples in parallel
+            const long m = last - first;
+            id_from.resize(m);
+            id_action.resize(m);
+            id_to.resize(m);
+#pragma omp parallel for schedule(static)
+            for (long j = 0; j < m; ++j) {
+                id_from[j] = *state_map.find(states_from[first + j]);
+                id_action[j] = *action_map.find(action_at(first + j));
+                id_to[j] = *state_map.find(states_to[first + j]);
+            }
+
+            // transition samples
+            for (long j = 0; j < m; ++j) {
+                const long i = first + j;
+                discretesamples->add_sample(id_from[j], id_action[j], id_to[j],
+                                            rewards[i], weights[i], steps[i], runs[i]);
+            }
         }
     }
 
     /** Returns a state index, and creates a new one if it does not exists */
     long add_state(const State& dstate) {
-        auto iter = state_map.find(dstate);
-        long index;
-        if (iter == state_map.end()) {
-            index = state_map.size();
-            state_map[dstate] = index;
-        } else {
-            index = iter->second;
-        }
-        return index;
+        return *state_map.emplace(dstate, state_map.size()).first;
     }
 
     /** Returns an action index, and creates a new one if it does not exists */
     long add_action(const State& dstate, const Action& action) {
-        auto da = make_pair(dstate, action);
-        auto iter = action_map.find(da);
-        long index;
-        if (iter == action_map.end()) {
-            index = (action_count[dstate]++);
-            action_map[da] = index;
-        } else {
-            index = iter->second;
-        }
-        return index;
+        return add_action(dstate, action, state_map.hash(dstate),
+                          action_map.hash(make_pair(dstate, action)));
     }
 
     /** Returns a shared pointer to the discrete samples */
     shared_ptr<DiscreteSamples> get_discrete() { return discretesamples; };
 
+    /** Statistics of the hash map of states */
+    HashMapStats state_map_stats() const { return state_map.stats(); }
+
+    /** Statistics of the hash map of state-action pairs */
+    HashMapStats action_map_stats() const { return action_map.stats(); }
+
 protected:
     shared_ptr<DiscreteSamples> discretesamples;
 
-    unordered_map<pair<State, Action>, long, SAHash> action_map;
+    FlatHashMap<pair<State, Action>, SAHash> action_map;
 
     /** keeps the number of actions for each state */
-    unordered_map<State, long, SHash> action_count;
-    unordered_map<State, long, SHash> state_map;
+    FlatHashMap<State, SHash> action_count;
+    FlatHashMap<State, SHash> state_map;
+
+    /// Returns an action index given the hashes of the state and the state-action
+    long add_action(const State& dstate, const Action& action, size_t statehash,
+                    size_t actionhash) {
+        const auto da = make_pair(dstate, action);
+        if (const long* index = action_map.find(da, actionhash)) return *index;
+        // the state and action maps use the same hash of states
+        long& count = *action_count.emplace(dstate, statehash, 0).first;
+        const long index = count++;
+        action_map.emplace(da, actionhash, index);
+        return index;
+    }
+};
+
+/**
+Aggregates continuous states to the closest representative state in the Euclidean
+distance. The representative states are the centers of the aggregate states, and
+the aggregation maps states of a continuous simulator to the states of a discrete
+one, such as when building an MDP with build_mdp or build_mdp_par.
+
+The representative states are indexed by a k-d tree. A query takes logarithmic
+time in the number of representative states when the dimension is small, instead
+of the linear time of an exhaustive search. When several representative states
+are equally close, the one with the smallest index is returned, just like by an
+exhaustive search.
+
+The index is immutable after construction and can be queried concurrently.
+*/
+class NearestStateAggregator {
+public:
+    /**
+     * Builds the index of representative states.
+     *
+     * @param representatives Representative states; all must have the same
+     *                        (positive) dimension
+     */
+    NearestStateAggregator(const numvecvec& representatives)
+        : dim(representatives.empty() ? 0 : representatives.front().size()) {
+        if (representatives.empty())
+            throw invalid_argument("There must be at least one representative state.");
+        if (dim == 0) throw invalid_argument("Representative states must be non-empty.");
+        for (const numvec& r : representatives)
+            if (r.size() != dim)
+                throw invalid_argument(
+                    "All representative states must have the same dimension.");
+
+        ids.resize(representatives.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+            ids[i] = long(i);
+        build_node(representatives, 0, ids.size());
+
+        // copy the points in the order of the tree to keep leaves contiguous
+        points.resize(ids.size() * dim);
+        for (size_t i = 0; i < ids.size(); ++i)
+            copy(representatives[ids[i]].cbegin(), representatives[ids[i]].cend(),
+                 points.begin() + i * dim);
+    }
+
+    /// Number of representative states
+    size_t size() const { return ids.size(); }
+
+    /// Dimension of the states
+    size_t dimension() const { return dim; }
+
+    /**
+     * Returns the index of the representative state closest to the point.
+     *
+     * @param point Pointer to the dimension() coordinates of the state
+     */
+    long closest(const prec_t* point) const {
+        prec_t bestdist = numeric_limits<prec_t>::infinity();
+        long bestid = -1;
+        search(0, point, bestdist, bestid);
+        return bestid;
+    }
+
+    /// Returns the index of the representative state closest to the state
+    long closest(const numvec& state) const {
+        if (state.size() != dim) throw invalid_argument("State dimension mismatch.");
+        return closest(state.data());
+    }
+
+    /// Returns the index of the representative state closest to the state
+    long operator()(const numvec& state) const { return closest(state); }
+
+    /**
+     * Returns the indexes of the representative states closest to each state.
+     * The states are processed in parallel.
+     */
+    indvec closest(const numvecvec& states) const {
+        for (const numvec& state : states)
+            if (state.size() != dim) throw invalid_argument("State dimension mismatch.");
+        indvec result(states.size());
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < long(states.size()); ++i)
+            result[i] = closest(states[i].data());
+        return result;
+    }
+
+protected:
+    /// Maximal number of states in a leaf of the tree
+    static constexpr size_t leaf_size = 8;
+
+    /// Node of the k-d tree
+    struct Node {
+        /// Range of the states of the node in ids and points
+        size_t begin, end;
+        /// Coordinate of the split, or -1 for a leaf
+        long split_dim;
+        /// Value of the split: left states are at most, right states at least this
+        prec_t split;
+        /// Index of the right child; the left child follows the node
+        size_t right;
+    };
+
+    /// Dimension of the states
+    size_t dim;
+    /// Nodes of the tree in preorder
+    vector<Node> nodes;
+    /// Original indexes of the states in the order of the tree
+    indvec ids;
+    /// Coordinates of the states in the order of the tree
+    numvec points;
+
+    /// Builds the subtree of the states ids[begin, end) and returns its index
+    size_t build_node(const numvecvec& representatives, size_t begin, size_t end) {
+        const size_t node = nodes.size();
+        nodes.push_back({begin, end, -1, 0.0, 0});
+        if (end - begin <= leaf_size) return node;
+
+        // split along the coordinate with the largest spread
+        long split_dim = -1;
+        prec_t spread = 0;
+        for (size_t d = 0; d < dim; ++d) {
+            prec_t lo = numeric_limits<prec_t>::infinity(), hi = -lo;
+            for (size_t i = begin; i < end; ++i) {
+                lo = min(lo, representatives[ids[i]][d]);
+                hi = max(hi, representatives[ids[i]][d]);
+            }
+            if (hi - lo > spread) {
+                spread = hi - lo;
+                split_dim = long(d);
+            }
+        }
+        // all states are identical
+        if (split_dim < 0) return node;
+
+        const size_t mid = begin + (end - begin) / 2;
+        nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end,
+                    [&](long i, long j) {
+                        return representatives[i][split_dim] <
+                               representatives[j][split_dim];
+                    });
+        nodes[node].split_dim = split_dim;
+        nodes[node].split = representatives[ids[mid]][split_dim];
+        build_node(representatives, begin, mid);
+        const size_t right = build_node(representatives, mid, end);
+        nodes[node].right = right;
+        return node;
+    }
+
+    /// Searches the subtree for a closer state than the best one
+    void search(size_t node, const prec_t* point, prec_t& bestdist, long& bestid) const {
+        const Node& n = nodes[node];
+        if (n.split_dim < 0) {
+            for (size_t i = n.begin; i < n.end; ++i) {
+                const prec_t* p = points.data() + i * dim;
+                prec_t dist = 0;
+                for (size_t d = 0; d < dim; ++d)
+                    dist += (point[d] - p[d]) * (point[d] - p[d]);
+                if (dist < bestdist || (dist == bestdist && ids[i] < bestid)) {
+                    bestdist = dist;
+                    bestid = ids[i];
+                }
+            }
+            return;
+        }
+        const prec_t diff = point[n.split_dim] - n.split;
+        const size_t near = diff <= 0 ? node + 1 : n.right,
+                     far = diff <= 0 ? n.right : node + 1;
+        search(near, point, bestdist, bestid);
+        // a tie may still have a smaller index
+        if (diff * diff <= bestdist) search(far, point, bestdist, bestid);
+    }
 };
 
 /**
@@ -515,76 +1020,73 @@ public:
      *        p &= (w_j/z(s,a)) 1\{ s = s_j, a = a_j, s' = s_j' \}\\
      *           r &= r_j \f}.
      *
+     *  Only the state-actions present in the samples are updated and normalized, so
+     *  the cost is proportional to the size of the sample set and of the updated
+     *  transitions, not of the whole MDP. The samples are grouped by their source
+     *  states, which are then updated in parallel.
+     *
      *   @param samples New sample set to add to transition probabilities and
      *                  rewards
      */
     void add_samples(const DiscreteSamples& samples) {
-        // copy the state and action counts to be
-        auto old_state_action_weights = state_action_weights;
-
-        // add transition samples
-        for (size_t si : indices(samples)) {
-
-            DiscreteSample s = samples.get_sample(si);
-
-            // -----------------
-            // Computes sample weights:
-            // the idea is to normalize new samples by the same
-            // value as the existing samples and then re-normalize
-            // this is linear complexity
-            // -----------------
-
-            // weight used to normalize old data
-            prec_t weight = 1.0; // this needs to be initialized to 1.0
-            // whether the sample weight has been initialized
-            bool weight_initialized = false;
-
-            // resize transition counts
-            // the actual values are updated later
-            if ((size_t)s.state_from() >= state_action_weights.size()) {
-                state_action_weights.resize(s.state_from() + 1);
-
-                // we know that the value will not be found in old data
-                weight_initialized = true;
-            }
-
-            // check if we have something for the action
-            numvec& actioncount = state_action_weights[s.state_from()];
-            if ((size_t)s.action() >= actioncount.size()) {
-                actioncount.resize(s.action() + 1);
-
-                // we know that the value will not be found in old data
-                weight_initialized = true;
-            }
-
-            // update the new count
-            assert(size_t(s.state_from()) < state_action_weights.size());
-            assert(size_t(s.action()) < state_action_weights[s.state_from()].size());
-
-            state_action_weights[s.state_from()][s.action()] += s.weight();
-
-            // get number of existing transitions
-            // this is only run when we do not know if we have any prior
-            // sample
-            if (!weight_initialized &&
-                (size_t(s.state_from()) < old_state_action_weights.size()) &&
-                (size_t(s.action()) < old_state_action_weights[s.state_from()].size())) {
-
-                size_t cnt = old_state_action_weights[s.state_from()][s.action()];
-
-                // adjust the weight of the new sample to be consistent
-                // with the previous normalization (use 1.0 if no previous action)
-                weight = 1.0 / prec_t(cnt);
+        const indvec &states_from = samples.get_states_from(),
+                     &actions = samples.get_actions(),
+                     &states_to = samples.get_states_to();
+        const numvec &rewards = samples.get_rewards(), &weights = samples.get_weights();
+
+        long maxfrom = -1, maxstate = -1;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (states_from[i] < 0 || actions[i] < 0 || states_to[i] < 0)
+                throw invalid_argument("Sample states and actions must be non-negative.");
+            maxfrom = max(maxfrom, states_from[i]);
+            maxstate = max(maxstate, max(states_from[i], states_to[i]));
+        }
+        // states are created before the parallel loop, which only touches their actions
+        if (maxstate >= 0) mdp->create_state(maxstate);
+        if (size_t(maxfrom + 1) > state_action_weights.size())
+            state_action_weights.resize(maxfrom + 1);
+
+        sizvec starts, order;
+        tie(starts, order) = craam::internal::group_by_state(states_from, maxfrom + 1);
+
+        bool openmp_error = false;
+        // samples of each state are added by a single thread
+#pragma omp parallel for schedule(dynamic, 64)
+        for (long s = 0; s <= maxfrom; ++s) {
+            if (starts[s] == starts[s + 1]) continue;
+            try {
+                numvec& actioncount = state_action_weights[s];
+                State& state = (*mdp)[s];
+                // weights before the batch, which normalized the existing transitions
+                const numvec old_actioncount = actioncount;
+                vector<bool> touched;
+
+                for (size_t j = starts[s]; j < starts[s + 1]; ++j) {
+                    const size_t i = order[j];
+                    const long a = actions[i];
+                    if (size_t(a) >= actioncount.size()) actioncount.resize(a + 1, 0.0);
+                    if (size_t(a) >= touched.size()) touched.resize(a + 1, false);
+                    actioncount[a] += weights[i];
+                    touched[a] = true;
+
+                    // adjust the weight of the new sample to be consistent
+                    // with the previous normalization (use 1.0 if no previous action)
+                    const prec_t weight = size_t(a) < old_actioncount.size() &&
+                                                  old_actioncount[a] > 0
+                                              ? 1.0 / old_actioncount[a]
+                                              : 1.0;
+                    state.create_action(a).add_sample(states_to[i], weight * weights[i],
+                                                      rewards[i]);
+                }
+                // normalize only the transition probabilities that changed
+                for (size_t a = 0; a < touched.size(); ++a)
+                    if (touched[a]) state[long(a)].normalize();
+            } catch (const exception& e) {
+                craam::internal::openmp_exception_handler(e, "SampledMDP::add_samples");
+                openmp_error = true;
             }
-            // ---------------------
-
-            // adds a transition
-            add_transition(*mdp, s.state_from(), s.action(), s.state_to(),
-                           weight * s.weight(), s.reward());
         }
-
-        //  Normalize the transition probabilities and rewards
-        mdp->normalize();
+        if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
 
         // set initial distribution (not normalized so it is updated correctly when
         // adding more samples
@@ -187,6 +187,16 @@ public:
         }
     }
 
+    /**
+     * Reserves the storage for the given number of target states. Adding sorted
+     * samples to distinct states after reserving their number does not reallocate.
+     */
+    void reserve(size_t count) {
+        indices.reserve(count);
+        probabilities.reserve(count);
+        rewards.reserve(count);
+    }
+
     /// Sums all probabilities
     prec_t sum_probabilities() const {
         return accumulate(probabilities.cbegin(), probabilities.cend(), 0.0);
@@ -273,6 +283,42 @@ public:
         return value(valuefunction, discount, probabilities);
     }
 
+    /**
+     * Computes values of the transition for several value functions at once.
+     *
+     * The value functions are stored in a state-major matrix: the value of state
+     * s in the k-th value function is values[s * width + k]. The values of all
+     * value functions for a target state are therefore contiguous, and the inner
+     * loop over the value functions is vectorized.
+     *
+     * When there are no target states, the result is nan.
+     *
+     * @param values State-major matrix of value functions
+     * @param width Number of value functions (columns of the matrix)
+     * @param discount Discount factor
+     * @param result Output, resized to width; result[k] is the value for the
+     *               k-th value function
+     */
+    void value_batch(const numvec& values, size_t width, prec_t discount,
+                     numvec& result) const {
+        assert(values.size() >= size_t(max_index() + 1) * width);
+
+        if (indices.empty()) {
+            result.assign(width, nan(""));
+            return;
+        }
+        result.assign(width, 0.0);
+        prec_t* const out = result.data();
+        for (size_t c = 0; c < size(); c++) {
+            const prec_t p = probabilities[c], pr = p * rewards[c],
+                         pd = p * discount;
+            const prec_t* const row = values.data() + size_t(indices[c]) * width;
+#pragma omp simd
+            for (size_t k = 0; k < width; k++)
+                out[k] += pr + pd * row[k];
+        }
+    }
+
     /**
      * Computes the mean return from this transition with custom transition
      * probabilities
@@ -0,0 +1,169 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "craam/definitions.hpp"
+
+#include <eigen3/Eigen/Dense>
+
+#include <cmath>
+#include <limits>
+
+namespace craam { namespace algorithms {
+
+using namespace std;
+
+/**
+ * Safeguarded Anderson acceleration (type II) of a fixed-point iteration
+ * x_{k+1} = F(x_k), where F is a contraction in the L-infinity norm, such as a
+ * (robust) Bellman operator, a Gauss-Seidel sweep, or the evaluation of a policy.
+ *
+ * Instead of the plain iterate F(x_k), the next iterate is the combination of the
+ * last depth + 1 values F(x_{k-j}) that minimizes the l2 norm of the linearized
+ * residual F(x) - x. Since the Bellman operators are not smooth, the accelerated
+ * iterate may be worse than the plain one. When the residual of an accelerated
+ * iterate is greater than contraction times the residual of the previous iterate,
+ * the iterate is rejected and the method restarts from the plain iterate of the
+ * previous one, which is guaranteed to decrease the residual that much. The
+ * method, therefore, converges for any contraction with the given coefficient.
+ *
+ * See: Walker, H. F., & Ni, P. (2011). Anderson acceleration for fixed-point
+ * iterations. SIAM Journal on Numerical Analysis, 49(4), 1715–1735.
+ */
+class AndersonAcceleration {
+protected:
+    /// Maximal number of differences used to compute the combination
+    size_t depth;
+    /// Contraction coefficient of the iteration (typically the discount factor)
+    prec_t contraction;
+    /// Differences of consecutive values of F (circular buffer)
+    numvecvec fdiffs;
+    /// Differences of consecutive residuals F(x) - x (circular buffer)
+    numvecvec gdiffs;
+    /// Number of valid differences in the buffers
+    size_t count = 0;
+    /// Position of the next difference in the buffers
+    size_t position = 0;
+    /// The last accepted iterate and its plain update
+    numvec last_x, last_f;
+    /// Residual of the last accepted iterate
+    prec_t last_residual = numeric_limits<prec_t>::infinity();
+    /// Whether there is an accepted iterate
+    bool has_last = false;
+    /// Whether the last iterate returned by step was accelerated
+    bool accelerated = false;
+    /// Number of rejected accelerated iterates
+    size_t rejections = 0;
+
+public:
+    /**
+     * @param depth Number of previous iterates to combine; 0 disables acceleration
+     * @param contraction Contraction coefficient of the iteration, used to reject
+     *                    accelerated iterates
+     */
+    AndersonAcceleration(size_t depth, prec_t contraction)
+        : depth(depth), contraction(contraction), fdiffs(depth), gdiffs(depth) {}
+
+    /// Forgets all previous iterates, such as when the iteration map changes
+    void reset() {
+        count = position = 0;
+        has_last = accelerated = false;
+        last_residual = numeric_limits<prec_t>::infinity();
+    }
+
+    /// Number of accelerated iterates that were rejected
+    size_t rejected() const { return rejections; }
+
+    /**
+     * Computes the next iterate.
+     *
+     * @param x The current iterate
+     * @param f The plain update F(x); it is replaced by the next iterate
+     * @param residual The L-infinity norm of F(x) - x
+     */
+    void step(const numvec& x, numvec& f, prec_t residual) {
+        if (depth == 0) return;
+        assert(x.size() == f.size());
+        const size_t n = x.size();
+
+        // safeguard: restart from the plain iterate of the last accepted one
+        if (accelerated && !(residual <= contraction * last_residual)) {
+            f = last_f;
+            count = position = 0;
+            has_last = accelerated = false;
+            ++rejections;
+            return;
+        }
+
+        if (has_last) {
+            numvec& fdiff = fdiffs[position];
+            numvec& gdiff = gdiffs[position];
+            fdiff.resize(n);
+            gdiff.resize(n);
+            for (size_t i = 0; i < n; i++) {
+                fdiff[i] = f[i] - last_f[i];
+                gdiff[i] = (f[i] - x[i]) - (last_f[i] - last_x[i]);
+            }
+            position = (position + 1) % depth;
+            count = std::min(count + 1, depth);
+        }
+        last_x = x;
+        last_f = f;
+        last_residual = residual;
+        has_last = true;
+        accelerated = false;
+        if (count == 0 || residual <= 0) return;
+
+        // least squares min_w || g - sum_j w_j gdiff_j || with g = F(x) - x,
+        // solved by the (regularized) normal equations
+        Eigen::MatrixXd gram(count, count);
+        Eigen::VectorXd rhs(count);
+        for (size_t j = 0; j < count; j++) {
+            for (size_t k = 0; k <= j; k++) {
+                prec_t dot = 0;
+                for (size_t i = 0; i < n; i++)
+                    dot += gdiffs[j][i] * gdiffs[k][i];
+                gram(j, k) = gram(k, j) = dot;
+            }
+            prec_t dot = 0;
+            for (size_t i = 0; i < n; i++)
+                dot += gdiffs[j][i] * (f[i] - x[i]);
+            rhs(j) = dot;
+        }
+        const prec_t regularization = 1e-10 * (gram.trace() / prec_t(count) + 1e-300);
+        gram.diagonal().array() += regularization;
+        const Eigen::VectorXd weights = gram.partialPivLu().solve(rhs);
+        if (!weights.allFinite()) return;
+
+        for (size_t j = 0; j < count; j++) {
+            const prec_t w = weights(j);
+            const numvec& fdiff = fdiffs[j];
+            for (size_t i = 0; i < n; i++)
+                f[i] -= w * fdiff[i];
+        }
+        accelerated = true;
+    }
+};
+
+}} // namespace craam::algorithms
@@ -0,0 +1,770 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "craam/CompiledMDP.hpp"
+#include "craam/Solution.hpp"
+#include "craam/algorithms/nature_declarations.hpp"
+
+#include <limits>
+
+namespace craam { namespace algorithms {
+
+// **************************************************************************
+// Bellman updates for compiled (flat) models
+// **************************************************************************
+
+/**
+ * A Bellman update class for solving regular MDPs in the compiled form. It
+ * computes the same updates as PlainBellman, but reads the transitions from
+ * contiguous arrays instead of chasing pointers through states and actions.
+ * It can be used with vi_gs, mpi_jac, and pi.
+ *
+ * The class does not own the model.
+ *
+ * @tparam Model CompiledMDP or another instance of BasicCompiledMDP
+ * @see PlainBellman
+ */
+template <class Model = CompiledMDP> class PlainBellmanCompiled {
+protected:
+    /// Compiled MDP definition
+    const Model& mdp;
+    /// Partial policy specification (action -1 is ignored and optimized)
+    const indvec initial_policy;
+
+public:
+    /// Deterministic policy: action index for each state
+    using policy_type = long;
+
+    /// Constructs the update with no constraints on the initial policy
+    PlainBellmanCompiled(const Model& mdp) : mdp(mdp), initial_policy(0) {}
+
+    /**
+     * A partial policy that can be used to fix some actions
+     *
+     * @param policy policy[s] = -1 means that the action should be optimized in
+     * the state policy of length 0 means that all actions will be optimized
+     */
+    PlainBellmanCompiled(const Model& mdp, indvec policy)
+        : mdp(mdp), initial_policy(move(policy)) {
+        if (!initial_policy.empty() && initial_policy.size() != mdp.size())
+            throw std::invalid_argument("Policy length must match the number of states.");
+    }
+
+    /// Number of MDP states
+    size_t state_count() const { return mdp.size(); }
+
+    /**
+     * Computes the Bellman update and returns the optimal action.
+     * @returns New value for the state and the policy
+     */
+    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
+                                            prec_t discount) const {
+        assert(stateid >= 0);
+        assert(initial_policy.empty() || stateid < long(initial_policy.size()));
+
+        if (initial_policy.empty() || initial_policy[stateid] < 0) { // optimizing
+            if (mdp.is_terminal(stateid)) return {0.0, -1};
+
+            const size_t first = mdp.sa_index(stateid, 0);
+            const size_t count = mdp.action_count(stateid);
+            prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+            long result = -1;
+            for (size_t a = 0; a < count; a++) {
+                const prec_t value = mdp.value(first + a, valuefunction, discount);
+                // ties are resolved in the same way as in value_max_state
+                if (value >= maxvalue) {
+                    maxvalue = value;
+                    result = long(a);
+                }
+            }
+            return {maxvalue, result};
+        } else { // fixed-action
+            return {compute_value(initial_policy[stateid], stateid, valuefunction,
+                                  discount),
+                    initial_policy[stateid]};
+        }
+    }
+
+    /**
+     *  Computes value function update using the current policy
+     * @returns New value for the state
+     */
+    prec_t compute_value(const policy_type& action, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdp.is_terminal(stateid)) return 0;
+        return mdp.value(mdp.sa_index(stateid, action), valuefunction, discount);
+    }
+
+    /** Returns the transition probabilities
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    Transition transition(long stateid, const policy_type& action) const {
+        assert(stateid >= 0 && size_t(stateid) < state_count());
+        if (mdp.is_terminal(stateid)) return Transition::empty_tran();
+        return mdp.transition(mdp.sa_index(stateid, action));
+    }
+
+    /** Returns the reward for the action
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    prec_t reward(long stateid, const policy_type& action) const {
+        if (mdp.is_terminal(stateid)) return 0;
+        return mdp.mean_reward(mdp.sa_index(stateid, action));
+    }
+};
+
+/**
+ * Robust Bellman update with an s,a-rectangular nature for MDPs in the compiled
+ * form. The update is the same as in SARobustBellman. It can be used with
+ * vi_gs, mpi_jac, pi, and also rppi.
+ *
+ * The class does not own the model and nature.
+ *
+ * @tparam Nature Type of the nature response, see SARobustBellman
+ * @tparam Model CompiledMDP or another instance of BasicCompiledMDP
+ * @see SARobustBellman
+ */
+template <class Nature = SANature, class Model = CompiledMDP>
+class SARobustBellmanCompiled {
+public:
+    /// the policy of the decision maker: action index
+    using dec_policy_type = long;
+    /// the policy of nature: distribution probability for the active action
+    using nat_policy_type = numvec;
+    /// action of the decision maker AND distribution of nature
+    using policy_type = pair<dec_policy_type, nat_policy_type>;
+
+protected:
+    /// Compiled MDP definition
+    const Model& mdp;
+    /// Reference to the function that is used to call the nature
+    const Nature& nature;
+    /// Partial policy specification for the decision maker (action -1 is ignored and optimized)
+    vector<dec_policy_type> decision_policy;
+    /// Initial policy specification for the decision maker (should be never changed)
+    const vector<dec_policy_type> initial_policy;
+
+    /// Computes the response of nature for the state and action in the workspace
+    prec_t nature_response(long stateid, long actionid, const numvec& valuefunction,
+                           prec_t discount, internal::NatureWorkspace& workspace) const {
+        const size_t saindex = mdp.sa_index(stateid, actionid);
+        mdp.zvalues(saindex, valuefunction, discount, workspace.zvalues);
+        mdp.sa_probabilities(saindex, workspace.nominal);
+        return algorithms::nature_response(nature, stateid, actionid, workspace.nominal,
+                                           workspace.zvalues, workspace.distribution);
+    }
+
+    /**
+     * Computes the Bellman update for the state. The response of nature is left in
+     * workspace.best_distribution and is empty when there is no action.
+     *
+     * @returns New value for the state and the action of the decision maker
+     */
+    pair<prec_t, long> best_response(long stateid, const numvec& valuefunction,
+                                     prec_t discount,
+                                     internal::NatureWorkspace& workspace) const {
+        if (mdp.is_terminal(stateid)) {
+            workspace.best_distribution.clear();
+            return {0.0, -1};
+        }
+        if (decision_policy.empty() || decision_policy[stateid] < 0) {
+            prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+            long actionid = -1;
+            // buffers reused for all actions
+            for (size_t a = 0; a < mdp.action_count(stateid); a++) {
+                prec_t value =
+                    nature_response(stateid, long(a), valuefunction, discount, workspace);
+                // ties are resolved in the same way as in value_max_state
+                if (value > maxvalue) {
+                    maxvalue = value;
+                    actionid = long(a);
+                    swap(workspace.best_distribution, workspace.distribution);
+                }
+            }
+            if (actionid < 0) workspace.best_distribution.clear();
+            return {maxvalue, actionid};
+        } else {
+            const long actionid = decision_policy[stateid];
+            prec_t newvalue =
+                nature_response(stateid, actionid, valuefunction, discount, workspace);
+            swap(workspace.best_distribution, workspace.distribution);
+            return {newvalue, actionid};
+        }
+    }
+
+public:
+    /**
+     * Constructs the object from a policy and a specification of nature. Action are
+     * optimized only in states in which policy is -1 (or < 0)
+     * @param policy Index of the action to take for each state
+     * @param nature Function that describes nature's response
+     */
+    SARobustBellmanCompiled(const Model& mdp, const Nature& nature,
+                            vector<dec_policy_type> policy = indvec(0))
+        : mdp(mdp), nature(nature), decision_policy(move(policy)),
+          initial_policy(decision_policy) {
+
+        if (!initial_policy.empty() && initial_policy.size() != mdp.size())
+            throw std::invalid_argument("Policy length must match the number of states.");
+    }
+
+    /// Number of MDP states
+    size_t state_count() const { return mdp.size(); }
+
+    /**
+     * Computes the Bellman update and the best response of the decision maker
+     * and nature.
+     *
+     * @returns New value for the state and the policy
+     */
+    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
+                                            prec_t discount) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            const auto [newvalue, actionid] =
+                best_response(stateid, valuefunction, discount, workspace);
+            return {newvalue, {actionid, workspace.best_distribution}};
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Computes the Bellman update like policy_update above, but stores the
+     * action and the response of nature in a preallocated flat policy instead of
+     * returning them.
+     *
+     * @returns New value for the state
+     */
+    prec_t policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                         FlatSARobustPolicy& policy) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            const auto [newvalue, actionid] =
+                best_response(stateid, valuefunction, discount, workspace);
+            policy.set(stateid, actionid, workspace.best_distribution);
+            return newvalue;
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Maximal length of nature's response in each state; used to preallocate a
+     * FlatSARobustPolicy.
+     */
+    sizvec nature_capacities() const {
+        sizvec result(mdp.size(), 0);
+        for (size_t s = 0; s < mdp.size(); s++) {
+            for (size_t a = 0; a < mdp.action_count(s); a++)
+                result[s] = max(result[s], mdp.sa_size(mdp.sa_index(s, a)));
+        }
+        return result;
+    }
+
+    /**
+     * Computes value function using the provided policy. Used in policy evaluation.
+     * @returns New value for the state
+     */
+    prec_t compute_value(const policy_type& action, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdp.is_terminal(stateid)) return 0;
+        return mdp.value(mdp.sa_index(stateid, action.first), valuefunction, discount,
+                         action.second);
+    }
+
+    /**
+     * Computes value function using the policy stored in a flat policy. Used in
+     * policy evaluation.
+     * @returns New value for the state
+     */
+    prec_t compute_value(const FlatSARobustPolicy& policy, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdp.is_terminal(stateid)) return 0;
+        numvec& distribution = internal::nature_workspace().distribution;
+        policy.nature(stateid, distribution);
+        return mdp.value(mdp.sa_index(stateid, policy.action(stateid)), valuefunction,
+                         discount, distribution);
+    }
+
+    /** Returns the transition probabilities chosen by nature
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    Transition transition(long stateid, const policy_type& action) const {
+        assert(stateid >= 0 && size_t(stateid) < state_count());
+        if (mdp.is_terminal(stateid)) return Transition::empty_tran();
+        if (action.second.empty())
+            throw invalid_argument("Nature unexpectedly computed an empty policy.");
+        return mdp.transition(mdp.sa_index(stateid, action.first), action.second);
+    }
+
+    /** Returns the reward for the action
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    prec_t reward(long stateid, const policy_type& action) const {
+        if (mdp.is_terminal(stateid)) return 0;
+        if (action.second.empty())
+            throw invalid_argument("Nature unexpectedly computed an empty policy.");
+        return mdp.mean_reward(mdp.sa_index(stateid, action.first), action.second);
+    }
+
+    /**
+     * Sets the policy that will be used by the update. The value -1 for a state
+     * means that the action will be optimized.
+     *
+     * If the length is 0, then the decision maker's policy is replaced by the initial
+     * policy (or an equivalent).
+     */
+    void set_decision_policy(
+        const vector<dec_policy_type>& policy = vector<dec_policy_type>(0)) {
+        if (policy.empty()) {
+            if (initial_policy.empty()) {
+                fill(decision_policy.begin(), decision_policy.end(), -1);
+            } else {
+                decision_policy = initial_policy;
+            }
+        } else {
+            assert(policy.size() == mdp.size());
+            decision_policy = policy;
+        }
+    }
+};
+
+/**
+ * Robust Bellman update with an s,a-rectangular nature over outcomes for MDPOs
+ * in the compiled form. The update is the same as in SARobustOutcomeBellman.
+ * It can be used with vi_gs, mpi_jac, pi, and also rppi.
+ *
+ * The class does not own the model. Nature is copied.
+ *
+ * @tparam Nature Type of the nature response, see SARobustBellman
+ * @tparam Model CompiledMDPO, another instance of BasicCompiledMDPO, or
+ *         SharedSupportMDPO
+ * @see SARobustOutcomeBellman
+ */
+template <class Nature = SANature, class Model = CompiledMDPO>
+class SARobustOutcomeBellmanCompiled {
+public:
+    /// the policy of the decision maker
+    using dec_policy_type = long;
+    /// the policy of nature: distribution over outcomes
+    using nat_policy_type = numvec;
+    /// action of the decision maker AND distribution of nature
+    using policy_type = pair<dec_policy_type, nat_policy_type>;
+
+protected:
+    /// Compiled MDPO definition
+    const Model& mdpo;
+    /// How to combine the values from a robust solution
+    Nature nature;
+    /// Partial policy specification (action -1 is ignored and optimized)
+    vector<dec_policy_type> decision_policy;
+    /// Initial policy specification for the decision maker (should be never changed)
+    const vector<dec_policy_type> initial_policy;
+
+    /// Computes the response of nature for the state and action in the workspace
+    prec_t nature_response(long stateid, long actionid, const numvec& valuefunction,
+                           prec_t discount, internal::NatureWorkspace& workspace) const {
+        const size_t saindex = mdpo.sa_index(stateid, actionid);
+        mdpo.zvalues(saindex, valuefunction, discount, workspace.zvalues);
+        mdpo.sa_distribution(saindex, workspace.nominal);
+        return algorithms::nature_response(nature, stateid, actionid, workspace.nominal,
+                                           workspace.zvalues, workspace.distribution);
+    }
+
+    /**
+     * Computes the Bellman update for the state. The response of nature is left in
+     * workspace.best_distribution and is empty when there is no action.
+     *
+     * @returns New value for the state and the action of the decision maker
+     */
+    pair<prec_t, long> best_response(long stateid, const numvec& valuefunction,
+                                     prec_t discount,
+                                     internal::NatureWorkspace& workspace) const {
+        if (mdpo.is_terminal(stateid)) {
+            workspace.best_distribution.clear();
+            return {0.0, -1};
+        }
+        if (decision_policy.empty() || decision_policy[stateid] < 0) {
+            prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+            long actionid = -1;
+            // buffers reused for all actions
+            for (size_t a = 0; a < mdpo.action_count(stateid); a++) {
+                prec_t value =
+                    nature_response(stateid, long(a), valuefunction, discount, workspace);
+                if (value > maxvalue) {
+                    maxvalue = value;
+                    actionid = long(a);
+                    swap(workspace.best_distribution, workspace.distribution);
+                }
+            }
+            if (actionid < 0) workspace.best_distribution.clear();
+            return {maxvalue, actionid};
+        } else {
+            const long actionid = decision_policy[stateid];
+            prec_t newvalue =
+                nature_response(stateid, actionid, valuefunction, discount, workspace);
+            swap(workspace.best_distribution, workspace.distribution);
+            return {newvalue, actionid};
+        }
+    }
+
+public:
+    /**
+     * @param mdpo Compiled MDPO definition. Does not take ownership
+     * @param nature Natures response function to outcomes. Uses the mean
+     *              value by default.
+     * @param initial_policy Fix policy for some states. Negative value
+     *         means that the action is not provided and should be optimized
+     */
+    SARobustOutcomeBellmanCompiled(const Model& mdpo,
+                                   const Nature& nature = nats::average(),
+                                   indvec initial_policy = indvec(0))
+        : mdpo(mdpo), nature(nature), decision_policy(move(initial_policy)),
+          initial_policy(decision_policy) {
+
+        if (!this->initial_policy.empty() && this->initial_policy.size() != mdpo.size())
+            throw std::invalid_argument("Policy length must match the number of states.");
+    }
+
+    /// Number of states in the MDPO
+    size_t state_count() const { return mdpo.size(); }
+
+    /**
+     * Computes the Bellman update and the best response of the decision maker
+     * and nature.
+     *
+     * @returns New value for the state and the policy
+     */
+    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
+                                            prec_t discount) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            const auto [newvalue, actionid] =
+                best_response(stateid, valuefunction, discount, workspace);
+            return {newvalue, {actionid, workspace.best_distribution}};
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Computes the Bellman update like policy_update above, but stores the
+     * action and the response of nature in a preallocated flat policy instead of
+     * returning them.
+     *
+     * @returns New value for the state
+     */
+    prec_t policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                         FlatSARobustPolicy& policy) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            const auto [newvalue, actionid] =
+                best_response(stateid, valuefunction, discount, workspace);
+            policy.set(stateid, actionid, workspace.best_distribution);
+            return newvalue;
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Maximal length of nature's response in each state; used to preallocate a
+     * FlatSARobustPolicy.
+     */
+    sizvec nature_capacities() const {
+        sizvec result(mdpo.size(), 0);
+        for (size_t s = 0; s < mdpo.size(); s++) {
+            for (size_t a = 0; a < mdpo.action_count(s); a++)
+                result[s] = max(result[s], mdpo.sa_size(mdpo.sa_index(s, a)));
+        }
+        return result;
+    }
+
+    /** Computes the Bellman update for a given policy.
+            The function is called for the particular state. */
+    prec_t compute_value(const policy_type& action, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdpo.is_terminal(stateid)) return 0;
+        return mdpo.value(mdpo.sa_index(stateid, action.first), valuefunction, discount,
+                          action.second);
+    }
+
+    /**
+     * Computes value function using the policy stored in a flat policy. Used in
+     * policy evaluation.
+     * @returns New value for the state
+     */
+    prec_t compute_value(const FlatSARobustPolicy& policy, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdpo.is_terminal(stateid)) return 0;
+        numvec& distribution = internal::nature_workspace().distribution;
+        policy.nature(stateid, distribution);
+        return mdpo.value(mdpo.sa_index(stateid, policy.action(stateid)), valuefunction,
+                         discount, distribution);
+    }
+
+    /** Returns the mean transition probabilities for nature's distribution
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    Transition transition(long stateid, const policy_type& action) const {
+        assert(stateid >= 0 && size_t(stateid) < state_count());
+        if (mdpo.is_terminal(stateid)) return Transition::empty_tran();
+        return mdpo.transition(mdpo.sa_index(stateid, action.first), action.second);
+    }
+
+    /** Returns the reward for the action
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    prec_t reward(long stateid, const policy_type& action) const {
+        if (mdpo.is_terminal(stateid)) return 0;
+        return mdpo.mean_reward(mdpo.sa_index(stateid, action.first), action.second);
+    }
+
+    /**
+     * Sets the policy that will be used by the update. The value -1 for a state
+     * means that the action will be optimized.
+     *
+     * If the length is 0, then the decision maker's policy is replaced by the initial
+     * policy (or an equivalent).
+     */
+    void set_decision_policy(
+        const vector<dec_policy_type>& policy = vector<dec_policy_type>(0)) {
+        if (policy.empty()) {
+            if (initial_policy.empty()) {
+                fill(decision_policy.begin(), decision_policy.end(), -1);
+            } else {
+                decision_policy = initial_policy;
+            }
+        } else {
+            assert(policy.size() == mdpo.size());
+            decision_policy = policy;
+        }
+    }
+};
+
+/**
+ * Robust Bellman update with an s-rectangular nature over outcomes for MDPOs in
+ * the compiled form. The update is the same as in SRobustOutcomeBellman: the
+ * z-values of all actions of the state are computed from the compiled arrays
+ * and passed to nature at once. It can be used with vi_gs, mpi_jac, pi, and also
+ * rppi.
+ *
+ * The class checks that, for each state, all actions have the same number of
+ * outcomes and the same nominal distributions over them.
+ *
+ * The class does not own the model and nature.
+ *
+ * @tparam Model CompiledMDPO, another instance of BasicCompiledMDPO, or
+ *         SharedSupportMDPO
+ * @see SRobustOutcomeBellman
+ */
+template <class Model = CompiledMDPO> class SRobustOutcomeBellmanCompiled {
+public:
+    /// action type of the decision maker
+    using dec_policy_type = numvec;
+    /// the policy of nature (this is the distribution over outcomes)
+    using nat_policy_type = numvec;
+    /// distribution the decision maker, distribution of nature
+    using policy_type = pair<dec_policy_type, nat_policy_type>;
+
+protected:
+    /// Compiled MDPO definition
+    const Model& mdpo;
+    /// Reference to the function that is used to call the nature
+    const SNatureOutcome& nature;
+    /// Partial policy specification for the decision maker (empty is optimized)
+    vector<dec_policy_type> decision_policy;
+    /// Initial policy specification for the decision maker (should be never changed)
+    const vector<dec_policy_type> initial_policy;
+
+public:
+    /**
+     * @param mdpo Compiled MDPO definition. Does not take ownership
+     * @param nature Function that computes the nature's response
+     * @param policy Fixed randomized policy for a subset of all states.
+     *               If empty or omitted then all states are optimized.
+     *               An empty vector for a specific state means that the
+     *               action will be optimized for that state.
+     */
+    SRobustOutcomeBellmanCompiled(const Model& mdpo, const SNatureOutcome& nature,
+                                  vector<dec_policy_type> policy = vector<dec_policy_type>(0))
+        : mdpo(mdpo), nature(nature), decision_policy(move(policy)),
+          initial_policy(decision_policy) {
+
+        if (!initial_policy.empty() && initial_policy.size() != mdpo.size())
+            throw std::invalid_argument("Policy length must match the number of states.");
+
+        // check that the outcomes and their weights are the same for all actions in one state
+        numvec dst0, dst; // buffers reused for all states
+        for (size_t idstate = 0; idstate < mdpo.size(); ++idstate) {
+            if (mdpo.is_terminal(idstate)) continue;
+            mdpo.sa_distribution(mdpo.sa_index(idstate, 0), dst0);
+            for (size_t idaction = 1; idaction < mdpo.action_count(idstate); ++idaction) {
+                mdpo.sa_distribution(mdpo.sa_index(idstate, idaction), dst);
+                if (dst.size() != dst0.size())
+                    throw ModelError("Number of outcomes must match across all actions in "
+                                     "a single states",
+                                     idstate, idaction);
+                for (size_t idoutcome = 0; idoutcome < dst.size(); ++idoutcome) {
+                    if (std::abs(dst0[idoutcome] - dst[idoutcome]) > EPSILON)
+                        throw ModelError("Distribution of outcomes must match across all "
+                                         "actions in a single state",
+                                         idstate, idaction, idoutcome);
+                }
+            }
+        }
+    }
+
+    /// Number of MDP states
+    size_t state_count() const { return mdpo.size(); }
+
+    /**
+     * Computes the Bellman update and the best response of the decision maker
+     * and nature.
+     *
+     * @returns New value for the state and the policy
+     */
+    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
+                                            prec_t discount) const {
+        if (mdpo.is_terminal(stateid)) return {0, {numvec(0), numvec(0)}};
+
+        const size_t first = mdpo.sa_index(stateid, 0);
+        const size_t count = mdpo.action_count(stateid);
+        numvecvec zvalues(count);
+        for (size_t a = 0; a < count; a++)
+            mdpo.zvalues(first + a, valuefunction, discount, zvalues[a]);
+
+        const numvec init_policy =
+            decision_policy.empty() ? numvec(0) : decision_policy[stateid];
+        numvec& nominal = internal::nature_workspace().nominal;
+        mdpo.sa_distribution(first, nominal);
+        numvec action, transitions;
+        prec_t newvalue;
+        {
+            CRAAM_TRACE_NATURE();
+            std::tie(action, transitions, newvalue) =
+                nature(stateid, init_policy, nominal, zvalues);
+        }
+
+        assert(!isinf(newvalue));
+        assert(action.size() == count);
+        return {newvalue, make_pair(move(action), move(transitions))};
+    }
+
+    /**
+     * Computes value function using the provided policy. Used in policy evaluation.
+     * @returns New value for the state
+     */
+    prec_t compute_value(const policy_type& action, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        if (mdpo.is_terminal(stateid)) return 0;
+        assert(action.first.size() == mdpo.action_count(stateid));
+        const size_t first = mdpo.sa_index(stateid, 0);
+        prec_t result = 0.0;
+        for (size_t a = 0; a < action.first.size(); a++) {
+            // skip actions that are not taken
+            if (action.first[a] <= 0) continue;
+            result += action.first[a] *
+                      mdpo.value(first + a, valuefunction, discount, action.second);
+        }
+        return result;
+    }
+
+    /** Returns the mean transition probabilities for the policy and nature
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    Transition transition(long stateid, const policy_type& action) const {
+        assert(stateid >= 0 && size_t(stateid) < state_count());
+        if (mdpo.is_terminal(stateid)) return Transition::empty_tran();
+        assert(action.first.size() == mdpo.action_count(stateid));
+        const size_t first = mdpo.sa_index(stateid, 0);
+        Transition result;
+        for (size_t a = 0; a < action.first.size(); a++) {
+            if (action.first[a] > EPSILON)
+                result.probabilities_add(action.first[a],
+                                         mdpo.transition(first + a, action.second));
+        }
+        return result;
+    }
+
+    /** Returns the reward for the policy and nature
+     *
+     * @param stateid State for which to get the transition probabilites
+     * @param action Which action is taken
+     */
+    prec_t reward(long stateid, const policy_type& action) const {
+        if (mdpo.is_terminal(stateid)) return 0;
+        assert(action.first.size() == mdpo.action_count(stateid));
+        const size_t first = mdpo.sa_index(stateid, 0);
+        prec_t result = 0.0;
+        for (size_t a = 0; a < action.first.size(); a++) {
+            if (action.first[a] > EPSILON)
+                result += action.first[a] * mdpo.mean_reward(first + a, action.second);
+        }
+        return result;
+    }
+
+    /**
+     * Sets the policy that will be used by the update. An empty distribution
+     * for a state means that the action will be optimized.
+     *
+     * If the length is 0, then the decision maker's policy is replaced by the initial
+     * policy (or an equivalent).
+     */
+    void set_decision_policy(
+        const vector<dec_policy_type>& policy = vector<dec_policy_type>(0)) {
+        if (policy.empty()) {
+            if (initial_policy.empty()) {
+                fill(decision_policy.begin(), decision_policy.end(), numvec(0));
+            } else {
+                decision_policy = initial_policy;
+            }
+        } else {
+            assert(policy.size() == mdpo.size());
+            decision_policy = policy;
+        }
+    }
+};
+
+}} // namespace craam::algorithms
@@ -0,0 +1,172 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/**
+ * Transition graphs of the models: the successors and the predecessors of the
+ * states and the strongly connected components. The graphs are used by the
+ * variants of value iteration that do not update all states in every sweep.
+ */
+#pragma once
+
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/definitions.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+/**
+ * Computes the states that can be reached from each state in one step under any
+ * action. Each list is sorted and has no duplicates.
+ */
+inline vector<indvec> state_successors(const MDP& mdp) {
+    vector<indvec> successors(mdp.size());
+    for (size_t s = 0; s < mdp.size(); s++) {
+        indvec& succ = successors[s];
+        for (const Action& a : mdp[s].get_actions())
+            succ.insert(succ.end(), a.get_indices().cbegin(), a.get_indices().cend());
+        sort(succ.begin(), succ.end());
+        succ.erase(unique(succ.begin(), succ.end()), succ.end());
+    }
+    return successors;
+}
+
+/**
+ * Computes the states that can be reached from each state in one step under any
+ * action and outcome. Each list is sorted and has no duplicates.
+ */
+inline vector<indvec> state_successors(const MDPO& mdpo) {
+    vector<indvec> successors(mdpo.size());
+    for (size_t s = 0; s < mdpo.size(); s++) {
+        indvec& succ = successors[s];
+        for (const ActionO& a : mdpo[s].get_actions())
+            for (const Transition& t : a.get_outcomes())
+                succ.insert(succ.end(), t.get_indices().cbegin(),
+                            t.get_indices().cend());
+        sort(succ.begin(), succ.end());
+        succ.erase(unique(succ.begin(), succ.end()), succ.end());
+    }
+    return successors;
+}
+
+/**
+ * Reverses the transition graph: computes the states that can transition to each
+ * state. The lists are sorted when the successor lists have no duplicates.
+ *
+ * @param successors Successors of each state, see state_successors
+ */
+inline vector<indvec> state_predecessors(const vector<indvec>& successors) {
+    // count first to allocate each list only once
+    sizvec counts(successors.size(), 0);
+    for (const indvec& succ : successors)
+        for (long t : succ)
+            counts[t]++;
+
+    vector<indvec> predecessors(successors.size());
+    for (size_t s = 0; s < successors.size(); s++)
+        predecessors[s].reserve(counts[s]);
+    for (size_t s = 0; s < successors.size(); s++)
+        for (long t : successors[s])
+            predecessors[t].push_back(long(s));
+    return predecessors;
+}
+
+/**
+ * Computes the strongly connected components of the transition graph using
+ * Tarjan's algorithm. The implementation is not recursive and can be used with
+ * long chains of states.
+ *
+ * The components are numbered in a reverse topological order: a transition from
+ * a state in component c always leads to a state in a component c' <= c. Solving
+ * the components from 0 upwards thus only needs the values of already solved
+ * components.
+ *
+ * @param successors Successors of each state, see state_successors
+ * @return Index of the component for each state
+ */
+inline indvec state_components(const vector<indvec>& successors) {
+    const long nstates = long(successors.size());
+
+    indvec component(nstates, -1);
+    indvec index(nstates, -1); // order of discovery, -1 when not visited
+    indvec lowlink(nstates);
+    vector<bool> onstack(nstates, false);
+    indvec stack; // states of the components that are not finished
+
+    // replaces the recursion: the state and the position of the next successor
+    vector<pair<long, size_t>> frames;
+
+    long nextindex = 0, nextcomponent = 0;
+    for (long root = 0; root < nstates; root++) {
+        if (index[root] >= 0) continue;
+
+        index[root] = lowlink[root] = nextindex++;
+        stack.push_back(root);
+        onstack[root] = true;
+        frames.emplace_back(root, 0);
+
+        while (!frames.empty()) {
+            const long v = frames.back().first;
+            const size_t pos = frames.back().second;
+
+            if (pos < successors[v].size()) {
+                frames.back().second++;
+                const long w = successors[v][pos];
+                if (index[w] < 0) {
+                    index[w] = lowlink[w] = nextindex++;
+                    stack.push_back(w);
+                    onstack[w] = true;
+                    frames.emplace_back(w, 0);
+                } else if (onstack[w]) {
+                    lowlink[v] = min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+
+            // all successors have been visited, v may be the root of a component
+            if (lowlink[v] == index[v]) {
+                long w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onstack[w] = false;
+                    component[w] = nextcomponent;
+                } while (w != v);
+                nextcomponent++;
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                const long u = frames.back().first;
+                lowlink[u] = min(lowlink[u], lowlink[v]);
+            }
+        }
+    }
+    return component;
+}
+
+} // namespace craam
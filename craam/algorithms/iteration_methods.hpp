@@ -24,10 +24,18 @@
 #pragma once
 
 #include "craam/Solution.hpp"
+#include "craam/algorithms/anderson.hpp"
+#include "craam/algorithms/graph.hpp"
 #include "craam/algorithms/matrices.hpp"
+#include "craam/algorithms/tracing.hpp"
 #include "craam/definitions.hpp"
 
 #include <chrono>
+#include <queue>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace craam { namespace algorithms {
 
@@ -42,6 +50,36 @@ namespace craam { namespace algorithms {
 using progress_t = std::function<bool(size_t, prec_t, const std::string&,
                                       const std::string&, const std::string&)>;
 
+/**
+ * Stopping rule of the policy and modified policy iteration methods and whether
+ * they use bounds on the optimal value function to eliminate actions.
+ *
+ * The span rules use the MacQueen bounds: when m and M are the smallest and the
+ * largest element of d = T v - v, then T v + g m <= v* <= T v + g M with
+ * g = discount / (1 - discount). The iteration stops when the half-span (M - m) / 2
+ * is below the target residual; this often happens much sooner than for the sup
+ * norm because shifting v by a constant does not change the span. The bounds
+ * require a discount smaller than 1 and transition probabilities that sum to 1 in
+ * every state (terminal states should be modeled as absorbing states).
+ *
+ * Value iteration methods (vi_gs) always use the sup norm, since the bounds for
+ * Gauss-Seidel sweeps depend on the state ordering.
+ *
+ * The solvers (mpi_jac, pi, rppi) cannot check that the response has no terminal
+ * states; the callers must ensure it, such as with check_no_terminal as done by
+ * the wrappers in solvers.hpp.
+ */
+enum class ValueBounds {
+    /// Stop when the sup norm of the Bellman residual is small
+    none,
+    /// Stop when the span seminorm of the Bellman residual is small
+    span,
+    /// Like span, but also permanently eliminate actions whose value is below the
+    /// lower bound on the optimal value; needs a response with eliminated_count,
+    /// the solvers throw invalid_argument for other responses
+    eliminate
+};
+
 namespace internal {
 /// An empty progress function, always returns true
 inline bool empty_progress(size_t, prec_t, const std::string&, const std::string&,
@@ -49,6 +87,222 @@ inline bool empty_progress(size_t, prec_t, const std::string&, const std::string
     return true;
 }
 
+/// Detects Bellman updates that can store their policy in a FlatSARobustPolicy
+template <class ResponseType, class = void> struct has_flat_policy : std::false_type {};
+
+template <class ResponseType>
+struct has_flat_policy<ResponseType,
+                       std::void_t<decltype(declval<const ResponseType&>()
+                                                .nature_capacities())>>
+    : std::true_type {};
+
+/// Detects Bellman updates that can eliminate actions given a threshold on their value
+template <class ResponseType, class = void>
+struct has_action_elimination : std::false_type {};
+
+template <class ResponseType>
+struct has_action_elimination<ResponseType,
+                              std::void_t<decltype(declval<const ResponseType&>()
+                                                       .eliminated_count())>>
+    : std::true_type {};
+
+/// Checks that the response supports the rule and throws invalid_argument if not
+template <class ResponseType> inline void check_value_bounds(ValueBounds bounds) {
+    if (bounds == ValueBounds::eliminate && !has_action_elimination<ResponseType>::value)
+        throw invalid_argument("ValueBounds::eliminate needs a response that supports "
+                               "action elimination.");
+}
+
+/// Computes the Bellman update of the response and passes it the elimination
+/// threshold if it supports it
+template <class ResponseType>
+inline pair<prec_t, typename ResponseType::policy_type>
+policy_update(const ResponseType& response, long stateid, const numvec& valuefunction,
+              prec_t discount, prec_t threshold) {
+    if constexpr (has_action_elimination<ResponseType>::value)
+        return response.policy_update(stateid, valuefunction, discount, threshold);
+    else
+        return response.policy_update(stateid, valuefunction, discount);
+}
+
+/**
+ * Policy computed by the iteration methods for each state. It stores the policy as a
+ * vector of policy_type, one for each state. The policy of responses that implement
+ * nature_capacities is stored in a preallocated FlatSARobustPolicy instead and it is
+ * converted to the vector only when the solution is constructed.
+ *
+ * Policies of different states can be updated concurrently.
+ */
+template <class ResponseType, bool Flat = has_flat_policy<ResponseType>::value>
+class PolicyStore {
+public:
+    using policy_type = typename ResponseType::policy_type;
+
+    PolicyStore(const ResponseType& response) : policy(response.state_count()) {}
+
+    /// Updates the policy in the state and returns the new value of the state.
+    /// Actions with a value below the threshold are eliminated, see BoundsTracker.
+    prec_t update(const ResponseType& response, long stateid,
+                  const numvec& valuefunction, prec_t discount,
+                  prec_t threshold = -numeric_limits<prec_t>::infinity()) {
+        prec_t newvalue;
+        tie(newvalue, policy[stateid]) =
+            policy_update(response, stateid, valuefunction, discount, threshold);
+        return newvalue;
+    }
+
+    /// Computes the value of the state for the stored policy
+    prec_t evaluate(const ResponseType& response, long stateid,
+                    const numvec& valuefunction, prec_t discount) const {
+        return response.compute_value(policy[stateid], stateid, valuefunction, discount);
+    }
+
+    /// Policy of the decision maker in the state
+    auto decision(long stateid) const { return policy[stateid].first; }
+
+    /// Returns the policy for the solution
+    vector<policy_type> release() { return move(policy); }
+
+protected:
+    vector<policy_type> policy;
+};
+
+/// Policy stored in a flat array, see PolicyStore
+template <class ResponseType> class PolicyStore<ResponseType, true> {
+public:
+    using policy_type = typename ResponseType::policy_type;
+
+    PolicyStore(const ResponseType& response) : policy(response.nature_capacities()) {}
+
+    /// Updates the policy in the state and returns the new value of the state.
+    /// Actions with a value below the threshold are eliminated, see BoundsTracker.
+    prec_t update(const ResponseType& response, long stateid,
+                  const numvec& valuefunction, prec_t discount,
+                  prec_t threshold = -numeric_limits<prec_t>::infinity()) {
+        if constexpr (has_action_elimination<ResponseType>::value)
+            return response.policy_update(stateid, valuefunction, discount, policy,
+                                          threshold);
+        else
+            return response.policy_update(stateid, valuefunction, discount, policy);
+    }
+
+    /// Computes the value of the state for the stored policy
+    prec_t evaluate(const ResponseType& response, long stateid,
+                    const numvec& valuefunction, prec_t discount) const {
+        return response.compute_value(policy, stateid, valuefunction, discount);
+    }
+
+    /// Policy of the decision maker in the state
+    long decision(long stateid) const { return policy.action(stateid); }
+
+    /// Returns the policy for the solution
+    vector<policy_type> release() { return policy.to_policy(); }
+
+protected:
+    FlatSARobustPolicy policy;
+};
+
+/**
+ * Computes the residual of the Bellman updates according to the stopping rule and
+ * maintains the MacQueen bounds on the optimal value function, see ValueBounds.
+ *
+ * The bounds are used to eliminate actions as follows. Let U >= v* be the upper
+ * bound and v the value function used in the next update. Then v* <= v + c with
+ * c = max(U - v) and, because the Bellman operator is monotone and
+ * T(v + c) = T(v) + discount * c, the value q(s,a) of any action computed from v
+ * satisfies q*(s,a) <= q(s,a) + discount * c. An action with
+ * q(s,a) + discount * c < L(s) <= v*(s) cannot be optimal. The same argument
+ * applies to the robust Bellman operators with s,a-rectangular ambiguity.
+ */
+class BoundsTracker {
+protected:
+    /// Stopping rule
+    ValueBounds rule;
+    /// Discount factor
+    prec_t discount;
+    /// The smallest and the largest difference between the updated and the previous
+    /// value function in the last update
+    prec_t dmin = 0, dmax = 0;
+    /// Lower and upper bounds on the optimal value function; only with elimination
+    numvec lower, upper;
+
+public:
+    BoundsTracker(ValueBounds rule, prec_t discount) : rule(rule), discount(discount) {
+        if (rule != ValueBounds::none && !(discount < 1))
+            throw invalid_argument("Value bounds require a discount factor smaller "
+                                   "than 1.");
+    }
+
+    /**
+     * Computes the shift of the value function used to compute the elimination
+     * thresholds in the next update. It is infinite when no action can be eliminated.
+     */
+    prec_t elimination_shift(const numvec& valuefunction) const {
+        if (rule != ValueBounds::eliminate || upper.empty())
+            return numeric_limits<prec_t>::infinity();
+        assert(upper.size() == valuefunction.size());
+        prec_t shift = -numeric_limits<prec_t>::infinity();
+        for (size_t s = 0; s < upper.size(); s++)
+            shift = std::max(shift, upper[s] - valuefunction[s]);
+        return discount * shift;
+    }
+
+    /// Value of actions in the state below which they cannot be optimal
+    prec_t threshold(long stateid, prec_t shift) const {
+        if (isinf(shift)) return -numeric_limits<prec_t>::infinity();
+        const prec_t bound = lower[stateid];
+        // a small margin prevents the elimination of optimal actions due to rounding
+        return bound - shift - 1e-10 * std::max(prec_t(1), abs(bound));
+    }
+
+    /**
+     * Computes the residual from the differences between the updated and the
+     * previous value function and tightens the bounds.
+     *
+     * @param differences Updated minus the previous value function for all states
+     * @param updated The updated value function
+     *
+     * @return Sup norm or the half-span of the differences
+     */
+    prec_t residual(const numvec& differences, const numvec& updated) {
+        assert(differences.size() == updated.size());
+        if (differences.empty()) return 0;
+        const auto [minit, maxit] =
+            minmax_element(differences.cbegin(), differences.cend());
+        dmin = *minit;
+        dmax = *maxit;
+        if (rule == ValueBounds::none) return sup();
+
+        if (rule == ValueBounds::eliminate) {
+            const prec_t factor = discount / (1 - discount);
+            if (lower.empty()) {
+                lower.assign(updated.size(), -numeric_limits<prec_t>::infinity());
+                upper.assign(updated.size(), numeric_limits<prec_t>::infinity());
+            }
+            for (size_t s = 0; s < updated.size(); s++) {
+                lower[s] = std::max(lower[s], updated[s] + factor * dmin);
+                upper[s] = std::min(upper[s], updated[s] + factor * dmax);
+            }
+        }
+        return (dmax - dmin) / 2;
+    }
+
+    /// Sup norm of the differences in the last update
+    prec_t sup() const { return std::max(abs(dmin), abs(dmax)); }
+
+    /**
+     * Shifts the updated value function to the midpoint of the bounds, which is
+     * within discount / (1 - discount) times the half-span of the optimal value
+     * function. Does nothing with the sup norm rule.
+     */
+    void center(numvec& updated) const {
+        if (rule == ValueBounds::none) return;
+        const prec_t shift = discount / (1 - discount) * (dmin + dmax) / 2;
+        for (prec_t& v : updated)
+            v += shift;
+    }
+};
+
 } // namespace internal
 
 /**
@@ -74,6 +328,8 @@ inline bool empty_progress(size_t, prec_t, const std::string&, const std::string
  * @param maxresidual Stop when the maximal residual falls below this value.
  * @param progress An optional function for reporting progress and can
  *                 return false to stop computation
+ * @param anderson Number of previous sweeps combined by Anderson acceleration,
+ *                 see AndersonAcceleration; 0 disables the acceleration
  *
  * @returns Solution that can be used to compute the total return, or the optimal
  * policy.
@@ -82,7 +338,7 @@ template <class ResponseType>
 inline Solution<typename ResponseType::policy_type>
 vi_gs(const ResponseType& response, prec_t discount, numvec valuefunction = numvec(0),
       unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-      const progress_t& progress = internal::empty_progress) {
+      const progress_t& progress = internal::empty_progress, size_t anderson = 0) {
     using policy_type = typename ResponseType::policy_type;
 
     // just quit if there are no states
@@ -93,34 +349,580 @@ vi_gs(const ResponseType& response, prec_t discount, numvec valuefunction = numv
 
     if (valuefunction.empty()) { valuefunction.resize(response.state_count(), 0.0); }
 
-    vector<policy_type> policy(response.state_count());
+    internal::PolicyStore<ResponseType> policy(response);
 
     // initialize values
     prec_t residual = numeric_limits<prec_t>::infinity();
     size_t i; // iterations defined outside to make them reportable
 
+    // the sweep is a contraction with the coefficient equal to the discount
+    AndersonAcceleration accelerator(anderson, discount);
+    numvec previous; // value function before the sweep, only used with acceleration
+
+    CRAAM_TRACE_SOLVER(tracer, "vi_gs");
     for (i = 0;
          i < iterations && residual > maxresidual && progress(i, residual, "vi", "", "");
          i++) {
         residual = 0;
+        if (anderson > 0) previous = valuefunction;
 
+        CRAAM_TRACE_BEGIN(tracer, update);
         for (size_t s = 0l; s < response.state_count(); s++) {
-            prec_t newvalue;
-            tie(newvalue, policy[s]) =
-                response.policy_update(long(s), valuefunction, discount);
+            CRAAM_TRACE_STATE(tracer);
+            const prec_t newvalue =
+                policy.update(response, long(s), valuefunction, discount);
 
             residual = max(residual, abs(valuefunction[s] - newvalue));
             valuefunction[s] = newvalue;
         }
+        // keep the plain sweep when it is the last one
+        if (anderson > 0 && residual > maxresidual && i + 1 < iterations)
+            accelerator.step(previous, valuefunction, residual);
+        CRAAM_TRACE_END(tracer, update);
+        CRAAM_TRACE_NEXT(tracer, residual);
     }
 
     auto finish = chrono::steady_clock::now();
     chrono::duration<double> duration = finish - start;
     int status = residual <= maxresidual ? 0 : 1;
-    return Solution<policy_type>(move(valuefunction), move(policy), residual, i + 1,
+    return Solution<policy_type>(move(valuefunction), policy.release(), residual, i + 1,
                                  duration.count(), status);
 }
 
+/**
+ * Asynchronous (chaotic relaxation) parallel variant of Gauss-Seidel value iteration.
+ * See solve_vi for a simplified interface.
+ *
+ * The states are split into contiguous blocks, one per thread. Each thread runs
+ * Gauss-Seidel sweeps over its own block without waiting for the other threads. The
+ * values are shared through the value function using relaxed atomic reads and writes;
+ * before every sweep, each thread refreshes only the values of the successors of its
+ * states that belong to other blocks, and it publishes the values of its block as soon
+ * as they are computed. As with vi_gs, the
+ * states should be ordered in the temporal order to get the fastest convergence.
+ *
+ * A thread stops when the residual of its block drops below maxresidual or after
+ * sweeps_check sweeps. Since the values of the other blocks may have been stale, the
+ * residual is then verified by a synchronous (Jacobi) Bellman update of the full
+ * value function, which also computes the returned policy. The reported residual is
+ * always the Bellman residual of this synchronous update.
+ *
+ * The response must support concurrent calls of policy_update for different states,
+ * just like in mpi_jac.
+ *
+ * @tparam ResponseType Class responsible for computing the Bellman updates. Should
+ * be compatible with PlainBellman
+ *
+ * @param response Using PolicyResponce allows to specify a partial policy. Only
+ * the actions that not provided by the partial policy are included in the
+ * optimization. Using a class of a different types enables computing other
+ * objectives, such as robust or risk averse ones.
+ * @param successors States that can be reached from each state under any action
+ * (and outcome), see state_successors.
+ * @param discount Discount factor.
+ * @param valuefunction Initial value function. Passed by value, because it is
+ * modified. Optional, use all zeros when not provided. Ignored when size is 0.
+ * @param iterations Maximal number of synchronous residual checks
+ * @param maxresidual Stop when the maximal residual falls below this value.
+ * @param progress An optional function for reporting progress and can
+ *                 return false to stop computation
+ * @param sweeps_check Maximal number of asynchronous sweeps of each thread between
+ *                     two synchronous residual checks
+ *
+ * @returns Solution that can be used to compute the total return, or the optimal
+ * policy.
+ */
+template <class ResponseType>
+inline Solution<typename ResponseType::policy_type>
+vi_gs_async(const ResponseType& response, const vector<indvec>& successors,
+            prec_t discount, numvec valuefunction = numvec(0),
+            unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+            const progress_t& progress = internal::empty_progress,
+            unsigned long sweeps_check = 8) {
+    using policy_type = typename ResponseType::policy_type;
+
+    const long nstates = long(response.state_count());
+
+    // just quit if there are no states
+    if (nstates == 0) return Solution<policy_type>(0, 0);
+
+    if (successors.size() != size_t(nstates))
+        throw invalid_argument("The number of successor lists must match the number "
+                               "of states.");
+
+    // time the computation
+    auto start = chrono::steady_clock::now();
+
+    if (valuefunction.empty()) { valuefunction.resize(nstates, 0.0); }
+
+    vector<policy_type> policy(nstates);
+    numvec targetvalue(nstates);   // values of the synchronous update
+    numvec residuals(nstates);
+
+    // private view of the value function of each thread, which is kept between the
+    // iterations; only the values of the block of the thread and of the successors
+    // of its states in the other blocks are read by its updates
+    struct ThreadView {
+        long first = 0, last = -1;
+        numvec values;
+        indvec external;
+    };
+    long maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = omp_get_max_threads();
+#endif
+    vector<ThreadView> views(maxthreads);
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    size_t i; // iterations defined outside to make them reportable
+
+    for (i = 0; i < iterations && residual > maxresidual &&
+                progress(i, residual, "vi_async", "", "");
+         i++) {
+
+        // 1. asynchronous Gauss-Seidel sweeps over the blocks of states
+        bool openmp_error = false;
+#pragma omp parallel
+        {
+            long nthreads = 1, thread = 0;
+#ifdef _OPENMP
+            nthreads = omp_get_num_threads();
+            thread = omp_get_thread_num();
+#endif
+            // the block of states that is updated by this thread
+            const long first = nstates * thread / nthreads;
+            const long last = nstates * (thread + 1) / nthreads;
+
+            try {
+                ThreadView& view = views[thread];
+                if (view.first != first || view.last != last) {
+                    view.first = first;
+                    view.last = last;
+                    view.values.assign(nstates, 0.0);
+                    view.external.clear();
+                    for (long s = first; s < last; s++)
+                        for (long t : successors[s])
+                            if (t < first || t >= last) view.external.push_back(t);
+                    sort(view.external.begin(), view.external.end());
+                    view.external.erase(
+                        unique(view.external.begin(), view.external.end()),
+                        view.external.end());
+                }
+                // only this thread writes the values of its block
+                numvec& localvalue = view.values;
+                for (long s = first; s < last; s++) {
+#pragma omp atomic read
+                    localvalue[s] = valuefunction[s];
+                }
+
+                for (unsigned long k = 0; k < sweeps_check; k++) {
+                    // refresh the values published by the other threads
+                    for (long t : view.external) {
+#pragma omp atomic read
+                        localvalue[t] = valuefunction[t];
+                    }
+
+                    prec_t block_residual = 0;
+                    for (long s = first; s < last; s++) {
+                        const prec_t newvalue =
+                            response.policy_update(s, localvalue, discount).first;
+                        block_residual =
+                            max(block_residual, abs(localvalue[s] - newvalue));
+                        localvalue[s] = newvalue;
+#pragma omp atomic write
+                        valuefunction[s] = newvalue;
+                    }
+                    if (block_residual <= maxresidual) break;
+                }
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "vi_gs_async_1");
+                    openmp_error = true;
+                }
+            }
+        }
+        // just terminate if there is an error
+        if (openmp_error)
+            throw runtime_error("Failed with an exception in OPENMP block.");
+
+        // 2. synchronous Bellman update to verify the residual
+#pragma omp parallel for
+        for (long s = 0; s < nstates; s++) {
+            try {
+                prec_t newvalue;
+                tie(newvalue, policy[s]) =
+                    response.policy_update(s, valuefunction, discount);
+                residuals[s] = abs(valuefunction[s] - newvalue);
+                targetvalue[s] = newvalue;
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "vi_gs_async_2");
+                    openmp_error = true;
+                }
+            }
+        }
+        // just terminate if there is an error
+        if (openmp_error)
+            throw runtime_error("Failed with an exception in OPENMP block.");
+
+        residual = *max_element(residuals.cbegin(), residuals.cend());
+        // this just swaps pointers
+        swap(valuefunction, targetvalue);
+    }
+
+    auto finish = chrono::steady_clock::now();
+    chrono::duration<double> duration = finish - start;
+    int status = residual <= maxresidual ? 0 : 1;
+    return Solution<policy_type>(move(valuefunction), move(policy), residual, i,
+                                 duration.count(), status);
+}
+
+/**
+ * Prioritized sweeping: value iteration that updates the states in the order of
+ * their Bellman residuals and only revisits the predecessors of the states whose
+ * values changed. See solve_vi for a simplified interface.
+ *
+ * The method keeps an upper bound on the Bellman residual of each state. When the
+ * value of a state changes by delta, the bound of each of its predecessors increases
+ * by discount * |delta|. The Bellman update of a predecessor is only recomputed when
+ * its bound exceeds maxresidual; the state is then queued with its exact residual as
+ * the priority. The states with the largest residuals are updated first.
+ *
+ * Each round starts and ends with a synchronous (Jacobi) Bellman update of all
+ * states that computes their exact residuals, so the reported residual is the
+ * Bellman residual of the returned value function and the policy is greedy with
+ * respect to it. The method relies on the Bellman operator being a discount-
+ * contraction in the L-infinity norm, which holds for all the responses in
+ * the library.
+ *
+ * @tparam ResponseType Class responsible for computing the Bellman updates. Should
+ * be compatible with PlainBellman
+ *
+ * @param response Using PolicyResponce allows to specify a partial policy. Only
+ * the actions that not provided by the partial policy are included in the
+ * optimization. Using a class of a different types enables computing other
+ * objectives, such as robust or risk averse ones.
+ * @param predecessors States that can transition to each state under any
+ * action (and outcome), see state_predecessors.
+ * @param discount Discount factor.
+ * @param valuefunction Initial value function. Passed by value, because it is
+ * modified. Optional, use all zeros when not provided. Ignored when size is 0.
+ * @param iterations Maximal number of Bellman updates divided by the number of
+ * states (that is, the number of equivalent sweeps of vi_gs)
+ * @param maxresidual Stop when the maximal residual falls below this value.
+ * @param progress An optional function for reporting progress and can
+ *                 return false to stop computation
+ *
+ * @returns Solution that can be used to compute the total return, or the optimal
+ * policy. The number of iterations is the number of equivalent sweeps.
+ */
+template <class ResponseType>
+inline Solution<typename ResponseType::policy_type>
+vi_prioritized(const ResponseType& response, const vector<indvec>& predecessors,
+               prec_t discount, numvec valuefunction = numvec(0),
+               unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+               const progress_t& progress = internal::empty_progress) {
+    using policy_type = typename ResponseType::policy_type;
+
+    const long nstates = long(response.state_count());
+
+    // just quit if there are no states
+    if (nstates == 0) return Solution<policy_type>(0, 0);
+
+    if (predecessors.size() != size_t(nstates))
+        throw invalid_argument("The number of predecessor lists must match the number "
+                               "of states.");
+
+    // time the computation
+    auto start = chrono::steady_clock::now();
+
+    if (valuefunction.empty()) { valuefunction.resize(nstates, 0.0); }
+
+    vector<policy_type> policy(nstates);
+    // value after the Bellman update, valid whenever bound > maxresidual
+    numvec newvalues(nstates);
+    // upper bound on the Bellman residual of each state
+    numvec bounds(nstates);
+
+    // queue of states with their residuals, may contain outdated entries
+    priority_queue<pair<prec_t, long>> queue;
+
+    const unsigned long maxupdates =
+        iterations >= numeric_limits<unsigned long>::max() / nstates
+            ? numeric_limits<unsigned long>::max()
+            : iterations * nstates;
+    unsigned long updates = 0; // number of Bellman updates so far
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    bool interrupted = false;
+
+    while (true) {
+        // 1. exact Bellman residuals of all states
+        bool openmp_error = false;
+#pragma omp parallel for
+        for (long s = 0; s < nstates; s++) {
+            try {
+                tie(newvalues[s], policy[s]) =
+                    response.policy_update(s, valuefunction, discount);
+                bounds[s] = abs(newvalues[s] - valuefunction[s]);
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "vi_prioritized");
+                    openmp_error = true;
+                }
+            }
+        }
+        // just terminate if there is an error
+        if (openmp_error)
+            throw runtime_error("Failed with an exception in OPENMP block.");
+
+        updates += nstates;
+        residual = *max_element(bounds.cbegin(), bounds.cend());
+
+        if (residual <= maxresidual || updates >= maxupdates || interrupted ||
+            !progress(updates / nstates, residual, "vi_prioritized", "", ""))
+            break;
+
+        for (long s = 0; s < nstates; s++)
+            if (bounds[s] > maxresidual) queue.emplace(bounds[s], s);
+
+        // 2. update the states with the largest residuals first
+        while (!queue.empty() && updates < maxupdates && !interrupted) {
+            const auto [priority, s] = queue.top();
+            queue.pop();
+            // skip entries that have been superseded
+            if (priority != bounds[s]) continue;
+
+            const prec_t change = abs(newvalues[s] - valuefunction[s]);
+            valuefunction[s] = newvalues[s];
+            bounds[s] = 0;
+
+            for (long p : predecessors[s]) {
+                bounds[p] += discount * change;
+                if (bounds[p] <= maxresidual) continue;
+
+                // the bound is too loose, compute the exact residual
+                newvalues[p] = response.policy_update(p, valuefunction, discount).first;
+                bounds[p] = abs(newvalues[p] - valuefunction[p]);
+                if (bounds[p] > maxresidual) queue.emplace(bounds[p], p);
+                // the residual check in step 1 runs even when interrupted
+                if (++updates % nstates == 0)
+                    interrupted =
+                        !progress(updates / nstates, priority, "vi_prioritized", "", "");
+            }
+        }
+        // outdated entries may remain when the loop is stopped early
+        queue = priority_queue<pair<prec_t, long>>();
+    }
+
+    auto finish = chrono::steady_clock::now();
+    chrono::duration<double> duration = finish - start;
+    int status = residual <= maxresidual ? 0 : 1;
+    return Solution<policy_type>(move(valuefunction), move(policy), residual,
+                                 (updates + nstates - 1) / nstates, duration.count(),
+                                 status);
+}
+
+/**
+ * Topological value iteration: solves the strongly connected components of the
+ * transition graph one at a time in a reverse topological order. See solve_vi for
+ * a simplified interface.
+ *
+ * A component with a single state and no self-loop is solved exactly by a single
+ * Bellman update, because the values of all its successors are already final. Only
+ * the cyclic components are solved by Gauss-Seidel value iteration, which only
+ * updates the states in the component. Acyclic models, such as finite-horizon
+ * models, are therefore solved in one sweep.
+ *
+ * Components that do not depend on each other (have the same depth in the graph of
+ * components) are solved in parallel.
+ *
+ * @tparam ResponseType Class responsible for computing the Bellman updates. Should
+ * be compatible with PlainBellman
+ *
+ * @param response Using PolicyResponce allows to specify a partial policy. Only
+ * the actions that not provided by the partial policy are included in the
+ * optimization. Using a class of a different types enables computing other
+ * objectives, such as robust or risk averse ones.
+ * @param successors States that can be reached from each state under any action
+ * (and outcome), see state_successors.
+ * @param discount Discount factor.
+ * @param valuefunction Initial value function. Passed by value, because it is
+ * modified. Optional, use all zeros when not provided. Ignored when size is 0.
+ * Only the values of states in cyclic components are used.
+ * @param iterations Maximal number of iterations to run in each component
+ * @param maxresidual Stop the iterations in a component when the maximal residual
+ *                    in the component falls below this value.
+ * @param progress An optional function for reporting progress and can
+ *                 return false to stop computation. It is called once for each
+ *                 depth of the components.
+ *
+ * @returns Solution that can be used to compute the total return, or the optimal
+ * policy. The residual is the largest residual of all components, and the number
+ * of iterations is the largest number of iterations of any component.
+ */
+template <class ResponseType>
+inline Solution<typename ResponseType::policy_type>
+vi_topological(const ResponseType& response, const vector<indvec>& successors,
+               prec_t discount, numvec valuefunction = numvec(0),
+               unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+               const progress_t& progress = internal::empty_progress) {
+    using policy_type = typename ResponseType::policy_type;
+
+    const long nstates = long(response.state_count());
+
+    // just quit if there are no states
+    if (nstates == 0) return Solution<policy_type>(0, 0);
+
+    if (successors.size() != size_t(nstates))
+        throw invalid_argument("The number of successor lists must match the number "
+                               "of states.");
+
+    // time the computation
+    auto start = chrono::steady_clock::now();
+
+    if (valuefunction.empty()) { valuefunction.resize(nstates, 0.0); }
+
+    vector<policy_type> policy(nstates);
+
+    // states of each component, they are in the reverse topological order
+    const indvec component = state_components(successors);
+    const long ncomponents = *max_element(component.cbegin(), component.cend()) + 1;
+    vector<indvec> members(ncomponents);
+    for (long s = 0; s < nstates; s++)
+        members[component[s]].push_back(s);
+
+    // the depth of each component in the graph of components and whether it has
+    // a cycle; the successors of a component have smaller indexes
+    indvec depth(ncomponents, 0);
+    vector<bool> cyclic(ncomponents, false);
+    long maxdepth = 0;
+    for (long c = 0; c < ncomponents; c++) {
+        cyclic[c] = members[c].size() > 1;
+        for (long s : members[c]) {
+            for (long t : successors[s]) {
+                if (component[t] != c)
+                    depth[c] = max(depth[c], depth[component[t]] + 1);
+                else if (t == s)
+                    cyclic[c] = true;
+            }
+        }
+        maxdepth = max(maxdepth, depth[c]);
+    }
+    vector<indvec> levels(maxdepth + 1);
+    for (long c = 0; c < ncomponents; c++)
+        levels[depth[c]].push_back(c);
+
+    numvec residuals(ncomponents, 0.0);
+    sizvec sweeps(ncomponents, 0);
+
+    prec_t residual = 0;
+    for (long l = 0; l <= maxdepth; l++) {
+        const indvec& level = levels[l];
+
+        bool openmp_error = false;
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < long(level.size()); i++) {
+            try {
+                const long c = level[i];
+                if (!cyclic[c]) {
+                    // the successors are final, one update is enough
+                    const long s = members[c].front();
+                    tie(valuefunction[s], policy[s]) =
+                        response.policy_update(s, valuefunction, discount);
+                    sweeps[c] = 1;
+                    continue;
+                }
+                // Gauss-Seidel value iteration restricted to the component
+                prec_t residual = numeric_limits<prec_t>::infinity();
+                size_t j;
+                for (j = 0; j < iterations && residual > maxresidual; j++) {
+                    residual = 0;
+                    for (long s : members[c]) {
+                        prec_t newvalue;
+                        tie(newvalue, policy[s]) =
+                            response.policy_update(s, valuefunction, discount);
+                        residual = max(residual, abs(valuefunction[s] - newvalue));
+                        valuefunction[s] = newvalue;
+                    }
+                }
+                residuals[c] = residual;
+                sweeps[c] = j;
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "vi_topological");
+                    openmp_error = true;
+                }
+            }
+        }
+        // just terminate if there is an error
+        if (openmp_error)
+            throw runtime_error("Failed with an exception in OPENMP block.");
+
+        residual = *max_element(residuals.cbegin(), residuals.cend());
+        if (!progress(size_t(l), residual, "vi_topological", "", "") && l < maxdepth) {
+            // some components have not been solved
+            residual = numeric_limits<prec_t>::infinity();
+            break;
+        }
+    }
+
+    auto finish = chrono::steady_clock::now();
+    chrono::duration<double> duration = finish - start;
+    int status = residual <= maxresidual ? 0 : 1;
+    return Solution<policy_type>(move(valuefunction), move(policy), residual,
+                                 *max_element(sweeps.cbegin(), sweeps.cend()),
+                                 duration.count(), status);
+}
+
+/// Determines which variant of value iteration to use
+enum class VISolver {
+    gs,         ///< Gauss-Seidel value iteration in a single thread, see vi_gs
+    gs_async,   ///< Asynchronous parallel Gauss-Seidel value iteration, see vi_gs_async
+    prioritized, ///< Prioritized sweeping, see vi_prioritized
+    topological  ///< Strongly connected components in order, see vi_topological
+};
+
+/**
+ * Runs the variant of value iteration chosen by vi_solver. The parameters are the
+ * same as in vi_gs.
+ *
+ * @param model The model of the response. It is only used to construct the
+ *              transition graph for VISolver::gs_async, VISolver::prioritized,
+ *              and VISolver::topological.
+ * @param anderson Anderson acceleration depth, only supported by VISolver::gs
+ */
+template <class Model, class ResponseType>
+inline Solution<typename ResponseType::policy_type>
+vi(const Model& model, const ResponseType& response, prec_t discount,
+   numvec valuefunction = numvec(0), unsigned long iterations = MAXITER,
+   prec_t maxresidual = SOLPREC, const progress_t& progress = internal::empty_progress,
+   VISolver vi_solver = VISolver::gs, size_t anderson = 0) {
+    if (anderson > 0 && vi_solver != VISolver::gs)
+        throw invalid_argument("Anderson acceleration is only supported by the "
+                               "Gauss-Seidel value iteration.");
+    switch (vi_solver) {
+    case VISolver::gs:
+        return vi_gs(response, discount, move(valuefunction), iterations, maxresidual,
+                     progress, anderson);
+    case VISolver::gs_async:
+        return vi_gs_async(response, state_successors(model), discount,
+                           move(valuefunction), iterations, maxresidual, progress);
+    case VISolver::prioritized:
+        return vi_prioritized(response, state_predecessors(state_successors(model)),
+                              discount, move(valuefunction), iterations, maxresidual,
+                              progress);
+    case VISolver::topological:
+        return vi_topological(response, state_successors(model), discount,
+                              move(valuefunction), iterations, maxresidual, progress);
+    }
+    throw invalid_argument("Unknown value iteration solver.");
+}
+
 /**
  * Modified policy iteration using Jacobi value iteration in the inner loop. See
  * solve_mpi for a simplified interface. This method can also be applied directly
@@ -155,6 +957,14 @@ vi_gs(const ResponseType& response, prec_t discount, numvec valuefunction = numv
  * below maxresidual_vi_rel * last_policy_residual
  * @param progress An optional function for reporting progress and can
  *                 return false to stop computation
+ * @param anderson Number of previous iterates combined by Anderson acceleration,
+ *                 see AndersonAcceleration; 0 disables the acceleration. The policy
+ *                 evaluation sweeps are accelerated, or the Bellman updates when
+ *                 iterations_vi is 0 (that is, in Jacobi value iteration).
+ * @param bounds Stopping rule, see ValueBounds. With the span rules, the returned
+ *                 value function is the midpoint of the bounds on the optimal one
+ *                 and the residual is the half-span. Unless it is none, the
+ *                 response must not have terminal states, which is not checked.
  *
  * @return Computed (approximate) solution
  */
@@ -164,7 +974,8 @@ mpi_jac(const ResponseType& response, prec_t discount,
         const numvec& valuefunction = numvec(0), unsigned long iterations_pi = MAXITER,
         prec_t maxresidual_pi = SOLPREC, unsigned long iterations_vi = MAXITER,
         prec_t maxresidual_vi_rel = 0.9,
-        const progress_t& progress = internal::empty_progress) {
+        const progress_t& progress = internal::empty_progress, size_t anderson = 0,
+        ValueBounds bounds = ValueBounds::none) {
 
     using policy_type = typename ResponseType::policy_type;
 
@@ -175,7 +986,7 @@ mpi_jac(const ResponseType& response, prec_t discount,
     auto start = chrono::steady_clock::now();
 
     // intialize the policy
-    vector<policy_type> policy(response.state_count());
+    internal::PolicyStore<ResponseType> policy(response);
 
     numvec sourcevalue = valuefunction; // value function to compute the update
     // resize if the the value function is empty and initialize to 0
@@ -190,8 +1001,14 @@ mpi_jac(const ResponseType& response, prec_t discount,
 
     //size_t iter_total = 0; // track the total number of iterations
 
+    // both the policy evaluation and the Bellman update are discount-contractions
+    AndersonAcceleration accelerator(anderson, discount);
+    internal::check_value_bounds<ResponseType>(bounds);
+    internal::BoundsTracker tracker(bounds, discount);
+
     // to capture the number of policy iterations
     size_t i;
+    CRAAM_TRACE_SOLVER(tracer, "mpi_jac");
     for (i = 0; i < iterations_pi; i++) {
         // this just swaps pointers
         swap(targetvalue, sourcevalue);
@@ -199,15 +1016,17 @@ mpi_jac(const ResponseType& response, prec_t discount,
         prec_t residual_vi = numeric_limits<prec_t>::infinity();
 
         // update policies
+        CRAAM_TRACE_BEGIN(tracer, update);
+        const prec_t shift = tracker.elimination_shift(sourcevalue);
         bool openmp_error = false;
 #pragma omp parallel for
         for (auto s = 0l; s < long(response.state_count()); s++) {
             try {
-                prec_t newvalue;
-                tie(newvalue, policy[s]) =
-                    response.policy_update(s, sourcevalue, discount);
+                CRAAM_TRACE_STATE(tracer);
+                const prec_t newvalue = policy.update(response, s, sourcevalue, discount,
+                                                      tracker.threshold(s, shift));
 
-                residuals[s] = abs(sourcevalue[s] - newvalue);
+                residuals[s] = newvalue - sourcevalue[s];
                 targetvalue[s] = newvalue;
             } catch (const exception& e) {
                 // only run this once per loop
@@ -224,17 +1043,30 @@ mpi_jac(const ResponseType& response, prec_t discount,
 #ifndef NDEBUG
         const prec_t old_residual_pi = residual_pi;
 #endif
-        residual_pi = *max_element(residuals.cbegin(), residuals.cend());
+        residual_pi = tracker.residual(residuals, targetvalue);
+        CRAAM_TRACE_END(tracer, update);
 
         // the residual is sufficiently small
-        if (residual_pi <= maxresidual_pi || !progress(i, residual_pi, "mpi", "", ""))
+        if (residual_pi <= maxresidual_pi || !progress(i, residual_pi, "mpi", "", "")) {
+            tracker.center(targetvalue);
+            CRAAM_TRACE_NEXT(tracer, residual_pi);
             break;
+        }
 
         // if this implements value iteration then the bellman residual should always
-        // decrease in easch iteration
-        if (iterations_vi <= 0) { assert(residual_pi <= old_residual_pi + 1e-5); }
+        // decrease in easch iteration (unless an accelerated iterate is rejected)
+        if (iterations_vi <= 0 && anderson == 0) {
+            assert(residual_pi <= old_residual_pi + 1e-5);
+        }
+
+        // accelerate the Jacobi value iteration (the safeguard uses the sup norm)
+        if (iterations_vi <= 0 && anderson > 0)
+            accelerator.step(sourcevalue, targetvalue, tracker.sup());
 
         // compute values using value iteration
+        CRAAM_TRACE_BEGIN(tracer, evaluation);
+        // the policy has changed and with it the evaluated operator
+        if (iterations_vi > 0) accelerator.reset();
         for (size_t j = 0;
              j < iterations_vi && residual_vi > maxresidual_vi_rel * residual_pi; j++) {
 
@@ -244,8 +1076,9 @@ mpi_jac(const ResponseType& response, prec_t discount,
 #pragma omp parallel for
             for (auto s = 0l; s < long(response.state_count()); s++) {
                 try {
-                    prec_t newvalue =
-                        response.compute_value(policy[s], s, sourcevalue, discount);
+                    CRAAM_TRACE_STATE(tracer);
+                    const prec_t newvalue =
+                        policy.evaluate(response, s, sourcevalue, discount);
                     residuals[s] = abs(sourcevalue[s] - newvalue);
                     targetvalue[s] = newvalue;
                 } catch (const exception& e) {
@@ -262,13 +1095,17 @@ mpi_jac(const ResponseType& response, prec_t discount,
 
             // update the residual value
             residual_vi = *max_element(residuals.begin(), residuals.end());
+            if (anderson > 0 && residual_vi > maxresidual_vi_rel * residual_pi)
+                accelerator.step(sourcevalue, targetvalue, residual_vi);
             //++iter_total;
         }
+        CRAAM_TRACE_END(tracer, evaluation);
+        CRAAM_TRACE_NEXT(tracer, residual_pi);
     }
     auto finish = chrono::steady_clock::now();
     chrono::duration<double> duration = finish - start;
     int status = residual_pi <= maxresidual_pi ? 0 : 1;
-    return Solution<policy_type>(move(targetvalue), move(policy), residual_pi, i,
+    return Solution<policy_type>(move(targetvalue), policy.release(), residual_pi, i,
                                  duration.count(), status);
 }
 
@@ -307,7 +1144,12 @@ mpi_jac(const ResponseType& response, prec_t discount,
  * below maxresidual_vi_rel * last_policy_residual
  * @param progress An optional function for reporting progress and can
  *                 return false to stop computation
- *
+ * @param solver Linear solver used to evaluate each policy. The sparse solvers
+ *                 scale to large problems with few transitions per state.
+ * @param bounds Stopping rule, see ValueBounds. With the span rules, the returned
+ *                 value function is the midpoint of the bounds on the optimal one
+ *                 and the residual is the half-span. Unless it is none, the
+ *                 response must not have terminal states, which is not checked.
  *
  * @return Computed (approximate) solution
  */
@@ -315,7 +1157,9 @@ template <class ResponseType>
 inline Solution<typename ResponseType::policy_type>
 pi(const ResponseType& response, prec_t discount, numvec valuefunction = numvec(0),
    unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
-   const progress_t& progress = internal::empty_progress) {
+   const progress_t& progress = internal::empty_progress,
+   LinearSolver solver = LinearSolver::sparse_lu,
+   ValueBounds bounds = ValueBounds::none) {
 
     const auto n = response.state_count();
 
@@ -332,13 +1176,15 @@ pi(const ResponseType& response, prec_t discount, numvec valuefunction = numvec(
     if (valuefunction.empty()) valuefunction.resize(n, 0.0);
 
     numvec residuals(n);
+    // the updated values are used to tighten the bounds on the optimal values
+    numvec updated(n);
+    internal::check_value_bounds<ResponseType>(bounds);
+    internal::BoundsTracker tracker(bounds, discount);
 
     // residual in the policy iteration part
     prec_t residual_pi = numeric_limits<prec_t>::infinity();
     size_t i; // defined here to be able to report the number of iterations
 
-    // NOTE: could be sped up by keeping I - gamma * P instead of transition probabilities
-
     bool openmp_error = false;
     // first udate the policy
 #pragma omp parallel for
@@ -356,38 +1202,36 @@ pi(const ResponseType& response, prec_t discount, numvec valuefunction = numvec(
     }
     if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
 
-    // **discounted** matrix of transition probabilities
-    MatrixXd trans_discounted = transition_mat(response, policy, false, discount);
+    // sparse rows of transition probabilities for the current policy
+    vector<Transition> transitions;
+    update_transition_rows(response, transitions, policy, vector<policy_type>(0));
 
+    CRAAM_TRACE_SOLVER(tracer, "pi");
     for (i = 0; i < iterations_pi; ++i) {
 
+        CRAAM_TRACE_BEGIN(tracer, evaluation);
         const numvec rw = rewards_vec(response, policy);
-        // get transition matrix and construct (I - gamma * P)
-        // TODO: this step could be eliminated by keeping I - gamma P (this is an unnecessary copy)
-        MatrixXd t_mat =
-            MatrixXd::Identity(n, n) - transition_mat(response, policy, false, discount);
-        // compute and store the value function
-        // note: this is the standard approach, but it is not parallel
-        //Map<VectorXd, Unaligned>(valuefunction.data(), valuefunction.size()) =
-        //    HouseholderQR<MatrixXd>(t_mat).solve(
-        //        Map<const VectorXd, Unaligned>(rw.data(), rw.size()));
-
-        // this alternative is parallelized:
-        // https://eigen.tuxfamily.org/dox/TopicMultiThreading.html
-        Map<VectorXd, Unaligned>(valuefunction.data(), valuefunction.size()) =
-            t_mat.lu().solve(Map<const VectorXd, Unaligned>(rw.data(), rw.size()));
+        // compute and store the value function by solving (I - gamma * P) v = r;
+        // the previous value function is the initial guess for iterative solvers
+        valuefunction =
+            solve_evaluation(transitions, discount, rw, false, solver, valuefunction);
+        CRAAM_TRACE_END(tracer, evaluation);
 
         // std::cout << policy << std::endl;
         // update policy
+        CRAAM_TRACE_BEGIN(tracer, update);
         swap(policy, policy_old);
+        const prec_t shift = tracker.elimination_shift(valuefunction);
         openmp_error = false;
 #pragma omp parallel for
         for (size_t s = 0; s < n; ++s) {
             try {
+                CRAAM_TRACE_STATE(tracer);
                 prec_t newvalue;
-                tie(newvalue, policy[s]) =
-                    response.policy_update(s, valuefunction, discount);
-                residuals[s] = abs(valuefunction[s] - newvalue);
+                tie(newvalue, policy[s]) = internal::policy_update(
+                    response, s, valuefunction, discount, tracker.threshold(s, shift));
+                residuals[s] = newvalue - valuefunction[s];
+                updated[s] = newvalue;
             } catch (const exception& e) {
                 // only run this once per loop
                 if (!openmp_error) {
@@ -400,20 +1244,25 @@ pi(const ResponseType& response, prec_t discount, numvec valuefunction = numvec(
         if (openmp_error)
             throw runtime_error("Failed with an exception in OPENMP block.");
 
-        // TODO: change this to a span seminorm (in all algorithms)
-        residual_pi = *max_element(residuals.cbegin(), residuals.cend());
+        residual_pi = tracker.residual(residuals, updated);
         //std::cout << residual_pi << std::endl;
 
         assert(!isinf(residual_pi));
+        CRAAM_TRACE_END(tracer, update);
+        CRAAM_TRACE_NEXT(tracer, residual_pi);
 
         // the residual is sufficiently small
         auto is_continue = !progress(i, residual_pi, "pi", "", "");
         if (is_continue || residual_pi <= maxresidual_pi || policy == policy_old) break;
 
         // ** now compute the value function
-        // 1. update the transition probabilities
-        update_transition_mat(response, trans_discounted, policy, policy_old, false,
-                              discount);
+        // 1. update the transition probabilities of states with a changed policy
+        update_transition_rows(response, transitions, policy, policy_old);
+    }
+    // the value function of the last policy may be off by a constant
+    if (bounds != ValueBounds::none && iterations_pi > 0) {
+        valuefunction = move(updated);
+        tracker.center(valuefunction);
     }
     auto finish = chrono::steady_clock::now();
     chrono::duration<double> duration = finish - start;
@@ -443,6 +1292,13 @@ enum class MDPSolver { pi, mpi, vi };
  * @param mdp_solver What method to use to solve the policy evaluation MDP
  * @param progress A method that handles reporting the progress and interrupting
  *                  the computation
+ * @param lin_solver Linear solver used by policy evaluation when mdp_solver is pi
+ * @param anderson Anderson acceleration depth of the policy evaluation when
+ *                  mdp_solver is mpi or vi, see mpi_jac
+ * @param bounds Stopping rule of the robust policy updates, see ValueBounds and
+ *                  pi. The policy evaluation always uses the sup norm. Unless it
+ *                  is none, the response must not have terminal states, which is
+ *                  not checked.
  *
  * @return Computed (approximate) solution
  */
@@ -452,7 +1308,9 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
      unsigned long iterations_pi = MAXITER, prec_t maxresidual = SOLPREC,
      const prec_t rob_residual_init = 1.0, prec_t rob_residual_rate = std::nan(""),
      MDPSolver mdp_solver = MDPSolver::pi,
-     const progress_t& progress = internal::empty_progress) {
+     const progress_t& progress = internal::empty_progress,
+     LinearSolver lin_solver = LinearSolver::sparse_lu, size_t anderson = 0,
+     ValueBounds bounds = ValueBounds::none) {
 
     // the policy evaluation target should be no greater than the
     // residual of the policy optimization (also it can only shrink and
@@ -482,11 +1340,15 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
 
     // initialize the policy (the policy could be randomized or deterministic)
     vector<dec_policy_type> dec_policy(response.state_count());
-    // this an array that holds the output policy (only used for the output)
-    vector<policy_type> output_policy(response.state_count());
+    // holds the output policy (only used for the output)
+    internal::PolicyStore<ResponseType> output_policy(response);
 
     // initial bellman residual = to check for the stopping criterion
     numvec residuals(response.state_count());
+    // the updated values are used to tighten the bounds on the optimal values
+    numvec updated(response.state_count());
+    internal::check_value_bounds<ResponseType>(bounds);
+    internal::BoundsTracker tracker(bounds, discount);
     bool openmp_error = false;
 
     // initialize the policy its residuals for the given (empty?) value function
@@ -495,13 +1357,13 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
         try {
             // the new value is only used to compute the residual
             // otherwise this only about the policy
-            prec_t newvalue;
-            tie(newvalue, output_policy[s]) =
-                response.policy_update(s, valuefunction, discount);
+            const prec_t newvalue =
+                output_policy.update(response, s, valuefunction, discount);
             // update the policy of the decision maker (to be used in the evaluation)
             // assume that the policy type is a tuple: [dec policy, nat policy]
-            dec_policy[s] = output_policy[s].first;
-            residuals[s] = abs(valuefunction[s] - newvalue);
+            dec_policy[s] = output_policy.decision(s);
+            residuals[s] = newvalue - valuefunction[s];
+            updated[s] = newvalue;
         } catch (const exception& e) {
             // only run this once per loop
             if (!openmp_error) {
@@ -513,12 +1375,13 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
     // just terminate if there is an error
     if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
 
-    // TODO: change to span seminorm (in all methods and all locations)
-    prec_t residual_pi = *max_element(residuals.cbegin(), residuals.cend());
+    prec_t residual_pi = tracker.residual(residuals, updated);
 
     unsigned long iterations = 0;
+    CRAAM_TRACE_SOLVER(tracer, "rppi");
     do {
         // *** robust policy evaluation ***
+        CRAAM_TRACE_BEGIN(tracer, evaluation);
         // set the dec_policy to prevent optimization
         // count the inner policy iterations too
         bool inner_continue = true; // propagate a termination request from
@@ -550,7 +1413,7 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
             long inner_piiters = iterations == 0 ? 5l : iters_left;
 
             solution_rob = pi(response, discount, valuefunction, inner_piiters,
-                              target_residual, inner_progress);
+                              target_residual, inner_progress, lin_solver);
         } else if (mdp_solver == MDPSolver::mpi) {
 
             // a small number of iterations for the initial policy,
@@ -558,15 +1421,16 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
             long inner_piiters = iterations == 0 ? 5 : iters_left;
             long inner_viiters = iterations == 0 ? 50 : 2000;
 
-            solution_rob =
-                mpi_jac(response, discount, valuefunction, inner_piiters, target_residual,
-                        inner_viiters, target_of_pi_factor * discount, inner_progress);
+            solution_rob = mpi_jac(response, discount, valuefunction, inner_piiters,
+                                   target_residual, inner_viiters,
+                                   target_of_pi_factor * discount, inner_progress,
+                                   anderson);
         } else if (mdp_solver == MDPSolver::vi) {
 
             // this method is meant to approximate the behavior RMPI, so the number
             // of iterations per policy improvement is relatively small
             solution_rob = mpi_jac(response, discount, valuefunction, 1000,
-                                   target_residual, 0, 1.0, inner_progress);
+                                   target_residual, 0, 1.0, inner_progress, anderson);
         } else {
             throw invalid_argument("Unsupported mdp_solver parameter");
         }
@@ -583,23 +1447,27 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
         // residual is not achieved
 
         valuefunction = move(solution_rob.valuefunction);
+        CRAAM_TRACE_END(tracer, evaluation);
 
         // *** robust policy update ***
         // set the dec policy to empty to optimize it
+        CRAAM_TRACE_BEGIN(tracer, update);
         response.set_decision_policy();
+        const prec_t shift = tracker.elimination_shift(valuefunction);
         openmp_error = false;
 #pragma omp parallel for
         for (auto s = 0l; s < long(response.state_count()); s++) {
             try {
+                CRAAM_TRACE_STATE(tracer);
                 // the new value is only used to compute the residual
                 // otherwise this only about the policy
-                prec_t newvalue;
-                tie(newvalue, output_policy[s]) =
-                    response.policy_update(s, valuefunction, discount);
+                const prec_t newvalue = output_policy.update(
+                    response, s, valuefunction, discount, tracker.threshold(s, shift));
                 // update the policy of the decision maker (to be used in the evaluation)
                 // assume that the policy type is a tuple: [dec policy, nat policy]
-                dec_policy[s] = output_policy[s].first;
-                residuals[s] = abs(valuefunction[s] - newvalue);
+                dec_policy[s] = output_policy.decision(s);
+                residuals[s] = newvalue - valuefunction[s];
+                updated[s] = newvalue;
             } catch (const exception& e) {
                 // only run this once per loop
                 if (!openmp_error) {
@@ -613,8 +1481,10 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
         if (openmp_error)
             throw runtime_error("Failed with an exception in OPENMP block.");
 
-        // TODO: change to span seminorm (in all methods and all locations)
-        residual_pi = *max_element(residuals.cbegin(), residuals.cend());
+        residual_pi = tracker.residual(residuals, updated);
+
+        CRAAM_TRACE_END(tracer, update);
+        CRAAM_TRACE_NEXT(tracer, residual_pi);
 
         // adjust the target residual to be smaller than the policy residual
         target_residual = std::min(target_of_pi_factor * residual_pi, target_residual);
@@ -632,10 +1502,16 @@ rppi(ResponseType response, prec_t discount, numvec valuefunction = numvec(0),
         ++iterations;
     } while (residual_pi > maxresidual && iterations <= iterations_pi);
 
+    // the value function of the last policy may be off by a constant
+    if (bounds != ValueBounds::none) {
+        valuefunction = move(updated);
+        tracker.center(valuefunction);
+    }
+
     auto finish = chrono::steady_clock::now();
     chrono::duration<double> duration = finish - start;
     int status = residual_pi <= maxresidual ? 0 : 1;
-    return Solution<policy_type>(move(valuefunction), move(output_policy), residual_pi,
-                                 iterations, duration.count(), status);
+    return Solution<policy_type>(move(valuefunction), output_policy.release(),
+                                 residual_pi, iterations, duration.count(), status);
 }
 }} // namespace craam::algorithms
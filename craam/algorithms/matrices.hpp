@@ -28,6 +28,7 @@
 #include "craam/Transition.hpp"
 
 #include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Sparse>
 #include <rm/range.hpp>
 
 namespace craam { namespace algorithms {
@@ -35,6 +36,26 @@ namespace craam { namespace algorithms {
 using namespace std;
 using namespace Eigen;
 
+/**
+ * Method used to solve the system of linear equations (I - gamma P) x = b that
+ * arises in policy evaluation and when computing occupancy frequencies.
+ *
+ * The dense methods need O(n^2) memory and O(n^3) time and are only practical
+ * for small problems. The sparse methods only store the non-zero transition
+ * probabilities.
+ */
+enum class LinearSolver {
+    /// Dense LU decomposition with partial pivoting
+    dense_lu,
+    /// Dense Householder QR decomposition
+    dense_qr,
+    /// Sparse supernodal LU decomposition (direct method)
+    sparse_lu,
+    /// Stabilized bi-conjugate gradient with an incomplete LU preconditioner
+    /// (iterative method, uses the provided initial guess)
+    bicgstab
+};
+
 /**
  * Updates transition probabilities according to the provided policy.
  *
@@ -81,7 +102,7 @@ update_transition_mat(const BellmanResponse& response, MatrixXd& transitions,
         } catch (const exception& e) {
             // only run this once per loop
             if (!openmp_error) {
-                internal::openmp_exception_handler(e, "update_transition_mat");
+                craam::internal::openmp_exception_handler(e, "update_transition_mat");
                 openmp_error = true;
             }
         }
@@ -136,7 +157,7 @@ inline numvec rewards_vec(const BellmanResponse& response,
         } catch (const exception& e) {
             // only run this once per loop
             if (!openmp_error) {
-                internal::openmp_exception_handler(e, "rewards_vec");
+                craam::internal::openmp_exception_handler(e, "rewards_vec");
                 openmp_error = true;
             }
         }
@@ -145,9 +166,186 @@ inline numvec rewards_vec(const BellmanResponse& response,
     return rewards;
 }
 
+/**
+ * Updates the rows of transition probabilities for the states in which the policy
+ * changed. This is the sparse counterpart of update_transition_mat; each row holds
+ * only the non-zero transition probabilities.
+ *
+ * @param response BellmanOperator class (e.g. PlainBellman)
+ * @param rows Transition probabilities for @a old_policy, one row for each state
+ * @param new_policy Policy used to update transition probabilities
+ * @param old_policy Policy that corresponds to the values in @a rows. The
+ *          parameter can be length 0 if all rows are invalid.
+ */
+template <typename BellmanResponse>
+inline void
+update_transition_rows(const BellmanResponse& response, vector<Transition>& rows,
+                       const vector<typename BellmanResponse::policy_type>& new_policy,
+                       const vector<typename BellmanResponse::policy_type>& old_policy) {
+
+    const size_t n = response.state_count();
+    assert(new_policy.size() == n);
+    assert(old_policy.empty() || new_policy.size() == old_policy.size());
+    rows.resize(n);
+
+    bool openmp_error = false;
+#pragma omp parallel for
+    for (size_t s = 0; s < n; s++) {
+        try {
+            // if the policy has not changed then do nothing
+            if (!old_policy.empty() && old_policy[s] == new_policy[s]) continue;
+            rows[s] = response.transition(s, new_policy[s]);
+        } catch (const exception& e) {
+            // only run this once per loop
+            if (!openmp_error) {
+                craam::internal::openmp_exception_handler(e, "update_transition_rows");
+                openmp_error = true;
+            }
+        }
+    }
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+}
+
+/**
+ * Constructs the sparse matrix I - gamma * P from the rows of transition
+ * probabilities.
+ *
+ * @tparam Options Storage order of the matrix (Eigen::ColMajor or Eigen::RowMajor)
+ * @param rows Transition probabilities, one row for each state
+ * @param discount Discount factor (gamma)
+ * @param transpose If true, constructs I - gamma * P^T instead
+ */
+template <int Options = Eigen::ColMajor>
+inline Eigen::SparseMatrix<prec_t, Options>
+evaluation_spmat(const vector<Transition>& rows, prec_t discount,
+                 bool transpose = false) {
+    const size_t n = rows.size();
+
+    size_t nonzeros = n;
+    for (const Transition& t : rows)
+        nonzeros += t.size();
+
+    vector<Eigen::Triplet<prec_t>> triplets;
+    triplets.reserve(nonzeros);
+    for (size_t s = 0; s < n; s++) {
+        triplets.emplace_back(s, s, 1.0);
+        const auto& indexes = rows[s].get_indices();
+        const auto& probabilities = rows[s].get_probabilities();
+        for (size_t j = 0; j < indexes.size(); j++) {
+            if (!transpose)
+                triplets.emplace_back(s, indexes[j], -discount * probabilities[j]);
+            else
+                triplets.emplace_back(indexes[j], s, -discount * probabilities[j]);
+        }
+    }
+    // duplicate entries (on the diagonal) are summed
+    Eigen::SparseMatrix<prec_t, Options> result(n, n);
+    result.setFromTriplets(triplets.cbegin(), triplets.cend());
+    return result;
+}
+
+/**
+ * @brief Creates a sparse transition probability matrix for the Bellman response
+ * operator. This is the sparse counterpart of transition_mat.
+ *
+ * @param response BellmanOperator class (e.g. PlainBellman)
+ * @param policy Policy used to construct transition probabilities
+ * @param transpose If yes, then the source states are columns (non-standard)
+ * @param discount An optional discount factor that multiplies each row
+ */
+template <typename BellmanResponse,
+          typename policy_type = typename BellmanResponse::policy_type>
+inline Eigen::SparseMatrix<prec_t>
+sparse_transition_mat(const BellmanResponse& response, const vector<policy_type>& policy,
+                      bool transpose = false, prec_t discount = 1.0) {
+    const size_t n = response.state_count();
+    vector<Transition> rows;
+    update_transition_rows(response, rows, policy, vector<policy_type>(0));
+    // I - (I - gamma P) = gamma P
+    Eigen::SparseMatrix<prec_t> identity(n, n);
+    identity.setIdentity();
+    return identity - evaluation_spmat(rows, discount, transpose);
+}
+
+/**
+ * Solves the system of linear equations (I - gamma * P) x = b where P is
+ * given by its rows of transition probabilities.
+ *
+ * @param rows Transition probabilities, one row for each state
+ * @param discount Discount factor (gamma)
+ * @param b The right-hand side
+ * @param transpose Whether to solve (I - gamma * P^T) x = b instead
+ * @param solver Which linear solver to use
+ * @param guess Initial guess for iterative solvers. Ignored when empty or
+ *              when the solver is direct.
+ * @return The solution x
+ */
+inline numvec solve_evaluation(const vector<Transition>& rows, prec_t discount,
+                               const numvec& b, bool transpose = false,
+                               LinearSolver solver = LinearSolver::sparse_lu,
+                               const numvec& guess = numvec(0)) {
+    const size_t n = rows.size();
+    assert(b.size() == n);
+
+    const Map<const VectorXd, Unaligned> bvec(b.data(), b.size());
+    numvec result(n, 0.0);
+    Map<VectorXd, Unaligned> xvec(result.data(), result.size());
+
+    switch (solver) {
+    case LinearSolver::dense_lu:
+    case LinearSolver::dense_qr: {
+        MatrixXd t_mat = MatrixXd::Identity(n, n);
+        for (size_t s = 0; s < n; s++) {
+            const auto& indexes = rows[s].get_indices();
+            const auto& probabilities = rows[s].get_probabilities();
+            for (size_t j = 0; j < indexes.size(); j++) {
+                if (!transpose)
+                    t_mat(s, indexes[j]) -= discount * probabilities[j];
+                else
+                    t_mat(indexes[j], s) -= discount * probabilities[j];
+            }
+        }
+        // the LU decomposition is parallelized:
+        // https://eigen.tuxfamily.org/dox/TopicMultiThreading.html
+        if (solver == LinearSolver::dense_lu)
+            xvec = t_mat.lu().solve(bvec);
+        else
+            xvec = HouseholderQR<MatrixXd>(t_mat).solve(bvec);
+        break;
+    }
+    case LinearSolver::sparse_lu: {
+        SparseLU<SparseMatrix<prec_t>, COLAMDOrdering<int>> lu(
+            evaluation_spmat(rows, discount, transpose));
+        if (lu.info() != Success)
+            throw runtime_error("Sparse LU decomposition failed: " +
+                                lu.lastErrorMessage());
+        xvec = lu.solve(bvec);
+        break;
+    }
+    case LinearSolver::bicgstab: {
+        // the row-major layout allows for a parallel matrix-vector product
+        const SparseMatrix<prec_t, RowMajor> t_mat =
+            evaluation_spmat<RowMajor>(rows, discount, transpose);
+        BiCGSTAB<SparseMatrix<prec_t, RowMajor>, IncompleteLUT<prec_t>> bicg;
+        bicg.setTolerance(1e-12);
+        bicg.compute(t_mat);
+        if (guess.size() == n)
+            xvec = bicg.solveWithGuess(
+                bvec, Map<const VectorXd, Unaligned>(guess.data(), guess.size()));
+        else
+            xvec = bicg.solve(bvec);
+        if (bicg.info() != Success)
+            throw runtime_error("BiCGSTAB failed to solve the linear system.");
+        break;
+    }
+    default: throw invalid_argument("Unsupported linear solver.");
+    }
+    return result;
+}
+
 /**
 Computes occupancy frequencies using matrix representation of transition
-probabilities. This method requires computing a matrix inverse.
+probabilities. This method requires solving a system of linear equations.
 
 @tparam Methods for computing Bellman responses, similar to PlainBellman
 
@@ -156,27 +354,22 @@ probabilities. This method requires computing a matrix inverse.
 @param policies The policy (indvec) or a pair of the policy and the policy
         of nature (pair<indvec,vector<numvec> >). The nature is typically
         a randomized policy
+@param solver Linear solver, the sparse LU decomposition by default
 */
 template <typename BellmanResponse,
           typename policy_type = typename BellmanResponse::policy_type>
 inline numvec occfreq_mat(const BellmanResponse& response, const Transition& init,
-                          prec_t discount, const policy_type& policy) {
+                          prec_t discount, const policy_type& policy,
+                          LinearSolver solver = LinearSolver::sparse_lu) {
     const auto n = response.state_count();
 
     // initial distribution
     const numvec& ivec = init.probabilities_vector(n);
-    const VectorXd initial_vec = Map<const VectorXd, Unaligned>(ivec.data(), ivec.size());
 
-    // get transition matrix and construct (I - gamma * P^T)
-    MatrixXd t_mat =
-        MatrixXd::Identity(n, n) - transition_mat(response, policy, true, discount);
-
-    // solve set of linear equations
-    numvec result(n, 0);
-    Map<VectorXd, Unaligned>(result.data(), result.size()) =
-        HouseholderQR<MatrixXd>(t_mat).solve(initial_vec);
-
-    return result;
+    // get transition probabilities and solve (I - gamma * P^T) d = alpha
+    vector<Transition> rows;
+    update_transition_rows(response, rows, policy, policy_type(0));
+    return solve_evaluation(rows, discount, ivec, true, solver);
 }
 
 /**
@@ -184,29 +377,21 @@ inline numvec occfreq_mat(const BellmanResponse& response, const Transition& ini
  *
  * @param response Bellman response that provides the transition probabilities and rewards
  * @param discount discount factor
- *
- *
+ * @param policy The policy to evaluate
+ * @param solver Linear solver, the sparse LU decomposition by default
  */
 template <typename BellmanResponse,
           typename policy_type = typename BellmanResponse::policy_type>
 inline numvec valuefunction_mat(const BellmanResponse& response, prec_t discount,
-                                const policy_type& policy) {
+                                const policy_type& policy,
+                                LinearSolver solver = LinearSolver::sparse_lu) {
 
-    const auto n = response.state_count();
     const numvec rewards = rewards_vec(response, policy);
-    const VectorXd rewards_vec =
-        Map<const VectorXd, Unaligned>(rewards.data(), rewards.size());
-
-    // get transition matrix and construct (I - gamma * P)
-    MatrixXd t_mat =
-        MatrixXd::Identity(n, n) - transition_mat(response, policy, true, discount);
 
-    // solve set of linear equations
-    numvec result(n, 0);
-    Map<VectorXd, Unaligned>(result.data(), result.size()) =
-        HouseholderQR<MatrixXd>(t_mat).solve(rewards_vec);
-
-    return result;
+    // get transition probabilities and solve (I - gamma * P) v = r
+    vector<Transition> rows;
+    update_transition_rows(response, rows, policy, policy_type(0));
+    return solve_evaluation(rows, discount, rewards, false, solver);
 }
 
 /**
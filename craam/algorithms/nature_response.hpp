@@ -60,6 +60,16 @@ public:
 
         return worstcase_l1(zfunction, nominalprob, budgets[stateid][actionid]);
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long stateid, long actionid, const numvec& nominalprob,
+                      const numvec& zfunction, numvec& distribution) const {
+        assert(stateid >= 0 && stateid < long(budgets.size()));
+        assert(actionid >= 0 && actionid < long(budgets[stateid].size()));
+
+        return worstcase_l1(zfunction, nominalprob, budgets[stateid][actionid],
+                            distribution);
+    }
 };
 
 /**
@@ -75,15 +85,25 @@ protected:
     /// The weights are optional, if empty then uniform weights are used.
     /// The elements are over states, actions, and then next state values
     vector<vector<numvec>> weights;
+    /// Homotopy gradients cached for each state and action and warm-started
+    /// in the next Bellman update
+    mutable vector<vector<GradientsL1_w>> gradients;
 
 public:
     /**
    * @param budgets One value for each state and action
    * @param weights State weights used in the L1 norm. One set of vectors for
    * each state and action. Use and empty vector to specify uniform weights.
+   *
+   * The response caches the homotopy gradients for each state and action.
+   * Different states may be evaluated in parallel, but the same state must not
+   * be evaluated concurrently by two threads.
    */
     robust_l1w(numvecvec budgets, vector<vector<numvec>> weights)
-        : budgets(move(budgets)), weights(weights) {}
+        : budgets(move(budgets)), weights(weights), gradients(this->budgets.size()) {
+        for (size_t s = 0; s < this->budgets.size(); s++)
+            gradients[s].resize(this->budgets[s].size());
+    }
 
     /**
    * @brief Implements SANature interface
@@ -95,8 +115,10 @@ public:
         assert(actionid >= 0 && actionid < long(budgets[stateid].size()));
         assert(zfunction.size() == weights[stateid][actionid].size());
 
-        return worstcase_l1_w(zfunction, nominalprob, weights[stateid][actionid],
-                              budgets[stateid][actionid]);
+        GradientsL1_w& sa_gradients = gradients[stateid][actionid];
+        sa_gradients.update(zfunction, weights[stateid][actionid]);
+        return worstcase_l1_w(sa_gradients, zfunction, nominalprob,
+                              weights[stateid][actionid], budgets[stateid][actionid]);
     }
 };
 
@@ -119,6 +141,12 @@ public:
                                     const numvec& zfunction) const {
         return worstcase_l1(zfunction, nominalprob, budget);
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long, long, const numvec& nominalprob, const numvec& zfunction,
+                      numvec& distribution) const {
+        return worstcase_l1(zfunction, nominalprob, budget, distribution);
+    }
 };
 
 /**
@@ -137,6 +165,14 @@ public:
 
         return {nominalprob, mean_value};
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long, long, const numvec& nominalprob, const numvec& zfunction,
+                      numvec& distribution) const {
+        distribution.assign(nominalprob.cbegin(), nominalprob.cend());
+        return std::inner_product(zfunction.cbegin(), zfunction.cend(),
+                                  nominalprob.cbegin(), 0.0);
+    }
 };
 
 /**
@@ -244,6 +280,16 @@ struct robust_unbounded {
         dist[index] = 1;
         return make_pair(dist, zfunction[index]);
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long, long, const numvec&, const numvec& zfunction,
+                      numvec& distribution) const {
+        distribution.assign(zfunction.size(), 0.0);
+        size_t index =
+            size_t(min_element(begin(zfunction), end(zfunction)) - begin(zfunction));
+        distribution[index] = 1;
+        return zfunction[index];
+    }
 };
 
 /// Absolutely best outcome
@@ -258,6 +304,16 @@ struct optimistic_unbounded {
         dist[index] = 1;
         return make_pair(dist, zfunction[index]);
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long, long, const numvec&, const numvec& zfunction,
+                      numvec& distribution) const {
+        distribution.assign(zfunction.size(), 0.0);
+        size_t index =
+            size_t(max_element(begin(zfunction), end(zfunction)) - begin(zfunction));
+        distribution[index] = 1;
+        return zfunction[index];
+    }
 };
 
 /// Picks a fixed outcome for each state. This can only be
@@ -497,6 +553,24 @@ protected:
     numvec budgets;
     /// one vector of weights per each state and action
     vector<numvecvec> weights;
+    /// Homotopy gradients cached for each state and action and warm-started
+    /// in the next Bellman update
+    mutable vector<vector<GradientsL1_w>> gradients;
+
+    /// Updates the cached gradients of the state for the new z-values
+    const vector<GradientsL1_w>& state_gradients(long stateid,
+                                                 const vector<numvec>& zvalues) const {
+        vector<GradientsL1_w>& result = gradients[stateid];
+        // the gradients are not used with uniform weights
+        if (weights[stateid].empty()) {
+            result.clear();
+            return result;
+        }
+        result.resize(zvalues.size());
+        for (size_t a = 0; a < zvalues.size(); a++)
+            result[a].update(zvalues[a], weights[stateid][a]);
+        return result;
+    }
 
 public:
     /**
@@ -504,9 +578,14 @@ public:
      * @param budgets Must have one budget for each state
      * @param weights Must have one vector of weights for each state and action. The number of
      * weights must match the number of state transition with positive probabilities.
+     *
+     * The response caches the homotopy gradients for each state and action.
+     * Different states may be evaluated in parallel, but the same state must not
+     * be evaluated concurrently by two threads.
      */
     robust_s_l1w(numvec budgets, vector<numvecvec> weights)
-        : budgets(move(budgets)), weights(move(weights)) {
+        : budgets(move(budgets)), weights(move(weights)),
+          gradients(this->budgets.size()) {
         if (this->weights.size() != this->budgets.size()) {
             throw invalid_argument(
                 "There must be one weight and one budget for each state.");
@@ -534,8 +613,9 @@ public:
 
             // compute the distribution of actions and the optimal budgets
 
-            tie(outcome, actiondist, sa_budgets) = solve_srect_bisection(
-                zvalues, nominalprobs, budgets[stateid], numvec(0), weights[stateid]);
+            tie(outcome, actiondist, sa_budgets) =
+                solve_srect_bisection(zvalues, nominalprobs, budgets[stateid], numvec(0),
+                                      weights[stateid], state_gradients(stateid, zvalues));
 
             assert(actiondist.size() == zvalues.size());
             assert(sa_budgets.size() == actiondist.size());
@@ -556,7 +636,8 @@ public:
         // a policy is provided
         else {
             std::tie(outcome, new_probability) = evaluate_srect_bisection_l1(
-                zvalues, nominalprobs, budgets[stateid], policy, weights[stateid]);
+                zvalues, nominalprobs, budgets[stateid], policy, weights[stateid],
+                state_gradients(stateid, zvalues));
             actiondist = policy;
         }
         // make sure that the states and nature have the same number of elements
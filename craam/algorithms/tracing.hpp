@@ -0,0 +1,459 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/**
+ * Instrumentation of the iterative solvers.
+ *
+ * The solvers vi_gs, mpi_jac, pi, and rppi record the time of each iteration split
+ * into the policy update and the policy evaluation phases, the residual, the number
+ * and the time of the calls of nature, and the number of states updated by each
+ * thread. The records are collected in a SolverTrace, which is active while a
+ * TraceScope exists:
+ *
+ *     SolverTrace trace;
+ *     {
+ *         TraceScope scope(trace);
+ *         auto solution = solve_mpi(mdp, 0.9);
+ *     }
+ *     std::cout << trace.to_json();
+ *
+ * The instrumentation is only compiled in when CRAAM_TRACE is defined (cmake option
+ * USE_TRACING); otherwise the hooks in the solvers expand to nothing and a trace
+ * stays empty.
+ *
+ * Memory allocations are counted when CRAAM_TRACE_ALLOCATIONS is defined in exactly
+ * one translation unit before including this header. That translation unit then
+ * replaces the global operator new and delete with counting versions.
+ *
+ * The trace is active only in the thread that creates the TraceScope, so solvers
+ * that run concurrently in other threads are not recorded in it. The solvers make
+ * the trace active in the OpenMP threads that compute their state updates, which
+ * records the calls of nature in these threads. The iterations of nested solvers,
+ * such as the inner solvers of rppi, are recorded in the same trace and are
+ * distinguished by the name of the method.
+ */
+#pragma once
+
+#include "craam/definitions.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace craam { namespace algorithms {
+
+using namespace std;
+
+/// Phases of an iteration of a solver
+enum class TracePhase { update, evaluation };
+
+/// Summary of a single iteration of a solver
+struct TraceIteration {
+    /// Name of the solver, such as mpi_jac
+    string method;
+    /// Index of the iteration in the solver
+    size_t iteration;
+    /// Bellman residual at the end of the iteration
+    prec_t residual;
+    /// Start of the iteration in seconds since the trace was created
+    double start;
+    /// Time spent in the policy update phase (seconds)
+    double update_time;
+    /// Time spent in the policy evaluation phase (seconds)
+    double evaluation_time;
+    /// Number of calls of nature
+    size_t nature_calls;
+    /// Time spent in the responses of nature summed over all threads (seconds)
+    double nature_time;
+    /// Number of memory allocations, -1 when they are not counted
+    long allocations;
+};
+
+/// A phase of an iteration, used to construct the timeline
+struct TraceEvent {
+    /// Name of the solver
+    string method;
+    /// The phase
+    TracePhase phase;
+    /// Index of the iteration in the solver
+    size_t iteration;
+    /// Start in seconds since the trace was created
+    double start;
+    /// Duration in seconds
+    double duration;
+};
+
+namespace internal {
+/// Counter of memory allocations, only incremented by the allocation hooks
+inline std::atomic<long>& allocation_count() {
+    static std::atomic<long> count{0};
+    return count;
+}
+
+/// Whether the allocation hooks are installed
+inline std::atomic<bool>& allocation_tracking() {
+    static std::atomic<bool> tracking{false};
+    return tracking;
+}
+
+/// Number of allocations so far, or -1 when they are not counted
+inline long allocations() {
+    return allocation_tracking().load() ? allocation_count().load() : -1;
+}
+} // namespace internal
+
+/**
+ * Records of solver iterations. The iterations and phases are added by the solvers
+ * and the calls of nature and thread loads are counted concurrently.
+ */
+class SolverTrace {
+protected:
+    /// Time when the trace was created
+    chrono::steady_clock::time_point origin;
+    /// Guards iterations and events
+    mutable std::mutex records_mutex;
+    /// Summaries of the iterations
+    vector<TraceIteration> iterations;
+    /// Phases in the order in which they finished
+    vector<TraceEvent> events;
+    /// Number of calls of nature
+    std::atomic<size_t> nature_count{0};
+    /// Time spent by nature in nanoseconds
+    std::atomic<long long> nature_nanos{0};
+    /// Number of threads for which the loads are recorded
+    size_t thread_count;
+    /// Number of state updates computed by each thread
+    unique_ptr<std::atomic<size_t>[]> states;
+
+public:
+    /// Creates an empty trace that records the loads of up to the maximal
+    /// number of OpenMP threads
+    SolverTrace() : origin(chrono::steady_clock::now()), thread_count(1) {
+#ifdef _OPENMP
+        thread_count = size_t(std::max(omp_get_max_threads(), 1));
+#endif
+        states = make_unique<std::atomic<size_t>[]>(thread_count);
+        for (size_t t = 0; t < thread_count; t++)
+            states[t] = 0;
+    }
+
+    /// Seconds since the trace was created
+    double elapsed() const {
+        return chrono::duration<double>(chrono::steady_clock::now() - origin).count();
+    }
+
+    /// Summaries of all recorded iterations
+    vector<TraceIteration> get_iterations() const {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        return iterations;
+    }
+
+    /// Timeline of all recorded phases
+    vector<TraceEvent> get_events() const {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        return events;
+    }
+
+    /// Total number of calls of nature
+    size_t nature_calls() const { return nature_count.load(); }
+
+    /// Total time spent by nature, summed over threads, in seconds
+    double nature_time() const { return double(nature_nanos.load()) * 1e-9; }
+
+    /// Number of state updates computed by each thread
+    sizvec thread_states() const {
+        sizvec result(thread_count);
+        for (size_t t = 0; t < thread_count; t++)
+            result[t] = states[t].load();
+        return result;
+    }
+
+    /// Adds the summary of an iteration
+    void add_iteration(TraceIteration record) {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        iterations.push_back(move(record));
+    }
+
+    /// Adds a finished phase
+    void add_event(TraceEvent event) {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        events.push_back(move(event));
+    }
+
+    /// Counts a call of nature that took the given number of nanoseconds
+    void add_nature_call(long long nanoseconds) {
+        nature_count.fetch_add(1, std::memory_order_relaxed);
+        nature_nanos.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    /// Counts a state update computed by the calling thread
+    void add_state() {
+        size_t thread = 0;
+#ifdef _OPENMP
+        thread = size_t(omp_get_thread_num());
+#endif
+        states[thread % thread_count].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * The trace as a JSON object with the members iterations (an array of the
+     * iteration summaries), nature_calls, nature_time, and thread_states.
+     */
+    string to_json() const {
+        const auto records = get_iterations();
+        stringstream out;
+        out.precision(12);
+        out << "{\"iterations\":[";
+        for (size_t i = 0; i < records.size(); i++) {
+            const TraceIteration& r = records[i];
+            out << (i > 0 ? "," : "") << "{\"method\":\"" << r.method
+                << "\",\"iteration\":" << r.iteration << ",\"residual\":" << r.residual
+                << ",\"start\":" << r.start << ",\"update_time\":" << r.update_time
+                << ",\"evaluation_time\":" << r.evaluation_time
+                << ",\"nature_calls\":" << r.nature_calls
+                << ",\"nature_time\":" << r.nature_time
+                << ",\"allocations\":" << r.allocations << "}";
+        }
+        out << "],\"nature_calls\":" << nature_calls()
+            << ",\"nature_time\":" << nature_time() << ",\"thread_states\":[";
+        const sizvec loads = thread_states();
+        for (size_t t = 0; t < loads.size(); t++)
+            out << (t > 0 ? "," : "") << loads[t];
+        out << "]}";
+        return out.str();
+    }
+
+    /**
+     * The trace in the Chrome trace event format, which can be opened in
+     * chrome://tracing or Perfetto. Each phase is a complete event and the
+     * residual is a counter.
+     */
+    string to_chrome_trace() const {
+        const auto phases = get_events();
+        const auto records = get_iterations();
+        stringstream out;
+        out.precision(12);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (const TraceEvent& e : phases) {
+            out << (first ? "" : ",") << "{\"name\":\""
+                << (e.phase == TracePhase::update ? "update" : "evaluation")
+                << "\",\"cat\":\"" << e.method << "\",\"ph\":\"X\",\"ts\":"
+                << e.start * 1e6 << ",\"dur\":" << e.duration * 1e6
+                << ",\"pid\":0,\"tid\":0,\"args\":{\"iteration\":" << e.iteration
+                << "}}";
+            first = false;
+        }
+        for (const TraceIteration& r : records) {
+            out << (first ? "" : ",") << "{\"name\":\"residual\",\"cat\":\"" << r.method
+                << "\",\"ph\":\"C\",\"ts\":"
+                << (r.start + r.update_time + r.evaluation_time) * 1e6
+                << ",\"pid\":0,\"args\":{\"residual\":" << r.residual << "}}";
+            first = false;
+        }
+        out << "],\"otherData\":{\"nature_calls\":" << nature_calls()
+            << ",\"nature_time\":" << nature_time() << "}}";
+        return out.str();
+    }
+};
+
+namespace internal {
+/// The trace that records the solvers in the calling thread, nullptr when there is
+/// none
+inline SolverTrace*& active_trace() {
+    thread_local SolverTrace* trace = nullptr;
+    return trace;
+}
+} // namespace internal
+
+/**
+ * Makes the trace active in the calling thread for the lifetime of the object. The
+ * previously active trace is restored when the scope is destroyed.
+ */
+class TraceScope {
+protected:
+    SolverTrace* previous;
+
+public:
+    explicit TraceScope(SolverTrace& trace)
+        : previous(std::exchange(internal::active_trace(), &trace)) {}
+    ~TraceScope() { internal::active_trace() = previous; }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+namespace internal {
+
+/**
+ * Records the iterations of a single run of a solver to the active trace. Does
+ * nothing when there is no active trace.
+ */
+class IterationTracer {
+protected:
+    SolverTrace* trace;
+    string method;
+    size_t iteration = 0;
+    double iteration_start = 0, phase_start = 0;
+    double phase_time[2] = {0, 0};
+    size_t nature_calls_start = 0;
+    double nature_time_start = 0;
+    long allocations_start = 0;
+
+    void reset() {
+        iteration_start = trace->elapsed();
+        phase_time[0] = phase_time[1] = 0;
+        nature_calls_start = trace->nature_calls();
+        nature_time_start = trace->nature_time();
+        allocations_start = allocations();
+    }
+
+public:
+    explicit IterationTracer(string method)
+        : trace(active_trace()), method(move(method)) {
+        if (trace != nullptr) reset();
+    }
+
+    /// Starts a phase of the current iteration
+    void begin(TracePhase) {
+        if (trace != nullptr) phase_start = trace->elapsed();
+    }
+
+    /// Finishes a phase of the current iteration
+    void end(TracePhase phase) {
+        if (trace == nullptr) return;
+        const double duration = trace->elapsed() - phase_start;
+        phase_time[size_t(phase)] += duration;
+        trace->add_event({method, phase, iteration, phase_start, duration});
+    }
+
+    /// Finishes the current iteration and starts the next one
+    void next(prec_t residual) {
+        if (trace == nullptr) return;
+        const long allocs = allocations();
+        trace->add_iteration({method, iteration, residual, iteration_start,
+                              phase_time[0], phase_time[1],
+                              trace->nature_calls() - nature_calls_start,
+                              trace->nature_time() - nature_time_start,
+                              allocs < 0 ? -1 : allocs - allocations_start});
+        iteration++;
+        reset();
+    }
+
+    /// Counts a state update by the calling thread
+    void state() const {
+        if (trace != nullptr) trace->add_state();
+    }
+
+    /// The trace that records the solver, nullptr when there is none
+    SolverTrace* get_trace() const { return trace; }
+};
+
+/**
+ * Counts a state update by the calling thread and makes the trace of the solver
+ * active in the thread while the state is updated. The previously active trace is
+ * restored when the object is destroyed.
+ */
+class StateTracer {
+protected:
+    SolverTrace* previous;
+
+public:
+    explicit StateTracer(const IterationTracer& tracer)
+        : previous(std::exchange(active_trace(), tracer.get_trace())) {
+        tracer.state();
+    }
+    ~StateTracer() { active_trace() = previous; }
+    StateTracer(const StateTracer&) = delete;
+    StateTracer& operator=(const StateTracer&) = delete;
+};
+
+/// Measures the time of a call of nature and adds it to the active trace
+class NatureTimer {
+protected:
+    SolverTrace* trace;
+    chrono::steady_clock::time_point start;
+
+public:
+    NatureTimer() : trace(active_trace()) {
+        if (trace != nullptr) start = chrono::steady_clock::now();
+    }
+    ~NatureTimer() {
+        if (trace != nullptr)
+            trace->add_nature_call(
+                chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() -
+                                                           start)
+                    .count());
+    }
+};
+
+} // namespace internal
+}} // namespace craam::algorithms
+
+// Hooks used by the solvers; they expand to nothing unless CRAAM_TRACE is defined.
+#ifdef CRAAM_TRACE
+#define CRAAM_TRACE_SOLVER(tracer, method)                                             \
+    craam::algorithms::internal::IterationTracer tracer(method)
+#define CRAAM_TRACE_BEGIN(tracer, phase)                                               \
+    tracer.begin(craam::algorithms::TracePhase::phase)
+#define CRAAM_TRACE_END(tracer, phase) tracer.end(craam::algorithms::TracePhase::phase)
+#define CRAAM_TRACE_NEXT(tracer, residual) tracer.next(residual)
+#define CRAAM_TRACE_STATE(tracer)                                                      \
+    craam::algorithms::internal::StateTracer craam_state_tracer(tracer)
+#define CRAAM_TRACE_NATURE() craam::algorithms::internal::NatureTimer craam_nature_timer
+#else
+#define CRAAM_TRACE_SOLVER(tracer, method)
+#define CRAAM_TRACE_BEGIN(tracer, phase) ((void)0)
+#define CRAAM_TRACE_END(tracer, phase) ((void)0)
+#define CRAAM_TRACE_NEXT(tracer, residual) ((void)0)
+#define CRAAM_TRACE_STATE(tracer) ((void)0)
+#define CRAAM_TRACE_NATURE() ((void)0)
+#endif
+
+// Counting replacements of the global allocation functions, see the top of the file.
+#if defined(CRAAM_TRACE) && defined(CRAAM_TRACE_ALLOCATIONS)
+#include <cstdlib>
+#include <new>
+
+namespace craam { namespace algorithms { namespace internal {
+/// Marks the allocations as counted during the static initialization
+static const bool allocation_hooks_installed = (allocation_tracking() = true);
+}}} // namespace craam::algorithms::internal
+
+void* operator new(std::size_t size) {
+    craam::algorithms::internal::allocation_count().fetch_add(1,
+                                                               std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
@@ -29,6 +29,36 @@
 #include "craam/algorithms/values_mdpo.hpp"
 
 namespace craam { namespace algorithms {
+
+namespace internal {
+/// Whether the action is flagged as eliminated; null or empty flags mean none is
+inline bool is_eliminated(const vector<bool>* eliminated, size_t actionid) {
+    return eliminated != nullptr && !eliminated->empty() && (*eliminated)[actionid];
+}
+
+/// Flags the action as eliminated and allocates the flags when needed; null flags
+/// are ignored
+inline void eliminate(vector<bool>* eliminated, size_t actionid, size_t action_count) {
+    if (eliminated == nullptr) return;
+    if (eliminated->empty()) eliminated->resize(action_count, false);
+    (*eliminated)[actionid] = true;
+}
+
+/// Makes sure that the best action is never eliminated
+inline void keep_action(vector<bool>* eliminated, long actionid) {
+    if (actionid >= 0 && eliminated != nullptr && !eliminated->empty())
+        (*eliminated)[actionid] = false;
+}
+
+/// Total number of actions flagged as eliminated in all states
+inline size_t eliminated_count(const vector<vector<bool>>& eliminated) {
+    size_t count = 0;
+    for (const auto& flags : eliminated)
+        count += size_t(std::count(flags.cbegin(), flags.cend(), true));
+    return count;
+}
+} // namespace internal
+
 // *******************************************************
 // State computation methods
 // *******************************************************
@@ -40,28 +70,39 @@ actions. Such state is assumed to be terminal.
 @param state State to compute the value for
 @param valuefunction Value function to use for the following states
 @param discount Discount factor
+@param eliminated Optional flags of the actions that are skipped; the actions with
+        a value smaller than the threshold (except the best one) are flagged. An
+        empty vector means that no action is flagged.
+@param threshold Value below which the actions are flagged as eliminated
 
 @return (Index of best action, value), returns 0 if the state is terminal.
 */
 template <class AType>
-inline pair<long, prec_t> value_max_state(const SAState<AType>& state,
-                                          const numvec& valuefunction, prec_t discount) {
+inline pair<long, prec_t>
+value_max_state(const SAState<AType>& state, const numvec& valuefunction,
+                prec_t discount, vector<bool>* eliminated = nullptr,
+                prec_t threshold = -numeric_limits<prec_t>::infinity()) {
     if (state.is_terminal()) return make_pair(-1, 0.0);
     // skip invalid state.get_actions()
+    assert(eliminated != nullptr || threshold == -numeric_limits<prec_t>::infinity());
 
     prec_t maxvalue = -numeric_limits<prec_t>::infinity();
     long result = -1l;
 
     for (size_t i = 0; i < state.size(); i++) {
+        if (internal::is_eliminated(eliminated, i)) continue;
         auto const& action = state[i];
 
         auto value = value_action(action, valuefunction, discount);
+        if (eliminated != nullptr && value < threshold)
+            internal::eliminate(eliminated, i, state.size());
 
         if (value >= maxvalue) {
             maxvalue = value;
             result = i;
         }
     }
+    internal::keep_action(eliminated, result);
 
     return {result, maxvalue};
 }
@@ -173,10 +214,10 @@ Computes the value of a fixed action and any response of nature.
 
 \return Value of state, 0 if it's terminal regardless of the action index
 */
-template <class SType>
+template <class SType, class Nature>
 inline vec_scal_t value_fix_state(const SType& state, numvec const& valuefunction,
                                   prec_t discount, long actionid, long stateid,
-                                  const SANature& nature) {
+                                  const Nature& nature) {
     // this is the terminal state, return 0
     if (state.is_terminal()) return make_pair(numvec(0), 0);
 
@@ -195,6 +236,53 @@ inline vec_scal_t value_fix_state(const SType& state, numvec const& valuefunctio
     return value_action(action, valuefunction, discount, stateid, actionid, nature);
 }
 
+/**
+ * Finds the greedy action and its value for the given value function, see
+ * value_max_state below. The response of nature to the greedy action is left in
+ * workspace.best_distribution and is empty when there is no action.
+ *
+ * The actions flagged in eliminated are skipped and the actions with a value
+ * smaller than the threshold are flagged, like in the plain value_max_state.
+ *
+ * @return (Action index, value), (-1, 0) if the state is terminal
+ */
+template <typename SType, class Nature>
+inline pair<long, prec_t>
+value_max_state(const SType& state, const numvec& valuefunction, prec_t discount,
+                long stateid, const Nature& nature, internal::NatureWorkspace& workspace,
+                vector<bool>* eliminated = nullptr,
+                prec_t threshold = -numeric_limits<prec_t>::infinity()) {
+    // can finish immediately when the state is terminal
+    if (state.is_terminal()) {
+        workspace.best_distribution.clear();
+        return {-1, 0};
+    }
+    assert(eliminated != nullptr || threshold == -numeric_limits<prec_t>::infinity());
+    // make sure that the number of natures is the same as the number of actions
+    prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+
+    long result = -1;
+    for (size_t i = 0; i < state.size(); i++) {
+        if (internal::is_eliminated(eliminated, i)) continue;
+        const auto& action = state[i];
+
+        prec_t value = value_action(action, valuefunction, discount, stateid, long(i),
+                                    nature, workspace.zvalues, workspace.distribution);
+        if (eliminated != nullptr && value < threshold)
+            internal::eliminate(eliminated, i, state.size());
+        if (value > maxvalue) {
+            maxvalue = value;
+            result = long(i);
+            // keep the best response and reuse the buffer of the previous one
+            swap(workspace.best_distribution, workspace.distribution);
+        }
+    }
+
+    if (result < 0) workspace.best_distribution.clear();
+    internal::keep_action(eliminated, result);
+    return {result, maxvalue};
+}
+
 /**
   * Finds the greedy action and its value for the given value function.
   * This function assumes a robust or optimistic response by nature depending on the
@@ -209,34 +297,64 @@ inline vec_scal_t value_fix_state(const SType& state, numvec const& valuefunctio
   * @param natures Method used to compute the response of nature; one for each
   * action available in the state.
   *
+  * The z-values and the responses of nature are computed in the thread-local
+  * workspace; only the returned distribution of nature is allocated.
+  *
   * \return (Action index, outcome index, value), 0 if it's terminal regardless of
   * the action index
   */
-template <typename SType>
-inline ind_vec_scal_t value_max_state(const SType& state, const numvec& valuefunction,
-                                      prec_t discount, long stateid,
-                                      const SANature& nature) {
-    // can finish immediately when the state is terminal
-    if (state.is_terminal()) return make_tuple(-1, numvec(), 0);
-    // make sure that the number of natures is the same as the number of actions
-    prec_t maxvalue = -numeric_limits<prec_t>::infinity();
-
-    long result = -1;
-    numvec result_outcome;
+template <typename SType, class Nature>
+inline ind_vec_scal_t
+value_max_state(const SType& state, const numvec& valuefunction, prec_t discount,
+                long stateid, const Nature& nature, vector<bool>* eliminated = nullptr,
+                prec_t threshold = -numeric_limits<prec_t>::infinity()) {
+    internal::NatureWorkspace& workspace = internal::nature_workspace();
+    const auto [result, maxvalue] =
+        value_max_state(state, valuefunction, discount, stateid, nature, workspace,
+                        eliminated, threshold);
+    return {result, workspace.best_distribution, maxvalue};
+}
 
-    for (size_t i = 0; i < state.size(); i++) {
-        const auto& action = state[i];
+/**
+ * Computes the value of a fixed action and any response of nature, see
+ * value_fix_state above. The response of nature is left in
+ * workspace.best_distribution and is empty when the state is terminal.
+ *
+ * @return Value of state, 0 if it's terminal regardless of the action index
+ */
+template <class SType, class Nature>
+inline prec_t value_fix_state(const SType& state, numvec const& valuefunction,
+                              prec_t discount, long actionid, long stateid,
+                              const Nature& nature,
+                              internal::NatureWorkspace& workspace) {
+    // this is the terminal state, return 0
+    if (state.is_terminal()) {
+        workspace.best_distribution.clear();
+        return 0;
+    }
 
-        auto value =
-            value_action(action, valuefunction, discount, stateid, long(i), nature);
-        if (value.second > maxvalue) {
-            maxvalue = value.second;
-            result = long(i);
-            result_outcome = move(value.first);
-        }
+    if (actionid < 0 || actionid >= long(state.size())) {
+        throw ModelError(
+            "invalid actionid: " + std::to_string(actionid) +
+                " for action count: " + std::to_string(state.get_actions().size()),
+            stateid, actionid);
     }
 
-    return {result, result_outcome, maxvalue};
+    return value_action(state[actionid], valuefunction, discount, stateid, actionid,
+                        nature, workspace.zvalues, workspace.best_distribution);
+}
+
+/**
+ * Maximal number of transitions (or outcomes) over the actions of each state of
+ * the model. This is the length of the longest response of nature in the state.
+ */
+template <class Model> inline sizvec nature_capacities(const Model& model) {
+    sizvec result(model.size(), 0);
+    for (size_t s = 0; s < model.size(); s++) {
+        for (const auto& action : model[s].get_actions())
+            result[s] = max(result[s], action.size());
+    }
+    return result;
 }
 
 }} // namespace craam::algorithms
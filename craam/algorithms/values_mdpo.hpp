@@ -37,6 +37,67 @@ using namespace std;
 // ActionO computation methods
 // *******************************************************
 
+/**
+ * The function computes the value of each outcome by adding the
+ * reward function to the discounted value function
+ * @param action Action for which to compute the z-values
+ * @param valuefunction Value function over ALL states
+ * @param discount Discount facto
+ * @param z_outcome Output buffer for the values of outcomes; it is resized as
+ *          needed and can be reused across calls
+ */
+inline void compute_zvalues(const ActionO& action, const numvec& valuefunction,
+                            prec_t discount, numvec& z_outcome) {
+    if (action.get_outcomes().empty()) throw invalid_argument("ActionO with no outcomes");
+    z_outcome.resize(action.size());
+#pragma omp simd
+    for (size_t i = 0; i < action.size(); i++)
+        z_outcome[i] = action[i].value(valuefunction, discount);
+}
+
+/**
+ * The function computes the value of each outcome by adding the
+ * reward function to the discounted value function
+ * @param action Action for which to compute the z-values
+ * @param valuefunction Value function over ALL states
+ * @param discount Discount facto
+ * @return The length of the zvalues is the same as the number of
+ *          transitions with positive probabilities.
+ */
+inline numvec compute_zvalues(const ActionO& action, const numvec& valuefunction,
+                              prec_t discount) {
+    numvec z_outcome;
+    compute_zvalues(action, valuefunction, discount, z_outcome);
+    return z_outcome;
+}
+
+/**
+ * Computes the maximal outcome distribution constraints on the nature's
+ * distribution. Does not work when the number of outcomes is zero. Does not
+ * allocate memory when the buffers have sufficient capacity and the nature
+ * implements the in-place interface.
+ *
+ * @param action Action for which the value is computed
+ * @param valuefunction Value function reference
+ * @param discount Discount factor
+ * @param nature Method used to compute the response of nature.
+ * @param zvalues Buffer used to store the values of outcomes
+ * @param distribution Output buffer for the outcome distribution
+ *
+ * @return The mean value for the choice of the nature
+ */
+template <class Nature>
+inline prec_t value_action(const ActionO& action, const numvec& valuefunction,
+                           prec_t discount, long stateid, long actionid,
+                           const Nature& nature, numvec& zvalues, numvec& distribution) {
+    assert(action.get_distribution().size() == action.get_outcomes().size());
+    if (action.get_outcomes().empty())
+        throw invalid_argument("Action with no action.get_outcomes().");
+    compute_zvalues(action, valuefunction, discount, zvalues);
+    return nature_response(nature, stateid, actionid, action.get_distribution(), zvalues,
+                           distribution);
+}
+
 /**
  * Computes the maximal outcome distribution constraints on the nature's
  * distribution. Does not work when the number of outcomes is zero.
@@ -48,18 +109,14 @@ using namespace std;
  *
  * @return Outcome distribution and the mean value for the choice of the nature
  */
+template <class Nature>
 inline vec_scal_t value_action(const ActionO& action, const numvec& valuefunction,
                                prec_t discount, long stateid, long actionid,
-                               const SANature& nature) {
-    assert(action.get_distribution().size() == action.get_outcomes().size());
-    if (action.get_outcomes().empty())
-        throw invalid_argument("Action with no action.get_outcomes().");
-    // loop over all outcomes
-    numvec outcomevalues(action.size());
-#pragma omp simd
-    for (size_t i = 0; i < action.size(); i++)
-        outcomevalues[i] = action[i].value(valuefunction, discount);
-    return nature(stateid, actionid, action.get_distribution(), outcomevalues);
+                               const Nature& nature) {
+    numvec distribution;
+    prec_t value = value_action(action, valuefunction, discount, stateid, actionid, nature,
+                                internal::nature_workspace().zvalues, distribution);
+    return {move(distribution), value};
 }
 
 // *******************************************************
@@ -107,25 +164,6 @@ inline prec_t value_action(const ActionO& action, numvec const& valuefunction,
     return averagevalue;
 }
 
-/**
- * The function computes the value of each outcome by adding the
- * reward function to the discounted value function
- * @param action Action for which to compute the z-values
- * @param valuefunction Value function over ALL states
- * @param discount Discount facto
- * @return The length of the zvalues is the same as the number of
- *          transitions with positive probabilities.
- */
-inline numvec compute_zvalues(const ActionO& action, const numvec& valuefunction,
-                              prec_t discount) {
-    if (action.get_outcomes().empty()) throw invalid_argument("ActionO with no outcomes");
-    numvec z_outcome(action.size());
-#pragma omp simd
-    for (size_t i = 0; i < action.size(); i++)
-        z_outcome[i] = action[i].value(valuefunction, discount);
-    return z_outcome;
-}
-
 // **********************************************************
 // State methods
 // **********************************************************
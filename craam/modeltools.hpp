@@ -28,19 +28,31 @@
 #include "craam/MDPO.hpp"
 #include "craam/State.hpp"
 #include "craam/Transition.hpp"
+#include "craam/builder.hpp"
+#include "craam/algorithms/graph.hpp"
 #include "craam/definitions.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <csv.h>
 #include <fstream>
 #include <functional>
 #include <istream>
+#include <iterator>
 #include <memory>
 #include <rm/range.hpp>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // **********************************************************************
 // ***********************    HELPER FUNCTIONS    ***********************
 // **********************************************************************
@@ -136,6 +148,308 @@ inline MDPO robustify(const MDP& mdp, bool allowzeros = false) {
     return rmdp;
 }
 
+// *************************************************************************************
+// **** Parallel CSV parsing and buffered formatting
+// *************************************************************************************
+
+namespace internal {
+
+/// Columns parsed from a csv file
+struct CSVColumns {
+    /// Integer columns (ids) in the order in which they were requested
+    vector<indvec> ids;
+    /// Real-valued columns in the order in which they were requested
+    vector<numvec> values;
+
+    CSVColumns(size_t idcount = 0, size_t valuecount = 0)
+        : ids(idcount), values(valuecount) {}
+
+    /// Number of rows
+    size_t size() const { return ids.empty() ? 0 : ids[0].size(); }
+
+    /// Appends the rows of the other columns
+    void append(const CSVColumns& other) {
+        for (size_t i = 0; i < ids.size(); ++i)
+            ids[i].insert(ids[i].end(), other.ids[i].cbegin(), other.ids[i].cend());
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i].insert(values[i].end(), other.values[i].cbegin(),
+                             other.values[i].cend());
+    }
+};
+
+/// Reads the entire content of the file into memory
+inline string read_text_file(const string& file_name) {
+    ifstream ifs(file_name, ios::binary | ios::ate);
+    if (!ifs.is_open()) throw runtime_error("Could not open the file: " + file_name);
+    string text(size_t(ifs.tellg()), '\0');
+    ifs.seekg(0);
+    ifs.read(&text[0], streamsize(text.size()));
+    if (!ifs) throw runtime_error("Failed reading the file: " + file_name);
+    return text;
+}
+
+/// Reads the remaining content of the stream into memory
+inline string read_text_stream(istream& input) {
+    return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+inline bool csv_is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+/**
+ * Parses lines between the two positions of the text. Returns an empty string
+ * when successful and the error message otherwise; errorpos is then set to the
+ * position of the offending line.
+ *
+ * @param targets Column index for each field of the line (-1 when the field is
+ *                  ignored); ids precede the values
+ */
+inline string parse_csv_range(const string& text, size_t begin, size_t end,
+                              const vector<long>& targets, CSVColumns& columns,
+                              size_t& errorpos) {
+    const long idcount = long(columns.ids.size());
+    const char* const first = text.data();
+    const char* p = first + begin;
+    const char* const last = first + end;
+
+    while (p < last) {
+        const char* lineend = static_cast<const char*>(memchr(p, '\n', last - p));
+        if (lineend == nullptr) lineend = last;
+        errorpos = p - first;
+
+        const char* q = p;
+        while (q < lineend && csv_is_space(*q))
+            ++q;
+        // skip empty lines
+        if (q == lineend) {
+            p = lineend + 1;
+            continue;
+        }
+
+        size_t field = 0;
+        for (q = p; field < targets.size(); ++field) {
+            while (q < lineend && csv_is_space(*q))
+                ++q;
+            const long target = targets[field];
+            if (target >= 0) {
+                if (q == lineend || *q == ',') return "Missing value";
+                if (target < idcount) {
+                    long value;
+                    const auto [ptr, ec] = std::from_chars(q, lineend, value);
+                    if (ec != std::errc()) return "Invalid integer value";
+                    columns.ids[target].push_back(value);
+                    q = ptr;
+                } else {
+                    double value;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+                    // from_chars does not accept the leading plus sign
+                    const char* start = (*q == '+') ? q + 1 : q;
+                    const auto [ptr, ec] = std::from_chars(start, lineend, value);
+                    if (ec != std::errc()) return "Invalid real value";
+#else
+                    char* ptr;
+                    value = strtod(q, &ptr);
+                    if (ptr == q) return "Invalid real value";
+#endif
+                    columns.values[target - idcount].push_back(value);
+                    q = ptr;
+                }
+                while (q < lineend && csv_is_space(*q))
+                    ++q;
+                if (q < lineend && *q != ',') return "Invalid value";
+            } else {
+                const char* comma = static_cast<const char*>(memchr(q, ',', lineend - q));
+                q = comma == nullptr ? lineend : comma;
+            }
+            if (q == lineend) break;
+            ++q; // skip the comma
+        }
+        if (field + 1 < targets.size()) return "Too few columns";
+        p = lineend + 1;
+    }
+    return {};
+}
+
+/**
+ * Parses the csv text with a header in parallel. The text is split into byte
+ * ranges aligned to line boundaries and each range is parsed into separate
+ * columns, which are then concatenated in the order of the file.
+ *
+ * Fields are separated by commas and may not be quoted. Columns in the header
+ * that are not requested are ignored.
+ *
+ * @param text Content of the csv file
+ * @param idnames Names of the integer columns
+ * @param valuenames Names of the real-valued columns
+ */
+inline CSVColumns parse_csv(const string& text, const vector<string>& idnames,
+                            const vector<string>& valuenames) {
+    // parse the header
+    size_t headerend = text.find('\n');
+    if (headerend == string::npos) headerend = text.size();
+    vector<string> header;
+    for (size_t p = 0; p <= headerend;) {
+        size_t e = text.find(',', p);
+        if (e == string::npos || e > headerend) e = headerend;
+        size_t b = p, f = e;
+        while (b < f && csv_is_space(text[b]))
+            ++b;
+        while (f > b && csv_is_space(text[f - 1]))
+            --f;
+        header.push_back(text.substr(b, f - b));
+        p = e + 1;
+    }
+
+    // map fields to the columns; fields after the last requested one are ignored
+    vector<long> targets(header.size(), -1);
+    size_t lastfield = 0;
+    const size_t colcount = idnames.size() + valuenames.size();
+    for (size_t c = 0; c < colcount; ++c) {
+        const string& name =
+            c < idnames.size() ? idnames[c] : valuenames[c - idnames.size()];
+        auto it = find(header.cbegin(), header.cend(), name);
+        if (it == header.cend())
+            throw invalid_argument("Missing column '" + name + "' in the csv header.");
+        targets[it - header.cbegin()] = long(c);
+        lastfield = max(lastfield, size_t(it - header.cbegin()));
+    }
+    targets.resize(lastfield + 1);
+
+    // split the body into chunks that start at line boundaries
+    const size_t bodybegin = min(headerend + 1, text.size());
+    const size_t bodylength = text.size() - bodybegin;
+#ifdef _OPENMP
+    const size_t threads = size_t(omp_get_max_threads());
+#else
+    const size_t threads = 1;
+#endif
+    const size_t chunkcount = max<size_t>(1, min(4 * threads, bodylength / (1 << 16)));
+    sizvec bounds(chunkcount + 1, text.size());
+    bounds[0] = bodybegin;
+    for (size_t k = 1; k < chunkcount; ++k) {
+        size_t b = max(bounds[k - 1], bodybegin + k * (bodylength / chunkcount));
+        while (b < text.size() && text[b - 1] != '\n')
+            ++b;
+        bounds[k] = b;
+    }
+
+    vector<CSVColumns> parts(chunkcount, CSVColumns(idnames.size(), valuenames.size()));
+    vector<string> errors(chunkcount);
+    sizvec errorpos(chunkcount, 0);
+
+    bool openmp_error = false;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < chunkcount; ++k) {
+        try {
+            errors[k] = parse_csv_range(text, bounds[k], bounds[k + 1], targets, parts[k],
+                                        errorpos[k]);
+        } catch (const exception& e) {
+            craam::internal::openmp_exception_handler(e, "parse_csv");
+            openmp_error = true;
+        }
+    }
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+
+    // report the first error in the file
+    for (size_t k = 0; k < chunkcount; ++k) {
+        if (!errors[k].empty()) {
+            const size_t line =
+                1 + size_t(count(text.cbegin(), text.cbegin() + errorpos[k], '\n'));
+            throw invalid_argument(errors[k] + " on line " + std::to_string(line) +
+                                   " of the csv file.");
+        }
+    }
+
+    CSVColumns result(std::move(parts[0]));
+    for (size_t k = 1; k < chunkcount; ++k)
+        result.append(parts[k]);
+    return result;
+}
+
+/**
+ * Appends the csv rows formatted for each state to the output. States are formatted
+ * in parallel in blocks, which are then written in order.
+ *
+ * @param statecount Number of states
+ * @param format Function (stateid, string&) that appends the rows of the state
+ */
+template <class Fun>
+inline void write_csv_blocks(ostream& output, size_t statecount, Fun&& format) {
+    constexpr size_t blocksize = 256;
+#ifdef _OPENMP
+    const size_t batchsize = 4 * size_t(omp_get_max_threads());
+#else
+    const size_t batchsize = 1;
+#endif
+    const size_t blockcount = (statecount + blocksize - 1) / blocksize;
+    vector<string> buffers(batchsize);
+
+    for (size_t batch = 0; batch < blockcount; batch += batchsize) {
+        const size_t batchend = min(blockcount, batch + batchsize);
+        bool openmp_error = false;
+#pragma omp parallel for schedule(dynamic)
+        for (size_t b = batch; b < batchend; ++b) {
+            try {
+                string& buffer = buffers[b - batch];
+                buffer.clear();
+                for (size_t s = b * blocksize; s < min(statecount, (b + 1) * blocksize);
+                     ++s)
+                    format(s, buffer);
+            } catch (const exception& e) {
+                craam::internal::openmp_exception_handler(e, "write_csv_blocks");
+                openmp_error = true;
+            }
+        }
+        if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+        for (size_t b = batch; b < batchend; ++b)
+            output.write(buffers[b - batch].data(), streamsize(buffers[b - batch].size()));
+    }
+    output.flush();
+}
+
+/**
+ * Formats numbers the same way as the output stream does with its precision and
+ * fixed or scientific flags.
+ */
+class CSVNumberFormat {
+public:
+    CSVNumberFormat(const ostream& output) : precision(int(output.precision())) {
+        const auto floatfield = output.flags() & ios::floatfield;
+        format = floatfield == ios::fixed ? "%.*f"
+                 : floatfield == ios::scientific ? "%.*e"
+                                                 : "%.*g";
+    }
+
+    void append(string& buffer, long value) const {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+    }
+
+    void append(string& buffer, size_t value) const {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+    }
+
+    void append(string& buffer, prec_t value) const {
+        char digits[64];
+        const int length = snprintf(digits, sizeof(digits), format, precision, value);
+        if (length < int(sizeof(digits))) {
+            buffer.append(digits, size_t(length));
+        } else { // large numbers in the fixed notation
+            string large(size_t(length) + 1, '\0');
+            snprintf(&large[0], large.size(), format, precision, value);
+            buffer.append(large.data(), size_t(length));
+        }
+    }
+
+protected:
+    int precision;
+    const char* format;
+};
+
+} // namespace internal
+
 // *************************************************************************************
 // **** MDP/O CSV tools
 // *************************************************************************************
@@ -153,25 +467,41 @@ inline MDP mdp_from_csv(io::CSVReader<5>& in) {
     long idstatefrom, idaction, idstateto;
     double probability, reward;
 
-    MDP mdp;
+    ModelBuilder builder;
     in.read_header(io::ignore_extra_column, "idstatefrom", "idaction", "idstateto",
                    "probability", "reward");
-    bool read_row = in.read_row(idstatefrom, idaction, idstateto, probability, reward);
-    do {
-        add_transition(mdp, idstatefrom, idaction, idstateto, probability, reward);
-        read_row = in.read_row(idstatefrom, idaction, idstateto, probability, reward);
-    } while (read_row);
-    return mdp;
+    while (in.read_row(idstatefrom, idaction, idstateto, probability, reward))
+        builder.add(idstatefrom, idaction, idstateto, probability, reward);
+    return builder.build_mdp();
+}
+
+namespace internal {
+/// Builds the MDP from the text of a csv file in parallel
+inline MDP mdp_from_csv_text(const string& text) {
+    const CSVColumns columns =
+        parse_csv(text, {"idstatefrom", "idaction", "idstateto"}, {"probability", "reward"});
+    return mdp_from_columns(columns.ids[0], columns.ids[1], columns.ids[2],
+                            columns.values[0], columns.values[1]);
 }
+} // namespace internal
 
+/**
+Loads an MDP definition from a csv file; see mdp_from_csv(io::CSVReader<5>&)
+for the format. The file is parsed in parallel in chunks, and the model is then
+built in parallel for each state. Fields cannot be quoted.
+
+The result is identical to loading the file sequentially.
+*/
 inline MDP mdp_from_csv(const string& file_name) {
-    io::CSVReader<5> reader(file_name);
-    return mdp_from_csv(reader);
+    return internal::mdp_from_csv_text(internal::read_text_file(file_name));
 }
 
+/**
+Loads an MDP definition from a csv stream in parallel. See
+mdp_from_csv(const string&).
+*/
 inline MDP mdp_from_csv(istream& input) {
-    io::CSVReader<5> reader("temp_file", input);
-    return mdp_from_csv(reader);
+    return internal::mdp_from_csv_text(internal::read_text_stream(input));
 }
 
 /**
@@ -198,11 +528,12 @@ inline void to_csv(const MDP& mdp, ostream& output, bool header = true) {
                << "idaction,"
                << "idstateto,"
                << "probability,"
-               << "reward" << endl;
+               << "reward" << '\n';
     }
 
+    const internal::CSVNumberFormat number(output);
     // idstatefrom
-    for (size_t i = 0l; i < mdp.size(); i++) {
+    internal::write_csv_blocks(output, mdp.size(), [&](size_t i, string& buffer) {
         // idaction
         for (size_t j = 0; j < mdp[i].size(); j++) {
             const auto& tran = mdp[i][j];
@@ -212,11 +543,19 @@ inline void to_csv(const MDP& mdp, ostream& output, bool header = true) {
             const auto& probabilities = tran.get_probabilities();
             // idstateto
             for (size_t l = 0; l < tran.size(); l++) {
-                output << i << ',' << j << ',' << indices[l] << ',' << probabilities[l]
-                       << ',' << rewards[l] << endl;
+                number.append(buffer, i);
+                buffer += ',';
+                number.append(buffer, j);
+                buffer += ',';
+                number.append(buffer, indices[l]);
+                buffer += ',';
+                number.append(buffer, probabilities[l]);
+                buffer += ',';
+                number.append(buffer, rewards[l]);
+                buffer += '\n';
             }
         }
-    }
+    });
 }
 
 /**
@@ -304,29 +643,40 @@ inline MDPO mdpo_from_csv(io::CSVReader<6>& in) {
     long idstatefrom, idaction, idoutcome, idstateto;
     double probability, reward;
 
-    MDPO mdp;
-
+    ModelBuilder builder;
     in.read_header(io::ignore_extra_column, "idstatefrom", "idaction", "idoutcome",
                    "idstateto", "probability", "reward");
-    bool read_row =
-        in.read_row(idstatefrom, idaction, idoutcome, idstateto, probability, reward);
-    do {
-        add_transition(mdp, idstatefrom, idaction, idoutcome, idstateto, probability,
-                       reward);
-        read_row =
-            in.read_row(idstatefrom, idaction, idoutcome, idstateto, probability, reward);
-    } while (read_row);
-    return mdp;
+    while (in.read_row(idstatefrom, idaction, idoutcome, idstateto, probability, reward))
+        builder.add(idstatefrom, idaction, idoutcome, idstateto, probability, reward);
+    return builder.build_mdpo();
 }
 
+namespace internal {
+/// Builds the MDPO from the text of a csv file in parallel
+inline MDPO mdpo_from_csv_text(const string& text) {
+    const CSVColumns columns =
+        parse_csv(text, {"idstatefrom", "idaction", "idoutcome", "idstateto"},
+                  {"probability", "reward"});
+    return mdpo_from_columns(columns.ids[0], columns.ids[1], columns.ids[2],
+                             columns.ids[3], columns.values[0], columns.values[1]);
+}
+} // namespace internal
+
+/**
+Loads an MDPO definition from a csv file; see mdpo_from_csv(io::CSVReader<6>&)
+for the format. The file is parsed and the model is built in parallel, as in
+mdp_from_csv(const string&).
+*/
 inline MDPO mdpo_from_csv(const string& file_name) {
-    io::CSVReader<6> reader(file_name);
-    return mdpo_from_csv(reader);
+    return internal::mdpo_from_csv_text(internal::read_text_file(file_name));
 }
 
+/**
+Loads an MDPO definition from a csv stream in parallel. See
+mdpo_from_csv(const string&).
+*/
 inline MDPO mdpo_from_csv(istream& input) {
-    io::CSVReader<6> reader("temp_file", input);
-    return mdpo_from_csv(reader);
+    return internal::mdpo_from_csv_text(internal::read_text_stream(input));
 }
 
 /**
@@ -357,11 +707,12 @@ inline void to_csv(const MDPO& rmdp, ostream& output, bool header = true) {
                << "idoutcome,"
                << "idstateto,"
                << "probability,"
-               << "reward" << endl;
+               << "reward" << '\n';
     }
 
+    const internal::CSVNumberFormat number(output);
     // idstatefrom
-    for (size_t i = 0l; i < rmdp.size(); i++) {
+    internal::write_csv_blocks(output, rmdp.size(), [&](size_t i, string& buffer) {
         const auto& actions = rmdp[i].get_actions();
         // idaction
         for (size_t j = 0; j < actions.size(); j++) {
@@ -376,12 +727,22 @@ inline void to_csv(const MDPO& rmdp, ostream& output, bool header = true) {
                 const auto& probabilities = tran.get_probabilities();
                 // idstateto
                 for (size_t l = 0; l < tran.size(); l++) {
-                    output << i << ',' << j << ',' << k << ',' << indices[l] << ','
-                           << probabilities[l] << ',' << rewards[l] << endl;
+                    number.append(buffer, i);
+                    buffer += ',';
+                    number.append(buffer, j);
+                    buffer += ',';
+                    number.append(buffer, k);
+                    buffer += ',';
+                    number.append(buffer, indices[l]);
+                    buffer += ',';
+                    number.append(buffer, probabilities[l]);
+                    buffer += ',';
+                    number.append(buffer, rewards[l]);
+                    buffer += '\n';
                 }
             }
         }
-    }
+    });
 }
 
 /**
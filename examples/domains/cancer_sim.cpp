@@ -48,6 +48,11 @@ struct CancerState {
         Q_p = state["Q_p"];
     }
 
+    /// Coordinates of the state used to find the closest representative state
+    std::array<double, 4> features() const noexcept {
+        return {C, P, Q, Q_p};
+    }
+
     bool in_bounds() const noexcept {
         return abs(C) < val_limit && abs(P) < val_limit && abs(Q) < val_limit && abs(Q_p) < val_limit;
     }
@@ -219,23 +224,17 @@ Rcpp::List cancer_transition(Rcpp::List state, bool action, Rcpp::List config){
 }
 
 
-/// Computes the distance between two state. 
-/// Used when constructing representative states for aggregation
-/// It is just euclidean distance for now.
-double state_distance(const CancerState& s1, const CancerState& s2) noexcept {
-    return sqrt(pow(s1.C - s2.C, 2) + pow(s1.P - s2.P, 2.0) + pow(s1.Q - s2.Q, 2.0) +
-                pow(s1.Q_p - s2.Q_p, 2.0));
-}
-
-/// This is a dumb exhaustive search, replace by some KNN techniques for improved performance
-/// 
-size_t closest_state(const CancerState& state, const std::vector<CancerState> rep_states) noexcept {
-
-    std::vector<double> distances(rep_states.size());
-    for(size_t i = 0; i < rep_states.size(); ++i){
-        distances[i] = state_distance(state, rep_states[i]);
+/// Builds the index of representative states for aggregation. The distance
+/// between states is the Euclidean distance of their features.
+craam::msen::NearestStateAggregator 
+state_aggregator(const std::vector<CancerState>& rep_states){
+    craam::numvecvec features;
+    features.reserve(rep_states.size());
+    for(const CancerState& state : rep_states){
+        const auto f = state.features();
+        features.emplace_back(f.cbegin(), f.cend());
     }
-    return std::distance(distances.cbegin(), std::min_element(distances.cbegin(), distances.cend()));
+    return craam::msen::NearestStateAggregator(features);
 }
 
 /**
@@ -248,13 +247,15 @@ class CancerSimulatorDisc {
 protected:
     Config config;                          ///< Configuration  of the simulator
     std::vector<CancerState> rep_states;    ///< Representative states
+    craam::msen::NearestStateAggregator aggregator; ///< Index of representative states
 
 public:
     using State = uint_t;
     using Action = uint_t;
 
     CancerSimulatorDisc(Config config, std::vector<CancerState> states) :
-        config(config), rep_states(states) {
+        config(config), rep_states(std::move(states)), 
+        aggregator(state_aggregator(rep_states)) {
         //std::cout << "in constructor" << std::endl;
     }
 
@@ -268,7 +269,7 @@ public:
 
         const auto [reward, cnextstate] = next_state(cstate, action == 0 ? false : true, config);
         const State next_s = cstate.in_bounds() ? 
-                                1 + closest_state(cnextstate, rep_states) : 0;
+                                1 + aggregator.closest(cnextstate.features().data()) : 0;
         return {reward, next_s};
     }
 
@@ -463,14 +464,14 @@ Rcpp::List simulate_trivial(Rcpp::List config, uint_t action, uint_t episodes, u
 /// State 0 is assume to be terminal and its action is ignored
 class ProximityPolicy{
     
-    std::vector<CancerState> states;
+    craam::msen::NearestStateAggregator aggregator;
     std::vector<uint_t> policy;
     
     
 public:
     
-    ProximityPolicy(std::vector<CancerState> states, std::vector<uint_t> policy) :
-        states(states), policy(policy)
+    ProximityPolicy(const std::vector<CancerState>& states, std::vector<uint_t> policy) :
+        aggregator(state_aggregator(states)), policy(policy)
     {
         if(states.size() != policy.size())
             throw std::runtime_error("states and policy sizes must match.");
@@ -478,7 +479,7 @@ public:
     
     /// returns the action for the closest discretized state
     uint_t operator()(const CancerState& state) noexcept {
-        const size_t idstate = closest_state(state, states);
+        const size_t idstate = aggregator.closest(state.features().data());
         return policy.at(idstate);
     }
 };
@@ -111,7 +111,7 @@ The regular value-function based methods are in the header
 
 | Method                  |  Algorithm                           |
 | ----------------------- | ------------------------------------ |
-| `solve_vi`              | Gauss-Seidel value iteration; runs in a single thread.
+| `solve_vi`              | Gauss-Seidel value iteration; runs in a single thread unless `VISolver::gs_async` is selected, which updates blocks of states asynchronously in parallel. `VISolver::prioritized` updates only the states with large Bellman residuals and their predecessors. `VISolver::topological` solves the strongly connected components of the model in a reverse topological order.
 | `solve_mpi`             | Jacobi modified policy iteration; parallelized with OpenMP. Generally, modified policy iteration is vastly more efficient than value iteration.
 | `rsolve_vi`             | Like the value iteration above, but also supports robust, risk-averse, or optimistic objectives.
 | `rsolve_mpi`            | Like the modified policy iteration above, but it also supports robust, risk-averse, optimistic objective.
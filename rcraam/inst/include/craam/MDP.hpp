@@ -119,4 +119,17 @@ inline void check_model(const MDP& mdp) {
     }
 }
 
+/**
+ * Checks that the model has no terminal states and throws ModelError for the first
+ * one. The value bounds used by the span stopping rule (see algorithms::ValueBounds)
+ * are not valid for terminal states; they should be modeled as absorbing states.
+ */
+inline void check_no_terminal(const MDP& mdp) {
+    for (long idstate = 0; idstate < long(mdp.size()); ++idstate) {
+        if (mdp[idstate].is_terminal())
+            throw ModelError("Value bounds require a model without terminal states.",
+                             idstate);
+    }
+}
+
 } // namespace craam
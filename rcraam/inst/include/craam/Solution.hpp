@@ -120,6 +120,112 @@ using SRobustSolution = Solution<pair<numvec, numvecvec>>;
 ///  2) distribution over outcomes
 using SRobustOutcomeSolution = Solution<pair<numvec, numvec>>;
 
+/**
+ * Policy of the decision maker and nature for an s,a-rectangular robust problem
+ * stored in flat arrays. The responses of nature of all states share one
+ * contiguous buffer in which each state owns a slice whose capacity is fixed when
+ * the policy is constructed, usually from the sparsity pattern of the model. The
+ * policy can be therefore updated in every iteration without allocating memory.
+ *
+ * The responses of different states can be set concurrently. Use to_policy to
+ * construct the policy of SARobustSolution or SARobustOutcomeSolution.
+ */
+class FlatSARobustPolicy {
+protected:
+    /// Action of the decision maker for each state
+    indvec actions;
+    /// Position of the first element of nature's response of each state, and the end
+    sizvec offsets;
+    /// Length of the current response of nature in each state
+    sizvec sizes;
+    /// Responses of nature for all states
+    numvec distributions;
+
+public:
+    /// Empty policy with no states
+    FlatSARobustPolicy() : actions(0), offsets(1, 0), sizes(0), distributions(0) {}
+
+    /**
+     * Preallocates the policy.
+     *
+     * @param capacities The maximal length of nature's response in each state
+     */
+    explicit FlatSARobustPolicy(const sizvec& capacities)
+        : actions(capacities.size(), -1), offsets(capacities.size() + 1, 0),
+          sizes(capacities.size(), 0) {
+        for (size_t s = 0; s < capacities.size(); s++)
+            offsets[s + 1] = offsets[s] + capacities[s];
+        distributions.resize(offsets.back(), 0.0);
+    }
+
+    /// Number of states
+    size_t size() const { return actions.size(); }
+
+    /// Action of the decision maker in the state
+    long action(size_t stateid) const {
+        assert(stateid < size());
+        return actions[stateid];
+    }
+
+    /// Length of nature's response in the state
+    size_t nature_size(size_t stateid) const {
+        assert(stateid < size());
+        return sizes[stateid];
+    }
+
+    /// Maximal length of nature's response in the state
+    size_t capacity(size_t stateid) const {
+        assert(stateid < size());
+        return offsets[stateid + 1] - offsets[stateid];
+    }
+
+    /**
+     * Copies the response of nature in the state to a vector, which reuses its
+     * memory when it is large enough.
+     */
+    void nature(size_t stateid, numvec& distribution) const {
+        assert(stateid < size());
+        const auto first = distributions.cbegin() + offsets[stateid];
+        distribution.assign(first, first + sizes[stateid]);
+    }
+
+    /**
+     * Sets the action of the decision maker and the response of nature in the
+     * state.
+     *
+     * @param stateid Index of the state
+     * @param actionid Action of the decision maker
+     * @param distribution Response of nature, must fit the capacity of the state
+     */
+    void set(size_t stateid, long actionid, const numvec& distribution) {
+        assert(stateid < size());
+        if (distribution.size() > capacity(stateid))
+            throw invalid_argument("Response of nature in state " +
+                                   std::to_string(stateid) +
+                                   " exceeds the preallocated capacity.");
+        actions[stateid] = actionid;
+        sizes[stateid] = distribution.size();
+        copy(distribution.cbegin(), distribution.cend(),
+             distributions.begin() + offsets[stateid]);
+    }
+
+    /// Action and response of nature in the state
+    pair<long, numvec> get(size_t stateid) const {
+        numvec distribution;
+        nature(stateid, distribution);
+        return {action(stateid), move(distribution)};
+    }
+
+    /// Constructs the policy in the format used by SARobustSolution
+    vector<pair<long, numvec>> to_policy() const {
+        vector<pair<long, numvec>> result;
+        result.reserve(size());
+        for (size_t s = 0; s < size(); s++)
+            result.push_back(get(s));
+        return result;
+    }
+};
+
 /**
  * Represents a solution to a problem with a static uncertainty. Unlike
  * the solution method, this structure contains no value function or Bellman
@@ -24,6 +24,7 @@
 #pragma once
 
 #include "craam/MDP.hpp"
+#include "craam/Solution.hpp"
 #include "craam/algorithms/nature_declarations.hpp"
 #include "craam/algorithms/values.hpp"
 #include "values_mdp.hpp"
@@ -53,6 +54,9 @@ protected:
     const MDP& mdp;
     /// Partial policy specification (action -1 is ignored and optimized)
     const indvec initial_policy;
+    /// Actions in each state that cannot be optimal and are skipped, see
+    /// policy_update; an empty vector means that no action is eliminated
+    mutable vector<vector<bool>> eliminated;
 
 public:
     /**
@@ -64,7 +68,7 @@ public:
     using state_type = State;
 
     /// Constructs the update with no constraints on the initial policy
-    PlainBellman(const MDP& mdp) : mdp(mdp), initial_policy(0) {}
+    PlainBellman(const MDP& mdp) : mdp(mdp), initial_policy(0), eliminated(mdp.size()) {}
 
     /**
      * A partial policy that can be used to fix some actions
@@ -72,7 +76,8 @@ public:
      * @param policy policy[s] = -1 means that the action should be optimized in
      * the state policy of length 0 means that all actions will be optimized
      */
-    PlainBellman(const MDP& mdp, indvec policy) : mdp(mdp), initial_policy(move(policy)) {
+    PlainBellman(const MDP& mdp, indvec policy)
+        : mdp(mdp), initial_policy(move(policy)), eliminated(mdp.size()) {
         if (!initial_policy.empty() && initial_policy.size() != mdp.size())
             throw std::invalid_argument("Policy length must match the number of states.");
     }
@@ -82,10 +87,17 @@ public:
 
     /**
      * Computes the Bellman update and returns the optimal action.
+     *
+     * Actions with a value below the threshold cannot be optimal and are skipped
+     * by all subsequent updates of the state (except the best action). The
+     * threshold must be computed from bounds on the optimal value function.
+     *
+     * @param threshold Value of actions below which they are eliminated
      * @returns New value for the state and the policy
      */
-    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
-                                            prec_t discount) const {
+    pair<prec_t, policy_type>
+    policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                  prec_t threshold = -numeric_limits<prec_t>::infinity()) const {
         try {
             // check whether this state should only be evaluated
             assert(stateid >= 0);
@@ -94,8 +106,9 @@ public:
                 prec_t newvalue;
                 policy_type action;
 
-                tie(action, newvalue) =
-                    value_max_state(mdp.at(stateid), valuefunction, discount);
+                tie(action, newvalue) = value_max_state(
+                    mdp.at(stateid), valuefunction, discount, &eliminated[stateid],
+                    threshold);
                 return make_pair(newvalue, action);
             } else { // fixed-action, do not copy
                 return {value_fix_state(mdp.at(stateid), valuefunction, discount,
@@ -150,6 +163,12 @@ public:
             return s[action].mean_reward();
         }
     }
+
+    /// Number of actions eliminated by policy_update in all states
+    size_t eliminated_count() const { return internal::eliminated_count(eliminated); }
+
+    /// Makes all actions available again, such as before solving with a new discount
+    void restore_actions() { eliminated.assign(mdp.size(), {}); }
 };
 
 /**
@@ -291,9 +310,15 @@ public:
  * When nature's vector is of length 0, this means that the nominal probability
  * should be followed.
  *
+ * @tparam Nature Type of the nature response. Natures passed as their concrete
+ *         types (e.g. nats::robust_l1) are dispatched statically and, if they
+ *         implement the in-place interface, the Bellman update does not allocate
+ *         except for the returned policy of nature. The default SANature
+ *         (std::function) is supported for compatibility.
+ *
  * @see PlainBellman for a plain implementation
  */
-class SARobustBellman {
+template <class Nature = SANature> class SARobustBellman {
 public:
     /// the policy of the decision maker: action index
     using dec_policy_type = long;
@@ -309,11 +334,14 @@ protected:
     /// MDP definition
     const MDP& mdp;
     /// Reference to the function that is used to call the nature
-    const SANature& nature;
+    const Nature& nature;
     /// Partial policy specification for the decision maker (action -1 is ignored and optimized)
     vector<dec_policy_type> decision_policy;
     /// Initial policy specification for the decision maker (should be never changed)
     const vector<dec_policy_type> initial_policy;
+    /// Actions in each state that cannot be optimal and are skipped, see
+    /// policy_update; an empty vector means that no action is eliminated
+    mutable vector<vector<bool>> eliminated;
 
 public:
     /**
@@ -322,10 +350,10 @@ public:
       @param policy Index of the action to take for each state
       @param nature Function that describes nature's response
       */
-    SARobustBellman(const MDP& mdp, const SANature& nature,
+    SARobustBellman(const MDP& mdp, const Nature& nature,
                     vector<dec_policy_type> policy = indvec(0))
         : mdp(mdp), nature(nature), decision_policy(move(policy)),
-          initial_policy(decision_policy) {
+          initial_policy(decision_policy), eliminated(mdp.size()) {
 
         if (!initial_policy.empty() && initial_policy.size() != mdp.size())
             throw std::invalid_argument("Policy length must match the number of states.");
@@ -342,11 +370,14 @@ public:
      * @param stateid  Index of the state
      * @param valuefunction Value function
      * @param discount Discount factor
+     * @param threshold Robust value of actions below which they are eliminated
+     *        from all subsequent updates, see PlainBellman::policy_update
      *
      * @returns New value for the state
      */
-    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
-                                            prec_t discount) const {
+    pair<prec_t, policy_type>
+    policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                  prec_t threshold = -numeric_limits<prec_t>::infinity()) const {
         try {
             prec_t newvalue = std::nan("");
             policy_type action;
@@ -356,8 +387,9 @@ public:
             // optimizing action
             if (decision_policy.empty() || decision_policy[stateid] < 0) {
                 long actionid;
-                tie(actionid, transition, newvalue) = value_max_state(
-                    mdp[stateid], valuefunction, discount, stateid, nature);
+                tie(actionid, transition, newvalue) =
+                    value_max_state(mdp[stateid], valuefunction, discount, stateid,
+                                    nature, &eliminated[stateid], threshold);
                 action = make_pair(actionid, move(transition));
             }
             // fixed-action, do not copy
@@ -396,6 +428,62 @@ public:
         }
     }
 
+    /**
+     * Maximal length of nature's response in each state; used to preallocate a
+     * FlatSARobustPolicy.
+     */
+    sizvec nature_capacities() const { return algorithms::nature_capacities(mdp); }
+
+    /**
+     * Computes the Bellman update like policy_update above, but stores the
+     * action and the response of nature in a preallocated flat policy instead of
+     * returning them.
+     *
+     * @returns New value for the state
+     */
+    prec_t policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                         FlatSARobustPolicy& policy,
+                         prec_t threshold = -numeric_limits<prec_t>::infinity()) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            long actionid;
+            prec_t newvalue;
+            if (decision_policy.empty() || decision_policy[stateid] < 0) {
+                tie(actionid, newvalue) =
+                    value_max_state(mdp[stateid], valuefunction, discount, stateid,
+                                    nature, workspace, &eliminated[stateid], threshold);
+            } else {
+                actionid = decision_policy[stateid];
+                newvalue = value_fix_state(mdp[stateid], valuefunction, discount,
+                                           actionid, stateid, nature, workspace);
+            }
+            policy.set(stateid, actionid, workspace.best_distribution);
+            return newvalue;
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Computes value function using the policy stored in a flat policy. Used in
+     * policy evaluation.
+     *
+     * @returns New value for the state
+     */
+    prec_t compute_value(const FlatSARobustPolicy& policy, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        try {
+            numvec& distribution = internal::nature_workspace().distribution;
+            policy.nature(stateid, distribution);
+            return value_fix_state(mdp[stateid], valuefunction, discount,
+                                   policy.action(stateid), distribution);
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
     /** Returns a reference to the transition probabilities
      *
      * @param stateid State for which to get the transition probabilites
@@ -457,6 +545,12 @@ public:
             decision_policy = policy;
         }
     }
+
+    /// Number of actions eliminated by policy_update in all states
+    size_t eliminated_count() const { return internal::eliminated_count(eliminated); }
+
+    /// Makes all actions available again, such as before solving with a new discount
+    void restore_actions() { eliminated.assign(mdp.size(), {}); }
 };
 
 /**
@@ -540,9 +634,12 @@ public:
         // check whether this state should only be evaluated or also optimized
         numvec init_policy =
             decision_policy.empty() ? numvec(0) : decision_policy[stateid];
-        std::tie(action, transitions, newvalue) =
-            nature(stateid, init_policy, compute_probabilities(state),
-                   compute_zvalues(state, valuefunction, discount));
+        const numvecvec zvalues = compute_zvalues(state, valuefunction, discount);
+        {
+            CRAAM_TRACE_NATURE();
+            std::tie(action, transitions, newvalue) =
+                nature(stateid, init_policy, compute_probabilities(state), zvalues);
+        }
         assert(!isinf(newvalue));
         assert(action.size() == state.size());
         policy_type action_response = make_pair(move(action), move(transitions));
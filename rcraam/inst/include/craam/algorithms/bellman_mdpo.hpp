@@ -24,6 +24,7 @@
 #pragma once
 
 #include "craam/MDPO.hpp"
+#include "craam/Solution.hpp"
 #include "craam/algorithms/nature_declarations.hpp"
 #include "craam/algorithms/values.hpp"
 
@@ -46,8 +47,10 @@ namespace craam { namespace algorithms {
  *
  * The update for a state value recomputes the worst case, which should ensure
  * the convergence of the modified policy policy iteration in robust cases.
+ *
+ * @tparam Nature Type of the nature response, see SARobustBellman
  */
-class SARobustOutcomeBellman {
+template <class Nature = SANature> class SARobustOutcomeBellman {
 public:
     /// the policy of the decision maker
     using dec_policy_type = long;
@@ -60,7 +63,7 @@ public:
 protected:
     const MDPO& mdpo;
     /// How to combine the values from a robust solution
-    SANature nature;
+    Nature nature;
     /// Partial policy specification (action -1 is ignored and optimized)
     vector<dec_policy_type> decision_policy;
     /// Initial policy specification for the decision maker (should be never changed)
@@ -74,7 +77,7 @@ public:
      * @param initial_policy Fix policy for some states. Negative value
      *         means that the action is not provided and should be optimized
      */
-    SARobustOutcomeBellman(const MDPO& mdpo, const SANature& nature = nats::average(),
+    SARobustOutcomeBellman(const MDPO& mdpo, const Nature& nature = nats::average(),
                            indvec initial_policy = indvec(0))
         : mdpo(mdpo), nature(nature), decision_policy(move(initial_policy)),
           initial_policy(decision_policy) {}
@@ -130,6 +133,60 @@ public:
                                action_pol.second);
     }
 
+    /**
+     * Maximal length of nature's response in each state; used to preallocate a
+     * FlatSARobustPolicy.
+     */
+    sizvec nature_capacities() const { return algorithms::nature_capacities(mdpo); }
+
+    /**
+     * Computes the Bellman update like policy_update above, but stores the
+     * action and the response of nature in a preallocated flat policy instead of
+     * returning them.
+     *
+     * @returns New value for the state
+     */
+    prec_t policy_update(long stateid, const numvec& valuefunction, prec_t discount,
+                         FlatSARobustPolicy& policy) const {
+        try {
+            internal::NatureWorkspace& workspace = internal::nature_workspace();
+            long actionid;
+            prec_t newvalue;
+            if (decision_policy.empty() || decision_policy[stateid] < 0) {
+                tie(actionid, newvalue) = value_max_state(
+                    mdpo[stateid], valuefunction, discount, stateid, nature, workspace);
+            } else {
+                actionid = decision_policy[stateid];
+                newvalue = value_fix_state(mdpo[stateid], valuefunction, discount,
+                                           actionid, stateid, nature, workspace);
+            }
+            policy.set(stateid, actionid, workspace.best_distribution);
+            return newvalue;
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
+    /**
+     * Computes value function using the policy stored in a flat policy. Used in
+     * policy evaluation.
+     *
+     * @returns New value for the state
+     */
+    prec_t compute_value(const FlatSARobustPolicy& policy, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        try {
+            numvec& distribution = internal::nature_workspace().distribution;
+            policy.nature(stateid, distribution);
+            return value_fix_state(mdpo[stateid], valuefunction, discount,
+                                   policy.action(stateid), distribution);
+        } catch (ModelError& e) {
+            e.set_state(stateid);
+            throw e;
+        }
+    }
+
     /** Returns a reference to the transition probabilities
      *
      * @param stateid State for which to get the transition probabilites
@@ -301,9 +358,14 @@ public:
         numvec init_policy =
             decision_policy.empty() ? numvec(0) : decision_policy[stateid];
 
-        auto [action, transitions, newvalue] =
-            nature(stateid, init_policy, state.get_action(0).get_distribution(),
-                   compute_zvalues(state, valuefunction, discount));
+        const numvecvec zvalues = compute_zvalues(state, valuefunction, discount);
+        numvec action, transitions;
+        prec_t newvalue;
+        {
+            CRAAM_TRACE_NATURE();
+            std::tie(action, transitions, newvalue) = nature(
+                stateid, init_policy, state.get_action(0).get_distribution(), zvalues);
+        }
 
         assert(!isinf(newvalue));
         assert(action.size() == state.size());
@@ -24,8 +24,11 @@
 #pragma once
 
 #include "craam/Transition.hpp"
+#include "craam/algorithms/tracing.hpp"
 #include "craam/definitions.hpp"
+
 #include <functional>
+#include <type_traits>
 
 namespace craam { namespace algorithms {
 
@@ -91,6 +94,82 @@ using SNatureOutcome = function<tuple<numvec, numvec, prec_t>(
     long stateid, const numvec& policy, const numvec& nominalprobs,
     const numvecvec& zvalues)>;
 
+// *******************************************************
+// Allocation-free nature specification
+// *******************************************************
+
+/**
+ * Checks whether the s,a-rectangular nature supports the in-place (allocation-free)
+ * interface in addition to (or instead of) the SANature interface:
+ *
+ *   prec_t operator()(long stateid, long actionid, const numvec& nominalprob,
+ *                     const numvec& zvalues, numvec& distribution) const
+ *
+ * The response distribution is written to @a distribution, which is a buffer
+ * provided by the caller and reused across calls (its capacity is retained);
+ * the function returns the value of the update.
+ *
+ * Nature classes that are passed to the Bellman updates as their concrete types
+ * (not wrapped in a std::function) are dispatched statically.
+ */
+template <class Nature>
+constexpr bool is_inplace_sanature_v =
+    std::is_invocable_r_v<prec_t, const Nature&, long, long, const numvec&,
+                          const numvec&, numvec&>;
+
+/**
+ * Calls an s,a-rectangular nature and writes its response to the provided buffer.
+ *
+ * Natures that implement the in-place interface are called directly. Other natures,
+ * including any SANature std::function, are called through the SANature interface
+ * and their result is moved to the buffer; this is the compatibility path and
+ * allocates as before.
+ *
+ * @param nature Nature response, either in-place or SANature compatible
+ * @param distribution Output buffer for the response distribution of nature
+ * @return The value of the nature's response
+ */
+template <class Nature>
+inline prec_t nature_response(const Nature& nature, long stateid, long actionid,
+                              const numvec& nominalprob, const numvec& zvalues,
+                              numvec& distribution) {
+    CRAAM_TRACE_NATURE();
+    if constexpr (is_inplace_sanature_v<Nature>) {
+        return nature(stateid, actionid, nominalprob, zvalues, distribution);
+    } else {
+        auto [response, value] = nature(stateid, actionid, nominalprob, zvalues);
+        distribution = move(response);
+        return value;
+    }
+}
+
+namespace internal {
+
+/**
+ * Scratch buffers that are used by the robust Bellman updates to compute the
+ * z-values and the responses of nature without allocating memory in each update.
+ * There is one workspace per thread; the buffers are only valid within a single
+ * Bellman update.
+ */
+struct NatureWorkspace {
+    /// nominal distribution of the action that is being evaluated
+    numvec nominal;
+    /// z-values of the action that is being evaluated
+    numvec zvalues;
+    /// response of nature for the action that is being evaluated
+    numvec distribution;
+    /// response of nature for the best action so far
+    numvec best_distribution;
+};
+
+/// Returns the workspace for the calling thread
+inline NatureWorkspace& nature_workspace() {
+    thread_local NatureWorkspace workspace;
+    return workspace;
+}
+
+} // namespace internal
+
 namespace nats {
 /**
  * Average nature response (just compute the average of values).
@@ -104,6 +183,14 @@ struct average {
         return {nominalprob, std::inner_product(zfunction.cbegin(), zfunction.cend(),
                                                 nominalprob.cbegin(), 0.0)};
     }
+
+    /// Implements the in-place interface
+    prec_t operator()(long, long, const numvec& nominalprob, const numvec& zfunction,
+                      numvec& distribution) const {
+        distribution.assign(nominalprob.cbegin(), nominalprob.cend());
+        return std::inner_product(zfunction.cbegin(), zfunction.cend(),
+                                  nominalprob.cbegin(), 0.0);
+    }
 };
 
 } // namespace nats
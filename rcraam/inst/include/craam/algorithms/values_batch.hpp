@@ -0,0 +1,279 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/**
+ * Methods that evaluate several value functions in a single pass over the model.
+ *
+ * The value functions are stored in a state-major matrix: the value of state s in
+ * the k-th value function is values[s * width + k]. All values of a target state
+ * are then contiguous and the inner loops run over the value functions.
+ */
+#pragma once
+
+#include "craam/CompiledMDP.hpp"
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/definitions.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace craam { namespace algorithms {
+
+using namespace std;
+
+namespace internal {
+
+/// Checks that the policy has a distribution over actions for every state
+template <class Model>
+inline void check_batch_policy(const Model& model, const numvecvec& policy) {
+    if (policy.size() != model.size())
+        throw invalid_argument("Policy length " + std::to_string(policy.size()) +
+                               " does not match the number of states " +
+                               std::to_string(model.size()) + ".");
+}
+
+/// Rearranges a state-major matrix to a list of value functions
+inline numvecvec unstack_values(const numvec& values, size_t width) {
+    const size_t nstates = width == 0 ? 0 : values.size() / width;
+    numvecvec result(width, numvec(nstates));
+    for (size_t s = 0; s < nstates; s++)
+        for (size_t k = 0; k < width; k++)
+            result[k][s] = values[s * width + k];
+    return result;
+}
+
+} // namespace internal
+
+/// Value functions of a policy in each outcome, computed by evaluate_outcomes
+struct OutcomeValues {
+    /// Value function for each outcome
+    numvecvec valuefunctions;
+    /// Largest change of the value function of each outcome in the last sweep
+    numvec residuals;
+    /// Number of sweeps taken
+    long iterations = -1;
+    /// Time taken to evaluate the policy
+    prec_t time = std::nan("");
+    /// Status (0 means that all residuals are within the bound, 1 means that the
+    /// iteration limit was reached first)
+    int status = 2;
+};
+
+/**
+ * Applies the Bellman operator of a fixed randomized policy to several value
+ * functions at once. The value of terminal states is 0.
+ *
+ * @param mdp The MDP model
+ * @param policy Distribution over actions for each state; it must be specified
+ *               in all non-terminal states
+ * @param values State-major matrix of value functions
+ * @param width Number of value functions in the matrix
+ * @param discount Discount factor
+ *
+ * @return State-major matrix of the updated value functions
+ */
+inline numvec bellman_batch(const MDP& mdp, const numvecvec& policy, const numvec& values,
+                            size_t width, prec_t discount) {
+    internal::check_batch_policy(mdp, policy);
+    if (values.size() != mdp.size() * width)
+        throw invalid_argument("The size of the value matrix does not match the "
+                               "number of states and value functions.");
+
+    numvec result(values.size(), 0.0);
+    bool openmp_error = false;
+#pragma omp parallel for
+    for (long s = 0; s < long(mdp.size()); s++) {
+        try {
+            const State& state = mdp[s];
+            if (state.is_terminal()) continue;
+            if (policy[s].size() != state.size())
+                throw invalid_argument("Policy in state " + std::to_string(s) +
+                                       " does not match the number of actions.");
+            thread_local numvec actionvalues;
+            prec_t* const out = result.data() + size_t(s) * width;
+            for (size_t a = 0; a < state.size(); a++) {
+                const prec_t p = policy[s][a];
+                if (p <= 0) continue;
+                state[a].value_batch(values, width, discount, actionvalues);
+#pragma omp simd
+                for (size_t k = 0; k < width; k++)
+                    out[k] += p * actionvalues[k];
+            }
+        } catch (const exception& e) {
+            // only run this once per loop
+            if (!openmp_error) {
+                craam::internal::openmp_exception_handler(e, "bellman_batch");
+                openmp_error = true;
+            }
+        }
+    }
+    // just terminate if there is an error
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+    return result;
+}
+
+/**
+ * Evaluates a randomized policy in each outcome of the MDPO at once. Every
+ * state-action must have the same number of outcomes K, such as K samples from a
+ * posterior distribution. The k-th value function is the value of the policy in
+ * the MDP made of the k-th outcome of every state-action.
+ *
+ * The value functions are computed by synchronous (Jacobi) value iteration on a
+ * state-major matrix so that every sweep traverses the model only once for all
+ * the outcomes. The value of terminal states is 0.
+ *
+ * @param mdpo MDPO with shared outcome supports
+ * @param policy Distribution over actions for each state; it must be specified
+ *               in all non-terminal states
+ * @param discount Discount factor, must be smaller than 1
+ * @param iterations Maximal number of sweeps
+ * @param maxresidual Stop when the largest change in any value function is smaller
+ *
+ * @return Value function and the final residual for each outcome
+ */
+inline OutcomeValues evaluate_outcomes(const SharedSupportMDPO& mdpo,
+                                       const numvecvec& policy, prec_t discount,
+                                       unsigned long iterations = MAXITER,
+                                       prec_t maxresidual = SOLPREC) {
+    const auto start = chrono::steady_clock::now();
+    internal::check_batch_policy(mdpo, policy);
+    const long nstates = long(mdpo.size());
+
+    // the number of outcomes must be the same for all state-actions
+    size_t width = 0;
+    for (size_t sa = 0; sa < mdpo.stateaction_count(); sa++) {
+        if (sa == 0)
+            width = mdpo.sa_size(sa);
+        else if (mdpo.sa_size(sa) != width)
+            throw invalid_argument("All state-actions must have the same number of "
+                                   "outcomes to be evaluated in a batch.");
+    }
+    for (long s = 0; s < nstates; s++) {
+        if (!mdpo.is_terminal(s) && policy[s].size() != mdpo.action_count(s))
+            throw invalid_argument("Policy in state " + std::to_string(s) +
+                                   " does not match the number of actions.");
+    }
+
+    numvec values(size_t(nstates) * width, 0.0), newvalues(values.size(), 0.0);
+    // the residual of each outcome; infinite before the first sweep
+    numvec residuals(width, numeric_limits<prec_t>::infinity());
+    prec_t residual = width == 0 ? 0.0 : numeric_limits<prec_t>::infinity();
+    unsigned long i = 0;
+    for (; i < iterations && residual > maxresidual; i++) {
+        residuals.assign(width, 0.0);
+        prec_t* const res = residuals.data();
+        bool openmp_error = false;
+#pragma omp parallel for reduction(max : res[:width])
+        for (long s = 0; s < nstates; s++) {
+            try {
+                prec_t* const out = newvalues.data() + size_t(s) * width;
+                std::fill(out, out + width, 0.0);
+                thread_local numvec zvalues;
+                for (size_t a = 0; a < mdpo.action_count(s); a++) {
+                    const prec_t p = policy[s][a];
+                    if (p <= 0) continue;
+                    mdpo.zvalues_batch(mdpo.sa_index(s, long(a)), values, discount,
+                                       zvalues);
+#pragma omp simd
+                    for (size_t k = 0; k < width; k++)
+                        out[k] += p * zvalues[k];
+                }
+                const prec_t* const old = values.data() + size_t(s) * width;
+                for (size_t k = 0; k < width; k++)
+                    res[k] = std::max(res[k], std::abs(out[k] - old[k]));
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "evaluate_outcomes");
+                    openmp_error = true;
+                }
+            }
+        }
+        // just terminate if there is an error
+        if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+        values.swap(newvalues);
+        residual = *max_element(residuals.cbegin(), residuals.cend());
+    }
+
+    OutcomeValues result;
+    result.valuefunctions = internal::unstack_values(values, width);
+    result.residuals = move(residuals);
+    result.iterations = long(i);
+    result.time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.status = residual <= maxresidual ? 0 : 1;
+    return result;
+}
+
+/**
+ * Evaluates a deterministic policy in each outcome of the MDPO at once. See the
+ * randomized version for details.
+ */
+inline OutcomeValues evaluate_outcomes(const SharedSupportMDPO& mdpo,
+                                       const indvec& policy, prec_t discount,
+                                       unsigned long iterations = MAXITER,
+                                       prec_t maxresidual = SOLPREC) {
+    if (policy.size() != mdpo.size())
+        throw invalid_argument("Policy length " + std::to_string(policy.size()) +
+                               " does not match the number of states " +
+                               std::to_string(mdpo.size()) + ".");
+    numvecvec rpolicy(mdpo.size());
+    for (size_t s = 0; s < mdpo.size(); s++) {
+        if (policy[s] < 0) continue;
+        rpolicy[s].assign(mdpo.action_count(s), 0.0);
+        rpolicy[s].at(policy[s]) = 1.0;
+    }
+    return evaluate_outcomes(mdpo, rpolicy, discount, iterations, maxresidual);
+}
+
+/**
+ * Evaluates a randomized policy in each outcome of the MDPO at once. The model
+ * is compiled to a SharedSupportMDPO first; see the version for the compiled model.
+ */
+inline OutcomeValues evaluate_outcomes(const MDPO& mdpo, const numvecvec& policy,
+                                       prec_t discount,
+                                       unsigned long iterations = MAXITER,
+                                       prec_t maxresidual = SOLPREC) {
+    return evaluate_outcomes(SharedSupportMDPO(mdpo), policy, discount, iterations,
+                             maxresidual);
+}
+
+/**
+ * Evaluates a deterministic policy in each outcome of the MDPO at once. The
+ * model is compiled to a SharedSupportMDPO first.
+ */
+inline OutcomeValues evaluate_outcomes(const MDPO& mdpo, const indvec& policy,
+                                       prec_t discount,
+                                       unsigned long iterations = MAXITER,
+                                       prec_t maxresidual = SOLPREC) {
+    return evaluate_outcomes(SharedSupportMDPO(mdpo), policy, discount, iterations,
+                             maxresidual);
+}
+
+}} // namespace craam::algorithms
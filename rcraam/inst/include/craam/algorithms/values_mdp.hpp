@@ -86,26 +86,66 @@ inline prec_t value_action(const Action& action, const numvec& valuefunction,
  * @param action Action for which to compute the z-values
  * @param valuefunction Value function over ALL states
  * @param discount Discount facto
- * @return The length of the zvalues is the same as the number of
- *          transitions with positive probabilities.
+ * @param zvalues Output buffer for the z-values; it is resized as needed and
+ *          can be reused across calls. The length of the zvalues is the same as
+ *          the number of transitions with positive probabilities.
  */
-inline numvec compute_zvalues(const Action& action, const numvec& valuefunction,
-                              prec_t discount) {
+inline void compute_zvalues(const Action& action, const numvec& valuefunction,
+                            prec_t discount, numvec& zvalues) {
     const numvec& rewards = action.get_rewards();
     const indvec& nonzero_indices = action.get_indices();
 
-    if (nonzero_indices.empty()) return numvec(rewards.size(), std::nan(""));
+    if (nonzero_indices.empty()) {
+        zvalues.assign(rewards.size(), std::nan(""));
+        return;
+    }
 
-    numvec zvalues(rewards.size()); // values for individual states - used by nature.
+    zvalues.resize(rewards.size()); // values for individual states - used by nature.
 
 #pragma omp simd
     for (size_t i = 0; i < rewards.size(); i++) {
         zvalues[i] = rewards[i] + discount * valuefunction[nonzero_indices[i]];
     }
+}
 
+/**
+ * The function computes the value of each transition by adding the
+ * reward function to the discounted value function
+ * @param action Action for which to compute the z-values
+ * @param valuefunction Value function over ALL states
+ * @param discount Discount facto
+ * @return The length of the zvalues is the same as the number of
+ *          transitions with positive probabilities.
+ */
+inline numvec compute_zvalues(const Action& action, const numvec& valuefunction,
+                              prec_t discount) {
+    numvec zvalues;
+    compute_zvalues(action, valuefunction, discount, zvalues);
     return zvalues;
 }
 
+/**
+ * Computes an ambiguous value (e.g. robust) of the action, depending on the type
+ * of nature that is provided. Does not allocate memory when the buffers have
+ * sufficient capacity and the nature implements the in-place interface.
+ *
+ * @param action Action for which to compute the value
+ * @param valuefunction State value function to use
+ * @param discount Discount factor
+ * @param nature Method used to compute the response of nature.
+ * @param zvalues Buffer used to store the z-values
+ * @param distribution Output buffer for the response of nature
+ * @return Value of the response of nature
+ */
+template <class Nature>
+inline prec_t value_action(const Action& action, const numvec& valuefunction,
+                           prec_t discount, long stateid, long actionid,
+                           const Nature& nature, numvec& zvalues, numvec& distribution) {
+    compute_zvalues(action, valuefunction, discount, zvalues);
+    return nature_response(nature, stateid, actionid, action.get_probabilities(),
+                           zvalues, distribution);
+}
+
 /**
  * Computes an ambiguous value (e.g. robust) of the action, depending on the type
  * of nature that is provided.
@@ -115,11 +155,14 @@ inline numvec compute_zvalues(const Action& action, const numvec& valuefunction,
  * @param discount Discount factor
  * @param nature Method used to compute the response of nature.
  */
+template <class Nature>
 inline vec_scal_t value_action(const Action& action, const numvec& valuefunction,
                                prec_t discount, long stateid, long actionid,
-                               const SANature& nature) {
-    numvec zvalues = compute_zvalues(action, valuefunction, discount);
-    return nature(stateid, actionid, action.get_probabilities(), zvalues);
+                               const Nature& nature) {
+    numvec distribution;
+    prec_t value = value_action(action, valuefunction, discount, stateid, actionid, nature,
+                                internal::nature_workspace().zvalues, distribution);
+    return {move(distribution), value};
 }
 
 // *******************************************************
@@ -0,0 +1,434 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "craam/CompiledMDP.hpp"
+#include "craam/definitions.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Binary file format for compiled MDPs and MDPOs.
+ *
+ * The file consists of a fixed header followed by the flat arrays of the compiled
+ * model in the order in which they are stored in CompiledMDP and CompiledMDPO.
+ * The elements are stored in the native byte order, so that the arrays can be used
+ * directly from a memory-mapped file without any copying or parsing. The offsets
+ * are 8 bytes wide; the probabilities, rewards, and indices are 8 bytes wide in
+ * double precision models (int64_t indices) and 4 bytes wide in single precision
+ * models (CompiledMDPf and CompiledMDPOf). Each array is padded with zeros to a
+ * multiple of 8 bytes. The header includes a version number and a checksum of the
+ * arrays.
+ */
+namespace craam {
+
+using namespace std;
+
+/// Version of the binary format that is written and accepted
+constexpr uint32_t binary_version = 1;
+
+/// Type of the model stored in the binary file
+enum class BinaryKind : uint32_t {
+    mdp = 1,        ///< CompiledMDP
+    mdpo = 2,       ///< CompiledMDPO
+    mdp_single = 3, ///< CompiledMDPf
+    mdpo_single = 4 ///< CompiledMDPOf
+};
+
+/// Header of the binary file, followed immediately by the arrays
+struct BinaryHeader {
+    /// Identifies the file format, always "CRAAMBIN"
+    char magic[8];
+    /// Format version, also detects a mismatched byte order
+    uint32_t version;
+    /// Type of the model
+    BinaryKind kind;
+    /// Number of states
+    uint64_t states;
+    /// Number of state-action pairs
+    uint64_t stateactions;
+    /// Number of outcomes (0 for an MDP)
+    uint64_t outcomes;
+    /// Number of transitions
+    uint64_t transitions;
+    /// Checksum of all the arrays that follow the header
+    uint64_t checksum;
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0, "The arrays must be aligned.");
+
+namespace internal {
+
+constexpr char binary_magic[8] = {'C', 'R', 'A', 'A', 'M', 'B', 'I', 'N'};
+
+/**
+ * Updates a checksum (64-bit FNV-1a over words) with an array of bytes. The last
+ * word is padded with zeros, just like the array in the file. The checksum detects
+ * truncated and corrupted files, not deliberate tampering.
+ */
+inline uint64_t binary_checksum(const void* data, size_t bytes, uint64_t hash) {
+    const char* first = static_cast<const char*>(data);
+    for (size_t i = 0; i < bytes; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, first + i, min<size_t>(8, bytes - i));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+constexpr uint64_t binary_checksum_init = 0xcbf29ce484222325ULL;
+
+/// Size of an array in the file, including the padding
+inline uint64_t binary_padded(uint64_t bytes) { return (bytes + 7) / 8 * 8; }
+
+/// Kind of the compiled model with the given storage types
+template <class Real, class Index> constexpr BinaryKind binary_kind(bool outcomes) {
+    static_assert((is_same_v<Real, prec_t> && sizeof(Real) == 8 && is_integral_v<Index> &&
+                   is_signed_v<Index> && sizeof(Index) == sizeof(int64_t)) ||
+                      (is_same_v<Real, float> && sizeof(Real) == 4 &&
+                       is_same_v<Index, int32_t>),
+                  "The binary format supports double values with 64-bit indices and "
+                  "float values with 32-bit indices.");
+    if constexpr (is_same_v<Real, float>)
+        return outcomes ? BinaryKind::mdpo_single : BinaryKind::mdp_single;
+    else
+        return outcomes ? BinaryKind::mdpo : BinaryKind::mdp;
+}
+
+/**
+ * Checks that the offsets can be stored in the file. This is not a static
+ * assertion so that the header can be included on 32-bit platforms.
+ */
+inline void check_binary_platform() {
+    if (sizeof(size_t) != sizeof(uint64_t))
+        throw runtime_error("The binary format requires a 64-bit platform.");
+}
+
+/// Writes the header and the arrays of a compiled model
+template <class... Arrays>
+inline void write_binary(const string& filename, BinaryHeader header,
+                         const Arrays&... arrays) {
+    check_binary_platform();
+    uint64_t hash = binary_checksum_init;
+    ((hash = binary_checksum(arrays.data(), arrays.size() * sizeof(*arrays.data()),
+                             hash)),
+     ...);
+    memcpy(header.magic, binary_magic, 8);
+    header.version = binary_version;
+    header.checksum = hash;
+
+    ofstream ofs(filename, ios::binary | ios::trunc);
+    if (!ofs.is_open())
+        throw runtime_error("Could not open the file for writing: " + filename);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
+    const char padding[8] = {};
+    const auto write_array = [&ofs, &padding](const auto& array) {
+        const uint64_t bytes = array.size() * sizeof(*array.data());
+        ofs.write(reinterpret_cast<const char*>(array.data()), streamsize(bytes));
+        ofs.write(padding, streamsize(binary_padded(bytes) - bytes));
+    };
+    (write_array(arrays), ...);
+    if (!ofs) throw runtime_error("Failed writing the file: " + filename);
+}
+
+/**
+ * Read-only content of a file. It is memory-mapped when supported by the
+ * platform and read into memory otherwise.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const string& filename) {
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("Could not open the file: " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw runtime_error("Could not read the file size: " + filename);
+        }
+        length = size_t(st.st_size);
+        if (length > 0) {
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED)
+                throw runtime_error("Could not memory-map the file: " + filename);
+            address = static_cast<const char*>(mapped);
+        } else {
+            ::close(fd);
+        }
+#else
+        ifstream ifs(filename, ios::binary | ios::ate);
+        if (!ifs.is_open()) throw runtime_error("Could not open the file: " + filename);
+        length = size_t(ifs.tellg());
+        // 8-byte words keep the arrays aligned
+        buffer.resize((length + 7) / 8);
+        ifs.seekg(0);
+        ifs.read(reinterpret_cast<char*>(buffer.data()), streamsize(length));
+        if (!ifs) throw runtime_error("Failed reading the file: " + filename);
+        address = reinterpret_cast<const char*>(buffer.data());
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (address != nullptr) ::munmap(const_cast<char*>(address), length);
+#endif
+    }
+
+    const char* data() const { return address; }
+    size_t size() const { return length; }
+
+protected:
+    const char* address = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    vector<uint64_t> buffer;
+#endif
+};
+
+/**
+ * Maps the file, validates the header, and returns the arrays one by one
+ * without copying them.
+ */
+class BinaryReader {
+public:
+    BinaryReader(const string& filename, BinaryKind kind, bool verify)
+        : file(make_shared<MappedFile>(filename)) {
+        check_binary_platform();
+        if (file->size() < sizeof(BinaryHeader) ||
+            memcmp(file->data(), binary_magic, 8) != 0)
+            throw runtime_error("Not a CRAAM binary file: " + filename);
+        memcpy(&header, file->data(), sizeof(BinaryHeader));
+        if (header.version != binary_version)
+            throw runtime_error("Unsupported binary file version or byte order: " +
+                                filename);
+        if (header.kind != kind)
+            throw runtime_error(
+                "The binary file contains a different model type or precision: " +
+                filename);
+
+        // width of the values and indices
+        const bool outcomes = kind == BinaryKind::mdpo || kind == BinaryKind::mdpo_single;
+        const uint64_t width =
+            kind == BinaryKind::mdp_single || kind == BinaryKind::mdpo_single ? 4 : 8;
+        const uint64_t bytes =
+            8 * (header.states + 1) + 8 * (header.stateactions + 1) +
+            (outcomes ? 8 * (header.outcomes + 1) +
+                            binary_padded(width * header.outcomes)
+                      : 0) +
+            3 * binary_padded(width * header.transitions);
+        if (file->size() != sizeof(BinaryHeader) + bytes)
+            throw runtime_error("The binary file is truncated or has extra data: " +
+                                filename);
+        if (verify) {
+            if (binary_checksum(file->data() + sizeof(BinaryHeader), bytes,
+                                binary_checksum_init) != header.checksum)
+                throw runtime_error("Checksum mismatch in the binary file: " + filename);
+        }
+        position = sizeof(BinaryHeader);
+    }
+
+    const BinaryHeader& get_header() const { return header; }
+
+    /// Returns the next array of the given length that refers to the mapped file
+    template <class T> FlatArray<T> next(size_t count) {
+        const T* first = reinterpret_cast<const T*>(file->data() + position);
+        position += binary_padded(count * sizeof(T));
+        return FlatArray<T>(first, count, file);
+    }
+
+protected:
+    shared_ptr<MappedFile> file;
+    BinaryHeader header;
+    size_t position = 0;
+};
+
+/**
+ * Checks that the offsets start at zero and are non-decreasing. The last offset
+ * is checked by the constructor of the compiled model.
+ */
+inline void check_binary_offsets(const FlatArray<size_t>& offsets, const char* name,
+                                 const string& filename) {
+    bool valid = offsets.empty() || offsets[0] == 0;
+    for (size_t i = 1; valid && i < offsets.size(); ++i)
+        valid = offsets[i - 1] <= offsets[i];
+    if (!valid)
+        throw runtime_error(string("Invalid ") + name +
+                            " offsets in the binary file: " + filename);
+}
+
+/// Checks that all target states are valid state indices
+template <class Index>
+inline void check_binary_indices(const FlatArray<Index>& indices, uint64_t states,
+                                 const string& filename) {
+    for (const Index index : indices) {
+        if (index < 0 || uint64_t(index) >= states)
+            throw runtime_error("Invalid target state " + std::to_string(index) +
+                                " in the binary file: " + filename);
+    }
+}
+
+} // namespace internal
+
+/**
+ * Saves the compiled MDP to a binary file that can be loaded with
+ * load_mdp_binary.
+ */
+template <class Real, class Index>
+inline void save_binary(const BasicCompiledMDP<Real, Index>& mdp,
+                        const string& filename) {
+    BinaryHeader header{};
+    header.kind = internal::binary_kind<Real, Index>(false);
+    header.states = mdp.size();
+    header.stateactions = mdp.stateaction_count();
+    header.outcomes = 0;
+    header.transitions = mdp.get_indices().size();
+    internal::write_binary(filename, header, mdp.get_state_offsets(),
+                           mdp.get_action_offsets(), mdp.get_indices(),
+                           mdp.get_probabilities(), mdp.get_rewards());
+}
+
+/**
+ * Compiles and saves the MDP to a binary file.
+ *
+ * @param single Whether to store the values in single precision with 32-bit
+ *               indices, see CompiledMDPf
+ */
+inline void save_binary(const MDP& mdp, const string& filename, bool single = false) {
+    if (single)
+        save_binary(CompiledMDPf(mdp), filename);
+    else
+        save_binary(CompiledMDP(mdp), filename);
+}
+
+/**
+ * Saves the compiled MDPO to a binary file that can be loaded with
+ * load_mdpo_binary.
+ */
+template <class Real, class Index>
+inline void save_binary(const BasicCompiledMDPO<Real, Index>& mdpo,
+                        const string& filename) {
+    BinaryHeader header{};
+    header.kind = internal::binary_kind<Real, Index>(true);
+    header.states = mdpo.size();
+    header.stateactions = mdpo.stateaction_count();
+    header.outcomes = mdpo.outcome_count();
+    header.transitions = mdpo.get_indices().size();
+    internal::write_binary(filename, header, mdpo.get_state_offsets(),
+                           mdpo.get_action_offsets(), mdpo.get_outcome_offsets(),
+                           mdpo.get_distribution(), mdpo.get_indices(),
+                           mdpo.get_probabilities(), mdpo.get_rewards());
+}
+
+/**
+ * Compiles and saves the MDPO to a binary file.
+ *
+ * @param single Whether to store the values in single precision with 32-bit
+ *               indices, see CompiledMDPOf
+ */
+inline void save_binary(const MDPO& mdpo, const string& filename, bool single = false) {
+    if (single)
+        save_binary(CompiledMDPOf(mdpo), filename);
+    else
+        save_binary(CompiledMDPO(mdpo), filename);
+}
+
+/**
+ * Loads a compiled MDP from a binary file. The file is memory-mapped and the
+ * returned model refers to it directly; the mapping is released when the model
+ * and all its copies are destroyed.
+ *
+ * The precision of the model is selected by the template arguments and must match
+ * the file: load_mdp_binary<float, int32_t> loads a CompiledMDPf.
+ *
+ * @param filename Binary file created by save_binary
+ * @param verify Whether to verify the checksum, the offsets, and the target
+ *              states, which requires reading the whole file
+ */
+template <class Real = prec_t, class Index = int64_t>
+inline BasicCompiledMDP<Real, Index> load_mdp_binary(const string& filename,
+                                                     bool verify = true) {
+    internal::BinaryReader reader(filename, internal::binary_kind<Real, Index>(false),
+                                  verify);
+    const BinaryHeader& header = reader.get_header();
+    auto state_offsets = reader.next<size_t>(header.states + 1);
+    auto action_offsets = reader.next<size_t>(header.stateactions + 1);
+    auto indices = reader.next<Index>(header.transitions);
+    auto probabilities = reader.next<Real>(header.transitions);
+    auto rewards = reader.next<Real>(header.transitions);
+    if (verify) {
+        internal::check_binary_offsets(state_offsets, "state", filename);
+        internal::check_binary_offsets(action_offsets, "action", filename);
+        internal::check_binary_indices(indices, header.states, filename);
+    }
+    return BasicCompiledMDP<Real, Index>(move(state_offsets), move(action_offsets),
+                                         move(indices), move(probabilities),
+                                         move(rewards));
+}
+
+/**
+ * Loads a compiled MDPO from a binary file. See load_mdp_binary.
+ */
+template <class Real = prec_t, class Index = int64_t>
+inline BasicCompiledMDPO<Real, Index> load_mdpo_binary(const string& filename,
+                                                       bool verify = true) {
+    internal::BinaryReader reader(filename, internal::binary_kind<Real, Index>(true),
+                                  verify);
+    const BinaryHeader& header = reader.get_header();
+    auto state_offsets = reader.next<size_t>(header.states + 1);
+    auto action_offsets = reader.next<size_t>(header.stateactions + 1);
+    auto outcome_offsets = reader.next<size_t>(header.outcomes + 1);
+    auto distribution = reader.next<Real>(header.outcomes);
+    auto indices = reader.next<Index>(header.transitions);
+    auto probabilities = reader.next<Real>(header.transitions);
+    auto rewards = reader.next<Real>(header.transitions);
+    if (verify) {
+        internal::check_binary_offsets(state_offsets, "state", filename);
+        internal::check_binary_offsets(action_offsets, "action", filename);
+        internal::check_binary_offsets(outcome_offsets, "outcome", filename);
+        internal::check_binary_indices(indices, header.states, filename);
+    }
+    return BasicCompiledMDPO<Real, Index>(
+        move(state_offsets), move(action_offsets), move(outcome_offsets),
+        move(distribution), move(indices), move(probabilities), move(rewards));
+}
+
+} // namespace craam
@@ -0,0 +1,379 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/Transition.hpp"
+#include "craam/definitions.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+// *************************************************************************************
+// **** Bulk construction of models from columns of transitions
+// *************************************************************************************
+
+namespace internal {
+
+/**
+ * Groups rows by the source state using a counting sort. Rows of each state
+ * remain in their original order.
+ *
+ * @return Pair of the positions of the first row of each state in the order
+ *          (length: states + 1) and the order of the rows
+ */
+inline pair<sizvec, sizvec> group_by_state(const indvec& statefrom, size_t statecount) {
+    sizvec starts(statecount + 1, 0);
+    for (long s : statefrom)
+        starts[s + 1]++;
+    for (size_t s = 0; s < statecount; ++s)
+        starts[s + 1] += starts[s];
+    sizvec order(statefrom.size());
+    sizvec next(starts.cbegin(), starts.cend() - 1);
+    for (size_t i = 0; i < statefrom.size(); ++i)
+        order[next[statefrom[i]]++] = i;
+    return {move(starts), move(order)};
+}
+
+/**
+ * Checks that the ids are non-negative and the probabilities are not negative and
+ * returns the number of states.
+ *
+ * @param statefrom Source states
+ * @param stateto Target states
+ * @param ids Other id columns (actions and outcomes)
+ * @param probability Probabilities
+ */
+inline size_t check_transition_columns(const indvec& statefrom, const indvec& stateto,
+                                       const vector<const indvec*>& ids,
+                                       const numvec& probability) {
+    long maxstate = -1;
+    for (const indvec* column : ids)
+        for (long id : *column)
+            if (id < 0) throw invalid_argument("Ids must be non-negative.");
+    for (const indvec* column : {&statefrom, &stateto})
+        for (long s : *column) {
+            if (s < 0) throw invalid_argument("Ids must be non-negative.");
+            maxstate = max(maxstate, s);
+        }
+    for (prec_t p : probability)
+        if (p < -0.001) throw invalid_argument("probabilities must be non-negative.");
+    return size_t(maxstate + 1);
+}
+
+/**
+ * Adds rows to a new transition. The rows must be sorted by the target state.
+ * Rows to the same target state are merged by Transition::add_sample in their
+ * order, and the storage is allocated exactly once.
+ *
+ * @param first Position of the first row
+ * @param last Position after the last row
+ */
+inline void add_sorted_rows(Transition& transition, sizvec::const_iterator first,
+                            sizvec::const_iterator last, const indvec& stateto,
+                            const numvec& probability, const numvec& reward,
+                            bool force) {
+    size_t count = 0;
+    long previous = -1;
+    for (auto it = first; it != last; ++it) {
+        if (probability[*it] <= 0 && !force) continue;
+        if (stateto[*it] != previous) {
+            previous = stateto[*it];
+            ++count;
+        }
+    }
+    transition.reserve(transition.size() + count);
+    for (auto it = first; it != last; ++it)
+        transition.add_sample(stateto[*it], probability[*it], reward[*it], force);
+}
+
+} // namespace internal
+
+/**
+ * Adds samples to a transition in bulk. The samples are sorted by the target
+ * state first, which avoids inserting in the middle of the transition, but the
+ * result is identical to calling Transition::add_sample for each sample in order.
+ *
+ * @param transition Transition to add the samples to, usually empty
+ * @param stateto Target states
+ * @param probability Probabilities of the samples
+ * @param reward Rewards of the samples
+ * @param force Whether to add also samples with zero probabilities
+ */
+inline void add_samples(Transition& transition, const indvec& stateto,
+                        const numvec& probability, const numvec& reward,
+                        bool force = false) {
+    if (stateto.size() != probability.size() || stateto.size() != reward.size())
+        throw invalid_argument("All sample columns must have the same size.");
+    sizvec order(stateto.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    // stable to merge samples to the same state in their order
+    stable_sort(order.begin(), order.end(),
+                [&stateto](size_t i, size_t j) { return stateto[i] < stateto[j]; });
+    internal::add_sorted_rows(transition, order.cbegin(), order.cend(), stateto,
+                              probability, reward, force);
+}
+
+/**
+ * Builds an MDP from columns of transitions. Each row i is a transition from
+ * statefrom[i] after taking action[i] to stateto[i].
+ *
+ * The result is identical to calling add_transition for each row in order, but the
+ * rows are grouped by the source state in linear time, each state is then sorted
+ * and built in parallel, and every transition is allocated with its exact size.
+ * Rows with the same state, action, and target state are merged as in
+ * Transition::add_sample: the probabilities are summed and the rewards are
+ * weighted by the probabilities.
+ *
+ * @param statefrom Source states
+ * @param action Actions
+ * @param stateto Target states
+ * @param probability Transition probabilities
+ * @param reward Transition rewards
+ * @param force Whether to add also transitions with zero probabilities
+ * @param statecount Minimal number of states in the MDP; states that do not appear
+ *                   in any transition are terminal
+ */
+inline MDP mdp_from_columns(const indvec& statefrom, const indvec& action,
+                            const indvec& stateto, const numvec& probability,
+                            const numvec& reward, bool force = false,
+                            size_t statecount = 0) {
+    const size_t n = statefrom.size();
+    if (action.size() != n || stateto.size() != n || probability.size() != n ||
+        reward.size() != n)
+        throw invalid_argument("All transition columns must have the same size.");
+    statecount = max(statecount, internal::check_transition_columns(
+                                     statefrom, stateto, {&action}, probability));
+
+    MDP mdp(statecount);
+    sizvec starts, order;
+    tie(starts, order) = internal::group_by_state(statefrom, statecount);
+
+    bool openmp_error = false;
+    // each state is constructed by a single thread
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t s = 0; s < statecount; ++s) {
+        try {
+            const auto first = order.begin() + starts[s],
+                       last = order.begin() + starts[s + 1];
+            if (first == last) continue;
+            // stable to merge rows to the same target state in their order
+            stable_sort(first, last, [&](size_t i, size_t j) {
+                return tie(action[i], stateto[i]) < tie(action[j], stateto[j]);
+            });
+            State& state = mdp[long(s)];
+            state.create_action(action[*(last - 1)]);
+            for (auto begin = first; begin != last;) {
+                const long a = action[*begin];
+                const auto end =
+                    find_if(begin, last, [&](size_t i) { return action[i] != a; });
+                internal::add_sorted_rows(state[a], begin, end, stateto, probability,
+                                          reward, force);
+                begin = end;
+            }
+        } catch (const exception& e) {
+            craam::internal::openmp_exception_handler(e, "mdp_from_columns");
+            openmp_error = true;
+        }
+    }
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+    return mdp;
+}
+
+/**
+ * Builds an MDPO from columns of transitions. Each row i is a transition from
+ * statefrom[i] after taking action[i] and outcome[i] to stateto[i]. The nominal
+ * distribution over the outcomes of each action is uniform.
+ *
+ * The result is identical to calling add_transition for each row in order; see
+ * mdp_from_columns for how the model is built.
+ *
+ * @param statefrom Source states
+ * @param action Actions
+ * @param outcome Outcomes
+ * @param stateto Target states
+ * @param probability Transition probabilities
+ * @param reward Transition rewards
+ * @param force Whether to add also transitions with zero probabilities
+ * @param statecount Minimal number of states in the MDPO; states that do not appear
+ *                   in any transition are terminal
+ */
+inline MDPO mdpo_from_columns(const indvec& statefrom, const indvec& action,
+                              const indvec& outcome, const indvec& stateto,
+                              const numvec& probability, const numvec& reward,
+                              bool force = false, size_t statecount = 0) {
+    const size_t n = statefrom.size();
+    if (action.size() != n || outcome.size() != n || stateto.size() != n ||
+        probability.size() != n || reward.size() != n)
+        throw invalid_argument("All transition columns must have the same size.");
+    statecount =
+        max(statecount, internal::check_transition_columns(
+                            statefrom, stateto, {&action, &outcome}, probability));
+
+    MDPO mdpo(statecount);
+    sizvec starts, order;
+    tie(starts, order) = internal::group_by_state(statefrom, statecount);
+
+    bool openmp_error = false;
+    // each state is constructed by a single thread
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t s = 0; s < statecount; ++s) {
+        try {
+            const auto first = order.begin() + starts[s],
+                       last = order.begin() + starts[s + 1];
+            if (first == last) continue;
+            // stable to merge rows to the same target state in their order
+            stable_sort(first, last, [&](size_t i, size_t j) {
+                return tie(action[i], outcome[i], stateto[i]) <
+                       tie(action[j], outcome[j], stateto[j]);
+            });
+            StateO& state = mdpo[long(s)];
+            state.create_action(action[*(last - 1)]);
+            for (auto abegin = first; abegin != last;) {
+                const long a = action[*abegin];
+                const auto aend =
+                    find_if(abegin, last, [&](size_t i) { return action[i] != a; });
+                // creating all outcomes at once makes the distribution uniform
+                ActionO& act = state[a];
+                act.create_outcome(outcome[*(aend - 1)]);
+                for (auto begin = abegin; begin != aend;) {
+                    const long o = outcome[*begin];
+                    const auto end =
+                        find_if(begin, aend, [&](size_t i) { return outcome[i] != o; });
+                    internal::add_sorted_rows(act.get_outcome(o), begin, end, stateto,
+                                              probability, reward, force);
+                    begin = end;
+                }
+                abegin = aend;
+            }
+        } catch (const exception& e) {
+            craam::internal::openmp_exception_handler(e, "mdpo_from_columns");
+            openmp_error = true;
+        }
+    }
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+    return mdpo;
+}
+
+/**
+ * Collects transitions of an MDP or an MDPO in columns and builds the model in
+ * bulk with mdp_from_columns or mdpo_from_columns. This is much faster than
+ * adding the transitions one by one with add_transition when they are not sorted.
+ *
+ * Transitions can be collected in parallel, with one builder per thread, and the
+ * builders then combined by append.
+ */
+class ModelBuilder {
+public:
+    /// Creates an empty builder
+    ModelBuilder() = default;
+
+    /// Reserves the storage for the given number of transitions
+    void reserve(size_t count) {
+        statefrom.reserve(count);
+        action.reserve(count);
+        stateto.reserve(count);
+        probability.reserve(count);
+        reward.reserve(count);
+    }
+
+    /// Adds a transition of an MDP; see add_transition(MDP&, ...)
+    void add(long idstatefrom, long idaction, long idstateto, prec_t prob, prec_t rew) {
+        statefrom.push_back(idstatefrom);
+        action.push_back(idaction);
+        stateto.push_back(idstateto);
+        probability.push_back(prob);
+        reward.push_back(rew);
+    }
+
+    /// Adds a transition of an MDPO; see add_transition(MDPO&, ...)
+    void add(long idstatefrom, long idaction, long idoutcome, long idstateto,
+             prec_t prob, prec_t rew) {
+        outcome.push_back(idoutcome);
+        add(idstatefrom, idaction, idstateto, prob, rew);
+    }
+
+    /// Appends all transitions of the other builder after the existing ones
+    void append(const ModelBuilder& other) {
+        statefrom.insert(statefrom.end(), other.statefrom.cbegin(),
+                         other.statefrom.cend());
+        action.insert(action.end(), other.action.cbegin(), other.action.cend());
+        outcome.insert(outcome.end(), other.outcome.cbegin(), other.outcome.cend());
+        stateto.insert(stateto.end(), other.stateto.cbegin(), other.stateto.cend());
+        probability.insert(probability.end(), other.probability.cbegin(),
+                           other.probability.cend());
+        reward.insert(reward.end(), other.reward.cbegin(), other.reward.cend());
+    }
+
+    /// Number of transitions
+    size_t size() const { return statefrom.size(); }
+
+    /// Whether there are no transitions
+    bool empty() const { return statefrom.empty(); }
+
+    /// Removes all transitions
+    void clear() {
+        statefrom.clear();
+        action.clear();
+        outcome.clear();
+        stateto.clear();
+        probability.clear();
+        reward.clear();
+    }
+
+    /**
+     * Builds the MDP; see mdp_from_columns. All transitions must be added without
+     * outcomes.
+     */
+    MDP build_mdp(bool force = false, size_t statecount = 0) const {
+        if (!outcome.empty())
+            throw invalid_argument("Cannot build an MDP from transitions with outcomes.");
+        return mdp_from_columns(statefrom, action, stateto, probability, reward, force,
+                                statecount);
+    }
+
+    /**
+     * Builds the MDPO; see mdpo_from_columns. All transitions must be added with
+     * outcomes.
+     */
+    MDPO build_mdpo(bool force = false, size_t statecount = 0) const {
+        if (outcome.size() != statefrom.size())
+            throw invalid_argument("All transitions of an MDPO must have outcomes.");
+        return mdpo_from_columns(statefrom, action, outcome, stateto, probability,
+                                 reward, force, statecount);
+    }
+
+protected:
+    indvec statefrom, action, outcome, stateto;
+    numvec probability, reward;
+};
+
+} // namespace craam
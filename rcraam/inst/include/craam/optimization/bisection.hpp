@@ -242,7 +242,7 @@ inline long minimize_piecewise(const numvec& knots, const numvec& derivatives,
 inline tuple<prec_t, numvec, numvec>
 solve_srect_bisection(const numvecvec& z, const numvecvec& pbar, const prec_t psi,
                       const numvec& wa = numvec(0), const numvecvec ws = numvecvec(0),
-                      const vector<GradientsL1_w> gradients = vector<GradientsL1_w>(0)) {
+                      const vector<GradientsL1_w>& gradients = vector<GradientsL1_w>(0)) {
 
     // make sure that the inputs make sense
     if (z.size() != pbar.size())
@@ -539,7 +539,7 @@ solve_srect_bisection(const numvecvec& z, const numvecvec& pbar, const prec_t ps
 inline pair<prec_t, numvecvec> evaluate_srect_bisection_l1(
     const vector<numvec>& z, const vector<numvec>& pbar, const prec_t psi,
     const numvec& d, const vector<numvec> ws = vector<numvec>(0),
-    const vector<GradientsL1_w> gradients = vector<GradientsL1_w>(0)) {
+    const vector<GradientsL1_w>& gradients = vector<GradientsL1_w>(0)) {
 
     // make sure that the inputs make sense
     if (z.size() != pbar.size())
@@ -725,17 +725,17 @@ inline pair<prec_t, numvecvec> evaluate_srect_bisection_l1(
         xi_values.push_back(xi);
     }
 
-    for (long ai = 0; ai < long(actioncount); ++ai) {
-        auto xi = xi_values[ai];
-        if (ws.empty()) {
-            auto [prob, value] = worstcase_l1(z[ai], pbar[ai], xi);
-
-            //objective_value += d[ai] * value + xi * lambda;  <=== if psi_remainder were not allocated before
-            objective_value += d[ai] * value;
-            probabilities_sol[ai] = prob;
-
-        } else {
-
+    if (ws.empty()) {
+        // solve the problems for all actions at once
+        numvec values;
+        worstcase_l1_batch(z, pbar, xi_values, probabilities_sol, values,
+                           internal::workspace_l1());
+        //objective_value += d[ai] * value + xi * lambda;  <=== if psi_remainder were not allocated before
+        for (long ai = 0; ai < long(actioncount); ++ai)
+            objective_value += d[ai] * values[ai];
+    } else {
+        for (long ai = 0; ai < long(actioncount); ++ai) {
+            auto xi = xi_values[ai];
             auto [prob, value] =
                 gradients.empty()
                     ? worstcase_l1_w(z[ai], pbar[ai], ws[ai], xi)
@@ -39,6 +39,24 @@
 
 namespace craam {
 
+/**
+Reusable memory for worstcase_l1. Reusing the same workspace for many calls
+avoids allocating memory in each call. A workspace must not be shared
+between threads.
+*/
+struct WorkspaceL1 {
+    /// Indices of the elements that may have their probabilities decreased
+    sizvec indices;
+};
+
+namespace internal {
+/// Returns a workspace for worstcase_l1 that is owned by the calling thread
+inline WorkspaceL1& workspace_l1() {
+    thread_local WorkspaceL1 workspace;
+    return workspace;
+}
+} // namespace internal
+
 /**
 @brief Worstcase distribution with a bounded deviation.
 
@@ -50,8 +68,11 @@ s.t.    ||p - pbar|| <= xi
 
 Notes
 -----
-This implementation works in O(n log n) time because of the sort. Using
-quickselect to choose the right quantile would work in O(n) time.
+The optimal solution moves as much probability as possible to the smallest
+element of z and takes it from the largest elements of z. The largest elements
+are found using a partial selection (quickselect) on the workspace indices, so
+this implementation works in expected O(n) time and does not allocate memory
+once the workspace and the output have sufficient capacity.
 
 This function does not check whether the provide probability distribution sums
 to 1.
@@ -59,11 +80,14 @@ to 1.
 @see worstcase_l1_penalty
 @param z Reward values
 @param pbar Nominal probability distribution
-@param t Bound on the L1 norm deviation
-@return Optimal solution p and the objective value
+@param xi Bound on the L1 norm deviation
+@param o Output buffer for the optimal solution p; it is resized as needed
+         and can be reused across calls
+@param workspace Memory that is used by the computation
+@return The objective value
 */
-std::pair<numvec, prec_t> inline worstcase_l1(numvec const& z, numvec const& pbar,
-                                              prec_t xi) {
+prec_t inline worstcase_l1(numvec const& z, numvec const& pbar, prec_t xi, numvec& o,
+                           WorkspaceL1& workspace) {
     assert(*min_element(pbar.cbegin(), pbar.cend()) >= -THRESHOLD);
     assert(*max_element(pbar.cbegin(), pbar.cend()) <= 1 + THRESHOLD);
     assert(xi >= -EPSILON);
@@ -73,36 +97,111 @@ std::pair<numvec, prec_t> inline worstcase_l1(numvec const& z, numvec const& pba
     xi = std::clamp(xi, 0.0, 2.0);
 
     const size_t sz = z.size();
-    // sort z values
-    const sizvec sorted_ind = sort_indexes<prec_t>(z);
     // initialize output probability distribution; copy the values because most
     // may be unchanged
-    numvec o(pbar);
-    // pointer to the smallest (worst case) element
-    size_t k = sorted_ind[0];
+    o.assign(pbar.cbegin(), pbar.cend());
+    // the smallest (worst case) element
+    const size_t kmin = size_t(min_element(z.cbegin(), z.cend()) - z.cbegin());
     // determine how much deviation is actually possible given the provided
     // distribution
-    prec_t epsilon = std::min(xi / 2, 1 - pbar[k]);
+    prec_t epsilon = std::min(xi / 2, 1 - pbar[kmin]);
     // add all the possible weight to the smallest element (structure of the
     // optimal solution)
-    o[k] += epsilon;
-    // start from the last element
-    size_t i = sz - 1;
-    // find the upper quantile that corresponds to the epsilon
-    while (epsilon > 0) {
-        k = sorted_ind[i];
-        // compute how much of epsilon remains and can be addressed by the current
-        // element
-        auto diff = std::min(epsilon, o[k]);
-        // adjust the output and epsilon accordingly
-        o[k] -= diff;
-        epsilon -= diff;
-        i--;
+    o[kmin] += epsilon;
+
+    // the remaining elements with a positive probability
+    sizvec& indices = workspace.indices;
+    indices.clear();
+    for (size_t i = 0; i < sz; ++i)
+        if (i != kmin && pbar[i] > 0) indices.push_back(i);
+
+    // remove epsilon from the largest elements: partition the candidates around
+    // the median and only recurse into the side that contains the upper quantile
+    const auto larger = [&z](size_t i1, size_t i2) { return z[i1] > z[i2]; };
+    auto first = indices.begin(), last = indices.end();
+    while (epsilon > 0 && first != last) {
+        const auto pivot = first + (last - first) / 2;
+        std::nth_element(first, pivot, last, larger);
+        // all the elements before the pivot have values at least as large
+        prec_t upper_mass = 0;
+        for (auto it = first; it != pivot; ++it)
+            upper_mass += o[*it];
+
+        if (upper_mass >= epsilon) {
+            // the quantile is within the larger elements
+            last = pivot;
+        } else {
+            // all larger elements are removed, continue with the pivot
+            for (auto it = first; it != pivot; ++it)
+                o[*it] = 0;
+            epsilon -= upper_mass;
+            auto diff = std::min(epsilon, o[*pivot]);
+            o[*pivot] -= diff;
+            epsilon -= diff;
+            first = pivot + 1;
+        }
     }
-    prec_t r = inner_product(o.cbegin(), o.cend(), z.cbegin(), prec_t(0.0));
+    // only when pbar does not sum to 1 (due to numerical issues)
+    if (epsilon > 0) o[kmin] -= std::min(epsilon, o[kmin]);
+
+    return inner_product(o.cbegin(), o.cend(), z.cbegin(), prec_t(0.0));
+}
+
+/**
+@brief Worstcase distribution with a bounded deviation. Uses a workspace that
+is owned by the calling thread.
+
+@see worstcase_l1(numvec const&, numvec const&, prec_t, numvec&, WorkspaceL1&)
+@param z Reward values
+@param pbar Nominal probability distribution
+@param xi Bound on the L1 norm deviation
+@param o Output buffer for the optimal solution p
+@return The objective value
+*/
+prec_t inline worstcase_l1(numvec const& z, numvec const& pbar, prec_t xi, numvec& o) {
+    return worstcase_l1(z, pbar, xi, o, internal::workspace_l1());
+}
+
+/**
+@brief Worstcase distribution with a bounded deviation.
+
+@see worstcase_l1(numvec const&, numvec const&, prec_t, numvec&, WorkspaceL1&)
+@param z Reward values
+@param pbar Nominal probability distribution
+@param xi Bound on the L1 norm deviation
+@return Optimal solution p and the objective value
+*/
+std::pair<numvec, prec_t> inline worstcase_l1(numvec const& z, numvec const& pbar,
+                                              prec_t xi) {
+    numvec o;
+    prec_t r = worstcase_l1(z, pbar, xi, o);
     return {move(o), r};
 }
 
+/**
+@brief Worstcase distributions with bounded deviations for all actions of a state.
+
+Solves worstcase_l1 for each triplet (z[a], pbar[a], xi[a]) using a single
+workspace. The output vectors are reused and only grow when necessary.
+
+@param z Reward values, one vector for each action
+@param pbar Nominal probability distributions, one for each action
+@param xi Bounds on the L1 norm deviation, one for each action
+@param distributions Output optimal distributions, one for each action
+@param values Output objective values, one for each action
+@param workspace Memory that is used by the computation
+*/
+void inline worstcase_l1_batch(const numvecvec& z, const numvecvec& pbar,
+                               const numvec& xi, numvecvec& distributions,
+                               numvec& values, WorkspaceL1& workspace) {
+    assert(z.size() == pbar.size() && z.size() == xi.size());
+    const size_t actioncount = z.size();
+    distributions.resize(actioncount);
+    values.resize(actioncount);
+    for (size_t a = 0; a < actioncount; ++a)
+        values[a] = worstcase_l1(z[a], pbar[a], xi[a], distributions[a], workspace);
+}
+
 /**
 @brief Worstcase deviation given a linear constraint. Used to compute
 s-rectangular solutions
@@ -248,6 +347,10 @@ std::pair<numvec, numvec> inline worstcase_l1_knots(
  *        p >= 0
  *        ||p - pbar||_{1,w} <= xi
  *
+ * The set of potential basic solutions only depends on the order of the
+ * elements of z (and on w), which rarely changes between consecutive Bellman
+ * updates of the same state and action. The method update reuses the basic
+ * solutions and their previous order as a warm start.
  */
 class GradientsL1_w {
 protected:
@@ -258,6 +361,17 @@ protected:
                                      // solution for each potential basic solution
     std::vector<size_t> sorted;      // order of elements after sorted increasingly
                                      // according to the derivatives
+    sizvec z_increasing; // order of the elements of z used to construct the solutions
+    bool z_strict = false; // whether z was strictly increasing in z_increasing
+
+    /// Derivative of the objective for the basic solution with the index e
+    prec_t compute_derivative(const numvec& z, const numvec& w, size_t e) const {
+        constexpr prec_t epsilon = 1e-8;
+        const size_t i = size_t(donors[e]), j = size_t(receivers[e]);
+        const prec_t derivative = donor_greater[e] ? (-z[i] + z[j]) / (-w[i] + w[j])
+                                                   : (-z[i] + z[j]) / (w[i] + w[j]);
+        return derivative < -epsilon ? derivative : 0;
+    }
 
 public:
     /**
@@ -270,10 +384,22 @@ public:
      * @param z Objective function
      * @param w Weights in the definition of the L1 norm
      */
-    GradientsL1_w(const numvec& z, const numvec& w) {
+    GradientsL1_w(const numvec& z, const numvec& w) { compute(z, w); }
+
+    /**
+     * Computes the possible gradients from scratch and sorts them increasingly
+     * @param z Objective function
+     * @param w Weights in the definition of the L1 norm
+     */
+    void compute(const numvec& z, const numvec& w) {
         constexpr prec_t epsilon = 1e-8;
         size_t element_count = z.size();
 
+        derivatives.clear();
+        donors.clear();
+        receivers.clear();
+        donor_greater.clear();
+
         assert(z.size() == element_count);
         assert(w.size() == element_count);
 
@@ -287,7 +413,10 @@ public:
         // elements)
         std::vector<std::size_t> possible_receivers;
         { // limit the visibility of these variables
-            std::vector<std::size_t> z_increasing = sort_indexes(z);
+            z_increasing = sort_indexes(z);
+            z_strict = true;
+            for (size_t k = 1; k < z_increasing.size(); k++)
+                z_strict = z_strict && z[z_increasing[k - 1]] < z[z_increasing[k]];
             prec_t smallest_w = std::numeric_limits<prec_t>::infinity();
 
             for (size_t iz : z_increasing) {
@@ -343,6 +472,49 @@ public:
         sorted = sort_indexes(derivatives);
     }
 
+    /**
+     * Updates the gradients for new values of z and the same weights w. When the
+     * elements of z are in the same strict order as when the gradients were
+     * computed, the potential basic solutions are reused, only their derivatives
+     * are recomputed, and the previous order is repaired using an insertion sort
+     * (linear when the order is nearly the same). Otherwise, the gradients are
+     * computed from scratch.
+     *
+     * @param z Objective function
+     * @param w Weights in the definition of the L1 norm; must be the same as
+     *          in the previous computation
+     * @return Whether the previous solution could be reused (warm start)
+     */
+    bool update(const numvec& z, const numvec& w) {
+        // check if the set of potential basic solutions is the same
+        bool same_order = z_strict && z_increasing.size() == z.size();
+        for (size_t k = 1; same_order && k < z_increasing.size(); k++)
+            same_order = z[z_increasing[k - 1]] < z[z_increasing[k]];
+        if (!same_order) {
+            compute(z, w);
+            return false;
+        }
+
+        for (size_t e = 0; e < derivatives.size(); e++)
+            derivatives[e] = compute_derivative(z, w, e);
+
+        // insertion sort, starting with the previous order; bail out to a full
+        // sort when the order changed too much
+        const size_t max_moves = 4 * sorted.size() + 16;
+        size_t moves = 0;
+        for (size_t k = 1; k < sorted.size() && moves <= max_moves; k++) {
+            const size_t e = sorted[k];
+            size_t l = k;
+            for (; l > 0 && derivatives[sorted[l - 1]] > derivatives[e] &&
+                   moves <= max_moves;
+                 l--, moves++)
+                sorted[l] = sorted[l - 1];
+            sorted[l] = e;
+        }
+        if (moves > max_moves) sorted = sort_indexes(derivatives);
+        return true;
+    }
+
     /** Returns the number of potential basic solutions generated */
     size_t size() const { return derivatives.size(); }
 
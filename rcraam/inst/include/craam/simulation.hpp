@@ -25,10 +25,12 @@
 
 #include "craam/MDP.hpp"
 #include "craam/Samples.hpp"
+#include "craam/builder.hpp"
 #include "craam/definitions.hpp"
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <random>
@@ -235,6 +237,212 @@ simulate_return(Sim& sim, prec_t discount,
     return make_pair(move(start_states), move(returns));
 }
 
+// ************************************************************************************
+// **** Parallel simulation ****
+// ************************************************************************************
+
+namespace internal {
+/**
+ * Derives the seed of an independent random stream from a seed and a counter (such
+ * as the index of a run) using the SplitMix64 mixing function. The streams do not
+ * depend on the order in which they are used.
+ */
+inline random_device::result_type stream_seed(uint64_t seed, uint64_t counter) {
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull * (counter + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return random_device::result_type(z ^ (z >> 31));
+}
+
+/// Number of runs that are simulated together and stored in one set of samples
+constexpr long simulation_block = 64;
+} // namespace internal
+
+/// Policy function used in the simulation
+template <class Sim>
+using sim_policy_t = function<typename Sim::Action(typename Sim::State&)>;
+
+/// Constructs a policy for a copy of the simulator and a seed
+template <class Sim>
+using sim_policy_factory_t = function<sim_policy_t<Sim>(const Sim&,
+                                                        random_device::result_type)>;
+
+/**
+Runs the simulator in parallel and generates samples.
+
+Each thread simulates runs on its own copy of the simulator. Each run uses
+independent random streams for the simulator, the policy, and the termination, and
+these streams are derived only from the seed and the index of the run. The samples
+are merged in the order of the runs. The result for a given seed is therefore
+identical regardless of the number of threads, but it differs from the result of
+simulate.
+
+The simulator must be copyable and must provide a method set_seed(seed), which is
+called at the beginning of each run. The simulator should not have any other state
+that changes during the simulation. Policies usually keep a reference to the
+simulator and have their own random number generator; they are constructed
+by make_policy at the beginning of each run.
+
+@tparam Sim Simulator class used in the simulation. See simulate.
+@tparam SampleType Class used to hold the samples.
+
+@param sim Simulator that holds the properties needed by the simulator
+@param make_policy Constructs the policy for a copy of the simulator and a seed
+@param horizon Number of steps
+@param runs Number of runs
+@param prob_term The probability of termination in each step
+@param seed Seed from which the seeds of all runs are derived
+
+@returns Set of samples
+ */
+template <class Sim,
+          class SampleType = Samples<typename Sim::State, typename Sim::Action>>
+SampleType simulate_par(const Sim& sim, const sim_policy_factory_t<Sim>& make_policy,
+                        long horizon, long runs, prec_t prob_term = 0.0,
+                        random_device::result_type seed = random_device{}()) {
+
+    const long nblocks = (runs + internal::simulation_block - 1) /
+                         internal::simulation_block;
+    vector<SampleType> blocks(max(nblocks, 0l));
+
+    bool openmp_error = false;
+#pragma omp parallel
+    {
+        Sim local_sim(sim);
+
+#pragma omp for schedule(dynamic)
+        for (long block = 0; block < nblocks; block++) {
+            try {
+                SampleType& samples = blocks[block];
+                const long first = block * internal::simulation_block;
+                const long last = min(runs, first + internal::simulation_block);
+                for (long run = first; run < last; run++) {
+                    const auto run_seed = internal::stream_seed(seed, run);
+                    local_sim.set_seed(internal::stream_seed(run_seed, 0));
+                    auto policy =
+                        make_policy(local_sim, internal::stream_seed(run_seed, 1));
+                    default_random_engine generator(internal::stream_seed(run_seed, 2));
+                    uniform_real_distribution<double> distribution(0.0, 1.0);
+
+                    typename Sim::State state = local_sim.init_state();
+                    samples.add_initial(state);
+
+                    for (long step = 0; step < horizon; step++) {
+                        if (local_sim.end_condition(state)) break;
+
+                        auto action = policy(state);
+                        auto reward_state = local_sim.transition(state, action);
+
+                        auto reward = reward_state.first;
+                        auto nextstate = move(reward_state.second);
+
+                        samples.add_sample(move(state), move(action), nextstate, reward,
+                                           1.0, step, run);
+                        state = move(nextstate);
+
+                        // test the termination probability only after at least one
+                        // transition
+                        if ((prob_term > 0.0) && (distribution(generator) <= prob_term))
+                            break;
+                    }
+                }
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "simulate_par");
+                    openmp_error = true;
+                }
+            }
+        }
+    }
+    // just terminate if there is an error
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+
+    // merge the samples in the order of the runs
+    SampleType samples = SampleType();
+    for (const SampleType& block : blocks) {
+        for (const auto& state : block.get_initial())
+            samples.add_initial(state);
+        for (size_t i = 0; i < block.size(); i++)
+            samples.add_sample(block.get_sample(i));
+    }
+    return samples;
+}
+
+/**
+Runs the simulator in parallel and computes the returns from the simulation.
+
+The simulation is run in the same way as in simulate_par and the result for a given
+seed is identical regardless of the number of threads.
+
+\param sim Simulator that holds the properties needed by the simulator
+\param discount Discount to use in the computation
+\param make_policy Constructs the policy for a copy of the simulator and a seed
+\param horizon Number of steps
+\param runs Number of runs
+\param prob_term The probability of termination in each step
+\param seed Seed from which the seeds of all runs are derived
+
+\returns Pair of (states, cumulative returns starting in states)
+ */
+template <class Sim>
+pair<vector<typename Sim::State>, numvec>
+simulate_return_par(const Sim& sim, prec_t discount,
+                    const sim_policy_factory_t<Sim>& make_policy, long horizon,
+                    long runs, prec_t prob_term = 0.0,
+                    random_device::result_type seed = random_device{}()) {
+
+    // pre-initialize output values
+    vector<typename Sim::State> start_states(runs);
+    numvec returns(runs);
+
+    bool openmp_error = false;
+#pragma omp parallel
+    {
+        Sim local_sim(sim);
+
+#pragma omp for schedule(dynamic, internal::simulation_block)
+        for (long run = 0; run < runs; run++) {
+            try {
+                const auto run_seed = internal::stream_seed(seed, run);
+                local_sim.set_seed(internal::stream_seed(run_seed, 0));
+                auto policy = make_policy(local_sim, internal::stream_seed(run_seed, 1));
+                default_random_engine generator(internal::stream_seed(run_seed, 2));
+                uniform_real_distribution<double> distribution(0.0, 1.0);
+
+                typename Sim::State state = local_sim.init_state();
+                start_states[run] = state;
+
+                prec_t runreturn = 0;
+                for (long step = 0; step < horizon; step++) {
+                    if (local_sim.end_condition(state)) break;
+
+                    auto action = policy(state);
+                    auto reward_state = local_sim.transition(state, action);
+
+                    runreturn += reward_state.first * pow(discount, step);
+                    state = move(reward_state.second);
+                    // test the termination probability only after at least one
+                    // transition
+                    if ((prob_term > 0.0) && (distribution(generator) <= prob_term))
+                        break;
+                }
+                returns[run] = runreturn;
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "simulate_return_par");
+                    openmp_error = true;
+                }
+            }
+        }
+    }
+    // just terminate if there is an error
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+
+    return make_pair(move(start_states), move(returns));
+}
+
 // ************************************************************************************
 // **** Randomized and random policies ****
 // ************************************************************************************
@@ -456,6 +664,110 @@ protected:
 // **** MDP simulation ****
 // ************************************************************************************
 
+/**
+ * Walker's alias tables for sampling from many discrete distributions. Each sample
+ * takes constant time and a single uniform random number, and it does not allocate
+ * any memory. The tables of all distributions are stored in contiguous arrays.
+ *
+ * See: Vose, M. D. (1991). A linear algorithm for generating random numbers with a
+ * given distribution. IEEE Transactions on Software Engineering, 17(9), 972–975.
+ */
+class AliasTables {
+public:
+    /// Constructs an object with no tables
+    AliasTables() : offsets(1, 0) {}
+
+    /**
+     * Adds a table for a distribution. The probabilities are normalized to sum
+     * to one, just like in std::discrete_distribution.
+     *
+     * @param probabilities Unnormalized probabilities of the outcomes. May be empty,
+     *                      in which case the table cannot be sampled from.
+     * @param extra An optional probability of an additional outcome with the index
+     *              probabilities.size(). It is ignored when it is not positive.
+     * @return Index of the table
+     */
+    size_t add(const numvec& probabilities, prec_t extra = 0.0) {
+        const size_t n = probabilities.size() + (extra > 0 ? 1 : 0);
+        const size_t b = offsets.back();
+
+        cutoffs.resize(b + n);
+        aliases.resize(b + n);
+        offsets.push_back(b + n);
+        if (n == 0) return offsets.size() - 2;
+
+        prec_t total = accumulate(probabilities.cbegin(), probabilities.cend(), 0.0);
+        if (extra > 0) total += extra;
+        if (total <= 0)
+            throw invalid_argument("Probabilities must have a positive sum.");
+
+        // probabilities scaled by the number of outcomes; the mean is 1
+        for (size_t i = 0; i < n; i++) {
+            cutoffs[b + i] =
+                (i < probabilities.size() ? probabilities[i] : extra) * prec_t(n) / total;
+            aliases[b + i] = i;
+        }
+        small.clear();
+        large.clear();
+        for (size_t i = 0; i < n; i++)
+            (cutoffs[b + i] < 1.0 ? small : large).push_back(i);
+
+        // pair each underfull bucket with an overfull one
+        while (!small.empty() && !large.empty()) {
+            const size_t l = small.back(), g = large.back();
+            small.pop_back();
+            aliases[b + l] = g;
+            cutoffs[b + g] = (cutoffs[b + g] + cutoffs[b + l]) - 1.0;
+            if (cutoffs[b + g] < 1.0) {
+                large.pop_back();
+                small.push_back(g);
+            }
+        }
+        // the remaining buckets are full up to rounding errors
+        for (size_t i : large)
+            cutoffs[b + i] = 1.0;
+        for (size_t i : small)
+            cutoffs[b + i] = 1.0;
+
+        return offsets.size() - 2;
+    }
+
+    /// Number of tables
+    size_t size() const { return offsets.size() - 1; }
+
+    /// Number of outcomes of the table
+    size_t outcome_count(size_t table) const {
+        return offsets[table + 1] - offsets[table];
+    }
+
+    /**
+     * Samples an outcome from the table.
+     *
+     * @param table Index of the table, it must have at least one outcome
+     * @param uniform A random number uniformly distributed in [0,1)
+     * @return Index of the outcome
+     */
+    size_t sample(size_t table, prec_t uniform) const {
+        const size_t b = offsets[table], n = offsets[table + 1] - b;
+        assert(n > 0);
+        const prec_t scaled = uniform * prec_t(n);
+        const size_t bucket = min(size_t(scaled), n - 1);
+        return (scaled - prec_t(bucket)) < cutoffs[b + bucket] ? bucket
+                                                               : aliases[b + bucket];
+    }
+
+protected:
+    /// Position of the first bucket of each table, the last element is the total
+    /// number of buckets
+    sizvec offsets;
+    /// Probability of keeping the bucket's own outcome
+    numvec cutoffs;
+    /// Outcome used when the bucket's own outcome is not kept
+    sizvec aliases;
+    /// Work lists used when building the tables
+    sizvec small, large;
+};
+
 /**
  * A simulator that behaves as the provided MDP. A state of MDP.size() is
  * considered to be the terminal state.
@@ -465,6 +777,15 @@ protected:
  *
  * Any state with an index higher or equal to the number of states is considered to
  * be terminal.
+ *
+ * The transitions are sampled from alias tables that are built for all states and
+ * actions when the simulator is constructed. Each transition then takes constant
+ * time and does not allocate memory. The MDP must not change after the simulator
+ * is constructed.
+ *
+ * Copies of the simulator share the alias tables and the other data derived from
+ * the MDP, and only copy the state of the random number generator. The parallel
+ * simulation methods can thus copy the simulator in each thread cheaply.
  */
 class ModelSimulator {
 
@@ -482,16 +803,39 @@ public:
      */
     ModelSimulator(const shared_ptr<const MDP>& mdp, const Transition& initial,
                    unsigned int seed = random_device{}())
-        : gen{seed}, mdp{mdp}, available_actions{mdp->size()}, initial{initial} {
+        : gen{seed}, mdp{mdp} {
 
         if (abs(initial.sum_probabilities() - 1) > SOLPREC)
             throw invalid_argument("Initial transition probabilities must sum to 1");
 
+        auto data = make_shared<SharedData>();
+        data->initial = initial;
+        data->available_actions.resize(mdp->size());
+        data->state_offsets.assign(mdp->size() + 1, 0);
+
         // initialize action count
         for (size_t is = 0; is < mdp->size(); ++is) {
-            available_actions[is].resize((*mdp)[is].size());
-            std::iota(available_actions[is].begin(), available_actions[is].end(), 0);
+            indvec& actions = data->available_actions[is];
+            actions.resize((*mdp)[is].size());
+            std::iota(actions.begin(), actions.end(), 0);
         }
+
+        // the first table is for the initial distribution
+        AliasTables& tables = data->tables;
+        tables.add(initial.get_probabilities());
+        for (size_t is = 0; is < mdp->size(); ++is) {
+            const auto& mdpstate = (*mdp)[is];
+            data->state_offsets[is] = tables.size();
+            for (size_t ia = 0; ia < mdpstate.size(); ++ia) {
+                const auto& tran = mdpstate[ia];
+                // the remainder is the probability of terminating
+                const prec_t prob_termination = 1 - tran.sum_probabilities();
+                tables.add(tran.get_probabilities(),
+                           prob_termination > SOLPREC ? prob_termination : 0.0);
+            }
+        }
+        data->state_offsets[mdp->size()] = tables.size();
+        shared = move(data);
     }
 
     /**
@@ -504,12 +848,15 @@ public:
                    random_device::result_type seed = random_device{}())
         : ModelSimulator(const_pointer_cast<const MDP>(mdp), initial, seed){};
 
+    /// Sets the seed
+    void set_seed(random_device::result_type seed = random_device{}()) {
+        gen.seed(seed);
+        distribution.reset();
+    }
+
     /// Returns a sample from the initial states.
     State init_state() {
-        const numvec& probs = initial.get_probabilities();
-        const indvec& inds = initial.get_indices();
-        auto dst = discrete_distribution<long>(probs.begin(), probs.end());
-        return inds[dst(gen)];
+        return shared->initial.get_indices()[shared->tables.sample(0, distribution(gen))];
     }
 
     /**
@@ -525,37 +872,19 @@ public:
     pair<double, State> transition(State state, Action action) {
 
         assert(state >= 0 && size_t(state) < mdp->size());
-        const auto& mdpstate = (*mdp)[state];
+        assert(action >= 0 && size_t(action) < (*mdp)[state].size());
 
-        assert(action >= 0 && size_t(action) < mdpstate.size());
-        const auto& mdpaction = mdpstate[action];
-        const auto& tran = mdpaction;
-
-        const numvec& probs = tran.get_probabilities();
-        const numvec& rews = tran.get_rewards();
-        const indvec& inds = tran.get_indices();
-
-        if (probs.empty())
+        const AliasTables& tables = shared->tables;
+        const size_t table = shared->state_offsets[state] + size_t(action);
+        if (tables.outcome_count(table) == 0)
             throw ModelError("No transitions associated with the state and action pair",
                              state, action);
 
-        // check if the transition sums to 1, if not use the remainder
-        // as a probability of terminating
-        prec_t prob_termination = 1 - tran.sum_probabilities();
-
-        discrete_distribution<long> dst;
-
-        if (prob_termination > SOLPREC) {
-            // copy the probabilities (there should be a faster way too)
-            numvec copy_probs(probs);
-            copy_probs.push_back(prob_termination);
-
-            dst = discrete_distribution<long>(copy_probs.begin(), copy_probs.end());
-        } else {
-            dst = discrete_distribution<long>(probs.begin(), probs.end());
-        }
+        const auto& tran = (*mdp)[state][action];
+        const numvec& rews = tran.get_rewards();
+        const indvec& inds = tran.get_indices();
 
-        const size_t nextindex = dst(gen);
+        const size_t nextindex = tables.sample(table, distribution(gen));
 
         // check if need to transition to a terminal state
         const State nextstate = nextindex < inds.size() ? inds[nextindex] : mdp->size();
@@ -577,7 +906,7 @@ public:
      * Returns available actions for the state.
      */
     const vector<Action>& get_valid_actions(State state) const {
-        return available_actions[state];
+        return shared->available_actions[state];
     }
 
     /// State dependent action list
@@ -589,15 +918,29 @@ public:
 protected:
     /// Random number engine
     default_random_engine gen;
+    /// Uniform distribution used to sample from the alias tables
+    uniform_real_distribution<prec_t> distribution{0.0, 1.0};
 
     /** MDP used for the simulation */
     shared_ptr<const MDP> mdp;
 
-    /** Available actions for each state */
-    vector<indvec> available_actions;
+    /// Data derived from the MDP, which does not change after the construction
+    struct SharedData {
+        /** Available actions for each state */
+        vector<indvec> available_actions;
+
+        /** Initial distribution */
+        Transition initial;
+
+        /// Index of the alias table of the first action of each state
+        sizvec state_offsets;
 
-    /** Initial distribution */
-    Transition initial;
+        /// Alias tables of the initial distribution and of all state-action pairs
+        AliasTables tables;
+    };
+
+    /// Shared by the copies of the simulator
+    shared_ptr<const SharedData> shared;
 };
 
 /// Random (uniformly) policy to be used with the model simulator
@@ -632,7 +975,7 @@ using ModelStochasticPolicy = StochasticPolicy<ModelSimulator>;
  */
 template <class S> inline MDP build_mdp(S& sim, unsigned int sample_count) {
 
-    MDP result(sim.state_count());
+    ModelBuilder builder;
     // the problem with parallelizing this loop is that it may affect the random
     // number generator in an unpredictable way
     for (long statefrom = 0; statefrom < sim.state_count(); ++statefrom) {
@@ -646,13 +989,12 @@ template <class S> inline MDP build_mdp(S& sim, unsigned int sample_count) {
                 prec_t reward;
                 std::tie(reward, stateto) = sim.transition(statefrom, action);
                 const prec_t probability = 1.0 / prec_t(sample_count);
-                // add transition probability,
-                // should be aggregated automatically
-                add_transition(result, statefrom, action, stateto, probability, reward);
+                // samples are aggregated when the MDP is built
+                builder.add(statefrom, action, stateto, probability, reward);
             }
         }
     }
-    return result;
+    return builder.build_mdp(false, size_t(sim.state_count()));
 }
 
 
@@ -660,37 +1002,78 @@ template <class S> inline MDP build_mdp(S& sim, unsigned int sample_count) {
  * Builds an MDP from a simulator and builds states in parallel.
  *
  * Requires that the states and actions have discrete numbers starting with 0.
- * 
- * This runs the construction in parallel, which could mess up the random number generator
- * or cause other unpredictable problems.
  *
- * @param sim Simulator. This is passed not as a constant because simulation
- *                       affects the random number generator.
+ * Each thread samples from its own copy of the simulator and the simulator is
+ * reseeded for each state with a seed derived from the seed and the state index.
+ * The result for a given seed is therefore identical regardless of the number of
+ * threads, but it differs from the result of build_mdp. The simulator must be
+ * copyable and must provide a method set_seed(seed).
+ *
+ * @param sim Simulator, it is copied for each thread
  * @param sample_count Number of samples to take for each state and action
+ * @param seed Seed from which the seeds for all states are derived
  */
-template <class S> inline MDP build_mdp_par(S& sim, unsigned int sample_count) {
+template <class S>
+inline MDP build_mdp_par(const S& sim, unsigned int sample_count,
+                         random_device::result_type seed = random_device{}()) {
 
     // it is important to initialize the state size in the beginning to avoid issues with
     // parallel access while the simulation is running
-    MDP result(sim.state_count());
-#pragma omp parallel for
-    for (long statefrom = 0; statefrom < sim.state_count(); ++statefrom) {
-        // check if the state is terminal and include no actions for it
-        // if true (meaning it is terminal)
-        if (sim.end_condition(statefrom)) continue;
-        for (long action = 0; action < sim.action_count(statefrom); ++action) {
-            for (long i = 0; i < sample_count; ++i) {
-                // simulate a single step of the transition probabilities
-                long stateto;
-                prec_t reward;
-                std::tie(reward, stateto) = sim.transition(statefrom, action);
-                const prec_t probability = 1.0 / prec_t(sample_count);
-                // add transition probability,
-                // should be aggregated automatically
-                add_transition(result, statefrom, action, stateto, probability, reward);
+    const long nstates = sim.state_count();
+    MDP result(nstates);
+    // the largest target state, states beyond nstates are added after the loop
+    long maxstate = nstates - 1;
+
+    bool openmp_error = false;
+#pragma omp parallel reduction(max : maxstate)
+    {
+        S local_sim(sim);
+        // samples of a single state and action
+        indvec samples_to(sample_count);
+        numvec samples_reward(sample_count);
+        const numvec samples_probability(sample_count, 1.0 / prec_t(sample_count));
+
+#pragma omp for schedule(dynamic)
+        for (long statefrom = 0; statefrom < nstates; ++statefrom) {
+            try {
+                // check if the state is terminal and include no actions for it
+                // if true (meaning it is terminal)
+                if (local_sim.end_condition(statefrom)) continue;
+                local_sim.set_seed(internal::stream_seed(seed, statefrom));
+
+                // each thread only modifies its own states
+                auto& state = result[statefrom];
+                for (long action = 0; action < long(local_sim.action_count(statefrom));
+                     ++action) {
+                    auto& mdpaction = state.create_action(action);
+                    for (long i = 0; i < sample_count; ++i) {
+                        // simulate a single step of the transition probabilities
+                        long stateto;
+                        prec_t reward;
+                        std::tie(reward, stateto) =
+                            local_sim.transition(statefrom, action);
+                        samples_to[i] = stateto;
+                        samples_reward[i] = reward;
+                        maxstate = max(maxstate, stateto);
+                    }
+                    // the samples are aggregated after sorting them
+                    add_samples(mdpaction, samples_to, samples_probability,
+                                samples_reward);
+                }
+            } catch (const exception& e) {
+                // only run this once per loop
+                if (!openmp_error) {
+                    craam::internal::openmp_exception_handler(e, "build_mdp_par");
+                    openmp_error = true;
+                }
             }
         }
     }
+    // just terminate if there is an error
+    if (openmp_error) throw runtime_error("Failed with an exception in OPENMP block.");
+
+    // make sure that all target states exist
+    if (maxstate >= 0) result.create_state(maxstate);
     return result;
 }
 
@@ -142,6 +142,9 @@ public:
         }
     }
 
+    /// Sets the seed
+    void set_seed(random_device::result_type seed = random_device{}()) { gen.seed(seed); }
+
     /// Returns the initial state
     long init_state() const { return init_population; }
 
@@ -23,14 +23,17 @@
 
 #pragma once
 
+#include "craam/CompiledMDP.hpp"
 #include "craam/MDP.hpp"
 #include "craam/MDPO.hpp"
 #include "craam/Solution.hpp"
+#include "craam/algorithms/bellman_compiled.hpp"
 #include "craam/algorithms/bellman_mdp.hpp"
 #include "craam/algorithms/bellman_mdpo.hpp"
 #include "craam/algorithms/iteration_methods.hpp"
 #include "craam/algorithms/linprog.hpp"
 #include "craam/algorithms/nature_declarations.hpp"
+#include "craam/algorithms/values_batch.hpp"
 #include "craam/modeltools.hpp"
 #include "craam/optimization/gurobi.hpp"
 
@@ -57,6 +60,9 @@ namespace craam {
  * @param maxresidual Stop when the maximal residual falls below this value.
  * @param progress An optional function for reporting progress and can
                 return false to stop computation
+ * @param vi_solver Variant of value iteration, see algorithms::VISolver
+ * @param anderson Number of previous sweeps combined by Anderson acceleration
+                (0 disables it); only supported by the Gauss-Seidel variant
  *
  * @returns Solution that can be used to compute the total return, or the optimal
 policy.
@@ -84,6 +90,10 @@ policy.
  * below maxresidual_vi * last_policy_residual
  * @param progress An optional function for reporting progress and can
                 return false to stop computation
+ * @param anderson Number of previous iterates combined by Anderson acceleration
+                of the policy evaluation (0 disables it), see algorithms::mpi_jac
+ * @param bounds Stopping rule and action elimination, see algorithms::ValueBounds;
+                the model must not have terminal states unless it is none
  *
  * @return Computed (approximate) solution
  */
@@ -91,9 +101,11 @@ policy.
 /**
  * @defgroup PolicyIteration
  *
- * Policy iteration using parallel action updated and Eigen to compute matrix
- * inverse. Since this method is based on dense matrices, it does not scale
- * particularly well.
+ * Policy iteration using parallel action updated and Eigen to solve the policy
+ * evaluation linear system. The transition matrix is sparse and only the rows
+ * of states with a changed policy are recomputed in each iteration. The linear
+ * solver (dense LU/QR, sparse LU, or BiCGSTAB) can be selected with the
+ * solver parameter; the dense solvers do not scale to large problems.
  *
  * The method stop when the residual reaches the specified threshold or the policy
  * no longer changes.
@@ -113,6 +125,8 @@ policy.
  * below this threshold.
  * @param progress An optional function for reporting progress and can
                 return false to stop computation
+ * @param bounds Stopping rule and action elimination, see algorithms::ValueBounds;
+                the model must not have terminal states unless it is none
  *
  * @return Computed (approximate) solution
  */
@@ -128,10 +142,12 @@ inline DetermSolution
 solve_vi(const MDP& mdp, prec_t discount, numvec valuefunction = numvec(0),
          const indvec& policy = indvec(0), unsigned long iterations = MAXITER,
          prec_t maxresidual = SOLPREC,
-         const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+         const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+         algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
     check_model(mdp);
-    return algorithms::vi_gs(algorithms::PlainBellman(mdp, policy), discount,
-                             move(valuefunction), iterations, maxresidual, progress);
+    return algorithms::vi(mdp, algorithms::PlainBellman(mdp, policy), discount,
+                          move(valuefunction), iterations, maxresidual, progress,
+                          vi_solver, anderson);
 }
 
 /**
@@ -142,29 +158,36 @@ solve_mpi(const MDP& mdp, prec_t discount, const numvec& valuefunction = numvec(
           const indvec& policy = indvec(0), unsigned long iterations_pi = MAXITER,
           prec_t maxresidual_pi = SOLPREC, unsigned long iterations_vi = MAXITER,
           prec_t maxresidual_vi = 0.9,
-          const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          size_t anderson = 0,
+          algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::mpi_jac(algorithms::PlainBellman(mdp, policy), discount,
                                valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson,
+                               bounds);
 }
 
 /**
  * Computes occupancy frequencies using matrix representation of transition
- * probabilities. This method requires computing a matrix inverse.
+ * probabilities. This method requires solving a system of linear equations.
  *
  * @param init Initial distribution (alpha)
  * @param discount Discount factor (gamma)
  * @param policies The policy (indvec) or a pair of the policy and the policy
  *        of nature (pair<indvec,vector<numvec> >). The nature is typicall
  *        a randomized policy
+ * @param solver Linear solver used to compute the frequencies
  */
-inline numvec occupancies(const MDP& mdp, const Transition& initial, prec_t discount,
-                          const indvec& policy) {
+inline numvec
+occupancies(const MDP& mdp, const Transition& initial, prec_t discount,
+            const indvec& policy,
+            algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
 
     check_model(mdp);
     return algorithms::occfreq_mat(algorithms::PlainBellman(mdp), initial, discount,
-                                   policy);
+                                   policy, solver);
 }
 
 /**
@@ -174,10 +197,14 @@ inline DetermSolution
 solve_pi(const MDP& mdp, prec_t discount, numvec valuefunction = numvec(0),
          const indvec& policy = indvec(0), unsigned long iterations = MAXITER,
          prec_t maxresidual = SOLPREC,
-         const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+         const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+         algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu,
+         algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::pi(algorithms::PlainBellman(mdp, policy), discount,
-                          move(valuefunction), iterations, maxresidual, progress);
+                          move(valuefunction), iterations, maxresidual, progress, solver,
+                          bounds);
 }
 
 #ifdef GUROBI_USE
@@ -221,14 +248,16 @@ inline RandSolution solve_vi_r(
     const MDP& mdp, prec_t discount, numvec valuefunction = numvec(0),
     const numvecvec& policy = numvecvec(0), unsigned long iterations = MAXITER,
     prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs) {
 
     check_model(mdp);
     if (!policy.empty() && policy.size() != mdp.size())
         throw invalid_argument("Policy length does not match number of states.");
 
-    return algorithms::vi_gs(algorithms::PlainBellmanRand(mdp, policy), discount,
-                             move(valuefunction), iterations, maxresidual, progress);
+    return algorithms::vi(mdp, algorithms::PlainBellmanRand(mdp, policy), discount,
+                          move(valuefunction), iterations, maxresidual, progress,
+                          vi_solver);
 }
 
 /**
@@ -291,14 +320,18 @@ inline RandSolution solve_pi_r(
  * @ingroup ValueIteration
  * Robust value iteration with an s,a-rectangular nature.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution
-rsolve_vi(const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
+rsolve_vi(const MDP& mdp, prec_t discount, const Nature& nature,
           numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
           unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-          const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          algorithms::VISolver vi_solver = algorithms::VISolver::gs,
+          size_t anderson = 0) {
     check_model(mdp);
-    return algorithms::vi_gs(algorithms::SARobustBellman(mdp, nature, policy), discount,
-                             move(valuefunction), iterations, maxresidual, progress);
+    return algorithms::vi(mdp, algorithms::SARobustBellman(mdp, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
 }
 
 /**
@@ -316,16 +349,20 @@ rsolve_vi(const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
  * and Theoretical Computer Science, 13, 51–71.
  *
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_mpi(
-    const MDP& mdp, prec_t discount, const algorithms::SANature&& nature,
+    const MDP& mdp, prec_t discount, const Nature& nature,
     const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
     unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0, algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::mpi_jac(algorithms::SARobustBellman(mdp, nature, policy), discount,
                                valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson,
+                               bounds);
 }
 
 /**
@@ -338,8 +375,9 @@ inline SARobustSolution rsolve_mpi(
  * Advances in Computational Complexity Theory, DIMACS Series in Discrete Mathematics
  * and Theoretical Computer Science, 13, 51–71.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution
-rsolve_pi(const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
+rsolve_pi(const MDP& mdp, prec_t discount, const Nature& nature,
           numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
           unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
           const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
@@ -359,15 +397,20 @@ rsolve_pi(const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
  * This method is guaranteed to converge to the optimal value function
  * and policy.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_ppi(
-    const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
+    const MDP& mdp, prec_t discount, const Nature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu,
+    algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::rppi(algorithms::SARobustBellman(mdp, nature, policy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::pi, progress);
+                            discount * discount, algorithms::MDPSolver::pi, progress,
+                            solver, 0, bounds);
 }
 
 /**
@@ -381,15 +424,19 @@ inline SARobustSolution rsolve_ppi(
  * This method is guaranteed to converge to the optimal value function
  * and policy.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_mppi(
-    const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
+    const MDP& mdp, prec_t discount, const Nature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0, algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::rppi(algorithms::SARobustBellman(mdp, nature, policy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            std::pow(discount, 2), algorithms::MDPSolver::mpi, progress);
+                            std::pow(discount, 2), algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson, bounds);
 }
 
 /**
@@ -403,15 +450,19 @@ inline SARobustSolution rsolve_mppi(
  * This method is guaranteed to converge to the optimal value function
  * and policy.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_vppi(
-    const MDP& mdp, prec_t discount, const algorithms::SANature& nature,
+    const MDP& mdp, prec_t discount, const Nature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0, algorithms::ValueBounds bounds = algorithms::ValueBounds::none) {
     check_model(mdp);
+    if (bounds != algorithms::ValueBounds::none) check_no_terminal(mdp);
     return algorithms::rppi(algorithms::SARobustBellman(mdp, nature, policy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::vi, progress);
+                            discount * discount, algorithms::MDPSolver::vi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson, bounds);
 }
 
 // **************************************************************************
@@ -426,11 +477,13 @@ inline SRobustSolution rsolve_s_vi(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
     check_model(mdp);
     auto rpolicy = policy_det2rand(mdp, policy);
-    return algorithms::vi_gs(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
-                             move(valuefunction), iterations, maxresidual, progress);
+    return algorithms::vi(mdp, algorithms::SRobustBellman(mdp, nature, rpolicy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
 }
 
 /**
@@ -441,10 +494,12 @@ inline SRobustSolution rsolve_s_vi_r(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const numvecvec& rpolicy = numvecvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
     check_model(mdp);
-    return algorithms::vi_gs(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
-                             move(valuefunction), iterations, maxresidual, progress);
+    return algorithms::vi(mdp, algorithms::SRobustBellman(mdp, nature, rpolicy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
 }
 
 /**
@@ -462,12 +517,13 @@ inline SRobustSolution rsolve_s_mpi(
     const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
     unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
     auto rpolicy = policy_det2rand(mdp, policy);
     return algorithms::mpi_jac(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                                valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson);
 }
 
 /**
@@ -487,11 +543,12 @@ inline SRobustSolution rsolve_s_mpi_r(
     const numvec& valuefunction = numvec(0), const numvecvec& rpolicy = numvecvec(0),
     unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
     unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
     return algorithms::mpi_jac(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                                valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson);
 }
 
 /**
@@ -576,13 +633,15 @@ inline SRobustSolution rsolve_s_mppi(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
 
     auto rpolicy = policy_det2rand(mdp, policy);
     return algorithms::rppi(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::mpi, progress);
+                            discount * discount, algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
 }
 
 /**
@@ -601,13 +660,15 @@ inline SRobustSolution rsolve_s_vppi(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
 
     auto rpolicy = policy_det2rand(mdp, policy);
     return algorithms::rppi(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::vi, progress);
+                            discount * discount, algorithms::MDPSolver::vi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
 }
 
 /**
@@ -665,12 +726,14 @@ inline SRobustSolution rsolve_s_mppi_r(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const numvecvec& rpolicy = numvecvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
 
     return algorithms::rppi(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::mpi, progress);
+                            discount * discount, algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
 }
 
 /**
@@ -689,12 +752,14 @@ inline SRobustSolution rsolve_s_vppi_r(
     const MDP& mdp, prec_t discount, const algorithms::SNature& nature,
     numvec valuefunction = numvec(0), const numvecvec& rpolicy = numvecvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
 
     return algorithms::rppi(algorithms::SRobustBellman(mdp, nature, rpolicy), discount,
                             move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::vi, progress);
+                            discount * discount, algorithms::MDPSolver::vi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
 }
 
 // **************************************************************************
@@ -712,11 +777,12 @@ inline DetermSolution
 solve_vi(const MDPO& mdp, prec_t discount, numvec valuefunction = numvec(0),
          const indvec& policy = indvec(0), unsigned long iterations = MAXITER,
          prec_t maxresidual = SOLPREC,
-         const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+         const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+         algorithms::VISolver vi_solver = algorithms::VISolver::gs) {
     check_model(mdp);
-    auto solution = algorithms::vi_gs(
-        algorithms::SARobustOutcomeBellman(mdp, algorithms::nats::average(), policy),
-        discount, move(valuefunction), iterations, maxresidual, progress);
+    auto solution = algorithms::vi(
+        mdp, algorithms::SARobustOutcomeBellman(mdp, algorithms::nats::average(), policy),
+        discount, move(valuefunction), iterations, maxresidual, progress, vi_solver);
 
     // remove the nature's choice from the solution since there is no
     // nature's choice
@@ -759,15 +825,18 @@ solve_mpi(const MDPO& mdp, prec_t discount, const numvec& valuefunction = numvec
  * @ingroup ValueIteration
  * Robust value iteration with an s,a-rectangular nature.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution
-rsolve_vi(const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
+rsolve_vi(const MDPO& mdp, prec_t discount, const Nature& nature,
           numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
           unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-          const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          algorithms::VISolver vi_solver = algorithms::VISolver::gs,
+          size_t anderson = 0) {
     check_model(mdp);
-    return algorithms::vi_gs(algorithms::SARobustOutcomeBellman(mdp, nature, policy),
-                             discount, move(valuefunction), iterations, maxresidual,
-                             progress);
+    return algorithms::vi(mdp, algorithms::SARobustOutcomeBellman(mdp, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
 }
 
 /**
@@ -780,8 +849,9 @@ rsolve_vi(const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
  * Advances in Computational Complexity Theory, DIMACS Series in Discrete Mathematics
  * and Theoretical Computer Science, 13, 51–71.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution
-rsolve_pi(const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
+rsolve_pi(const MDPO& mdp, prec_t discount, const Nature& nature,
           numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
           unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
           const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
@@ -801,16 +871,18 @@ rsolve_pi(const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
  * modified policy iteration. INFORMS Journal on Computing, 25(3), 396–410. See
  * the discussion in the paper on methods like this one (e.g. Seid, White)
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_mpi(
-    const MDPO& mdp, prec_t discount, const algorithms::SANature&& nature,
+    const MDPO& mdp, prec_t discount, const Nature& nature,
     const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
     unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
     return algorithms::mpi_jac(algorithms::SARobustOutcomeBellman(mdp, nature, policy),
                                discount, valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson);
 }
 
 /**
@@ -823,16 +895,19 @@ inline SARobustSolution rsolve_mpi(
  * Uses  policy iteration to solve the inner MDP problem that corresponds
  * to the nature.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_ppi(
-    const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
+    const MDPO& mdp, prec_t discount, const Nature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
     check_model(mdp);
 
     return algorithms::rppi(algorithms::SARobustOutcomeBellman(mdp, nature, policy),
                             discount, move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::pi, progress);
+                            discount * discount, algorithms::MDPSolver::pi, progress,
+                            solver);
 }
 
 /**
@@ -845,16 +920,19 @@ inline SARobustSolution rsolve_ppi(
  * Uses modified policy iteration to solve the inner MDP problem that corresponds
  * to the nature.
  */
+template <class Nature = algorithms::SANature>
 inline SARobustSolution rsolve_mppi(
-    const MDPO& mdp, prec_t discount, const algorithms::SANature& nature,
+    const MDPO& mdp, prec_t discount, const Nature& nature,
     numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
 
     return algorithms::rppi(algorithms::SARobustOutcomeBellman(mdp, nature, policy),
                             discount, move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::mpi, progress);
+                            discount * discount, algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
 }
 
 // **************************************************************************
@@ -869,11 +947,12 @@ inline SRobustOutcomeSolution rsolve_s_vi(
     const MDPO& mdp, prec_t discount, const algorithms::SNatureOutcome& nature,
     numvec valuefunction = numvec(0), const numvecvec& policy = numvecvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
     check_model(mdp);
-    return algorithms::vi_gs(algorithms::SRobustOutcomeBellman(mdp, nature, policy),
-                             discount, move(valuefunction), iterations, maxresidual,
-                             progress);
+    return algorithms::vi(mdp, algorithms::SRobustOutcomeBellman(mdp, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
 }
 
 /**
@@ -912,11 +991,12 @@ inline SRobustOutcomeSolution rsolve_s_mpi(
     const numvec& valuefunction = numvec(0), const numvecvec& policy = numvecvec(0),
     unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
     unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
     check_model(mdp);
     return algorithms::mpi_jac(algorithms::SRobustOutcomeBellman(mdp, nature, policy),
                                discount, valuefunction, iterations_pi, maxresidual_pi,
-                               iterations_vi, maxresidual_vi, progress);
+                               iterations_vi, maxresidual_vi, progress, anderson);
 }
 
 /**
@@ -955,13 +1035,333 @@ inline SRobustOutcomeSolution rsolve_s_mppi(
     const MDPO& mdp, prec_t discount, const algorithms::SNatureOutcome& nature,
     numvec valuefunction = numvec(0), const numvecvec& policy = numvecvec(0),
     unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
-    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
 
     check_model(mdp);
 
     return algorithms::rppi(algorithms::SRobustOutcomeBellman(mdp, nature, policy),
                             discount, move(valuefunction), iterations, maxresidual, 1.0,
-                            discount * discount, algorithms::MDPSolver::mpi, progress);
+                            discount * discount, algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
+}
+
+// **************************************************************************
+// Compiled MDP methods
+// **************************************************************************
+
+/**
+ * @ingroup ValueIteration
+ * Value iteration on the compiled (flat) form of the MDP. The model is
+ * checked when it is compiled.
+ */
+template <class Real, class Index>
+inline DetermSolution
+solve_vi(const BasicCompiledMDP<Real, Index>& mdp, prec_t discount,
+         numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+         unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+         const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+         algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
+    return algorithms::vi(mdp, algorithms::PlainBellmanCompiled(mdp, policy), discount,
+                          move(valuefunction), iterations, maxresidual, progress,
+                          vi_solver, anderson);
+}
+
+/**
+ * @ingroup ModifiedPolicyIteration
+ * Modified policy iteration on the compiled (flat) form of the MDP.
+ */
+template <class Real, class Index>
+inline DetermSolution
+solve_mpi(const BasicCompiledMDP<Real, Index>& mdp, prec_t discount,
+          const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
+          unsigned long iterations_pi = MAXITER,
+          prec_t maxresidual_pi = SOLPREC, unsigned long iterations_vi = MAXITER,
+          prec_t maxresidual_vi = 0.9,
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          size_t anderson = 0) {
+    return algorithms::mpi_jac(algorithms::PlainBellmanCompiled(mdp, policy), discount,
+                               valuefunction, iterations_pi, maxresidual_pi,
+                               iterations_vi, maxresidual_vi, progress, anderson);
+}
+
+/**
+ * @ingroup PolicyIteration
+ * Policy iteration on the compiled (flat) form of the MDP.
+ */
+template <class Real, class Index>
+inline DetermSolution
+solve_pi(const BasicCompiledMDP<Real, Index>& mdp, prec_t discount,
+         numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+         unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+         const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+         algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
+    return algorithms::pi(algorithms::PlainBellmanCompiled(mdp, policy), discount,
+                          move(valuefunction), iterations, maxresidual, progress, solver);
+}
+
+/**
+ * @ingroup ValueIteration
+ * Robust value iteration with an s,a-rectangular nature on the compiled MDP.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution
+rsolve_vi(const BasicCompiledMDP<Real, Index>& mdp, prec_t discount, const Nature& nature,
+          numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+          unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          algorithms::VISolver vi_solver = algorithms::VISolver::gs,
+          size_t anderson = 0) {
+    return algorithms::vi(mdp, algorithms::SARobustBellmanCompiled(mdp, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
+}
+
+/**
+ * @ingroup ModifiedPolicyIteration
+ * Robust modified policy iteration with an s,a-rectangular nature on the
+ * compiled MDP.
+ *
+ * WARNING: There is no proof of convergence for this method. See rsolve_mpi
+ * for the MDP.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution rsolve_mpi(
+    const BasicCompiledMDP<Real, Index>& mdp, prec_t discount, const Nature& nature,
+    const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
+    unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
+    return algorithms::mpi_jac(algorithms::SARobustBellmanCompiled(mdp, nature, policy),
+                               discount, valuefunction, iterations_pi, maxresidual_pi,
+                               iterations_vi, maxresidual_vi, progress, anderson);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an sa-rectangular nature on the
+ * compiled MDP.
+ *
+ * This method is guaranteed to converge to the optimal value function
+ * and policy.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution rsolve_ppi(
+    const BasicCompiledMDP<Real, Index>& mdp, prec_t discount, const Nature& nature,
+    numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
+    return algorithms::rppi(algorithms::SARobustBellmanCompiled(mdp, nature, policy),
+                            discount, move(valuefunction), iterations, maxresidual, 1.0,
+                            discount * discount, algorithms::MDPSolver::pi, progress,
+                            solver);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an sa-rectangular nature on the
+ * compiled MDP. Uses modified policy iteration to solve the inner MDP.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution rsolve_mppi(
+    const BasicCompiledMDP<Real, Index>& mdp, prec_t discount, const Nature& nature,
+    numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
+    return algorithms::rppi(algorithms::SARobustBellmanCompiled(mdp, nature, policy),
+                            discount, move(valuefunction), iterations, maxresidual, 1.0,
+                            discount * discount, algorithms::MDPSolver::mpi, progress,
+                            algorithms::LinearSolver::sparse_lu, anderson);
+}
+
+/**
+ * @ingroup ValueIteration
+ * Robust value iteration with an s,a-rectangular nature over the outcomes of
+ * the compiled MDPO.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution
+rsolve_vi(const BasicCompiledMDPO<Real, Index>& mdpo, prec_t discount,
+          const Nature& nature, numvec valuefunction = numvec(0),
+          const indvec& policy = indvec(0),
+          unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          algorithms::VISolver vi_solver = algorithms::VISolver::gs,
+          size_t anderson = 0) {
+    return algorithms::vi(
+        mdpo, algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        move(valuefunction), iterations, maxresidual, progress, vi_solver, anderson);
+}
+
+/**
+ * @ingroup ModifiedPolicyIteration
+ * Robust modified policy iteration with an s,a-rectangular nature over the
+ * outcomes of the compiled MDPO.
+ *
+ * WARNING: There is no proof of convergence for this method. See rsolve_mpi
+ * for the MDP.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution rsolve_mpi(
+    const BasicCompiledMDPO<Real, Index>& mdpo, prec_t discount, const Nature& nature,
+    const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
+    unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
+    return algorithms::mpi_jac(
+        algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        valuefunction, iterations_pi, maxresidual_pi, iterations_vi, maxresidual_vi,
+        progress, anderson);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an s,a-rectangular nature over the
+ * outcomes of the compiled MDPO.
+ */
+template <class Nature = algorithms::SANature, class Real, class Index>
+inline SARobustSolution rsolve_ppi(
+    const BasicCompiledMDPO<Real, Index>& mdpo, prec_t discount, const Nature& nature,
+    numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
+    return algorithms::rppi(
+        algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        move(valuefunction), iterations, maxresidual, 1.0, discount * discount,
+        algorithms::MDPSolver::pi, progress, solver);
+}
+
+/**
+ * @ingroup ValueIteration
+ * Robust value iteration with an s,a-rectangular nature over the outcomes of
+ * the MDPO with shared outcome supports.
+ */
+template <class Nature = algorithms::SANature>
+inline SARobustSolution
+rsolve_vi(const SharedSupportMDPO& mdpo, prec_t discount, const Nature& nature,
+          numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+          unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+          const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+          algorithms::VISolver vi_solver = algorithms::VISolver::gs,
+          size_t anderson = 0) {
+    return algorithms::vi(
+        mdpo, algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        move(valuefunction), iterations, maxresidual, progress, vi_solver, anderson);
+}
+
+/**
+ * @ingroup ModifiedPolicyIteration
+ * Robust modified policy iteration with an s,a-rectangular nature over the
+ * outcomes of the MDPO with shared outcome supports.
+ *
+ * WARNING: There is no proof of convergence for this method. See rsolve_mpi
+ * for the MDP.
+ */
+template <class Nature = algorithms::SANature>
+inline SARobustSolution rsolve_mpi(
+    const SharedSupportMDPO& mdpo, prec_t discount, const Nature& nature,
+    const numvec& valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations_pi = MAXITER, prec_t maxresidual_pi = SOLPREC,
+    unsigned long iterations_vi = MAXITER, prec_t maxresidual_vi = 0.9,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    size_t anderson = 0) {
+    return algorithms::mpi_jac(
+        algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        valuefunction, iterations_pi, maxresidual_pi, iterations_vi, maxresidual_vi,
+        progress, anderson);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an s,a-rectangular nature over the
+ * outcomes of the MDPO with shared outcome supports.
+ */
+template <class Nature = algorithms::SANature>
+inline SARobustSolution rsolve_ppi(
+    const SharedSupportMDPO& mdpo, prec_t discount, const Nature& nature,
+    numvec valuefunction = numvec(0), const indvec& policy = indvec(0),
+    unsigned long iterations = MAXITER, prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::LinearSolver solver = algorithms::LinearSolver::sparse_lu) {
+    return algorithms::rppi(
+        algorithms::SARobustOutcomeBellmanCompiled(mdpo, nature, policy), discount,
+        move(valuefunction), iterations, maxresidual, 1.0, discount * discount,
+        algorithms::MDPSolver::pi, progress, solver);
+}
+
+/**
+ * @ingroup ValueIteration
+ * Robust value iteration with an s-rectangular nature over the outcomes of the
+ * compiled MDPO.
+ */
+template <class Real, class Index>
+inline SRobustOutcomeSolution rsolve_s_vi(
+    const BasicCompiledMDPO<Real, Index>& mdpo, prec_t discount,
+    const algorithms::SNatureOutcome& nature, numvec valuefunction = numvec(0),
+    const numvecvec& policy = numvecvec(0), unsigned long iterations = MAXITER,
+    prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
+    return algorithms::vi(mdpo,
+                          algorithms::SRobustOutcomeBellmanCompiled(mdpo, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an s-rectangular nature over the
+ * outcomes of the compiled MDPO.
+ */
+template <class Real, class Index>
+inline SRobustOutcomeSolution rsolve_s_ppi(
+    const BasicCompiledMDPO<Real, Index>& mdpo, prec_t discount,
+    const algorithms::SNatureOutcome& nature, numvec valuefunction = numvec(0),
+    const numvecvec& policy = numvecvec(0), unsigned long iterations = MAXITER,
+    prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    return algorithms::rppi(algorithms::SRobustOutcomeBellmanCompiled(mdpo, nature, policy),
+                            discount, move(valuefunction), iterations, maxresidual, 1.0,
+                            discount * discount, algorithms::MDPSolver::pi, progress);
+}
+
+/**
+ * @ingroup ValueIteration
+ * Robust value iteration with an s-rectangular nature over the outcomes of the
+ * MDPO with shared outcome supports.
+ */
+inline SRobustOutcomeSolution rsolve_s_vi(
+    const SharedSupportMDPO& mdpo, prec_t discount,
+    const algorithms::SNatureOutcome& nature, numvec valuefunction = numvec(0),
+    const numvecvec& policy = numvecvec(0), unsigned long iterations = MAXITER,
+    prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress,
+    algorithms::VISolver vi_solver = algorithms::VISolver::gs, size_t anderson = 0) {
+    return algorithms::vi(mdpo,
+                          algorithms::SRobustOutcomeBellmanCompiled(mdpo, nature, policy),
+                          discount, move(valuefunction), iterations, maxresidual,
+                          progress, vi_solver, anderson);
+}
+
+/**
+ * @ingroup PartialPolicyIteration
+ * Robust partial policy iteration with an s-rectangular nature over the
+ * outcomes of the MDPO with shared outcome supports.
+ */
+inline SRobustOutcomeSolution rsolve_s_ppi(
+    const SharedSupportMDPO& mdpo, prec_t discount,
+    const algorithms::SNatureOutcome& nature, numvec valuefunction = numvec(0),
+    const numvecvec& policy = numvecvec(0), unsigned long iterations = MAXITER,
+    prec_t maxresidual = SOLPREC,
+    const algorithms::progress_t& progress = algorithms::internal::empty_progress) {
+    return algorithms::rppi(algorithms::SRobustOutcomeBellmanCompiled(mdpo, nature, policy),
+                            discount, move(valuefunction), iterations, maxresidual, 1.0,
+                            discount * discount, algorithms::MDPSolver::pi, progress);
 }
 
 // **************************************************************************
@@ -95,13 +95,24 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// mdp_compile
+SEXP mdp_compile(Rcpp::DataFrame model);
+RcppExport SEXP _rcraam_mdp_compile(SEXP modelSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type model(modelSEXP);
+    rcpp_result_gen = Rcpp::wrap(mdp_compile(model));
+    return rcpp_result_gen;
+END_RCPP
+}
 // solve_mdp
-Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, int show_progress);
+Rcpp::List solve_mdp(SEXP mdp, double discount, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, int show_progress);
 RcppExport SEXP _rcraam_solve_mdp(SEXP mdpSEXP, SEXP discountSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP show_progressSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdp(mdpSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdp(mdpSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type algorithm(algorithmSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::DataFrame> >::type policy_fixed(policy_fixedSEXP);
@@ -116,12 +127,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // solve_mdp_rand
-Rcpp::List solve_mdp_rand(Rcpp::DataFrame mdp, double discount, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, int show_progress);
+Rcpp::List solve_mdp_rand(SEXP mdp, double discount, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, int show_progress);
 RcppExport SEXP _rcraam_solve_mdp_rand(SEXP mdpSEXP, SEXP discountSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP show_progressSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdp(mdpSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdp(mdpSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type algorithm(algorithmSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::DataFrame> >::type policy_fixed(policy_fixedSEXP);
@@ -135,12 +146,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // compute_qvalues
-Rcpp::DataFrame compute_qvalues(Rcpp::DataFrame mdp, double discount, Rcpp::DataFrame valuefunction);
+Rcpp::DataFrame compute_qvalues(SEXP mdp, double discount, Rcpp::DataFrame valuefunction);
 RcppExport SEXP _rcraam_compute_qvalues(SEXP mdpSEXP, SEXP discountSEXP, SEXP valuefunctionSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdp(mdpSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdp(mdpSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::DataFrame >::type valuefunction(valuefunctionSEXP);
     rcpp_result_gen = Rcpp::wrap(compute_qvalues(mdp, discount, valuefunction));
@@ -148,12 +159,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // rsolve_mdp_sa
-Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress);
-RcppExport SEXP _rcraam_rsolve_mdp_sa(SEXP mdpSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP) {
+Rcpp::List rsolve_mdp_sa(SEXP mdp, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress, size_t anderson);
+RcppExport SEXP _rcraam_rsolve_mdp_sa(SEXP mdpSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP, SEXP andersonSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdp(mdpSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdp(mdpSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type nature(natureSEXP);
     Rcpp::traits::input_parameter< SEXP >::type nature_par(nature_parSEXP);
@@ -166,17 +177,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type pack_actions(pack_actionsSEXP);
     Rcpp::traits::input_parameter< bool >::type output_tran(output_tranSEXP);
     Rcpp::traits::input_parameter< int >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(rsolve_mdp_sa(mdp, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress));
+    Rcpp::traits::input_parameter< size_t >::type anderson(andersonSEXP);
+    rcpp_result_gen = Rcpp::wrap(rsolve_mdp_sa(mdp, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress, anderson));
     return rcpp_result_gen;
 END_RCPP
 }
 // rsolve_mdpo_sa
-Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress);
-RcppExport SEXP _rcraam_rsolve_mdpo_sa(SEXP mdpoSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP) {
+Rcpp::List rsolve_mdpo_sa(SEXP mdpo, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress, size_t anderson);
+RcppExport SEXP _rcraam_rsolve_mdpo_sa(SEXP mdpoSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP, SEXP andersonSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdpo(mdpoSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdpo(mdpoSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type nature(natureSEXP);
     Rcpp::traits::input_parameter< SEXP >::type nature_par(nature_parSEXP);
@@ -189,17 +201,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type pack_actions(pack_actionsSEXP);
     Rcpp::traits::input_parameter< bool >::type output_tran(output_tranSEXP);
     Rcpp::traits::input_parameter< int >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(rsolve_mdpo_sa(mdpo, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress));
+    Rcpp::traits::input_parameter< size_t >::type anderson(andersonSEXP);
+    rcpp_result_gen = Rcpp::wrap(rsolve_mdpo_sa(mdpo, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress, anderson));
     return rcpp_result_gen;
 END_RCPP
 }
 // srsolve_mdpo
-Rcpp::List srsolve_mdpo(Rcpp::DataFrame mdpo, Rcpp::DataFrame init_distribution, double discount, double alpha, double beta, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> model_distribution, Rcpp::String output_filename);
+Rcpp::List srsolve_mdpo(SEXP mdpo, Rcpp::DataFrame init_distribution, double discount, double alpha, double beta, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> model_distribution, Rcpp::String output_filename);
 RcppExport SEXP _rcraam_srsolve_mdpo(SEXP mdpoSEXP, SEXP init_distributionSEXP, SEXP discountSEXP, SEXP alphaSEXP, SEXP betaSEXP, SEXP algorithmSEXP, SEXP model_distributionSEXP, SEXP output_filenameSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdpo(mdpoSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdpo(mdpoSEXP);
     Rcpp::traits::input_parameter< Rcpp::DataFrame >::type init_distribution(init_distributionSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< double >::type alpha(alphaSEXP);
@@ -212,12 +225,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // rsolve_mdp_s
-Rcpp::List rsolve_mdp_s(Rcpp::DataFrame mdp, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress);
-RcppExport SEXP _rcraam_rsolve_mdp_s(SEXP mdpSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP) {
+Rcpp::List rsolve_mdp_s(SEXP mdp, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress, size_t anderson);
+RcppExport SEXP _rcraam_rsolve_mdp_s(SEXP mdpSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP, SEXP andersonSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdp(mdpSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdp(mdpSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type nature(natureSEXP);
     Rcpp::traits::input_parameter< SEXP >::type nature_par(nature_parSEXP);
@@ -230,17 +243,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type pack_actions(pack_actionsSEXP);
     Rcpp::traits::input_parameter< bool >::type output_tran(output_tranSEXP);
     Rcpp::traits::input_parameter< int >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(rsolve_mdp_s(mdp, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress));
+    Rcpp::traits::input_parameter< size_t >::type anderson(andersonSEXP);
+    rcpp_result_gen = Rcpp::wrap(rsolve_mdp_s(mdp, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress, anderson));
     return rcpp_result_gen;
 END_RCPP
 }
 // rsolve_mdpo_s
-Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress);
-RcppExport SEXP _rcraam_rsolve_mdpo_s(SEXP mdpoSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP) {
+Rcpp::List rsolve_mdpo_s(SEXP mdpo, double discount, Rcpp::String nature, SEXP nature_par, Rcpp::String algorithm, Rcpp::Nullable<Rcpp::DataFrame> policy_fixed, double maxresidual, size_t iterations, double timeout, Rcpp::Nullable<Rcpp::DataFrame> value_init, bool pack_actions, bool output_tran, int show_progress, size_t anderson);
+RcppExport SEXP _rcraam_rsolve_mdpo_s(SEXP mdpoSEXP, SEXP discountSEXP, SEXP natureSEXP, SEXP nature_parSEXP, SEXP algorithmSEXP, SEXP policy_fixedSEXP, SEXP maxresidualSEXP, SEXP iterationsSEXP, SEXP timeoutSEXP, SEXP value_initSEXP, SEXP pack_actionsSEXP, SEXP output_tranSEXP, SEXP show_progressSEXP, SEXP andersonSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdpo(mdpoSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdpo(mdpoSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type nature(natureSEXP);
     Rcpp::traits::input_parameter< SEXP >::type nature_par(nature_parSEXP);
@@ -253,17 +267,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type pack_actions(pack_actionsSEXP);
     Rcpp::traits::input_parameter< bool >::type output_tran(output_tranSEXP);
     Rcpp::traits::input_parameter< int >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(rsolve_mdpo_s(mdpo, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress));
+    Rcpp::traits::input_parameter< size_t >::type anderson(andersonSEXP);
+    rcpp_result_gen = Rcpp::wrap(rsolve_mdpo_s(mdpo, discount, nature, nature_par, algorithm, policy_fixed, maxresidual, iterations, timeout, value_init, pack_actions, output_tran, show_progress, anderson));
     return rcpp_result_gen;
 END_RCPP
 }
 // revaluate_mdpo_rnd
-Rcpp::DataFrame revaluate_mdpo_rnd(Rcpp::DataFrame mdpo, double discount, Rcpp::Nullable<Rcpp::DataFrame> policy_rnd, Rcpp::Nullable<Rcpp::DataFrame> initial, bool show_progress);
+Rcpp::DataFrame revaluate_mdpo_rnd(SEXP mdpo, double discount, Rcpp::Nullable<Rcpp::DataFrame> policy_rnd, Rcpp::Nullable<Rcpp::DataFrame> initial, bool show_progress);
 RcppExport SEXP _rcraam_revaluate_mdpo_rnd(SEXP mdpoSEXP, SEXP discountSEXP, SEXP policy_rndSEXP, SEXP initialSEXP, SEXP show_progressSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type mdpo(mdpoSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mdpo(mdpoSEXP);
     Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::DataFrame> >::type policy_rnd(policy_rndSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::DataFrame> >::type initial(initialSEXP);
@@ -404,14 +419,15 @@ static const R_CallMethodDef CallEntries[] = {
     {"_rcraam_avar", (DL_FUNC) &_rcraam_avar, 3},
     {"_rcraam_pack_actions", (DL_FUNC) &_rcraam_pack_actions, 1},
     {"_rcraam_mdp_clean", (DL_FUNC) &_rcraam_mdp_clean, 1},
+    {"_rcraam_mdp_compile", (DL_FUNC) &_rcraam_mdp_compile, 1},
     {"_rcraam_solve_mdp", (DL_FUNC) &_rcraam_solve_mdp, 10},
     {"_rcraam_solve_mdp_rand", (DL_FUNC) &_rcraam_solve_mdp_rand, 9},
     {"_rcraam_compute_qvalues", (DL_FUNC) &_rcraam_compute_qvalues, 3},
-    {"_rcraam_rsolve_mdp_sa", (DL_FUNC) &_rcraam_rsolve_mdp_sa, 13},
-    {"_rcraam_rsolve_mdpo_sa", (DL_FUNC) &_rcraam_rsolve_mdpo_sa, 13},
+    {"_rcraam_rsolve_mdp_sa", (DL_FUNC) &_rcraam_rsolve_mdp_sa, 14},
+    {"_rcraam_rsolve_mdpo_sa", (DL_FUNC) &_rcraam_rsolve_mdpo_sa, 14},
     {"_rcraam_srsolve_mdpo", (DL_FUNC) &_rcraam_srsolve_mdpo, 8},
-    {"_rcraam_rsolve_mdp_s", (DL_FUNC) &_rcraam_rsolve_mdp_s, 13},
-    {"_rcraam_rsolve_mdpo_s", (DL_FUNC) &_rcraam_rsolve_mdpo_s, 13},
+    {"_rcraam_rsolve_mdp_s", (DL_FUNC) &_rcraam_rsolve_mdp_s, 14},
+    {"_rcraam_rsolve_mdpo_s", (DL_FUNC) &_rcraam_rsolve_mdpo_s, 14},
     {"_rcraam_revaluate_mdpo_rnd", (DL_FUNC) &_rcraam_revaluate_mdpo_rnd, 5},
     {"_rcraam_rcraam_set_threads", (DL_FUNC) &_rcraam_rcraam_set_threads, 1},
     {"_rcraam_gurobi_set_param", (DL_FUNC) &_rcraam_gurobi_set_param, 3},
@@ -444,6 +444,47 @@ Rcpp::DataFrame mdp_clean(Rcpp::DataFrame mdp) {
     return mdp_to_dataframe(mdp_from_dataframe(mdp));
 }
 
+//' Parses a model once to be solved repeatedly
+//'
+//' Parses the data frame of an MDP or an MDPO to a native model that can be passed
+//' in place of the data frame to solve_mdp, solve_mdp_rand, compute_qvalues,
+//' rsolve_mdp_sa, rsolve_mdp_s, rsolve_mdpo_sa, rsolve_mdpo_s, srsolve_mdpo, and
+//' revaluate_mdpo_rnd. Parsing a large data frame often takes longer than solving the
+//' model; the compiled model is parsed only once. The model with packed actions and
+//' the MDPs of individual outcomes are also computed only once, when first needed.
+//'
+//' Each function gets the same model from the compiled model as from the data frame:
+//' the robust solvers keep the transitions with zero probabilities and the other
+//' functions drop them. The model cannot be modified and it is not preserved when
+//' saved and loaded in another R session.
+//'
+//' @param model Dataframe representation of the MDP, with columns
+//'            idstatefrom, idaction, idstateto, probability, reward. The model is
+//'            an MDPO when it also has the column idoutcome.
+//'
+//' @return External pointer to the model with the class rcraam_model
+// [[Rcpp::export]]
+SEXP mdp_compile(Rcpp::DataFrame model) {
+    // the model without zero probabilities is the same unless there are any
+    const craam::numvec probability = Rcpp::as<craam::numvec>(model["probability"]);
+    const bool zeros = std::any_of(probability.cbegin(), probability.cend(),
+                                   [](double p) { return p <= 0; });
+
+    ModelHandle* handle;
+    if (model.containsElementNamed("idoutcome")) {
+        handle = zeros ? new ModelHandle(mdpo_from_dataframe(model, true),
+                                         mdpo_from_dataframe(model, false))
+                       : new ModelHandle(mdpo_from_dataframe(model, true));
+    } else {
+        handle = zeros ? new ModelHandle(mdp_from_dataframe(model, true),
+                                         mdp_from_dataframe(model, false))
+                       : new ModelHandle(mdp_from_dataframe(model, true));
+    }
+    Rcpp::XPtr<ModelHandle> result(handle, true);
+    result.attr("class") = model_handle_class;
+    return result;
+}
+
 //' Solves a plain Markov decision process.
 //'
 //' This method supports only deterministic policies. See solve_mdp_rand for a
@@ -457,6 +498,7 @@ Rcpp::DataFrame mdp_clean(Rcpp::DataFrame mdp) {
 //'            represents a single transition from one state to another
 //'            after taking an action a. The columns are:
 //'            idstatefrom, idaction, idstateto, probability, reward
+//'            It can also be a model compiled by mdp_compile.
 //' @param discount Discount factor in [0,1]
 //' @param algorithm One of "mpi", "vi", "vi_j", "vi_g", "pi". Also supports "lp"
 //'           when Gurobi is properly installed
@@ -478,7 +520,7 @@ Rcpp::DataFrame mdp_clean(Rcpp::DataFrame mdp) {
 //'         0 means no progress, 1 is progress bar, and 2 is a detailed report
 //' @return A list with value function policy and other values
 // [[Rcpp::export]]
-Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorithm = "mpi",
+Rcpp::List solve_mdp(SEXP mdp, double discount, Rcpp::String algorithm = "mpi",
                      Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                      double maxresidual = 10e-4, size_t iterations = 10000,
                      double timeout = 300,
@@ -490,19 +532,15 @@ Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorith
                       "become invalid.");
     }
 
-    // parse MDP from the dataframe
-    MDP m = mdp_from_dataframe(mdp);
+    // parse MDP from the dataframe (or use the compiled one) and remove actions
+    // that are not being used; do not report the map to prevent confusion
+    std::vector<craam::indvec> actionmap;
+    const auto mdp_parsed = get_mdp(mdp, false, pack_actions, &actionmap);
+    const MDP& m = *mdp_parsed;
     if (m.size() == 0) return Rcpp::List();
 
     // Construct the output (to get the output from pack actions)
     Rcpp::List result;
-    std::optional<std::vector<craam::indvec>> actionmap;
-    // remove actions that are not being used
-    if (pack_actions) {
-        actionmap = m.pack_actions();
-        // do not report the value to prevent confusion
-        //result["action_map"] = actionmap2df(m.pack_actions());
-    }
 
     // Solution to be constructed and returned
     DetermSolution sol;
@@ -550,13 +588,13 @@ Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorith
     }
 
     // check if we need to remap the actions if they were packed
-    if (actionmap.has_value()) {
+    if (pack_actions) {
         craam::indvec mapped_policy(sol.policy.size(), -1);
         // policy has the id of the action for each state
         for (std::size_t istate = 0; istate < sol.policy.size(); ++istate) {
             // make sure to handle policy values -1 for terminal states!
             if (sol.policy[istate] >= 0) // not terminal
-                mapped_policy[istate] = (actionmap->at(istate)).at(sol.policy[istate]);
+                mapped_policy[istate] = actionmap.at(istate).at(sol.policy[istate]);
             else
                 mapped_policy[istate] = -1; // terminal
         }
@@ -583,6 +621,7 @@ Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorith
 //'            represents a single transition from one state to another
 //'            after taking an action a. The columns are:
 //'            idstatefrom, idaction, idstateto, probability, reward
+//'            It can also be a model compiled by mdp_compile.
 //' @param discount Discount factor in [0,1]
 //' @param algorithm One of "mpi", "vi", "vi_j", "vi_g", "pi"
 //' @param policy_fixed States for which the  policy should be fixed. This
@@ -600,7 +639,7 @@ Rcpp::List solve_mdp(Rcpp::DataFrame mdp, double discount, Rcpp::String algorith
 //'
 //' @return A list with value function policy and other values
 // [[Rcpp::export]]
-Rcpp::List solve_mdp_rand(Rcpp::DataFrame mdp, double discount,
+Rcpp::List solve_mdp_rand(SEXP mdp, double discount,
                           Rcpp::String algorithm = "mpi",
                           Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                           double maxresidual = 10e-4, size_t iterations = 10000,
@@ -613,7 +652,8 @@ Rcpp::List solve_mdp_rand(Rcpp::DataFrame mdp, double discount,
     // Construct the output (to get the output from pack actions)
     Rcpp::List result;
 
-    MDP m = mdp_from_dataframe(mdp);
+    const auto mdp_parsed = get_mdp(mdp);
+    const MDP& m = *mdp_parsed;
     if (m.size() == 0) return Rcpp::List();
 
     // use one of the solutions, stochastic or deterministic
@@ -671,15 +711,17 @@ Rcpp::List solve_mdp_rand(Rcpp::DataFrame mdp, double discount,
 //'            represents a single transition from one state to another
 //'            after taking an action a. The columns are:
 //'            idstatefrom, idaction, idstateto, probability, reward
+//'            It can also be a model compiled by mdp_compile.
 //' @param discount Discount factor in [0,1]
 //' @param valuefunction A dataframe representation of the value function. Each row
 //'             represents a state. The columns must be idstate, value
 //'
 //' @return Dataframe with idstate, idaction, qvalue columns
 // [[Rcpp::export]]
-Rcpp::DataFrame compute_qvalues(Rcpp::DataFrame mdp, double discount,
+Rcpp::DataFrame compute_qvalues(SEXP mdp, double discount,
                                 Rcpp::DataFrame valuefunction) {
-    MDP m = mdp_from_dataframe(mdp);
+    const auto mdp_parsed = get_mdp(mdp);
+    const MDP& m = *mdp_parsed;
     Rcpp::IntegerVector states = valuefunction["idstate"];
     auto minmax_els = std::minmax_element(states.cbegin(), states.cend());
 
@@ -780,6 +822,7 @@ algorithms::SANature parse_nature_sa(const MDPO& mdpo, const string& nature,
 //'            represents a single transition from one state to another
 //'            after taking an action a. The columns are:
 //'            idstatefrom, idaction, idstateto, probability, reward
+//'            It can also be a model compiled by mdp_compile.
 //' @param discount Discount factor in [0,1]
 //' @param nature Algorithm used to select the robust outcome. See details for options.
 //' @param nature_par Parameters for the nature. Varies depending on the nature.
@@ -804,6 +847,9 @@ algorithms::SANature parse_nature_sa(const MDPO& mdpo, const string& nature,
 //'          probabilites and a vector of rewards
 //' @param show_progress Whether to show a progress bar during the computation.
 //'         0 means no progress, 1 is progress bar, and 2 is a detailed report
+//' @param anderson Number of previous iterates combined by Anderson acceleration
+//'         in the value iteration steps of vi_g, vi_j, mpi, mppi, and vppi.
+//'         0 disables the acceleration.
 //'
 //' @return A list with value function policy and other values
 //'
@@ -839,22 +885,24 @@ algorithms::SANature parse_nature_sa(const MDPO& mdpo, const string& nature,
 //'                 worst-case.
 //'    }
 // [[Rcpp::export]]
-Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String nature,
+Rcpp::List rsolve_mdp_sa(SEXP mdp, double discount, Rcpp::String nature,
                          SEXP nature_par, Rcpp::String algorithm = "mppi",
                          Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                          double maxresidual = 10e-4, size_t iterations = 10000,
                          double timeout = 300,
                          Rcpp::Nullable<Rcpp::DataFrame> value_init = R_NilValue,
                          bool pack_actions = false, bool output_tran = false,
-                         int show_progress = 1) {
+                         int show_progress = 1, size_t anderson = 0) {
     Rcpp::List result;
 
     // make robust transitions to states with 0 probability possible
-    MDP m = mdp_from_dataframe(mdp, true);
+    // and remove actions that are not being used
+    std::vector<craam::indvec> actionmap;
+    const auto mdp_parsed = get_mdp(mdp, true, pack_actions, &actionmap);
+    const MDP& m = *mdp_parsed;
     if (m.size() == 0) return Rcpp::List();
 
-    // remove actions that are not being used
-    if (pack_actions) { result["action_map"] = m.pack_actions(); }
+    if (pack_actions) { result["action_map"] = actionmap; }
 
     // policy: the method can be used to compute the robust solution for a policy
     indvec policy = policy_fixed.isNotNull()
@@ -873,28 +921,34 @@ Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String natu
 
     ComputeProgress progress(iterations, maxresidual, show_progress, timeout);
 
+#ifdef CRAAM_TRACE
+    // record the iterations of the solver when compiled with -DCRAAM_TRACE
+    algorithms::SolverTrace trace;
+    algorithms::TraceScope trace_scope(trace);
+#endif
+
     // the default method is to use ppa
     if (algorithm == "ppi") {
         sol = rsolve_ppi(m, discount, std::move(natparsed), vf_init, policy, iterations,
                          maxresidual, progress);
     } else if (algorithm == "mppi") {
         sol = rsolve_mppi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                          maxresidual, progress);
+                          maxresidual, progress, anderson);
     } else if (algorithm == "vppi") {
         sol = rsolve_vppi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                          maxresidual, progress);
+                          maxresidual, progress, anderson);
     } else if (algorithm == "mpi") {
         Rcpp::warning("The robust version of the mpi method may cycle forever "
                       "without converging.");
         sol = rsolve_mpi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                         maxresidual, defaults::mpi_vi_count, 0.5, progress);
+                         maxresidual, defaults::mpi_vi_count, 0.5, progress, anderson);
     } else if (algorithm == "vi_g") {
         sol = rsolve_vi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                        maxresidual, progress);
+                        maxresidual, progress, algorithms::VISolver::gs, anderson);
     } else if (algorithm == "vi_j" || algorithm == "vi") {
         // Jacobian value iteration, simulated using mpi
         sol = rsolve_mpi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                         maxresidual, 0, 0.5, progress);
+                         maxresidual, 0, 0.5, progress, anderson);
     } else if (algorithm == "pi") {
         Rcpp::warning("The robust version of the pi method may cycle forever without "
                       "converging.");
@@ -928,6 +982,9 @@ Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String natu
     result["policy"] = output_policy(dec_pol);
     result["nature"] = sanature_todataframe(m, dec_pol, nat_pol);
     result["valuefunction"] = output_value_fun(move(sol.valuefunction));
+#ifdef CRAAM_TRACE
+    result["trace"] = trace.to_json();
+#endif
     result["status"] = sol.status;
     report_solution_status(sol);
     return result;
@@ -964,6 +1021,9 @@ Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String natu
 //'          probabilites and a vector of rewards
 //' @param show_progress Whether to show a progress bar during the computation.
 //'         0 means no progress, 1 is progress bar, and 2 is a detailed report
+//' @param anderson Number of previous iterates combined by Anderson acceleration
+//'         in the value iteration steps of vi_g, vi_j, mpi, and mppi.
+//'         0 disables the acceleration.
 //'
 //' @return A list with value function policy and other values
 //'
@@ -990,14 +1050,14 @@ Rcpp::List rsolve_mdp_sa(Rcpp::DataFrame mdp, double discount, Rcpp::String natu
 //'                 worst-case.
 //'    }
 // [[Rcpp::export]]
-Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String nature,
+Rcpp::List rsolve_mdpo_sa(SEXP mdpo, double discount, Rcpp::String nature,
                           SEXP nature_par, Rcpp::String algorithm = "mppi",
                           Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                           double maxresidual = 10e-4, size_t iterations = 10000,
                           double timeout = 300,
                           Rcpp::Nullable<Rcpp::DataFrame> value_init = R_NilValue,
                           bool pack_actions = false, bool output_tran = false,
-                          int show_progress = 1) {
+                          int show_progress = 1, size_t anderson = 0) {
     Rcpp::List result;
 
     // What would be the point of forcing to add transitions even if
@@ -1005,11 +1065,13 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
     // perhaps only if the RMDP is transformed to an MDP
     // that is why this is set to true for now .... it is also easy to remove the 0s from
     // the dataframe
-    MDPO m = mdpo_from_dataframe(mdpo, true);
+    std::vector<craam::indvec> actionmap;
+    const auto mdpo_parsed = get_mdpo(mdpo, true, pack_actions, &actionmap);
+    const MDPO& m = *mdpo_parsed;
     if (m.size() == 0) return Rcpp::List();
 
     // remove actions that are not being used
-    if (pack_actions) { result["action_map"] = m.pack_actions(); }
+    if (pack_actions) { result["action_map"] = actionmap; }
 
     // policy: the method can be used to compute the robust solution for a policy
     indvec policy = policy_fixed.isNotNull()
@@ -1028,9 +1090,15 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
 
     ComputeProgress progress(iterations, maxresidual, show_progress, timeout);
 
+#ifdef CRAAM_TRACE
+    // record the iterations of the solver when compiled with -DCRAAM_TRACE
+    algorithms::SolverTrace trace;
+    algorithms::TraceScope trace_scope(trace);
+#endif
+
     if (algorithm == "mppi") {
         sol = rsolve_mppi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                          maxresidual, progress);
+                          maxresidual, progress, anderson);
     } else if (algorithm == "ppi") {
         sol = rsolve_ppi(m, discount, std::move(natparsed), vf_init, policy, iterations,
                          maxresidual, progress);
@@ -1038,14 +1106,14 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
         Rcpp::warning("The robust version of the mpi method may cycle forever "
                       "without converging.");
         sol = rsolve_mpi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                         maxresidual, defaults::mpi_vi_count, 0.5, progress);
+                         maxresidual, defaults::mpi_vi_count, 0.5, progress, anderson);
     } else if (algorithm == "vi_g") {
         sol = rsolve_vi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                        maxresidual, progress);
+                        maxresidual, progress, algorithms::VISolver::gs, anderson);
     } else if (algorithm == "vi_j" || algorithm == "vi") {
         // Jacobian value iteration, simulated using mpi
         sol = rsolve_mpi(m, discount, std::move(natparsed), vf_init, policy, iterations,
-                         maxresidual, 0, 0.5, progress);
+                         maxresidual, 0, 0.5, progress, anderson);
     } else if (algorithm == "pi") {
         Rcpp::warning("The robust version of the pi method may cycle forever without "
                       "converging.");
@@ -1078,6 +1146,9 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
     result["policy"] = output_policy(dec_pol);
     result["nature"] = sanature_out_todataframe(m, dec_pol, nat_pol);
     result["valuefunction"] = output_value_fun(move(sol.valuefunction));
+#ifdef CRAAM_TRACE
+    result["trace"] = trace.to_json();
+#endif
     result["status"] = sol.status;
     report_solution_status(sol);
 
@@ -1094,7 +1165,8 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
 //'
 //' @param mdpo Uncertain MDP. The outcomes are assumed to represent the uncertainty over MDPs.
 //'              The number of outcomes must be uniform for all states and actions
-//'              (except for terminal states which have no actions).
+//'              (except for terminal states which have no actions). It can also be
+//'              a model compiled by mdp_compile.
 //' @param alpha Risk level of avar (0 = worst-case). The minimum value is 1e-5, the maximum
 //'              value is 1.
 //' @param beta Weight on AVaR and the complement (1-beta) is the weight
@@ -1111,7 +1183,7 @@ Rcpp::List rsolve_mdpo_sa(Rcpp::DataFrame mdpo, double discount, Rcpp::String na
 //' @return Returns a list with policy, objective (return), time (computation),
 //'               status (whether it is optimal, directly passed from gurobi)
 // [[Rcpp::export]]
-Rcpp::List srsolve_mdpo(Rcpp::DataFrame mdpo, Rcpp::DataFrame init_distribution,
+Rcpp::List srsolve_mdpo(SEXP mdpo, Rcpp::DataFrame init_distribution,
                         double discount, double alpha, double beta,
                         Rcpp::String algorithm = "milp",
                         Rcpp::Nullable<Rcpp::DataFrame> model_distribution = R_NilValue,
@@ -1124,7 +1196,8 @@ Rcpp::List srsolve_mdpo(Rcpp::DataFrame mdpo, Rcpp::DataFrame init_distribution,
     // perhaps only if the RMDP is transformed to an MDP
     // that is why this is set to true for now .... it is also easy to remove the 0s from
     // the dataframe
-    MDPO m = mdpo_from_dataframe(mdpo, true);
+    const auto mdpo_parsed = get_mdpo(mdpo, true);
+    const MDPO& m = *mdpo_parsed;
 
     const ProbDst init_dst = parse_s_values(m.size(), init_distribution, 0.0,
                                             "probability", "init_distribution");
@@ -1243,6 +1316,9 @@ algorithms::SNature parse_nature_s(const MDP& mdp, const string& nature,
 //'          probabilites and a vector of rewards
 //' @param show_progress Whether to show a progress bar during the computation.
 //'         0 means no progress, 1 is progress bar, and 2 is a detailed report
+//' @param anderson Number of previous iterates combined by Anderson acceleration
+//'         in the value iteration steps of vi_g, vi_j, mpi, mppi, and vppi.
+//'         0 disables the acceleration.
 //'
 //' @return A list with value function policy and other values
 //' @details
@@ -1261,21 +1337,23 @@ algorithms::SNature parse_nature_s(const MDP& mdp, const string& nature,
 //'                 idstatefrom, idaction, idstateto, weight (for the l1 weighted norms)
 //'    }
 // [[Rcpp::export]]
-Rcpp::List rsolve_mdp_s(Rcpp::DataFrame mdp, double discount, Rcpp::String nature,
+Rcpp::List rsolve_mdp_s(SEXP mdp, double discount, Rcpp::String nature,
                         SEXP nature_par, Rcpp::String algorithm = "mppi",
                         Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                         double maxresidual = 10e-4, size_t iterations = 10000,
                         double timeout = 300,
                         Rcpp::Nullable<Rcpp::DataFrame> value_init = R_NilValue,
                         bool pack_actions = false, bool output_tran = false,
-                        int show_progress = 1) {
+                        int show_progress = 1, size_t anderson = 0) {
     Rcpp::List result;
 
-    MDP m = mdp_from_dataframe(mdp, true);
+    std::vector<craam::indvec> actionmap;
+    const auto mdp_parsed = get_mdp(mdp, true, pack_actions, &actionmap);
+    const MDP& m = *mdp_parsed;
     if (m.size() == 0) return Rcpp::List();
 
     // remove actions that are not being used
-    if (pack_actions) { result["action_map"] = m.pack_actions(); }
+    if (pack_actions) { result["action_map"] = actionmap; }
 
     // policy: the method can be used to compute the robust solution for a policy
     // rpolicy stands for randomize policy and NOT robust policy
@@ -1295,26 +1373,33 @@ Rcpp::List rsolve_mdp_s(Rcpp::DataFrame mdp, double discount, Rcpp::String natur
 
     ComputeProgress progress(iterations, maxresidual, show_progress, timeout);
 
+#ifdef CRAAM_TRACE
+    // record the iterations of the solver when compiled with -DCRAAM_TRACE
+    algorithms::SolverTrace trace;
+    algorithms::TraceScope trace_scope(trace);
+#endif
+
     if (algorithm == "ppi") {
         sol = rsolve_s_ppi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
                              iterations, maxresidual, progress);
     } else if (algorithm == "mppi") {
         sol = rsolve_s_mppi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
-                              iterations, maxresidual, progress);
+                              iterations, maxresidual, progress, anderson);
     } else if (algorithm == "vppi") {
         sol = rsolve_s_vppi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
-                              iterations, maxresidual, progress);
+                              iterations, maxresidual, progress, anderson);
     } else if (algorithm == "mpi") {
         sol = rsolve_s_mpi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
                              iterations / defaults::mpi_vi_count, maxresidual,
-                             defaults::mpi_vi_count, 0.5, progress);
+                             defaults::mpi_vi_count, 0.5, progress, anderson);
     } else if (algorithm == "vi_g") {
         sol = rsolve_s_vi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
-                            iterations, maxresidual, progress);
+                            iterations, maxresidual, progress,
+                            algorithms::VISolver::gs, anderson);
     } else if (algorithm == "vi_j" || algorithm == "vi") {
         // Jacobian value iteration, simulated using mpi
         sol = rsolve_s_mpi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
-                             iterations, maxresidual, 0, 0.5, progress);
+                             iterations, maxresidual, 0, 0.5, progress, anderson);
     } else if (algorithm == "pi") {
         sol = rsolve_s_pi_r(m, discount, std::move(natparsed), vf_init, rpolicy,
                             iterations, maxresidual, progress);
@@ -1343,6 +1428,9 @@ Rcpp::List rsolve_mdp_s(Rcpp::DataFrame mdp, double discount, Rcpp::String natur
     result["policy_rand"] = output_policy(dec_pol);
     result["nature"] = sasnature_todataframe(m, nat_pol);
     result["valuefunction"] = output_value_fun(move(sol.valuefunction));
+#ifdef CRAAM_TRACE
+    result["trace"] = trace.to_json();
+#endif
     result["status"] = sol.status;
     report_solution_status(sol);
 
@@ -1396,6 +1484,9 @@ algorithms::SNatureOutcome parse_nature_s(const MDPO& mdpo, const string& nature
 //'          probabilites and a vector of rewards
 //' @param show_progress Whether to show a progress bar during the computation.
 //'         0 means no progress, 1 is progress bar, and 2 is a detailed report
+//' @param anderson Number of previous iterates combined by Anderson acceleration
+//'         in the value iteration steps of vi_g, vi_j, mpi, and mppi.
+//'         0 disables the acceleration.
 //'
 //' @return A list with value function policy and other values
 //'
@@ -1415,14 +1506,14 @@ algorithms::SNatureOutcome parse_nature_s(const MDPO& mdpo, const string& nature
 //'                 worst-case.
 //'    }
 // [[Rcpp::export]]
-Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nature,
+Rcpp::List rsolve_mdpo_s(SEXP mdpo, double discount, Rcpp::String nature,
                          SEXP nature_par, Rcpp::String algorithm = "mppi",
                          Rcpp::Nullable<Rcpp::DataFrame> policy_fixed = R_NilValue,
                          double maxresidual = 10e-4, size_t iterations = 10000,
                          double timeout = 300,
                          Rcpp::Nullable<Rcpp::DataFrame> value_init = R_NilValue,
                          bool pack_actions = false, bool output_tran = false,
-                         int show_progress = 1) {
+                         int show_progress = 1, size_t anderson = 0) {
 #ifdef GUROBI_USE // all srectangular MDPO methods require gurobi so far
     Rcpp::List result;
 
@@ -1431,11 +1522,13 @@ Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nat
     // perhaps only if the RMDP is transformed to an MDP
     // that is why this is set to true for now .... it is also easy to remove the 0s from
     // the dataframe
-    MDPO m = mdpo_from_dataframe(mdpo, true);
+    std::vector<craam::indvec> actionmap;
+    const auto mdpo_parsed = get_mdpo(mdpo, true, pack_actions, &actionmap);
+    const MDPO& m = *mdpo_parsed;
     if (m.size() == 0) return Rcpp::List();
 
     // remove actions that are not being used
-    if (pack_actions) { result["action_map"] = m.pack_actions(); }
+    if (pack_actions) { result["action_map"] = actionmap; }
 
     // policy: the method can be used to compute the robust solution for a policy
     // rpolicy stands for randomized policy and NOT robust policy
@@ -1454,26 +1547,32 @@ Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nat
 
     ComputeProgress progress(iterations, maxresidual, show_progress, timeout);
 
+#ifdef CRAAM_TRACE
+    // record the iterations of the solver when compiled with -DCRAAM_TRACE
+    algorithms::SolverTrace trace;
+    algorithms::TraceScope trace_scope(trace);
+#endif
+
     SRobustOutcomeSolution sol;
     if (algorithm == "mppi") {
         sol = rsolve_s_mppi(m, discount, std::move(natparsed), vf_init, rpolicy,
-                            iterations, maxresidual, progress);
+                            iterations, maxresidual, progress, anderson);
     } else if (algorithm == "ppi") {
         sol = rsolve_s_ppi(m, discount, std::move(natparsed), vf_init, rpolicy,
                            iterations, maxresidual, progress);
     } else if (algorithm == "mpi") {
         Rcpp::warning("The robust version of the mpi method may cycle forever "
                       "without converging.");
-        sol =
-            rsolve_s_mpi(m, discount, std::move(natparsed), vf_init, rpolicy, iterations,
-                         maxresidual, defaults::mpi_vi_count, 0.5, progress);
+        sol = rsolve_s_mpi(m, discount, std::move(natparsed), vf_init, rpolicy,
+                           iterations, maxresidual, defaults::mpi_vi_count, 0.5, progress,
+                           anderson);
     } else if (algorithm == "vi_g") {
         sol = rsolve_s_vi(m, discount, std::move(natparsed), vf_init, rpolicy, iterations,
-                          maxresidual, progress);
+                          maxresidual, progress, algorithms::VISolver::gs, anderson);
     } else if (algorithm == "vi_j" || algorithm == "vi") {
         // Jacobian value iteration, simulated using mpi
         sol = rsolve_s_mpi(m, discount, std::move(natparsed), vf_init, rpolicy,
-                           iterations, maxresidual, 0, 0.5, progress);
+                           iterations, maxresidual, 0, 0.5, progress, anderson);
     } else if (algorithm == "pi") {
         Rcpp::warning("The robust version of the pi method may cycle forever without "
                       "converging.");
@@ -1500,6 +1599,9 @@ Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nat
     result["policy_rand"] = output_policy(dec_pol);
     result["nature"] = output_snature(m, nat_pol);
     result["valuefunction"] = output_value_fun(move(sol.valuefunction));
+#ifdef CRAAM_TRACE
+    result["trace"] = trace.to_json();
+#endif
     result["status"] = sol.status;
     report_solution_status(sol);
 
@@ -1513,6 +1615,7 @@ Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nat
 //'
 //' @param mdpo Dataframe with `idstatefrom`, `idaction`, `idstateto`, `idoutcome`, `probability`, `reward`.
 //'             Each `idoutcome` represents a sample. The outcomes must be sorted increasingly.
+//'             It can also be a model compiled by mdp_compile.
 //' @param discount Discount rate in [0,1) (or = 1 at the risk of divergence)
 //' @param policy_rand Randomized policy with columns `idstate`, `idaction`, `probability`.
 //' @param initial Initial distribution with columns `idstate` and `probability`. If null
@@ -1522,33 +1625,55 @@ Rcpp::List rsolve_mdpo_s(Rcpp::DataFrame mdpo, double discount, Rcpp::String nat
 //' @return List of return values / or solutions for all outcomes
 // [[Rcpp::export]]
 Rcpp::DataFrame
-revaluate_mdpo_rnd(Rcpp::DataFrame mdpo, double discount,
+revaluate_mdpo_rnd(SEXP mdpo, double discount,
                    Rcpp::Nullable<Rcpp::DataFrame> policy_rnd = R_NilValue,
                    Rcpp::Nullable<Rcpp::DataFrame> initial = R_NilValue,
                    bool show_progress = true) {
 
-    if (mdpo.nrow() == 0) return Rcpp::List();
+    // a compiled model provides the MDPs of the outcomes, which are otherwise parsed
+    // from the dataframe one at a time
+    ModelHandle* handle = as_model_handle(mdpo);
+    const std::vector<craam::MDP>* outcome_mdps =
+        handle != nullptr ? &handle->outcome_mdps() : nullptr;
 
-    craam::indvec idstatefrom = mdpo["idstatefrom"], idaction = mdpo["idaction"],
-                  idstateto = mdpo["idstateto"], idoutcome = mdpo["idoutcome"];
-    craam::numvec probability = mdpo["probability"], reward = mdpo["reward"];
+    craam::indvec idstatefrom, idaction, idstateto, idoutcome;
+    craam::numvec probability, reward;
+    // get the unique outcomes
+    craam::indvec outcome_uniq;
 
-    // parse the data for the first outcome
-    if (!std::is_sorted(idoutcome.cbegin(), idoutcome.cend())) {
-        Rcpp::stop("The function requires that the outcomes are sorted in a "
-                   "non-descending order.");
-    }
+    if (outcome_mdps != nullptr) {
+        if (outcome_mdps->empty()) return Rcpp::List();
+        outcome_uniq.resize(outcome_mdps->size());
+        std::iota(outcome_uniq.begin(), outcome_uniq.end(), 0);
+    } else {
+        Rcpp::DataFrame frame = Rcpp::as<Rcpp::DataFrame>(mdpo);
+        if (frame.nrow() == 0) return Rcpp::List();
+
+        idstatefrom = Rcpp::as<craam::indvec>(frame["idstatefrom"]);
+        idaction = Rcpp::as<craam::indvec>(frame["idaction"]);
+        idstateto = Rcpp::as<craam::indvec>(frame["idstateto"]);
+        idoutcome = Rcpp::as<craam::indvec>(frame["idoutcome"]);
+        probability = Rcpp::as<craam::numvec>(frame["probability"]);
+        reward = Rcpp::as<craam::numvec>(frame["reward"]);
+
+        // parse the data for the first outcome
+        if (!std::is_sorted(idoutcome.cbegin(), idoutcome.cend())) {
+            Rcpp::stop("The function requires that the outcomes are sorted in a "
+                       "non-descending order.");
+        }
 
-    // get the unique outcomes
-    craam::indvec outcome_uniq = idoutcome;
-    {
+        outcome_uniq = idoutcome;
         auto unique_end = std::unique(outcome_uniq.begin(), outcome_uniq.end());
         outcome_uniq.erase(unique_end, outcome_uniq.end());
     }
 
     // parse the first MDP to get the number of states (assumed be the same for each outcome!)
-    auto mdp_init = mdp_from_mdpo_dataframe(idstatefrom, idaction, idoutcome, idstateto,
+    craam::MDP mdp_first;
+    if (outcome_mdps == nullptr)
+        mdp_first = mdp_from_mdpo_dataframe(idstatefrom, idaction, idoutcome, idstateto,
                                             probability, reward, outcome_uniq[0], false);
+    const craam::MDP& mdp_init =
+        outcome_mdps != nullptr ? outcome_mdps->front() : mdp_first;
 
     // policy: the method can be used to compute the robust solution for a policy
     // rpolicy stands for randomized policy and NOT robust policy
@@ -1582,10 +1707,14 @@ revaluate_mdpo_rnd(Rcpp::DataFrame mdpo, double discount,
 
         // check if an abort was called; do not stop or bad things happen because of openMP
         if (!progress.check_abort()) {
-            // parse the MDP for the given outcome
-            auto mdp =
-                mdp_from_mdpo_dataframe(idstatefrom, idaction, idoutcome, idstateto,
-                                        probability, reward, outcome_uniq[iout], false);
+            // parse the MDP for the given outcome unless it is compiled
+            craam::MDP parsed;
+            if (outcome_mdps == nullptr)
+                parsed = mdp_from_mdpo_dataframe(idstatefrom, idaction, idoutcome,
+                                                 idstateto, probability, reward,
+                                                 outcome_uniq[iout], false);
+            const craam::MDP& mdp =
+                outcome_mdps != nullptr ? (*outcome_mdps)[iout] : parsed;
             // solve the MDP
             { // make sure sol cannot be used elsewhere since we move the value function
                 auto sol = solve_mpi_r(mdp, discount, craam::numvec(0), rpolicy);
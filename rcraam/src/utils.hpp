@@ -26,10 +26,14 @@
 
 #include "rcraam_utils.hpp"
 
+#include "craam/builder.hpp"
+
 #include <eigen3/Eigen/Dense>
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
 /**
  * Converts a an integer vector to an Rcpp integer vector to pass it to
@@ -84,18 +88,14 @@ inline Rcpp::NumericVector as_vector(const Eigen::VectorXd& vector) {
  */
 inline craam::MDP mdp_from_dataframe(const Rcpp::DataFrame& data, bool force = false) {
     // idstatefrom, idaction, idstateto, probability, reward
-    Rcpp::IntegerVector idstatefrom = data["idstatefrom"], idaction = data["idaction"],
-                        idstateto = data["idstateto"];
-    Rcpp::NumericVector probability = data["probability"], reward = data["reward"];
-
-    size_t n = data.nrow();
-    craam::MDP m;
-
-    for (size_t i = 0; i < n; i++) {
-        craam::add_transition(m, idstatefrom[i], idaction[i], idstateto[i],
-                              probability[i], reward[i], force);
-    }
-    return m;
+    const auto idstatefrom = Rcpp::as<craam::indvec>(data["idstatefrom"]),
+               idaction = Rcpp::as<craam::indvec>(data["idaction"]),
+               idstateto = Rcpp::as<craam::indvec>(data["idstateto"]);
+    const auto probability = Rcpp::as<craam::numvec>(data["probability"]),
+               reward = Rcpp::as<craam::numvec>(data["reward"]);
+
+    return craam::mdp_from_columns(idstatefrom, idaction, idstateto, probability, reward,
+                                   force);
 }
 
 /**
@@ -128,12 +128,16 @@ mdp_from_mdpo_dataframe(const craam::indvec& idstatefrom, const craam::indvec id
     const auto istart = std::distance(idoutcome.begin(), start); // start - idoutcome.begin()
     const auto iend = std::distance(idoutcome.begin(), end); // end - idoutcome.begin()
 
-    craam::MDP m;
-    for (size_t i = istart; i < iend; i++) {
-        craam::add_transition(m, idstatefrom[i], idaction[i], idstateto[i],
-                              probability[i], reward[i], force);
-    }
-    return m;
+    // only the rows of the outcome
+    const craam::indvec statefrom_o(idstatefrom.cbegin() + istart,
+                                    idstatefrom.cbegin() + iend),
+        action_o(idaction.cbegin() + istart, idaction.cbegin() + iend),
+        stateto_o(idstateto.cbegin() + istart, idstateto.cbegin() + iend);
+    const craam::numvec probability_o(probability.cbegin() + istart,
+                                      probability.cbegin() + iend),
+        reward_o(reward.cbegin() + istart, reward.cbegin() + iend);
+    return craam::mdp_from_columns(statefrom_o, action_o, stateto_o, probability_o,
+                                   reward_o, force);
 }
 /**
  * Parses a data frame  to an MDPO. Each outcome represents a possible outcome of nature
@@ -148,19 +152,16 @@ mdp_from_mdpo_dataframe(const craam::indvec& idstatefrom, const craam::indvec id
  * @returns Corresponding MDPO definition
  */
 inline craam::MDPO mdpo_from_dataframe(const Rcpp::DataFrame& data, bool force = false) {
-    // idstatefrom, idaction, idstateto, probability, reward
-    Rcpp::IntegerVector idstatefrom = data["idstatefrom"], idaction = data["idaction"],
-                        idstateto = data["idstateto"], idoutcome = data["idoutcome"];
-    Rcpp::NumericVector probability = data["probability"], reward = data["reward"];
-
-    size_t n = data.nrow();
-    craam::MDPO m;
-
-    for (size_t i = 0; i < n; i++) {
-        craam::add_transition(m, idstatefrom[i], idaction[i], idoutcome[i], idstateto[i],
-                              probability[i], reward[i], force);
-    }
-    return m;
+    // idstatefrom, idaction, idoutcome, idstateto, probability, reward
+    const auto idstatefrom = Rcpp::as<craam::indvec>(data["idstatefrom"]),
+               idaction = Rcpp::as<craam::indvec>(data["idaction"]),
+               idoutcome = Rcpp::as<craam::indvec>(data["idoutcome"]),
+               idstateto = Rcpp::as<craam::indvec>(data["idstateto"]);
+    const auto probability = Rcpp::as<craam::numvec>(data["probability"]),
+               reward = Rcpp::as<craam::numvec>(data["reward"]);
+
+    return craam::mdpo_from_columns(idstatefrom, idaction, idoutcome, idstateto,
+                                    probability, reward, force);
 }
 
 /**
@@ -610,3 +611,187 @@ inline Rcpp::DataFrame actionmap2df(const std::vector<craam::indvec>& actionmap)
                                    Rcpp::_["idaction_old"] = as_intvec(idaction_old),
                                    Rcpp::_["idaction_new"] = as_intvec(idaction_new));
 }
+
+/**
+ * A model parsed once by mdp_compile and kept in R as an external pointer. The
+ * exported functions that accept a model data frame also accept the handle, which
+ * saves parsing the data frame on every call when the same model is solved
+ * repeatedly (e.g. with different discounts or budgets).
+ *
+ * The handle returns the same model as parsing the data frame would: the robust
+ * solvers get the model with the transitions with zero probabilities and the other
+ * functions get the model without them. Both are the same model unless the data
+ * frame has zero probabilities. Structures derived from the model, such as the
+ * model with packed actions or the MDPs of individual outcomes, are computed on
+ * the first use and cached too. The handle is immutable from R.
+ */
+class ModelHandle {
+protected:
+    /// A parsed model and the model with packed actions
+    template <class Model> struct Parsed {
+        /// Parsed model, null when the handle has the other type of the model
+        std::shared_ptr<const Model> model;
+        /// Model with packed actions, computed on the first use
+        std::shared_ptr<const Model> packed;
+        /// Indices of the original actions for each packed action
+        std::vector<craam::indvec> action_map;
+
+        /// Returns the model and computes the packed one when needed
+        std::shared_ptr<const Model> get(bool pack, std::vector<craam::indvec>* map) {
+            if (!pack) return model;
+            if (!packed) {
+                auto result = std::make_shared<Model>(*model);
+                action_map = result->pack_actions();
+                packed = std::move(result);
+            }
+            if (map != nullptr) *map = action_map;
+            return packed;
+        }
+    };
+
+    /// MDP with (forced) and without the transitions with zero probabilities;
+    /// empty for an MDPO
+    Parsed<craam::MDP> mdp_forced_, mdp_;
+    /// MDPO with (forced) and without the transitions with zero probabilities;
+    /// empty for an MDP
+    Parsed<craam::MDPO> mdpo_forced_, mdpo_;
+    /// MDP for each outcome of the MDPO
+    std::vector<craam::MDP> outcome_mdps_;
+
+public:
+    /// Model with no transitions with zero probabilities
+    explicit ModelHandle(craam::MDP mdp) {
+        mdp_.model = std::make_shared<const craam::MDP>(std::move(mdp));
+        mdp_forced_.model = mdp_.model;
+    }
+    /// Model parsed with and without the transitions with zero probabilities
+    ModelHandle(craam::MDP forced, craam::MDP plain) {
+        mdp_forced_.model = std::make_shared<const craam::MDP>(std::move(forced));
+        mdp_.model = std::make_shared<const craam::MDP>(std::move(plain));
+    }
+    /// Model with no transitions with zero probabilities
+    explicit ModelHandle(craam::MDPO mdpo) {
+        mdpo_.model = std::make_shared<const craam::MDPO>(std::move(mdpo));
+        mdpo_forced_.model = mdpo_.model;
+    }
+    /// Model parsed with and without the transitions with zero probabilities
+    ModelHandle(craam::MDPO forced, craam::MDPO plain) {
+        mdpo_forced_.model = std::make_shared<const craam::MDPO>(std::move(forced));
+        mdpo_.model = std::make_shared<const craam::MDPO>(std::move(plain));
+    }
+
+    /// Whether the model has outcomes
+    bool is_mdpo() const { return bool(mdpo_.model); }
+
+    /// Number of states in the model
+    size_t state_count() const {
+        return is_mdpo() ? mdpo_.model->size() : mdp_.model->size();
+    }
+
+    /**
+     * The model as an MDP; stops if it is an MDPO.
+     *
+     * @param force Whether to include the transitions with zero probabilities
+     * @param pack Whether to pack the actions, see craam::MDP::pack_actions
+     * @param action_map Receives the mapping of the packed actions when pack is true
+     */
+    std::shared_ptr<const craam::MDP>
+    mdp(bool force, bool pack = false, std::vector<craam::indvec>* action_map = nullptr) {
+        if (is_mdpo()) Rcpp::stop("The compiled model has outcomes; an MDP is expected.");
+        return (force ? mdp_forced_ : mdp_).get(pack, action_map);
+    }
+
+    /// The model as an MDPO; stops if it is an MDP. See mdp.
+    std::shared_ptr<const craam::MDPO>
+    mdpo(bool force, bool pack = false, std::vector<craam::indvec>* action_map = nullptr) {
+        if (!is_mdpo())
+            Rcpp::stop("The compiled model has no outcomes; an MDPO is expected.");
+        return (force ? mdpo_forced_ : mdpo_).get(pack, action_map);
+    }
+
+    /**
+     * MDPs of the individual outcomes of the MDPO (without the transitions with
+     * zero probabilities), with the transitions of outcome o in the MDP o. All
+     * states and actions must have the same number of outcomes.
+     */
+    const std::vector<craam::MDP>& outcome_mdps() {
+        if (!is_mdpo())
+            Rcpp::stop("The compiled model has no outcomes; an MDPO is expected.");
+        if (outcome_mdps_.empty() && mdpo_.model->size() > 0) {
+            const craam::MDPO& m = *mdpo_.model;
+            // the number of outcomes of the first non-terminal state
+            size_t outcome_count = 0;
+            for (size_t s = 0; s < m.size() && outcome_count == 0; ++s)
+                if (!m[s].is_terminal()) outcome_count = m[s][0].size();
+
+            std::vector<craam::MDP> result(outcome_count, craam::MDP(m.size()));
+            for (size_t s = 0; s < m.size(); ++s) {
+                for (size_t a = 0; a < m[s].size(); ++a) {
+                    if (m[s][a].size() != outcome_count)
+                        Rcpp::stop("All states and actions must have the same number "
+                                   "of outcomes.");
+                    for (size_t o = 0; o < outcome_count; ++o)
+                        result[o][s].create_action(a) = m[s][a][o];
+                }
+            }
+            outcome_mdps_ = std::move(result);
+        }
+        return outcome_mdps_;
+    }
+};
+
+/// Class of the R external pointer to a ModelHandle
+constexpr const char* model_handle_class = "rcraam_model";
+
+/**
+ * Returns the model handle when the argument is an external pointer created by
+ * mdp_compile and nullptr when it is not (e.g. a data frame).
+ */
+inline ModelHandle* as_model_handle(SEXP model) {
+    if (TYPEOF(model) != EXTPTRSXP || !Rf_inherits(model, model_handle_class))
+        return nullptr;
+    Rcpp::XPtr<ModelHandle> handle(model);
+    if (handle.get() == nullptr)
+        Rcpp::stop("The compiled model is no longer valid (was it saved and loaded?).");
+    return handle.get();
+}
+
+/**
+ * Returns the MDP passed to an exported function as a data frame or a handle
+ * created by mdp_compile. A data frame is parsed on every call, while the handle
+ * shares the parsed model (and the packed one) between the calls. Both return the
+ * same model.
+ *
+ * @param model Data frame or a model handle
+ * @param force Whether to keep transitions with zero probabilities
+ * @param pack Whether to pack the actions, see craam::MDP::pack_actions
+ * @param action_map Receives the mapping of the packed actions when pack is true
+ */
+inline std::shared_ptr<const craam::MDP>
+get_mdp(SEXP model, bool force = false, bool pack = false,
+        std::vector<craam::indvec>* action_map = nullptr) {
+    if (ModelHandle* handle = as_model_handle(model))
+        return handle->mdp(force, pack, action_map);
+    auto result = std::make_shared<craam::MDP>(
+        mdp_from_dataframe(Rcpp::as<Rcpp::DataFrame>(model), force));
+    if (pack) {
+        auto map = result->pack_actions();
+        if (action_map != nullptr) *action_map = std::move(map);
+    }
+    return result;
+}
+
+/// Returns the MDPO passed to an exported function, see get_mdp
+inline std::shared_ptr<const craam::MDPO>
+get_mdpo(SEXP model, bool force = false, bool pack = false,
+         std::vector<craam::indvec>* action_map = nullptr) {
+    if (ModelHandle* handle = as_model_handle(model))
+        return handle->mdpo(force, pack, action_map);
+    auto result = std::make_shared<craam::MDPO>(
+        mdpo_from_dataframe(Rcpp::as<Rcpp::DataFrame>(model), force));
+    if (pack) {
+        auto map = result->pack_actions();
+        if (action_map != nullptr) *action_map = std::move(map);
+    }
+    return result;
+}
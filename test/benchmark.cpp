@@ -23,6 +23,7 @@
 
 #include "craam/MDP.hpp"
 #include "craam/Samples.hpp"
+#include "craam/binary.hpp"
 #include "craam/algorithms/nature_response.hpp"
 #include "craam/modeltools.hpp"
 #include "craam/solvers.hpp"
@@ -43,17 +44,8 @@ enum class Solver { VI, MPI };
 void solve_mdp(const cxxopts::ParseResult& options, Solver solver) {
     cout << "Loading ... " << endl;
 
-    // open file
-    ifstream ifs;
-    ifs.open(options["input"].as<string>());
-    if (!ifs.is_open()) {
-        cout << "Failed to open the input file." << endl;
-        terminate();
-    }
-
-    // solve the MDP
-    MDP mdp = mdp_from_csv(ifs);
-    ifs.close();
+    // the file is parsed in parallel
+    MDP mdp = mdp_from_csv(options["input"].as<string>());
 
     // parse computation-related options
     auto iterations = options["iterations"].as<unsigned long>();
@@ -245,6 +237,41 @@ void build_mdp(const cxxopts::ParseResult& options) {
     }
 }
 
+void convert_binary(const cxxopts::ParseResult& options) {
+    if (options.count("output") == 0) {
+        cout << "No output file provided for the binary model." << endl;
+        terminate();
+    }
+    const string input = options["input"].as<string>();
+    const string output = options["output"].as<string>();
+
+    // a model with outcomes has an idoutcome column in the header
+    string header;
+    {
+        ifstream ifs(input);
+        if (!ifs.is_open()) {
+            cout << "Failed to open the input file." << endl;
+            terminate();
+        }
+        getline(ifs, header);
+    }
+
+    // store probabilities and rewards as floats and indices as 32-bit integers
+    const bool single = options["single"].as<bool>();
+
+    cout << "Loading ... " << endl;
+    if (header.find("idoutcome") != string::npos) {
+        MDPO mdpo = mdpo_from_csv(input);
+        cout << "Writing binary MDPO ... " << endl;
+        save_binary(mdpo, output, single);
+    } else {
+        MDP mdp = mdp_from_csv(input);
+        cout << "Writing binary MDP ... " << endl;
+        save_binary(mdp, output, single);
+    }
+    cout << "Done." << endl;
+}
+
 int main(int argc, char* argv[]) {
 
     cxxopts::Options options("craam", "Fast command-line solver for (robust) MDPs");
@@ -255,7 +282,7 @@ int main(int argc, char* argv[]) {
                                   cxxopts::value<string>())(
         "m,method",
         "Solution method: MPI - Modified Policy Iteration, VI - Value Iteration, "
-        "MDP - Construct from samples",
+        "MDP - Construct from samples, BIN - Convert a csv model to the binary format",
         cxxopts::value<string>()->default_value("MPI"))(
         "d,discount", "Discount factor", cxxopts::value<double>()->default_value("0.9"))(
         "e,precision", "Maximum residual",
@@ -263,7 +290,8 @@ int main(int argc, char* argv[]) {
         "l,iterations", "Maximum number of iterations",
         cxxopts::value<unsigned long>()->default_value("2000"))(
         "b,budget", "Robustness budget", cxxopts::value<double>()->default_value("0.0"))(
-        "u,ambiguity", "Type of ambiguity", cxxopts::value<string>());
+        "u,ambiguity", "Type of ambiguity", cxxopts::value<string>())(
+        "s,single", "Store the binary model in single precision with 32-bit indices");
 
     try {
         auto presult = options.parse(argc, argv);
@@ -285,6 +313,8 @@ int main(int argc, char* argv[]) {
             solve_mdp(presult, Solver::VI);
         } else if (method == "MDP") {
             build_mdp(presult);
+        } else if (method == "BIN") {
+            convert_binary(presult);
         } else {
             cout << "Unknown method type: " << method << "." << endl;
             return 0;
@@ -0,0 +1,191 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Parameterized synthetic models used by the benchmark suite and the tests. All
+// generators are deterministic for a given seed.
+
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/modeltools.hpp"
+#include "craam/simulation.hpp"
+#include "craam/simulators/inventory.hpp"
+#include "craam/simulators/population.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace craam { namespace bench {
+
+using namespace std;
+
+/**
+ * Random sparse MDP. Every action transitions to `branching` distinct states
+ * chosen uniformly at random with random probabilities and rewards in [0,1].
+ *
+ * @param nstates Number of states
+ * @param nactions Number of actions in every state
+ * @param branching Number of target states of each action (at most nstates)
+ * @param seed Seed of the random number generator
+ */
+inline MDP random_mdp(long nstates, long nactions, long branching,
+                      default_random_engine::result_type seed = 0) {
+    if (nstates <= 0 || nactions <= 0 || branching <= 0)
+        throw invalid_argument("The size of the random MDP must be positive.");
+    branching = std::min(branching, nstates);
+
+    default_random_engine gen(seed);
+    uniform_real_distribution<prec_t> unif(0.0, 1.0);
+    uniform_int_distribution<long> target(0, nstates - 1);
+
+    MDP mdp(nstates);
+    indvec targets;
+    for (long s = 0; s < nstates; s++) {
+        for (long a = 0; a < nactions; a++) {
+            // distinct targets; rejection is cheap because branching is small
+            targets.clear();
+            while (long(targets.size()) < branching) {
+                const long t = target(gen);
+                if (find(targets.cbegin(), targets.cend(), t) == targets.cend())
+                    targets.push_back(t);
+            }
+            Transition& tran = mdp[s].create_action(a);
+            for (long t : targets)
+                tran.add_sample(t, unif(gen) + 1e-3, unif(gen));
+            tran.normalize();
+        }
+    }
+    return mdp;
+}
+
+/**
+ * Riverswim chain. Action 0 deterministically moves left and receives a small
+ * reward; action 1 moves left, stays, or moves right with the given probabilities
+ * and receives a large reward only in the right-most state.
+ *
+ * @param nstates Number of states in the chain
+ * @param probabilities Probabilities of moving left, staying, and moving right
+ *                      with action 1
+ * @param left_reward Reward for taking action 0
+ * @param prize_reward Reward for action 1 in the right-most state
+ */
+inline MDP riverswim(long nstates, array<prec_t, 3> probabilities = {0.2, 0.3, 0.5},
+                     prec_t left_reward = 5.0, prec_t prize_reward = 100.0) {
+    if (nstates < 2) throw invalid_argument("Riverswim needs at least 2 states.");
+    MDP mdp(nstates);
+    for (long s = 0; s < nstates; s++) {
+        const long left = std::max(0l, s - 1), right = std::min(nstates - 1, s + 1);
+        const prec_t prize = s == nstates - 1 ? prize_reward : 0.0;
+        add_transition(mdp, s, 0, left, 1.0, left_reward);
+        add_transition(mdp, s, 1, left, probabilities[0], 0.0);
+        add_transition(mdp, s, 1, s, probabilities[1], prize);
+        add_transition(mdp, s, 1, right, probabilities[2], prize);
+    }
+    return mdp;
+}
+
+/**
+ * MDP of the inventory management problem, see msen::InventorySimulator. The
+ * model has max_inventory + 1 states and max_inventory / 2 + 1 actions.
+ *
+ * @param max_inventory Maximal inventory level
+ */
+inline MDP inventory_mdp(long max_inventory) {
+    if (max_inventory < 1) throw invalid_argument("Maximal inventory must be positive.");
+    const numvec demands{0.1, 0.2, 0.3, 0.3, 0.1};
+    const array<prec_t, 4> costs{2.0, 0.5, 0.2, 0.1};
+    const array<long, 3> limits{max_inventory, 0l, max_inventory / 2};
+    const msen::InventorySimulator simulator(demands, costs, 3.0, limits);
+
+    MDP mdp;
+    simulator.build_mdp(
+        [&mdp](long statefrom, long action, long stateto, prec_t prob, prec_t rew) {
+            add_transition(mdp, statefrom, action, stateto, prob, rew);
+        });
+    return mdp;
+}
+
+/**
+ * MDP of the invasive species management problem estimated from samples of
+ * msen::PopulationSim. The model has carrying_capacity + 1 states and 2 actions.
+ *
+ * @param carrying_capacity Maximal population
+ * @param sample_count Number of samples for each state and action
+ * @param seed Seed of the simulator
+ */
+inline MDP population_mdp(long carrying_capacity, unsigned int sample_count = 50,
+                          random_device::result_type seed = 0) {
+    if (carrying_capacity < 1)
+        throw invalid_argument("Carrying capacity must be positive.");
+    const size_t n = carrying_capacity + 1;
+    const numvecvec mean_rate{numvec(n, 1.03), numvec(n, 0.95)};
+    const numvecvec std_rate{numvec(n, 0.5), numvec(n, 0.5)};
+    const numvecvec rewards{numvec(n, -1.0), numvec(n, 0.2)};
+    const msen::PopulationSim simulator(carrying_capacity, 0, 2, mean_rate, std_rate,
+                                        rewards, 0, 0,
+                                        msen::PopulationSim::Growth::Exponential, seed);
+    return msen::build_mdp_par(simulator, sample_count, seed);
+}
+
+/**
+ * Bayesian MDPO in which each outcome is a sample from a Dirichlet posterior
+ * around a random sparse MDP. All outcomes of a state-action share its support
+ * and rewards, as samples from a posterior do.
+ *
+ * @param nstates Number of states
+ * @param nactions Number of actions in every state
+ * @param branching Number of target states of each action
+ * @param noutcomes Number of posterior samples (outcomes) of each state-action
+ * @param concentration Sum of the Dirichlet parameters; larger values make the
+ *                      samples closer to the nominal probabilities
+ * @param seed Seed of the random number generator
+ */
+inline MDPO bayesian_mdpo(long nstates, long nactions, long branching, long noutcomes,
+                          prec_t concentration = 20.0,
+                          default_random_engine::result_type seed = 0) {
+    if (noutcomes <= 0) throw invalid_argument("The number of outcomes must be positive.");
+    const MDP nominal = random_mdp(nstates, nactions, branching, seed);
+
+    default_random_engine gen(seed + 1);
+    MDPO mdpo(nstates);
+    for (long s = 0; s < nstates; s++) {
+        for (long a = 0; a < nactions; a++) {
+            const Transition& t = nominal[s][a];
+            ActionO& action = mdpo[s].create_action(a);
+            for (long o = 0; o < noutcomes; o++) {
+                Transition& outcome = action.create_outcome(o);
+                for (size_t j = 0; j < t.size(); j++) {
+                    gamma_distribution<prec_t> gamma(
+                        concentration * t.get_probabilities()[j], 1.0);
+                    outcome.add_sample(t.get_indices()[j], gamma(gen) + 1e-6,
+                                       t.get_rewards()[j]);
+                }
+                outcome.normalize();
+            }
+        }
+    }
+    return mdpo;
+}
+
+}} // namespace craam::bench
@@ -0,0 +1,455 @@
+// This file is part of CRAAM, a C++ library for solving plain
+// and robust Markov decision processes.
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Benchmark suite: generates synthetic models of several sizes, solves them with
+// every combination of a solver, a nature, and a number of threads, and writes one
+// csv or json line per run. On POSIX systems, each run is executed in a forked child
+// process and its peak memory is the peak resident set size of the child, which
+// includes the model inherited from the parent.
+
+#include "craam/MDP.hpp"
+#include "craam/MDPO.hpp"
+#include "craam/algorithms/nature_response.hpp"
+#include "craam/solvers.hpp"
+
+#include "test/benchmark_models.hpp"
+#include "cxxopts/cxxopts.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <variant>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CRAAM_BENCH_FORK
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace craam;
+
+/// Outcome of a single solver run
+struct RunResult {
+    long iterations;
+    prec_t residual;
+    int status;
+};
+
+/// Settings shared by all runs
+struct Settings {
+    prec_t discount;
+    prec_t precision;
+    unsigned long iterations;
+    prec_t budget;
+};
+
+template <class S> RunResult to_result(const S& sol) {
+    return {sol.iterations, sol.residual, sol.status};
+}
+
+/// Splits a comma-separated list
+vector<string> split_list(const string& text) {
+    vector<string> result;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty()) result.push_back(item);
+    return result;
+}
+
+/// Runs a solver with an s,a-rectangular nature on an MDP or an MDPO
+template <class Model, class Nature>
+optional<RunResult> run_sa(const string& algorithm, const Model& model,
+                           const Nature& nature, const Settings& set) {
+    using namespace algorithms;
+    if (algorithm == "vi")
+        return to_result(rsolve_vi(model, set.discount, nature, numvec(0), indvec(0),
+                                   set.iterations, set.precision));
+    if (algorithm == "mpi")
+        return to_result(rsolve_mpi(model, set.discount, nature, numvec(0), indvec(0),
+                                    set.iterations, set.precision));
+    if (algorithm == "pi")
+        return to_result(rsolve_pi(model, set.discount, nature, numvec(0), indvec(0),
+                                   set.iterations, set.precision));
+    if (algorithm == "ppi")
+        return to_result(rsolve_ppi(model, set.discount, nature, numvec(0), indvec(0),
+                                    set.iterations, set.precision));
+    return nullopt;
+}
+
+/// Runs a solver with an s-rectangular nature on an MDP
+optional<RunResult> run_s(const string& algorithm, const MDP& mdp,
+                          const algorithms::SNature& nature, const Settings& set) {
+    using namespace algorithms;
+    if (algorithm == "vi")
+        return to_result(rsolve_s_vi(mdp, set.discount, nature, numvec(0), indvec(0),
+                                     set.iterations, set.precision));
+    if (algorithm == "mpi")
+        return to_result(rsolve_s_mpi(mdp, set.discount, nature, numvec(0), indvec(0),
+                                      set.iterations, set.precision));
+    if (algorithm == "pi")
+        return to_result(rsolve_s_pi(mdp, set.discount, nature, numvec(0), indvec(0),
+                                     set.iterations, set.precision));
+    if (algorithm == "ppi")
+        return to_result(rsolve_s_ppi(mdp, set.discount, nature, numvec(0), indvec(0),
+                                      set.iterations, set.precision));
+    return nullopt;
+}
+
+/// Runs a solver without a nature
+optional<RunResult> run_plain(const string& algorithm, const MDP& mdp,
+                              const Settings& set) {
+    using namespace algorithms;
+    if (algorithm == "vi")
+        return to_result(solve_vi(mdp, set.discount, numvec(0), indvec(0), set.iterations,
+                                  set.precision));
+    if (algorithm == "mpi")
+        return to_result(solve_mpi(mdp, set.discount, numvec(0), indvec(0),
+                                   set.iterations, set.precision));
+    if (algorithm == "pi")
+        return to_result(solve_pi(mdp, set.discount, numvec(0), indvec(0), set.iterations,
+                                  set.precision));
+    return nullopt;
+}
+
+/// Runs a solver without a nature, using the nominal distribution over outcomes
+optional<RunResult> run_plain(const string& algorithm, const MDPO& mdpo,
+                              const Settings& set) {
+    using namespace algorithms;
+    if (algorithm == "vi")
+        return to_result(solve_vi(mdpo, set.discount, numvec(0), indvec(0),
+                                  set.iterations, set.precision));
+    if (algorithm == "mpi")
+        return to_result(solve_mpi(mdpo, set.discount, numvec(0), indvec(0),
+                                   set.iterations, set.precision));
+    return nullopt;
+}
+
+/**
+ * Runs the algorithm with the nature on the model. Returns nothing when the
+ * combination is not supported.
+ */
+template <class Model>
+optional<RunResult> run(const string& algorithm, const string& nature, const Model& model,
+                        const Settings& set) {
+    using namespace algorithms;
+    if (nature == "none") return run_plain(algorithm, model, set);
+    if (nature == "l1u") return run_sa(algorithm, model, nats::robust_l1u(set.budget), set);
+    if (nature == "avar")
+        return run_sa(algorithm, model, nats::robust_avar_exp_u(set.budget, 0.5), set);
+    if constexpr (std::is_same_v<Model, MDP>) {
+        if (nature == "s_l1u")
+            return run_s(algorithm, model, nats::robust_s_l1u(set.budget), set);
+    }
+    return nullopt;
+}
+
+/// Statistics of a generated model
+struct ModelStats {
+    size_t states, stateactions, transitions;
+};
+
+ModelStats model_stats(const MDP& mdp) {
+    ModelStats stats{mdp.size(), 0, 0};
+    for (const State& s : mdp) {
+        stats.stateactions += s.size();
+        for (const Action& a : s.get_actions())
+            stats.transitions += a.size();
+    }
+    return stats;
+}
+
+ModelStats model_stats(const MDPO& mdpo) {
+    ModelStats stats{mdpo.size(), 0, 0};
+    for (const StateO& s : mdpo) {
+        stats.stateactions += s.size();
+        for (const ActionO& a : s.get_actions())
+            for (const Transition& t : a.get_outcomes())
+                stats.transitions += t.size();
+    }
+    return stats;
+}
+
+/// Writes the results of the runs as csv or json lines
+class ResultWriter {
+    ostream& out;
+    bool json;
+
+public:
+    ResultWriter(ostream& out, bool json) : out(out), json(json) {
+        if (!json)
+            out << "model,size,states,stateactions,transitions,threads,algorithm,nature,"
+                   "repeat,status,iterations,residual,seconds,sa_per_sec,peak_rss_kb"
+                << endl;
+    }
+
+    void write(const string& model, long size, const ModelStats& stats, int threads,
+               const string& algorithm, const string& nature, int repeat,
+               const RunResult& result, double seconds, long rss) {
+        // state-action updates per second, each iteration updates all of them
+        const double sa_per_sec =
+            seconds > 0 ? double(stats.stateactions) * double(result.iterations) / seconds
+                        : 0.0;
+        if (json) {
+            out << "{\"model\":\"" << model << "\",\"size\":" << size
+                << ",\"states\":" << stats.states
+                << ",\"stateactions\":" << stats.stateactions
+                << ",\"transitions\":" << stats.transitions << ",\"threads\":" << threads
+                << ",\"algorithm\":\"" << algorithm << "\",\"nature\":\"" << nature
+                << "\",\"repeat\":" << repeat << ",\"status\":" << result.status
+                << ",\"iterations\":" << result.iterations
+                << ",\"residual\":" << result.residual << ",\"seconds\":" << seconds
+                << ",\"sa_per_sec\":" << sa_per_sec << ",\"peak_rss_kb\":" << rss << "}"
+                << endl;
+        } else {
+            out << model << "," << size << "," << stats.states << ","
+                << stats.stateactions << "," << stats.transitions << "," << threads
+                << "," << algorithm << "," << nature << "," << repeat << ","
+                << result.status << "," << result.iterations << "," << result.residual
+                << "," << seconds << "," << sa_per_sec << "," << rss << endl;
+        }
+    }
+};
+
+/// Result, time, and memory of a single run
+struct Measurement {
+    /// Whether the combination of the algorithm and the nature is supported
+    bool supported;
+    RunResult result;
+    double seconds;
+    /// Peak resident set size of the run in kilobytes, -1 when not available
+    long peak_rss_kb;
+};
+
+/// Runs and times the algorithm with the nature on the model in this process
+template <class Model>
+Measurement measure_here(const string& algorithm, const string& nature,
+                         const Model& model, const Settings& set, int nthreads) {
+#ifdef _OPENMP
+    omp_set_num_threads(nthreads);
+#endif
+    const auto start = chrono::steady_clock::now();
+    const auto result = run(algorithm, nature, model, set);
+    const auto finish = chrono::steady_clock::now();
+    return {result.has_value(), result.value_or(RunResult{0, 0, 0}),
+            chrono::duration<double>(finish - start).count(), -1};
+}
+
+/**
+ * Runs and times the algorithm with the nature on the model. On POSIX systems, the
+ * run is executed in a forked child process, so that its peak memory is not
+ * affected by the previous runs.
+ */
+template <class Model>
+Measurement measure(const string& algorithm, const string& nature, const Model& model,
+                    const Settings& set, int nthreads) {
+#ifdef CRAAM_BENCH_FORK
+    int fds[2];
+    if (pipe(fds) != 0) throw runtime_error("Could not create a pipe.");
+    const pid_t pid = fork();
+    if (pid < 0) throw runtime_error("Could not fork a process for the run.");
+    if (pid == 0) {
+        // the child only reports the measurement through the pipe
+        close(fds[0]);
+        int code = 0;
+        try {
+            const Measurement m = measure_here(algorithm, nature, model, set, nthreads);
+            if (write(fds[1], &m, sizeof(m)) != ssize_t(sizeof(m))) code = 1;
+        } catch (const exception& e) {
+            cerr << "Run failed: " << e.what() << endl;
+            code = 1;
+        }
+        close(fds[1]);
+        _exit(code);
+    }
+    close(fds[1]);
+    Measurement m;
+    const bool received = read(fds[0], &m, sizeof(m)) == ssize_t(sizeof(m));
+    close(fds[0]);
+    int status = 0;
+    rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !received)
+        throw runtime_error("The run of " + algorithm + " with " + nature + " failed.");
+#ifdef __APPLE__
+    m.peak_rss_kb = usage.ru_maxrss / 1024; // reported in bytes
+#else
+    m.peak_rss_kb = usage.ru_maxrss;
+#endif
+    return m;
+#else
+    return measure_here(algorithm, nature, model, set, nthreads);
+#endif
+}
+
+/// Runs all combinations of algorithms, natures, and threads for a model
+template <class Model>
+void benchmark_model(const string& name, long size, const Model& model,
+                     const vector<string>& algorithms, const vector<string>& natures,
+                     const vector<int>& threads, int repeats, const Settings& set,
+                     ResultWriter& writer) {
+    const ModelStats stats = model_stats(model);
+    for (const string& nature : natures) {
+        for (const string& algorithm : algorithms) {
+            for (int nthreads : threads) {
+#ifndef _OPENMP
+                if (nthreads != 1) continue;
+#endif
+                for (int r = 0; r < repeats; r++) {
+                    const Measurement m =
+                        measure(algorithm, nature, model, set, nthreads);
+                    // the combination is not supported
+                    if (!m.supported) break;
+                    cerr << name << " " << size << " " << algorithm << " " << nature
+                         << " threads: " << nthreads << endl;
+                    writer.write(name, size, stats, nthreads, algorithm, nature, r,
+                                 m.result, m.seconds, m.peak_rss_kb);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("craam-bench",
+                             "Benchmarks of the solvers on synthetic (robust) MDPs");
+
+    options.add_options()("h,help", "Display help message.")(
+        "m,models", "Models: random, riverswim, inventory, population, bayes",
+        cxxopts::value<string>()->default_value("random,riverswim,inventory,population,"
+                                                "bayes"))(
+        "n,sizes", "Model sizes (number of states, approximately)",
+        cxxopts::value<string>()->default_value("100,1000"))(
+        "a,algorithms", "Solvers: vi, mpi, pi, ppi",
+        cxxopts::value<string>()->default_value("vi,mpi,pi,ppi"))(
+        "u,natures", "Natures: none, l1u, avar, s_l1u",
+        cxxopts::value<string>()->default_value("none,l1u,s_l1u"))(
+        "t,threads", "Numbers of threads", cxxopts::value<string>()->default_value("1"))(
+        "r,repeat", "Number of repetitions of each run",
+        cxxopts::value<int>()->default_value("1"))(
+        "k,actions", "Number of actions of the random models",
+        cxxopts::value<long>()->default_value("4"))(
+        "c,branching", "Number of target states of each action in the random models",
+        cxxopts::value<long>()->default_value("10"))(
+        "x,outcomes", "Number of outcomes of the Bayesian models",
+        cxxopts::value<long>()->default_value("20"))(
+        "d,discount", "Discount factor", cxxopts::value<double>()->default_value("0.95"))(
+        "e,precision", "Maximum residual",
+        cxxopts::value<double>()->default_value("0.0001"))(
+        "l,iterations", "Maximum number of iterations",
+        cxxopts::value<unsigned long>()->default_value("10000"))(
+        "b,budget", "Budget of the natures",
+        cxxopts::value<double>()->default_value("0.2"))(
+        "s,seed", "Seed of the model generators",
+        cxxopts::value<unsigned int>()->default_value("0"))(
+        "f,format", "Output format: csv or json",
+        cxxopts::value<string>()->default_value("csv"))(
+        "o,output", "Output file, standard output if omitted", cxxopts::value<string>());
+
+    try {
+        auto presult = options.parse(argc, argv);
+
+        if (presult["h"].as<bool>()) {
+            cout << options.help() << endl;
+            return 0;
+        }
+
+        const Settings set{presult["discount"].as<double>(),
+                           presult["precision"].as<double>(),
+                           presult["iterations"].as<unsigned long>(),
+                           presult["budget"].as<double>()};
+        const auto models = split_list(presult["models"].as<string>());
+        const auto algorithms = split_list(presult["algorithms"].as<string>());
+        const auto natures = split_list(presult["natures"].as<string>());
+        vector<long> sizes;
+        for (const string& s : split_list(presult["sizes"].as<string>()))
+            sizes.push_back(stol(s));
+        vector<int> threads;
+        for (const string& t : split_list(presult["threads"].as<string>()))
+            threads.push_back(stoi(t));
+        const int repeats = presult["repeat"].as<int>();
+        const long nactions = presult["actions"].as<long>();
+        const long branching = presult["branching"].as<long>();
+        const long noutcomes = presult["outcomes"].as<long>();
+        const unsigned int seed = presult["seed"].as<unsigned int>();
+
+        const string format = presult["format"].as<string>();
+        if (format != "csv" && format != "json") {
+            cout << "Unknown output format: " << format << "." << endl;
+            return 1;
+        }
+        ofstream ofs;
+        if (presult.count("output") > 0) {
+            ofs.open(presult["output"].as<string>());
+            if (!ofs.is_open()) {
+                cout << "Could not open the output file for writing" << endl;
+                return 1;
+            }
+        }
+        ResultWriter writer(ofs.is_open() ? ofs : cout, format == "json");
+
+        for (const string& name : models) {
+            for (long size : sizes) {
+                if (name == "random") {
+                    benchmark_model(name, size,
+                                    bench::random_mdp(size, nactions, branching, seed),
+                                    algorithms, natures, threads, repeats, set, writer);
+                } else if (name == "riverswim") {
+                    benchmark_model(name, size, bench::riverswim(size), algorithms,
+                                    natures, threads, repeats, set, writer);
+                } else if (name == "inventory") {
+                    benchmark_model(name, size, bench::inventory_mdp(size - 1), algorithms,
+                                    natures, threads, repeats, set, writer);
+                } else if (name == "population") {
+                    benchmark_model(name, size, bench::population_mdp(size - 1, 50, seed),
+                                    algorithms, natures, threads, repeats, set, writer);
+                } else if (name == "bayes") {
+                    benchmark_model(
+                        name, size,
+                        bench::bayesian_mdpo(size, nactions, branching, noutcomes, 20.0,
+                                             seed),
+                        algorithms, natures, threads, repeats, set, writer);
+                } else {
+                    cout << "Unknown model: " << name << "." << endl;
+                    return 1;
+                }
+            }
+        }
+    } catch (const cxxopts::OptionException& oe) {
+        cout << oe.what() << endl << endl << " *** usage *** " << endl;
+        cout << options.help() << endl;
+        return 1;
+    } catch (const runtime_error& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
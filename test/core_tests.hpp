@@ -25,6 +25,7 @@
 
 #include "craam/MDP.hpp"
 #include "craam/MDPO.hpp"
+#include "craam/binary.hpp"
 #include "craam/algorithms/matrices.hpp"
 #include "craam/algorithms/nature_response.hpp"
 #include "craam/algorithms/soft_robust.hpp"
@@ -39,9 +40,13 @@
 #include "test/example_mdps.hpp"
 
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <numeric>
+#include <random>
 #include <sstream>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -64,7 +69,7 @@ inline void add_transition(MDPO& mdp, long fromid, long actionid, long toid,
 inline PlainBellman make_bellman(const MDP& mdp) { return PlainBellman(mdp); }
 
 /// A helper function to address template issues
-inline SARobustOutcomeBellman make_bellman(const MDPO& mdpo) {
+inline SARobustOutcomeBellman<> make_bellman(const MDPO& mdpo) {
     return SARobustOutcomeBellman(mdpo);
 }
 
@@ -139,6 +144,53 @@ BOOST_AUTO_TEST_CASE(test_l1_worst_case) {
     BOOST_CHECK_CLOSE(w, 2.0, 1e-3);
 }
 
+BOOST_AUTO_TEST_CASE(test_l1_worst_case_workspace) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<prec_t> unif(0.0, 1.0);
+
+    WorkspaceL1 workspace;
+    numvec o;
+    numvecvec zs, ps;
+    numvec xis, objectives;
+    for (size_t n : {1, 2, 5, 50, 301}) {
+        numvec z(n), p(n);
+        for (size_t i = 0; i < n; i++) {
+            z[i] = std::round(10 * unif(gen)); // ties are common
+            p[i] = unif(gen) < 0.2 ? 0.0 : unif(gen);
+        }
+        p[0] += 0.1;
+        const prec_t sum = accumulate(p.cbegin(), p.cend(), 0.0);
+        for (auto& pi : p)
+            pi /= sum;
+
+        for (prec_t xi : {0.0, 0.05, 0.3, 1.0, 1.7, 2.0}) {
+            prec_t obj = worstcase_l1(z, p, xi, o, workspace);
+            // compare with an independent implementation
+            auto [pol_w, obj_w] = worstcase_l1_w(z, p, numvec(n, 1.0), xi);
+            BOOST_CHECK_CLOSE(obj, obj_w, 1e-6);
+            BOOST_CHECK_CLOSE(obj, inner_product(o.cbegin(), o.cend(), z.cbegin(), 0.0),
+                              1e-6);
+            BOOST_CHECK_CLOSE(accumulate(o.cbegin(), o.cend(), 0.0), 1.0, 1e-6);
+            BOOST_CHECK_LE(*min_element(o.cbegin(), o.cend()), 1.0);
+            BOOST_CHECK_GE(*min_element(o.cbegin(), o.cend()), 0.0);
+            BOOST_CHECK_LE(l1norm(o, p), xi + 1e-8);
+
+            zs.push_back(z);
+            ps.push_back(p);
+            xis.push_back(xi);
+            objectives.push_back(obj);
+        }
+    }
+
+    // the batched version returns the same solutions
+    numvecvec distributions;
+    numvec values;
+    worstcase_l1_batch(zs, ps, xis, distributions, values, workspace);
+    BOOST_CHECK_EQUAL_COLLECTIONS(values.cbegin(), values.cend(), objectives.cbegin(),
+                                  objectives.cend());
+    BOOST_CHECK_EQUAL(distributions.size(), zs.size());
+}
+
 // ********************************************************************************
 // ***** Risk measures
 // ********************************************************************************
@@ -520,6 +572,41 @@ BOOST_AUTO_TEST_CASE(simple_robust_algorithms) {
     CHECK_CLOSE_COLLECTION(solution3.valuefunction, solution5.valuefunction, 1.0);
 }
 
+BOOST_AUTO_TEST_CASE(inplace_nature_dispatch) {
+    MDP mdp = create_test_mdp<MDP>();
+    const double discount = 0.9;
+
+    // the in-place interface and the SANature interface compute the same response
+    const numvec z{1.0, 3.0, -2.0, 0.5}, pbar{0.1, 0.4, 0.2, 0.3};
+    numvec distribution(10, -1.0);
+    const auto l1 = algorithms::nats::robust_l1u(0.4);
+    const auto [pair_dist, pair_value] = l1(0, 0, pbar, z);
+    BOOST_CHECK_CLOSE(l1(0, 0, pbar, z, distribution), pair_value, 1e-8);
+    BOOST_CHECK_EQUAL_COLLECTIONS(distribution.cbegin(), distribution.cend(),
+                                  pair_dist.cbegin(), pair_dist.cend());
+
+    // static dispatch of a concrete nature is the same as the std::function path
+    const algorithms::SANature l1_function = l1;
+    auto sol_static = rsolve_vi(mdp, discount, l1);
+    auto sol_function = rsolve_vi(mdp, discount, l1_function);
+    BOOST_CHECK_EQUAL_COLLECTIONS(sol_static.valuefunction.cbegin(),
+                                  sol_static.valuefunction.cend(),
+                                  sol_function.valuefunction.cbegin(),
+                                  sol_function.valuefunction.cend());
+    for (size_t s = 0; s < mdp.size(); s++) {
+        BOOST_CHECK_EQUAL(sol_static.policy[s].first, sol_function.policy[s].first);
+        BOOST_CHECK_EQUAL_COLLECTIONS(
+            sol_static.policy[s].second.cbegin(), sol_static.policy[s].second.cend(),
+            sol_function.policy[s].second.cbegin(), sol_function.policy[s].second.cend());
+    }
+
+    // natures without the in-place interface are adapted
+    auto sol_var = rsolve_mpi(mdp, discount, algorithms::nats::robust_var_exp_u(0.5, 0.5));
+    auto sol_var_f = rsolve_mpi(
+        mdp, discount, algorithms::SANature(algorithms::nats::robust_var_exp_u(0.5, 0.5)));
+    CHECK_CLOSE_COLLECTION(sol_var.valuefunction, sol_var_f.valuefunction, 1e-8);
+}
+
 BOOST_AUTO_TEST_CASE(simple_robust_algorithms_ind) {
     MDP fullmdp = create_test_mdp<MDP>();
 
@@ -553,6 +640,897 @@ BOOST_AUTO_TEST_CASE(simple_robust_algorithms_ind) {
     CHECK_CLOSE_COLLECTION(solution3.valuefunction, solution5.valuefunction, 1.0);
 }
 
+BOOST_AUTO_TEST_CASE(compiled_mdp_algorithms) {
+    MDP fullmdp = create_test_mdp<MDP>();
+    // add a terminal state
+    fullmdp.create_state(3);
+    const CompiledMDP cmdp(fullmdp);
+
+    BOOST_CHECK_EQUAL(cmdp.size(), 4);
+    BOOST_CHECK_EQUAL(cmdp.stateaction_count(), 6);
+    BOOST_CHECK_EQUAL(cmdp.transition_count(), 6);
+    BOOST_CHECK(cmdp.is_terminal(3));
+
+    double discount = 0.9;
+
+    auto sol_vi = solve_vi(fullmdp, discount);
+    auto csol_vi = solve_vi(cmdp, discount);
+    BOOST_CHECK(csol_vi.status == 0);
+    CHECK_CLOSE_COLLECTION(sol_vi.valuefunction, csol_vi.valuefunction, 1e-8);
+    BOOST_CHECK_EQUAL_COLLECTIONS(sol_vi.policy.cbegin(), sol_vi.policy.cend(),
+                                  csol_vi.policy.cbegin(), csol_vi.policy.cend());
+
+    auto csol_mpi = solve_mpi(cmdp, discount);
+    BOOST_CHECK(csol_mpi.status == 0);
+    CHECK_CLOSE_COLLECTION(sol_vi.valuefunction, csol_mpi.valuefunction, 0.1);
+
+    auto csol_pi = solve_pi(cmdp, discount);
+    BOOST_CHECK(csol_pi.status == 0);
+    CHECK_CLOSE_COLLECTION(sol_vi.valuefunction, csol_pi.valuefunction, 0.1);
+
+    auto nature = algorithms::nats::robust_l1u(0.5);
+    auto rsol_vi = rsolve_vi(fullmdp, discount, nature);
+    auto rcsol_vi = rsolve_vi(cmdp, discount, nature);
+    CHECK_CLOSE_COLLECTION(rsol_vi.valuefunction, rcsol_vi.valuefunction, 1e-8);
+    auto rcsol_ppi = rsolve_ppi(cmdp, discount, nature);
+    BOOST_CHECK(rcsol_ppi.status == 0);
+    CHECK_CLOSE_COLLECTION(rsol_vi.valuefunction, rcsol_ppi.valuefunction, 0.1);
+
+    // the same model with outcomes
+    MDPO mdpo = robustify(fullmdp);
+    const CompiledMDPO cmdpo(mdpo);
+    BOOST_CHECK_EQUAL(cmdpo.outcome_count(), 6);
+    auto csol_o = rsolve_vi(cmdpo, discount, algorithms::nats::average());
+    CHECK_CLOSE_COLLECTION(sol_vi.valuefunction, csol_o.valuefunction, 1e-8);
+    auto csol_oppi = rsolve_ppi(cmdpo, discount, algorithms::nats::robust_unbounded());
+    auto sol_oppi = rsolve_ppi(mdpo, discount, algorithms::nats::robust_unbounded());
+    CHECK_CLOSE_COLLECTION(sol_oppi.valuefunction, csol_oppi.valuefunction, 0.1);
+
+    // invalid models are rejected when compiled
+    MDP badmdp(1);
+    badmdp.create_state(0).create_action(0);
+    BOOST_CHECK_THROW(CompiledMDP{badmdp}, ModelError);
+}
+
+/// Hides the flat policy of a response, so that the iteration methods store the
+/// policy in a vector
+template <class Response> class VectorPolicyResponse {
+protected:
+    const Response& response;
+
+public:
+    using policy_type = typename Response::policy_type;
+
+    VectorPolicyResponse(const Response& response) : response(response) {}
+    size_t state_count() const { return response.state_count(); }
+    pair<prec_t, policy_type> policy_update(long stateid, const numvec& valuefunction,
+                                            prec_t discount) const {
+        return response.policy_update(stateid, valuefunction, discount);
+    }
+    prec_t compute_value(const policy_type& policy, long stateid,
+                         const numvec& valuefunction, prec_t discount) const {
+        return response.compute_value(policy, stateid, valuefunction, discount);
+    }
+};
+
+template <class Policy>
+void check_policies_equal(const vector<Policy>& policy1, const vector<Policy>& policy2) {
+    BOOST_REQUIRE_EQUAL(policy1.size(), policy2.size());
+    for (size_t s = 0; s < policy1.size(); s++) {
+        BOOST_CHECK_EQUAL(policy1[s].first, policy2[s].first);
+        BOOST_CHECK_EQUAL_COLLECTIONS(
+            policy1[s].second.cbegin(), policy1[s].second.cend(),
+            policy2[s].second.cbegin(), policy2[s].second.cend());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flat_robust_policy) {
+    FlatSARobustPolicy policy(sizvec{2, 0, 3});
+    BOOST_CHECK_EQUAL(policy.size(), 3);
+    BOOST_CHECK_EQUAL(policy.capacity(2), 3);
+    policy.set(0, 1, numvec{0.25, 0.75});
+    policy.set(2, 0, numvec{1.0});
+    policy.set(1, -1, numvec(0));
+    BOOST_CHECK_THROW(policy.set(1, 0, numvec{1.0}), invalid_argument);
+    const auto converted = policy.to_policy();
+    check_policies_equal(converted, vector<pair<long, numvec>>{
+                                        {1, {0.25, 0.75}}, {-1, {}}, {0, {1.0}}});
+
+    using algorithms::internal::has_flat_policy;
+    static_assert(has_flat_policy<SARobustBellman<>>::value);
+    static_assert(has_flat_policy<SARobustOutcomeBellmanCompiled<>>::value);
+    static_assert(!has_flat_policy<PlainBellman>::value);
+    static_assert(!has_flat_policy<SRobustBellman>::value);
+
+    // a random model with several transitions per action and a terminal state
+    std::default_random_engine gen(7);
+    std::uniform_int_distribution<long> target(0, 19);
+    std::uniform_real_distribution<prec_t> dst(0.0, 1.0);
+    MDP mdp(20);
+    for (long s = 0; s < 19; s++) {
+        for (long a = 0; a < 3; a++) {
+            for (long i = 0; i < 4; i++)
+                add_transition(mdp, s, a, target(gen), dst(gen), dst(gen));
+        }
+    }
+    mdp.normalize();
+    const double discount = 0.9;
+    const auto nature = algorithms::nats::robust_l1u(0.5);
+
+    // the flat policy computes the same solutions as the vector of policies
+    const SARobustBellman<decltype(nature)> bellman(mdp, nature);
+    const VectorPolicyResponse vector_bellman(bellman);
+    const auto flat_vi = vi_gs(bellman, discount);
+    const auto vector_vi = vi_gs(vector_bellman, discount);
+    BOOST_CHECK_EQUAL_COLLECTIONS(flat_vi.valuefunction.cbegin(),
+                                  flat_vi.valuefunction.cend(),
+                                  vector_vi.valuefunction.cbegin(),
+                                  vector_vi.valuefunction.cend());
+    check_policies_equal(flat_vi.policy, vector_vi.policy);
+    BOOST_CHECK_EQUAL(flat_vi.policy[19].first, -1);
+
+    const auto flat_mpi = mpi_jac(bellman, discount);
+    const auto vector_mpi = mpi_jac(vector_bellman, discount);
+    BOOST_CHECK_EQUAL_COLLECTIONS(flat_mpi.valuefunction.cbegin(),
+                                  flat_mpi.valuefunction.cend(),
+                                  vector_mpi.valuefunction.cbegin(),
+                                  vector_mpi.valuefunction.cend());
+    check_policies_equal(flat_mpi.policy, vector_mpi.policy);
+
+    // compiled models and models with outcomes
+    const CompiledMDP cmdp(mdp);
+    const SARobustBellmanCompiled<decltype(nature)> cbellman(cmdp, nature);
+    const auto cflat_mpi = mpi_jac(cbellman, discount);
+    const auto cvector_mpi = mpi_jac(VectorPolicyResponse(cbellman), discount);
+    CHECK_CLOSE_COLLECTION(cflat_mpi.valuefunction, cvector_mpi.valuefunction, 1e-8);
+    check_policies_equal(cflat_mpi.policy, cvector_mpi.policy);
+
+    const MDPO mdpo = robustify(mdp);
+    const CompiledMDPO cmdpo(mdpo);
+    const auto onature = algorithms::nats::robust_unbounded();
+    const SARobustOutcomeBellman obellman(mdpo, onature);
+    const SARobustOutcomeBellmanCompiled cobellman(cmdpo, onature);
+    const auto oflat_vi = vi_gs(obellman, discount);
+    const auto ovector_vi = vi_gs(VectorPolicyResponse(obellman), discount);
+    CHECK_CLOSE_COLLECTION(oflat_vi.valuefunction, ovector_vi.valuefunction, 1e-8);
+    check_policies_equal(oflat_vi.policy, ovector_vi.policy);
+    const auto coflat_vi = vi_gs(cobellman, discount);
+    CHECK_CLOSE_COLLECTION(oflat_vi.valuefunction, coflat_vi.valuefunction, 1e-8);
+    check_policies_equal(oflat_vi.policy, coflat_vi.policy);
+
+    // robust partial policy iteration returns the full policy
+    const auto rppi_sol = rppi(bellman, discount);
+    BOOST_CHECK(rppi_sol.status == 0);
+    CHECK_CLOSE_COLLECTION(rppi_sol.valuefunction, flat_vi.valuefunction, 0.1);
+    BOOST_CHECK_EQUAL(rppi_sol.policy.size(), mdp.size());
+    for (size_t s = 0; s < 19; s++)
+        BOOST_CHECK_EQUAL(rppi_sol.policy[s].second.size(),
+                          mdp[s][rppi_sol.policy[s].first].size());
+}
+
+BOOST_AUTO_TEST_CASE(shared_support_mdpo) {
+    // posterior-like samples: all outcomes share the support, except for one
+    std::default_random_engine gen(3);
+    std::uniform_real_distribution<prec_t> dst(0.0, 1.0);
+    const long nstates = 30, nactions = 3, noutcomes = 20;
+    MDPO mdpo;
+    for (long s = 0; s < nstates; s++) {
+        for (long a = 0; a < nactions; a++) {
+            ActionO& action = mdpo.create_state(s).create_action(a);
+            for (long o = 0; o < noutcomes; o++) {
+                Transition& t = action.create_outcome(o);
+                for (long k = 0; k < 4; k++) {
+                    if (o == 0 && k == 2) continue;
+                    const long to = (s + k * (a + 1)) % nstates;
+                    mdpo.create_state(to);
+                    t.add_sample(to, dst(gen), dst(gen));
+                }
+                t.normalize();
+            }
+        }
+    }
+    const prec_t discount = 0.9;
+    const CompiledMDPO cmdpo(mdpo);
+    const SharedSupportMDPO smdpo(mdpo);
+    BOOST_CHECK_EQUAL(smdpo.outcome_count(), cmdpo.outcome_count());
+    BOOST_CHECK_EQUAL(smdpo.matrix_size(), cmdpo.transition_count() + nstates * nactions);
+
+    numvec valuefunction(nstates);
+    for (auto& v : valuefunction)
+        v = dst(gen);
+    numvec z1, z2;
+    for (size_t sa = 0; sa < smdpo.stateaction_count(); sa++) {
+        cmdpo.zvalues(sa, valuefunction, discount, z1);
+        smdpo.zvalues(sa, valuefunction, discount, z2);
+        CHECK_CLOSE_COLLECTION(z1, z2, 1e-8);
+        BOOST_CHECK_CLOSE(cmdpo.mean_reward(sa), smdpo.mean_reward(sa), 1e-8);
+        BOOST_CHECK_CLOSE(cmdpo.transition(sa).value(valuefunction),
+                          smdpo.transition(sa).value(valuefunction), 1e-8);
+    }
+
+    auto nature = algorithms::nats::robust_l1u(0.3);
+    auto sol = rsolve_vi(mdpo, discount, nature);
+    auto ssol = rsolve_vi(smdpo, discount, nature);
+    BOOST_CHECK_EQUAL(ssol.status, 0);
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, ssol.valuefunction, 1e-6);
+    auto ssol_ppi = rsolve_ppi(smdpo, discount, nature);
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, ssol_ppi.valuefunction, 0.1);
+
+    // s-rectangular nature: the best action for the nominal distribution
+    algorithms::SNatureOutcome nature_s = [](long, const numvec&, const numvec& nominal,
+                                             const numvecvec& zvalues) {
+        numvec policy(zvalues.size(), 0.0);
+        prec_t best = -numeric_limits<prec_t>::infinity();
+        size_t besta = 0;
+        for (size_t a = 0; a < zvalues.size(); a++) {
+            const prec_t value =
+                inner_product(nominal.cbegin(), nominal.cend(), zvalues[a].cbegin(), 0.0);
+            if (value > best) {
+                best = value;
+                besta = a;
+            }
+        }
+        policy[besta] = 1.0;
+        return make_tuple(policy, nominal, best);
+    };
+    auto sol_s = rsolve_s_vi(mdpo, discount, nature_s);
+    auto csol_s = rsolve_s_vi(cmdpo, discount, nature_s);
+    auto ssol_s = rsolve_s_vi(smdpo, discount, nature_s);
+    CHECK_CLOSE_COLLECTION(sol_s.valuefunction, csol_s.valuefunction, 1e-6);
+    CHECK_CLOSE_COLLECTION(sol_s.valuefunction, ssol_s.valuefunction, 1e-6);
+    auto ssol_sppi = rsolve_s_ppi(smdpo, discount, nature_s);
+    CHECK_CLOSE_COLLECTION(sol_s.valuefunction, ssol_sppi.valuefunction, 0.1);
+}
+
+BOOST_AUTO_TEST_CASE(batched_outcome_evaluation) {
+    std::default_random_engine gen(5);
+    std::uniform_real_distribution<prec_t> dst(0.0, 1.0);
+    const long nstates = 25, nactions = 3, noutcomes = 7;
+    MDPO mdpo;
+    for (long s = 0; s < nstates - 1; s++) {
+        for (long a = 0; a < nactions; a++) {
+            ActionO& action = mdpo.create_state(s).create_action(a);
+            for (long o = 0; o < noutcomes; o++) {
+                Transition& t = action.create_outcome(o);
+                for (long k = 0; k < 3; k++) {
+                    if (o == 1 && k == 0) continue;
+                    const long to = (s + k * (a + 2)) % nstates;
+                    t.add_sample(to, dst(gen), dst(gen));
+                }
+                t.normalize();
+            }
+        }
+    }
+    // the last state is terminal
+    mdpo.create_state(nstates - 1);
+    const prec_t discount = 0.9;
+
+    numvecvec rpolicy(nstates);
+    for (long s = 0; s < nstates - 1; s++) {
+        rpolicy[s] = {dst(gen), dst(gen), dst(gen)};
+        const prec_t sum = accumulate(rpolicy[s].cbegin(), rpolicy[s].cend(), 0.0);
+        for (auto& p : rpolicy[s])
+            p /= sum;
+    }
+
+    const auto result =
+        algorithms::evaluate_outcomes(mdpo, rpolicy, discount, MAXITER, 1e-10);
+    const numvecvec& values = result.valuefunctions;
+    BOOST_CHECK_EQUAL(values.size(), noutcomes);
+    BOOST_CHECK_EQUAL(result.status, 0);
+    BOOST_CHECK_EQUAL(result.residuals.size(), noutcomes);
+    for (prec_t residual : result.residuals)
+        BOOST_CHECK_LE(residual, 1e-10);
+
+    // compare with evaluating the policy separately in each outcome
+    vector<MDP> mdps(noutcomes);
+    for (long o = 0; o < noutcomes; o++) {
+        for (long s = 0; s < nstates; s++) {
+            mdps[o].create_state(s);
+            for (long a = 0; a < long(mdpo[s].size()); a++)
+                mdps[o].create_state(s).create_action(a) = mdpo[s][a][o];
+        }
+        const auto sol = solve_pi_r(mdps[o], discount, numvec(0), rpolicy);
+        CHECK_CLOSE_COLLECTION(values[o], sol.valuefunction, 1e-6);
+    }
+
+    // a deterministic policy
+    indvec dpolicy(nstates, 1);
+    dpolicy.back() = -1;
+    const numvecvec dvalues =
+        algorithms::evaluate_outcomes(SharedSupportMDPO(mdpo), dpolicy, discount, MAXITER,
+                                      1e-10)
+            .valuefunctions;
+    const auto dsol = solve_pi(mdps[2], discount, numvec(0), dpolicy);
+    CHECK_CLOSE_COLLECTION(dvalues[2], dsol.valuefunction, 1e-6);
+
+    // the Bellman operator applied to all value functions in one pass
+    numvec matrix(nstates * noutcomes);
+    for (long s = 0; s < nstates; s++)
+        for (long k = 0; k < noutcomes; k++)
+            matrix[s * noutcomes + k] = values[k][s];
+    const numvec updated =
+        algorithms::bellman_batch(mdps[0], rpolicy, matrix, noutcomes, discount);
+    for (long s = 0; s < nstates - 1; s++) {
+        for (long k = 0; k < noutcomes; k++) {
+            prec_t expected = 0;
+            for (long a = 0; a < nactions; a++)
+                expected += rpolicy[s][a] * mdps[0][s][a].value(values[k], discount);
+            BOOST_CHECK_CLOSE(updated[s * noutcomes + k], expected, 1e-8);
+        }
+    }
+    BOOST_CHECK_EQUAL(updated[(nstates - 1) * noutcomes], 0.0);
+
+    // the residuals are reported when the iteration limit is reached
+    const auto limited = algorithms::evaluate_outcomes(mdpo, rpolicy, discount, 3, 1e-10);
+    BOOST_CHECK_EQUAL(limited.status, 1);
+    BOOST_CHECK_EQUAL(limited.iterations, 3);
+    for (prec_t residual : limited.residuals)
+        BOOST_CHECK_GT(residual, 1e-10);
+
+    // outcome counts must agree
+    mdpo[0][0].create_outcome(noutcomes).add_sample(0, 1.0, 0.0);
+    mdpo[0][0].normalize_distribution();
+    BOOST_CHECK_THROW(algorithms::evaluate_outcomes(mdpo, rpolicy, discount),
+                      invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(anderson_acceleration) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    const MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.99;
+    const size_t depth = 5;
+
+    const auto optimal = solve_pi(mdp, discount);
+
+    // Gauss-Seidel value iteration
+    const auto vi_plain = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8);
+    const auto vi_anderson =
+        solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                 algorithms::internal::empty_progress, algorithms::VISolver::gs, depth);
+    BOOST_CHECK_EQUAL(vi_anderson.status, 0);
+    CHECK_CLOSE_COLLECTION(vi_anderson.valuefunction, optimal.valuefunction, 1e-4);
+    BOOST_CHECK_LT(vi_anderson.iterations, vi_plain.iterations);
+    BOOST_CHECK_THROW(solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                               algorithms::internal::empty_progress,
+                               algorithms::VISolver::prioritized, depth),
+                      invalid_argument);
+
+    // Jacobi value iteration and the policy evaluation in modified policy iteration
+    const auto jac_plain =
+        solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8, 0, 0.9);
+    const auto jac_anderson =
+        solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8, 0, 0.9,
+                  algorithms::internal::empty_progress, depth);
+    BOOST_CHECK_EQUAL(jac_anderson.status, 0);
+    CHECK_CLOSE_COLLECTION(jac_anderson.valuefunction, optimal.valuefunction, 1e-4);
+    BOOST_CHECK_LT(jac_anderson.iterations, jac_plain.iterations);
+    const auto mpi_anderson =
+        solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8, MAXITER, 0.1,
+                  algorithms::internal::empty_progress, depth);
+    BOOST_CHECK_EQUAL(mpi_anderson.status, 0);
+    CHECK_CLOSE_COLLECTION(mpi_anderson.valuefunction, optimal.valuefunction, 1e-4);
+
+    // the robust Bellman operator is not smooth
+    const auto nature = algorithms::nats::robust_l1u(0.5);
+    const auto robust = rsolve_ppi(mdp, discount, nature, numvec(0), indvec(0), MAXITER,
+                                   1e-8);
+    const auto rvi = rsolve_vi(mdp, discount, nature, numvec(0), indvec(0), MAXITER,
+                               1e-8, algorithms::internal::empty_progress,
+                               algorithms::VISolver::gs, depth);
+    BOOST_CHECK_EQUAL(rvi.status, 0);
+    CHECK_CLOSE_COLLECTION(rvi.valuefunction, robust.valuefunction, 1e-4);
+    const auto rmppi = rsolve_mppi(mdp, discount, nature, numvec(0), indvec(0), MAXITER,
+                                   1e-8, algorithms::internal::empty_progress, depth);
+    BOOST_CHECK_EQUAL(rmppi.status, 0);
+    CHECK_CLOSE_COLLECTION(rmppi.valuefunction, robust.valuefunction, 1e-4);
+    const auto rvppi = rsolve_vppi(mdp, discount, nature, numvec(0), indvec(0), MAXITER,
+                                   1e-8, algorithms::internal::empty_progress, depth);
+    BOOST_CHECK_EQUAL(rvppi.status, 0);
+    CHECK_CLOSE_COLLECTION(rvppi.valuefunction, robust.valuefunction, 1e-4);
+
+    // outcomes of an MDPO with the average nature are the same as the MDP
+    const MDPO mdpo = robustify(mdp);
+    const auto ovi = rsolve_vi(mdpo, discount, algorithms::nats::average(), numvec(0),
+                               indvec(0), MAXITER, 1e-8,
+                               algorithms::internal::empty_progress,
+                               algorithms::VISolver::gs, depth);
+    BOOST_CHECK_EQUAL(ovi.status, 0);
+    CHECK_CLOSE_COLLECTION(ovi.valuefunction, optimal.valuefunction, 1e-4);
+    const auto omppi = rsolve_mppi(mdpo, discount, algorithms::nats::average(),
+                                   numvec(0), indvec(0), MAXITER, 1e-8,
+                                   algorithms::internal::empty_progress, depth);
+    BOOST_CHECK_EQUAL(omppi.status, 0);
+    CHECK_CLOSE_COLLECTION(omppi.valuefunction, optimal.valuefunction, 1e-4);
+    const auto cvi = rsolve_vi(CompiledMDPO(mdpo), discount, algorithms::nats::average(),
+                               numvec(0), indvec(0), MAXITER, 1e-8,
+                               algorithms::internal::empty_progress,
+                               algorithms::VISolver::gs, depth);
+    BOOST_CHECK_EQUAL(cvi.status, 0);
+    CHECK_CLOSE_COLLECTION(cvi.valuefunction, optimal.valuefunction, 1e-4);
+
+    // an accelerated iterate that increases the residual is rejected
+    algorithms::AndersonAcceleration accelerator(2, 0.5);
+    numvec x{1.0, 1.0}, f{0.5, 0.5};
+    accelerator.step(x, f, 0.5);
+    BOOST_CHECK_EQUAL(accelerator.rejected(), 0);
+    x = f;
+    f = {0.25, 0.25};
+    accelerator.step(x, f, 0.25);
+    // a linear map, so the combination is the fixed point
+    BOOST_CHECK_SMALL(f[0], 1e-8);
+    x = f;
+    f = {1.0, 1.0};
+    accelerator.step(x, f, 1.0);
+    BOOST_CHECK_EQUAL(accelerator.rejected(), 1);
+    BOOST_CHECK_CLOSE(f[0], 0.25, 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(span_bounds_elimination) {
+    // a random MDP with many actions and no terminal states
+    const long nstates = 40, nactions = 20;
+    std::default_random_engine gen(1);
+    std::uniform_real_distribution<prec_t> unif(0.0, 1.0);
+    std::uniform_int_distribution<long> target(0, nstates - 1);
+    MDP mdp(nstates);
+    for (long s = 0; s < nstates; s++) {
+        for (long a = 0; a < nactions; a++) {
+            for (int j = 0; j < 4; j++)
+                add_transition(mdp, s, a, target(gen), unif(gen) + 0.01, unif(gen));
+            mdp[s][a].normalize();
+        }
+    }
+    const prec_t discount = 0.95;
+    const auto optimal = solve_pi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-10);
+
+    // the half-span is at most the sup norm, so the iteration stops earlier
+    const auto jac_sup =
+        solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-6, 0, 0.9);
+    const auto jac_span = solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-6, 0,
+                                    0.9, algorithms::internal::empty_progress, 0,
+                                    algorithms::ValueBounds::span);
+    BOOST_CHECK_EQUAL(jac_span.status, 0);
+    BOOST_CHECK_LT(jac_span.iterations, jac_sup.iterations);
+    CHECK_CLOSE_COLLECTION(jac_span.valuefunction, optimal.valuefunction, 1e-3);
+    BOOST_CHECK(jac_span.policy == optimal.policy);
+
+    // eliminated actions are never optimal
+    algorithms::PlainBellman response(mdp);
+    const auto jac_elim = algorithms::mpi_jac(
+        response, discount, numvec(0), MAXITER, 1e-6, 0, 0.9,
+        algorithms::internal::empty_progress, 0, algorithms::ValueBounds::eliminate);
+    BOOST_CHECK_EQUAL(jac_elim.status, 0);
+    BOOST_CHECK_GT(response.eliminated_count(), 0);
+    BOOST_CHECK_LT(response.eliminated_count(), size_t(nstates * (nactions - 1) + 1));
+    CHECK_CLOSE_COLLECTION(jac_elim.valuefunction, optimal.valuefunction, 1e-3);
+    BOOST_CHECK(jac_elim.policy == optimal.policy);
+    response.restore_actions();
+    BOOST_CHECK_EQUAL(response.eliminated_count(), 0);
+
+    const auto mpi_elim = solve_mpi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-6,
+                                    MAXITER, 0.9, algorithms::internal::empty_progress,
+                                    0, algorithms::ValueBounds::eliminate);
+    CHECK_CLOSE_COLLECTION(mpi_elim.valuefunction, optimal.valuefunction, 1e-3);
+    const auto pi_elim = solve_pi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                                  algorithms::internal::empty_progress,
+                                  algorithms::LinearSolver::sparse_lu,
+                                  algorithms::ValueBounds::eliminate);
+    CHECK_CLOSE_COLLECTION(pi_elim.valuefunction, optimal.valuefunction, 1e-4);
+    BOOST_CHECK(pi_elim.policy == optimal.policy);
+
+    // robust Bellman operators are also monotone and shift the values by the discount
+    const auto nature = algorithms::nats::robust_l1u(0.3);
+    const auto robust = rsolve_ppi(mdp, discount, nature, numvec(0), indvec(0), MAXITER,
+                                   1e-10);
+    algorithms::SARobustBellman<algorithms::nats::robust_l1u> rresponse(mdp, nature);
+    const auto rjac_elim = algorithms::mpi_jac(
+        rresponse, discount, numvec(0), MAXITER, 1e-6, 0, 0.9,
+        algorithms::internal::empty_progress, 0, algorithms::ValueBounds::eliminate);
+    BOOST_CHECK_GT(rresponse.eliminated_count(), 0);
+    CHECK_CLOSE_COLLECTION(rjac_elim.valuefunction, robust.valuefunction, 1e-3);
+    for (long s = 0; s < nstates; s++)
+        BOOST_CHECK_EQUAL(rjac_elim.policy[s].first, robust.policy[s].first);
+    const auto rmppi_elim = rsolve_mppi(mdp, discount, nature, numvec(0), indvec(0),
+                                        MAXITER, 1e-8, algorithms::internal::empty_progress,
+                                        0, algorithms::ValueBounds::eliminate);
+    BOOST_CHECK_EQUAL(rmppi_elim.status, 0);
+    CHECK_CLOSE_COLLECTION(rmppi_elim.valuefunction, robust.valuefunction, 1e-4);
+
+    // the bounds need a discount smaller than 1, no terminal states, and the
+    // elimination needs a response that supports it
+    const CompiledMDP cmdp(mdp);
+    BOOST_CHECK_THROW(solve_mpi(mdp, 1.0, numvec(0), indvec(0), 10, 1e-6, 0, 0.9,
+                                algorithms::internal::empty_progress, 0,
+                                algorithms::ValueBounds::span),
+                      invalid_argument);
+    BOOST_CHECK_THROW(algorithms::mpi_jac(algorithms::PlainBellmanCompiled<>(cmdp),
+                                          discount, numvec(0), MAXITER, 1e-6, 0, 0.9,
+                                          algorithms::internal::empty_progress, 0,
+                                          algorithms::ValueBounds::eliminate),
+                      invalid_argument);
+    MDP terminal = mdp;
+    terminal.create_state(nstates);
+    BOOST_CHECK_THROW(solve_pi(terminal, discount, numvec(0), indvec(0), MAXITER, 1e-6,
+                               algorithms::internal::empty_progress,
+                               algorithms::LinearSolver::sparse_lu,
+                               algorithms::ValueBounds::span),
+                      ModelError);
+}
+
+BOOST_AUTO_TEST_CASE(solver_trace) {
+    algorithms::SolverTrace trace;
+    trace.add_iteration({"mpi_jac", 0, 0.5, 0.0, 1e-3, 2e-3, 4, 1e-4, -1});
+    trace.add_event({"mpi_jac", algorithms::TracePhase::update, 0, 0.0, 1e-3});
+    trace.add_nature_call(1000);
+    BOOST_CHECK_EQUAL(trace.get_iterations().size(), 1);
+    BOOST_CHECK_EQUAL(trace.nature_calls(), 1);
+    BOOST_CHECK_CLOSE(trace.nature_time(), 1e-6, 1e-6);
+
+    const string json = trace.to_json();
+    BOOST_CHECK(json.find("\"method\":\"mpi_jac\"") != string::npos);
+    BOOST_CHECK(json.find("\"residual\":0.5") != string::npos);
+    BOOST_CHECK(json.find("\"thread_states\":[") != string::npos);
+    const string chrome = trace.to_chrome_trace();
+    BOOST_CHECK(chrome.find("\"traceEvents\":[") != string::npos);
+    BOOST_CHECK(chrome.find("\"ph\":\"X\"") != string::npos);
+    BOOST_CHECK(chrome.find("\"ph\":\"C\"") != string::npos);
+
+#ifdef CRAAM_TRACE
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    const MDP mdp = mdp_from_csv(reader);
+
+    algorithms::SolverTrace mpi_trace;
+    DetermSolution sol;
+    {
+        algorithms::TraceScope scope(mpi_trace);
+        sol = solve_mpi(mdp, 0.9);
+    }
+    const auto records = mpi_trace.get_iterations();
+    BOOST_CHECK_EQUAL(records.size(), sol.iterations + 1);
+    BOOST_CHECK_EQUAL(records.front().method, "mpi_jac");
+    BOOST_CHECK_CLOSE(records.back().residual, sol.residual, 1e-6);
+    const sizvec loads = mpi_trace.thread_states();
+    BOOST_CHECK_GE(accumulate(loads.cbegin(), loads.cend(), size_t(0)), mdp.size());
+
+    // robust solvers count the calls of nature
+    algorithms::SolverTrace rppi_trace;
+    {
+        algorithms::TraceScope scope(rppi_trace);
+        rsolve_ppi(mdp, 0.9, algorithms::nats::robust_l1u(0.1));
+    }
+    BOOST_CHECK_GT(rppi_trace.nature_calls(), 0);
+    BOOST_CHECK(!rppi_trace.get_iterations().empty());
+
+    // nothing is recorded without an active trace
+    solve_mpi(mdp, 0.9);
+    BOOST_CHECK_EQUAL(mpi_trace.get_iterations().size(), records.size());
+
+    // the trace is not active in other threads
+    {
+        algorithms::TraceScope scope(mpi_trace);
+        std::thread other([&mdp]() { solve_mpi(mdp, 0.9); });
+        other.join();
+    }
+    BOOST_CHECK_EQUAL(mpi_trace.get_iterations().size(), records.size());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(binary_model_files) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.9;
+
+    const auto dir = std::filesystem::temp_directory_path();
+    const string mdpfile = (dir / "craam_test_mdp.bin").string();
+    const string mdpofile = (dir / "craam_test_mdpo.bin").string();
+
+    save_binary(mdp, mdpfile);
+    auto sol = solve_vi(mdp, discount);
+    {
+        // the model must remain valid after the loaded copy is destroyed
+        CompiledMDP loaded;
+        {
+            const CompiledMDP mapped = load_mdp_binary(mdpfile);
+            BOOST_CHECK(!mapped.get_indices().owns());
+            loaded = mapped;
+        }
+        BOOST_CHECK_EQUAL(loaded.size(), mdp.size());
+        auto lsol = solve_vi(loaded, discount);
+        CHECK_CLOSE_COLLECTION(sol.valuefunction, lsol.valuefunction, 1e-8);
+        BOOST_CHECK_EQUAL_COLLECTIONS(sol.policy.cbegin(), sol.policy.cend(),
+                                      lsol.policy.cbegin(), lsol.policy.cend());
+    }
+
+    MDPO mdpo = robustify(mdp);
+    save_binary(mdpo, mdpofile);
+    const CompiledMDPO mdpo_loaded = load_mdpo_binary(mdpofile);
+    BOOST_CHECK_EQUAL(mdpo_loaded.outcome_count(), CompiledMDPO(mdpo).outcome_count());
+    auto osol = rsolve_vi(mdpo_loaded, discount, algorithms::nats::average());
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, osol.valuefunction, 1e-8);
+
+    // a model of the other type is rejected
+    BOOST_CHECK_THROW(load_mdpo_binary(mdpfile), runtime_error);
+
+    // corrupt a single value, which is detected only with the checksum
+    {
+        fstream fs(mdpfile, ios::in | ios::out | ios::binary);
+        fs.seekp(-8, ios::end);
+        const prec_t corrupt = 12345.0;
+        fs.write(reinterpret_cast<const char*>(&corrupt), sizeof(prec_t));
+    }
+    BOOST_CHECK_THROW(load_mdp_binary(mdpfile), runtime_error);
+    BOOST_CHECK_NO_THROW(load_mdp_binary(mdpfile, false));
+
+    // a file in a different format
+    {
+        ofstream ofs(mdpfile);
+        ofs << "idstatefrom,idaction,idstateto,probability,reward" << endl;
+    }
+    BOOST_CHECK_THROW(load_mdp_binary(mdpfile), runtime_error);
+
+    // invalid target states and offsets have a valid checksum but are rejected
+    save_binary(CompiledMDP(sizvec{0, 1}, sizvec{0, 1}, vector<int64_t>{5},
+                            numvec{1.0}, numvec{0.0}),
+                mdpfile);
+    BOOST_CHECK_THROW(load_mdp_binary(mdpfile), runtime_error);
+    save_binary(CompiledMDP(sizvec{0, 2, 1}, sizvec{0, 1}, vector<int64_t>{0},
+                            numvec{1.0}, numvec{0.0}),
+                mdpfile);
+    BOOST_CHECK_THROW(load_mdp_binary(mdpfile), runtime_error);
+
+    std::filesystem::remove(mdpfile);
+    std::filesystem::remove(mdpofile);
+}
+
+BOOST_AUTO_TEST_CASE(single_precision_models) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.95;
+
+    // single precision storage agrees with double precision within the rounding
+    // of the probabilities and rewards
+    const CompiledMDP cmdp(mdp);
+    const CompiledMDPf fmdp(mdp);
+    BOOST_CHECK_EQUAL(fmdp.transition_count(), cmdp.transition_count());
+
+    auto sol = solve_vi(cmdp, discount);
+    auto fsol = solve_vi(fmdp, discount);
+    BOOST_CHECK(fsol.status == 0);
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, fsol.valuefunction, 1e-3);
+    auto fsol_mpi = solve_mpi(fmdp, discount);
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, fsol_mpi.valuefunction, 1e-2);
+    auto fsol_pi = solve_pi(fmdp, discount);
+    CHECK_CLOSE_COLLECTION(sol.valuefunction, fsol_pi.valuefunction, 1e-2);
+
+    const auto nature = algorithms::nats::robust_l1u(0.3);
+    auto rsol = rsolve_vi(cmdp, discount, nature);
+    auto frsol = rsolve_vi(fmdp, discount, nature);
+    CHECK_CLOSE_COLLECTION(rsol.valuefunction, frsol.valuefunction, 1e-3);
+    auto frsol_ppi = rsolve_ppi(fmdp, discount, nature);
+    CHECK_CLOSE_COLLECTION(rsol.valuefunction, frsol_ppi.valuefunction, 1e-2);
+
+    const MDPO mdpo = robustify(mdp);
+    const CompiledMDPO cmdpo(mdpo);
+    const CompiledMDPOf fmdpo(mdpo);
+    const auto onature = algorithms::nats::robust_unbounded();
+    auto osol = rsolve_vi(cmdpo, discount, onature);
+    auto fosol = rsolve_vi(fmdpo, discount, onature);
+    CHECK_CLOSE_COLLECTION(osol.valuefunction, fosol.valuefunction, 1e-3);
+
+    // binary files in single precision, the arrays of 4-byte values are padded
+    const auto dir = std::filesystem::temp_directory_path();
+    const string mdpfile = (dir / "craam_test_mdpf.bin").string();
+    const string mdpofile = (dir / "craam_test_mdpof.bin").string();
+    save_binary(mdp, mdpfile, true);
+    const CompiledMDPf fmdp_loaded = load_mdp_binary<float, int32_t>(mdpfile);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        fmdp_loaded.get_probabilities().cbegin(), fmdp_loaded.get_probabilities().cend(),
+        fmdp.get_probabilities().cbegin(), fmdp.get_probabilities().cend());
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        fmdp_loaded.get_indices().cbegin(), fmdp_loaded.get_indices().cend(),
+        fmdp.get_indices().cbegin(), fmdp.get_indices().cend());
+    auto lsol = solve_vi(fmdp_loaded, discount);
+    CHECK_CLOSE_COLLECTION(fsol.valuefunction, lsol.valuefunction, 1e-8);
+    // the precision must match the file
+    BOOST_CHECK_THROW(load_mdp_binary(mdpfile), runtime_error);
+
+    save_binary(mdpo, mdpofile, true);
+    const CompiledMDPOf fmdpo_loaded = load_mdpo_binary<float, int32_t>(mdpofile);
+    auto losol = rsolve_vi(fmdpo_loaded, discount, onature);
+    CHECK_CLOSE_COLLECTION(fosol.valuefunction, losol.valuefunction, 1e-8);
+
+    std::filesystem::remove(mdpfile);
+    std::filesystem::remove(mdpofile);
+
+    // the indices must fit the index type
+    BOOST_CHECK_THROW((BasicCompiledMDP<float, int8_t>(MDP(200))), ModelError);
+}
+
+BOOST_AUTO_TEST_CASE(policy_evaluation_linear_solvers) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.95;
+
+    const auto& noprogress = algorithms::internal::empty_progress;
+
+    auto sol_dense = solve_pi(mdp, discount, numvec(0), indvec(0), MAXITER, SOLPREC,
+                              noprogress, LinearSolver::dense_lu);
+    auto sol_sparse = solve_pi(mdp, discount, numvec(0), indvec(0), MAXITER, SOLPREC,
+                               noprogress, LinearSolver::sparse_lu);
+    auto sol_bicg = solve_pi(mdp, discount, numvec(0), indvec(0), MAXITER, SOLPREC,
+                             noprogress, LinearSolver::bicgstab);
+    CHECK_CLOSE_COLLECTION(sol_dense.valuefunction, sol_sparse.valuefunction, 1e-6);
+    CHECK_CLOSE_COLLECTION(sol_dense.valuefunction, sol_bicg.valuefunction, 1e-4);
+
+    // the value function of the optimal policy is a fixed point
+    auto vf_qr = valuefunction_mat(PlainBellman(mdp), discount, sol_dense.policy,
+                                   LinearSolver::dense_qr);
+    CHECK_CLOSE_COLLECTION(sol_dense.valuefunction, vf_qr, 1e-6);
+
+    // occupancy frequencies are the same for all solvers
+    Transition initial;
+    for (size_t s = 0; s < mdp.size(); s++)
+        initial.add_sample(s, 1.0 / mdp.size(), 0.0);
+    auto occ_qr =
+        occupancies(mdp, initial, discount, sol_dense.policy, LinearSolver::dense_qr);
+    auto occ_sparse =
+        occupancies(mdp, initial, discount, sol_dense.policy, LinearSolver::sparse_lu);
+    auto occ_bicg =
+        occupancies(mdp, initial, discount, sol_dense.policy, LinearSolver::bicgstab);
+    CHECK_CLOSE_COLLECTION(occ_qr, occ_sparse, 1e-6);
+    CHECK_CLOSE_COLLECTION(occ_qr, occ_bicg, 1e-4);
+
+    // the total return computed from the occupancy frequencies matches the value
+    auto rewards = rewards_vec(PlainBellman(mdp), sol_dense.policy);
+    BOOST_CHECK_CLOSE(
+        inner_product(rewards.cbegin(), rewards.cend(), occ_sparse.cbegin(), 0.0),
+        sol_dense.total_return(initial), 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(async_value_iteration) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.95;
+
+    const auto& noprogress = algorithms::internal::empty_progress;
+
+    auto sol_gs = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8);
+    auto sol_async = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                              noprogress, VISolver::gs_async);
+    BOOST_CHECK_EQUAL(sol_async.status, 0);
+    BOOST_CHECK_LE(sol_async.residual, 1e-8);
+    CHECK_CLOSE_COLLECTION(sol_gs.valuefunction, sol_async.valuefunction, 1e-4);
+
+    // the reported residual is the Bellman residual of the returned solution
+    auto sol_check = solve_vi(mdp, discount, sol_async.valuefunction, indvec(0), 1);
+    BOOST_CHECK_LE(sol_check.residual, discount * 1e-8);
+
+    // robust objectives
+    auto rsol_gs = rsolve_vi(mdp, discount, nats::robust_l1u(0.5), numvec(0),
+                             indvec(0), MAXITER, 1e-8);
+    auto rsol_async = rsolve_vi(mdp, discount, nats::robust_l1u(0.5), numvec(0),
+                                indvec(0), MAXITER, 1e-8, noprogress,
+                                VISolver::gs_async);
+    CHECK_CLOSE_COLLECTION(rsol_gs.valuefunction, rsol_async.valuefunction, 1e-4);
+
+    auto ssol_gs = rsolve_s_vi(mdp, discount, nats::robust_s_l1u(0.5), numvec(0),
+                               indvec(0), MAXITER, 1e-8);
+    auto ssol_async = rsolve_s_vi(mdp, discount, nats::robust_s_l1u(0.5), numvec(0),
+                                  indvec(0), MAXITER, 1e-8, noprogress,
+                                  VISolver::gs_async);
+    CHECK_CLOSE_COLLECTION(ssol_gs.valuefunction, ssol_async.valuefunction, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(prioritized_value_iteration) {
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.95;
+
+    const auto& noprogress = algorithms::internal::empty_progress;
+
+    // the reverse graph
+    auto predecessors = state_predecessors(state_successors(mdp));
+    for (size_t s = 0; s < mdp.size(); s++)
+        for (const auto& action : mdp[s].get_actions())
+            for (long t : action.get_indices())
+                BOOST_CHECK(std::binary_search(predecessors[t].cbegin(),
+                                               predecessors[t].cend(), long(s)));
+
+    auto sol_gs = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8);
+    auto sol_pr = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                           noprogress, VISolver::prioritized);
+    BOOST_CHECK_EQUAL(sol_pr.status, 0);
+    BOOST_CHECK_LE(sol_pr.residual, 1e-8);
+    CHECK_CLOSE_COLLECTION(sol_gs.valuefunction, sol_pr.valuefunction, 1e-4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(sol_gs.policy.cbegin(), sol_gs.policy.cend(),
+                                  sol_pr.policy.cbegin(), sol_pr.policy.cend());
+
+    // the reported residual is the Bellman residual of the returned solution
+    auto sol_check = solve_vi(mdp, discount, sol_pr.valuefunction, indvec(0), 1);
+    BOOST_CHECK_LE(sol_check.residual, 1e-8);
+
+    // the compiled model and robust objectives
+    auto sol_cmp = solve_vi(CompiledMDP(mdp), discount, numvec(0), indvec(0), MAXITER,
+                            1e-8, noprogress, VISolver::prioritized);
+    CHECK_CLOSE_COLLECTION(sol_gs.valuefunction, sol_cmp.valuefunction, 1e-4);
+
+    auto rsol_gs = rsolve_vi(mdp, discount, nats::robust_l1u(0.5), numvec(0),
+                             indvec(0), MAXITER, 1e-8);
+    auto rsol_pr = rsolve_vi(mdp, discount, nats::robust_l1u(0.5), numvec(0),
+                             indvec(0), MAXITER, 1e-8, noprogress,
+                             VISolver::prioritized);
+    CHECK_CLOSE_COLLECTION(rsol_gs.valuefunction, rsol_pr.valuefunction, 1e-4);
+
+    auto ssol_gs = rsolve_s_vi(mdp, discount, nats::robust_s_l1u(0.5), numvec(0),
+                               indvec(0), MAXITER, 1e-8);
+    auto ssol_pr = rsolve_s_vi(mdp, discount, nats::robust_s_l1u(0.5), numvec(0),
+                               indvec(0), MAXITER, 1e-8, noprogress,
+                               VISolver::prioritized);
+    CHECK_CLOSE_COLLECTION(ssol_gs.valuefunction, ssol_pr.valuefunction, 1e-4);
+
+    // the iteration limit is respected
+    auto sol_lim = solve_vi(mdp, discount, numvec(0), indvec(0), 1, 1e-8, noprogress,
+                            VISolver::prioritized);
+    BOOST_CHECK_EQUAL(sol_lim.status, 1);
+    BOOST_CHECK_EQUAL(sol_lim.iterations, 1);
+}
+
+BOOST_AUTO_TEST_CASE(topological_value_iteration) {
+    const auto& noprogress = algorithms::internal::empty_progress;
+
+    // components: {0,1} -> {2} -> {3} with a self-loop, {4} -> {2}
+    vector<indvec> graph{{1, 2}, {0}, {3}, {3}, {2}};
+    auto components = state_components(graph);
+    BOOST_CHECK_EQUAL(components[0], components[1]);
+    BOOST_CHECK_LT(components[3], components[2]);
+    BOOST_CHECK_LT(components[2], components[0]);
+    BOOST_CHECK_LT(components[2], components[4]);
+    BOOST_CHECK_NE(components[0], components[4]);
+
+    // a finite-horizon chain is solved in a single sweep even when the states
+    // are in the wrong order
+    const long horizon = 200;
+    MDP chain;
+    for (long s = 0; s < horizon; s++) {
+        add_transition(chain, s, 0, s + 1, 1.0, 1.0);
+        add_transition(chain, s, 1, s + 1, 0.5, 3.0);
+        add_transition(chain, s, 1, horizon, 0.5, 0.0);
+    }
+    auto sol_gs = solve_vi(chain, 1.0, numvec(0), indvec(0), MAXITER, 1e-8);
+    auto sol_top = solve_vi(chain, 1.0, numvec(0), indvec(0), MAXITER, 1e-8,
+                            noprogress, VISolver::topological);
+    BOOST_CHECK_GT(sol_gs.iterations, 100);
+    BOOST_CHECK_EQUAL(sol_top.iterations, 1);
+    BOOST_CHECK_EQUAL(sol_top.status, 0);
+    CHECK_CLOSE_COLLECTION(sol_gs.valuefunction, sol_top.valuefunction, 1e-6);
+
+    // a model with cycles
+    std::stringstream mdp_stream(mdp_cartpole_str);
+    io::CSVReader<5> reader("nofile", mdp_stream);
+    craam::MDP mdp = mdp_from_csv(reader);
+    const prec_t discount = 0.95;
+
+    auto cpol_gs = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8);
+    auto cpol_top = solve_vi(mdp, discount, numvec(0), indvec(0), MAXITER, 1e-8,
+                             noprogress, VISolver::topological);
+    BOOST_CHECK_EQUAL(cpol_top.status, 0);
+    CHECK_CLOSE_COLLECTION(cpol_gs.valuefunction, cpol_top.valuefunction, 1e-4);
+
+    auto rsol_gs = rsolve_vi(robustify(mdp), discount, nats::robust_l1u(0.5),
+                             numvec(0), indvec(0), MAXITER, 1e-8);
+    auto rsol_top = rsolve_vi(robustify(mdp), discount, nats::robust_l1u(0.5),
+                              numvec(0), indvec(0), MAXITER, 1e-8, noprogress,
+                              VISolver::topological);
+    CHECK_CLOSE_COLLECTION(rsol_gs.valuefunction, rsol_top.valuefunction, 1e-4);
+}
+
 BOOST_AUTO_TEST_CASE(terminal_randomized_policy) {
     // check if everything works out without an error when
     // passing in an MDP with a randomized policy
@@ -794,6 +1772,154 @@ void test_simple_mdp_save_load_save_load() {
     BOOST_CHECK_EQUAL(string1, string2);
 }
 
+BOOST_AUTO_TEST_CASE(parallel_csv_load_save) {
+    // random rows in no particular order, with repeated transitions
+    std::default_random_engine gen(7);
+    std::uniform_int_distribution<long> state_dst(0, 1999), small_dst(0, 3);
+    // integer values are parsed exactly by both readers
+    std::uniform_int_distribution<long> value_dst(0, 64);
+    stringstream mdp_text, mdpo_text;
+    // columns in a different order with an extra column
+    mdp_text << "reward,idstateto,idaction,extra,idstatefrom,probability\n";
+    mdpo_text << "idstatefrom,idaction,idoutcome,idstateto,probability,reward\n";
+    for (int i = 0; i < 60000; ++i) {
+        const long from = state_dst(gen), action = small_dst(gen),
+                   outcome = small_dst(gen), to = state_dst(gen) % 20;
+        const prec_t prob = prec_t(value_dst(gen)), reward = prec_t(value_dst(gen));
+        mdp_text << reward << ", " << to << "," << action << ",x," << from << "," << prob
+                 << "\n";
+        mdpo_text << from << "," << action << "," << outcome << "," << to << "," << prob
+                  << "," << reward << "\r\n";
+    }
+
+    // the sequential reader is the reference
+    MDP mdp_seq;
+    {
+        stringstream input(mdp_text.str());
+        io::CSVReader<5> reader("nofile", input);
+        mdp_seq = mdp_from_csv(reader);
+    }
+    stringstream input(mdp_text.str());
+    MDP mdp_par = mdp_from_csv(input);
+    BOOST_CHECK_EQUAL(mdp_par.size(), mdp_seq.size());
+
+    // the buffered writer must match the stream formatting
+    stringstream out_seq, out_par;
+    out_seq << "idstatefrom,idaction,idstateto,probability,reward" << endl;
+    for (size_t i = 0; i < mdp_seq.size(); i++) {
+        for (size_t j = 0; j < mdp_seq[i].size(); j++) {
+            const auto& tran = mdp_seq[i][j];
+            for (size_t l = 0; l < tran.size(); l++)
+                out_seq << i << ',' << j << ',' << tran.get_indices()[l] << ','
+                        << tran.get_probabilities()[l] << ',' << tran.get_rewards()[l]
+                        << endl;
+        }
+    }
+    to_csv(mdp_par, out_par);
+    BOOST_CHECK(out_seq.str() == out_par.str());
+
+    MDPO mdpo_seq;
+    {
+        stringstream input(mdpo_text.str());
+        io::CSVReader<6> reader("nofile", input);
+        mdpo_seq = mdpo_from_csv(reader);
+    }
+    stringstream inputo(mdpo_text.str());
+    MDPO mdpo_par = mdpo_from_csv(inputo);
+    stringstream outo_seq, outo_par;
+    outo_seq.precision(12);
+    outo_par.precision(12);
+    to_csv(mdpo_seq, outo_seq);
+    to_csv(mdpo_par, outo_par);
+    BOOST_CHECK(outo_seq.str() == outo_par.str());
+    for (size_t s = 0; s < mdpo_seq.size(); ++s)
+        for (size_t a = 0; a < mdpo_seq[s].size(); ++a) {
+            const numvec &d1 = mdpo_seq[s][a].get_distribution(),
+                         &d2 = mdpo_par[s][a].get_distribution();
+            BOOST_CHECK_EQUAL_COLLECTIONS(d1.cbegin(), d1.cend(), d2.cbegin(), d2.cend());
+        }
+
+    // errors report the line
+    stringstream bad("idstatefrom,idaction,idstateto,probability,reward\n"
+                     "0,0,1,0.5,1\n0,0,,0.5,1\n");
+    BOOST_CHECK_EXCEPTION(mdp_from_csv(bad), invalid_argument,
+                          [](const invalid_argument& e) {
+                              return string(e.what()).find("line 3") != string::npos;
+                          });
+    stringstream missing("idstatefrom,idaction,probability,reward\n0,0,0.5,1\n");
+    BOOST_CHECK_THROW(mdp_from_csv(missing), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(bulk_model_builder) {
+    // unsorted rows with repeated transitions and zero probabilities
+    std::default_random_engine gen(11);
+    std::uniform_int_distribution<long> state_dst(0, 299), small_dst(0, 3);
+    std::uniform_real_distribution<prec_t> value_dst(0.0, 1.0);
+
+    for (bool force : {false, true}) {
+        MDP mdp_rows;
+        MDPO mdpo_rows;
+        ModelBuilder first, second, builder_o;
+        for (int i = 0; i < 20000; ++i) {
+            const long from = state_dst(gen), action = small_dst(gen),
+                       outcome = small_dst(gen), to = state_dst(gen) % 50;
+            const prec_t prob = i % 10 == 0 ? 0.0 : value_dst(gen),
+                         reward = value_dst(gen);
+            add_transition(mdp_rows, from, action, to, prob, reward, force);
+            add_transition(mdpo_rows, from, action, outcome, to, prob, reward, force);
+            (i < 7000 ? first : second).add(from, action, to, prob, reward);
+            builder_o.add(from, action, outcome, to, prob, reward);
+        }
+        first.append(second);
+        BOOST_CHECK_EQUAL(first.size(), 20000);
+        const MDP mdp = first.build_mdp(force);
+        const MDPO mdpo = builder_o.build_mdpo(force);
+
+        // the same merging order makes the models identical
+        BOOST_CHECK_EQUAL(mdp.size(), mdp_rows.size());
+        for (size_t s = 0; s < mdp.size(); ++s) {
+            BOOST_CHECK_EQUAL(mdp[s].size(), mdp_rows[s].size());
+            for (size_t a = 0; a < mdp[s].size(); ++a) {
+                const Transition &t1 = mdp[s][a], &t2 = mdp_rows[s][a];
+                BOOST_CHECK(t1.get_indices() == t2.get_indices());
+                BOOST_CHECK(t1.get_probabilities() == t2.get_probabilities());
+                BOOST_CHECK(t1.get_rewards() == t2.get_rewards());
+            }
+        }
+        BOOST_CHECK_EQUAL(mdpo.size(), mdpo_rows.size());
+        for (size_t s = 0; s < mdpo.size(); ++s) {
+            BOOST_CHECK_EQUAL(mdpo[s].size(), mdpo_rows[s].size());
+            for (size_t a = 0; a < mdpo[s].size(); ++a) {
+                const ActionO &a1 = mdpo[s][a], &a2 = mdpo_rows[s][a];
+                BOOST_CHECK_EQUAL(a1.size(), a2.size());
+                for (size_t o = 0; o < a1.size(); ++o) {
+                    const Transition &t1 = a1[o], &t2 = a2[o];
+                    BOOST_CHECK(t1.get_indices() == t2.get_indices());
+                    BOOST_CHECK(t1.get_probabilities() == t2.get_probabilities());
+                    BOOST_CHECK(t1.get_rewards() == t2.get_rewards());
+                    BOOST_CHECK_CLOSE(a1.get_distribution()[o], a2.get_distribution()[o],
+                                      1e-10);
+                }
+            }
+        }
+    }
+
+    // states that do not appear in transitions are terminal
+    ModelBuilder small;
+    small.add(0, 1, 1, 0.5, 1.0);
+    small.add(0, 1, 1, 0.5, 3.0);
+    const MDP mdp = small.build_mdp(false, 4);
+    BOOST_CHECK_EQUAL(mdp.size(), 4);
+    BOOST_CHECK_EQUAL(mdp[0].size(), 2);
+    BOOST_CHECK(mdp[0][0].empty());
+    BOOST_CHECK_EQUAL(mdp[0][1].size(), 1);
+    BOOST_CHECK_CLOSE(mdp[0][1].get_rewards()[0], 2.0, 1e-10);
+    BOOST_CHECK_THROW(small.build_mdpo(), invalid_argument);
+
+    small.add(2, 0, -1, 1.0, 0.0);
+    BOOST_CHECK_THROW(small.build_mdp(), invalid_argument);
+}
+
 // ********************************************************************************
 // ***** Value function
 // ********************************************************************************
@@ -1860,6 +2986,62 @@ BOOST_AUTO_TEST_CASE(inventory_failure_bug) {
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(test_l1w_warm_start) {
+    numvec z = {993.124, 990.787, 987.932, 984.191, 978.15,  967.83,  965.318,
+                962.154, 958.304, 1052.06, 1050.56, 1049.05, 1047.54, 1046.03,
+                1044.52, 1043,    1041.48, 1039.95, 1038.43, 1036.9,  1035.37};
+    const numvec pbar = {0.0111947, 0.0163699, 0.0229988, 0.0310452, 0.0402634,
+                         0.0501713, 0.0600659, 0.0690923, 0.0763588, 0.0810805,
+                         0.0827185, 0.0810805, 0.0763588, 0.0690923, 0.0600659,
+                         0.0501713, 0.0402634, 0.0310452, 0.0229988, 0.0163699,
+                         0.0111947};
+    const numvec w = {0.121204,  0.107023,  0.0928649, 0.0787302, 0.0646223, 0.0567386,
+                      0.0708033, 0.0848458, 0.0988657, 0.112863,  0.126837,  0.140787,
+                      0.154715,  0.168619,  0.182499,  0.196357,  0.210191,  0.224003,
+                      0.237791,  0.251556,  0.265298};
+    const double xi = 0.2;
+
+    GradientsL1_w gradients;
+    // the first update cannot be warm-started
+    BOOST_CHECK(!gradients.update(z, w));
+
+    // small changes that preserve the order of z are warm-started
+    for (int k = 0; k < 5; k++) {
+        for (size_t i = 0; i < z.size(); i++)
+            z[i] = 0.9 * z[i] + 0.01 * double(i % 3);
+        BOOST_CHECK(gradients.update(z, w));
+        auto sol_warm = worstcase_l1_w(gradients, z, pbar, w, xi);
+        auto sol_cold = worstcase_l1_w(z, pbar, w, xi);
+        BOOST_CHECK_CLOSE(sol_warm.second, sol_cold.second, 1e-6);
+        CHECK_CLOSE_COLLECTION(sol_warm.first, sol_cold.first, 1e-6);
+    }
+
+    // changing the order recomputes the gradients
+    swap(z[0], z[9]);
+    BOOST_CHECK(!gradients.update(z, w));
+    BOOST_CHECK_CLOSE(worstcase_l1_w(gradients, z, pbar, w, xi).second,
+                      worstcase_l1_w(z, pbar, w, xi).second, 1e-6);
+
+    // cached natures compute the same solution as the uncached one
+    MDP mdp = create_test_mdp<MDP>();
+    numvecvec budgets(mdp.size());
+    vector<numvecvec> weights(mdp.size());
+    for (size_t s = 0; s < mdp.size(); s++) {
+        for (size_t a = 0; a < mdp[s].size(); a++) {
+            budgets[s].push_back(0.3);
+            weights[s].push_back(numvec(mdp[s][a].size(), 1.0));
+        }
+    }
+    auto sol_w = rsolve_vi(mdp, 0.9, nats::robust_l1w(budgets, weights));
+    auto sol_u = rsolve_vi(mdp, 0.9, nats::robust_l1(budgets));
+    CHECK_CLOSE_COLLECTION(sol_w.valuefunction, sol_u.valuefunction, 1e-4);
+
+    const numvec s_budgets(mdp.size(), 0.3);
+    auto sol_sw = rsolve_s_vi(mdp, 0.9, nats::robust_s_l1w(s_budgets, weights));
+    auto sol_su = rsolve_s_vi(mdp, 0.9, nats::robust_s_l1(s_budgets));
+    CHECK_CLOSE_COLLECTION(sol_sw.valuefunction, sol_su.valuefunction, 1e-4);
+}
+
 // computes the s-rectangular value for a policy d, transition probabilities p,
 // and rewards z
 prec_t compute_s_value(const numvec& d, const numvecvec& p, const numvecvec& z) {
@@ -30,14 +30,22 @@
 #include "craam/simulators/inventory.hpp"
 #include "craam/simulators/population.hpp"
 
+#include "test/benchmark_models.hpp"
+
 #include <functional>
 #include <iostream>
+#include <map>
 #include <random>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/functional/hash.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace craam;
 using namespace craam::msen;
@@ -297,6 +305,42 @@ BOOST_AUTO_TEST_CASE(sampled_mdp_reward) {
     BOOST_CHECK_CLOSE(reward, 2.916666666666, 1e-4);
 }
 
+BOOST_AUTO_TEST_CASE(sampled_mdp_incremental) {
+    // random samples with fractional weights
+    std::default_random_engine gen(3);
+    std::uniform_int_distribution<long> state_dst(0, 39), action_dst(0, 2);
+    std::uniform_real_distribution<prec_t> value_dst(0.1, 2.0);
+    DiscreteSamples all;
+    vector<DiscreteSamples> batches(25);
+    for (int i = 0; i < 5000; ++i) {
+        const long from = state_dst(gen), action = action_dst(gen), to = state_dst(gen);
+        const prec_t reward = value_dst(gen), weight = value_dst(gen);
+        all.add_sample(from, action, to, reward, weight, 0, i);
+        batches[i % 25].add_sample(from, action, to, reward, weight, 0, i);
+    }
+
+    SampledMDP smdp_all, smdp_batches;
+    smdp_all.add_samples(all);
+    for (const auto& batch : batches)
+        smdp_batches.add_samples(batch);
+
+    const MDP &mdp1 = *smdp_all.get_mdp(), &mdp2 = *smdp_batches.get_mdp();
+    check_model(mdp2);
+    BOOST_CHECK_EQUAL(mdp1.size(), mdp2.size());
+    for (size_t s = 0; s < mdp1.size(); ++s) {
+        BOOST_CHECK_EQUAL(mdp1[s].size(), mdp2[s].size());
+        for (size_t a = 0; a < mdp1[s].size(); ++a) {
+            const Transition &t1 = mdp1[s][a], &t2 = mdp2[s][a];
+            BOOST_CHECK(t1.get_indices() == t2.get_indices());
+            for (size_t j = 0; j < t1.size(); ++j) {
+                BOOST_CHECK_CLOSE(t1.get_probabilities()[j], t2.get_probabilities()[j],
+                                  1e-8);
+                BOOST_CHECK_CLOSE(t1.get_rewards()[j], t2.get_rewards()[j], 1e-8);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(construct_mdp_from_samples_si_pol) {
 
     CounterTerminal sim(0.9, 0, 10, 1);
@@ -332,6 +376,116 @@ BOOST_AUTO_TEST_CASE(construct_mdp_from_samples_si_pol) {
     BOOST_CHECK_CLOSE(sol.total_return(smdp.get_initial()), 51.313973, 1e-3);
 }
 
+BOOST_AUTO_TEST_CASE(nearest_state_aggregation) {
+    // integer coordinates create many ties
+    std::default_random_engine gen(5);
+    std::uniform_int_distribution<int> coord(0, 20);
+    numvecvec representatives(3000, numvec(3));
+    for (numvec& r : representatives)
+        for (prec_t& x : r)
+            x = coord(gen);
+    numvecvec states(1000, numvec(3));
+    for (numvec& st : states)
+        for (prec_t& x : st)
+            x = coord(gen) + 0.5 * (coord(gen) % 2);
+
+    const NearestStateAggregator aggregator(representatives);
+    BOOST_CHECK_EQUAL(aggregator.size(), 3000);
+    BOOST_CHECK_EQUAL(aggregator.dimension(), 3);
+
+    const indvec batch = aggregator.closest(states);
+    for (size_t i = 0; i < states.size(); ++i) {
+        // exhaustive search returns the first closest state
+        numvec distances(representatives.size());
+        for (size_t j = 0; j < representatives.size(); ++j) {
+            prec_t dist = 0;
+            for (size_t d = 0; d < 3; ++d)
+                dist += (states[i][d] - representatives[j][d]) *
+                        (states[i][d] - representatives[j][d]);
+            distances[j] = dist;
+        }
+        const long expected =
+            min_element(distances.cbegin(), distances.cend()) - distances.cbegin();
+        BOOST_CHECK_EQUAL(aggregator(states[i]), expected);
+        BOOST_CHECK_EQUAL(batch[i], expected);
+    }
+
+    BOOST_CHECK_THROW(aggregator.closest(numvec{1.0, 2.0}), invalid_argument);
+    BOOST_CHECK_THROW(NearestStateAggregator(numvecvec{}), invalid_argument);
+    BOOST_CHECK_THROW(NearestStateAggregator(numvecvec{{1.0}, {1.0, 2.0}}),
+                      invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(flat_hash_map_discretization) {
+    FlatHashMap<long> map;
+    for (long k = 0; k < 10000; ++k)
+        BOOST_CHECK(map.emplace(k * 1024, k).second);
+    BOOST_CHECK(!map.emplace(5 * 1024, -1).second);
+    BOOST_CHECK_EQUAL(*map.find(5 * 1024), 5);
+    BOOST_CHECK(map.find(7) == nullptr);
+    const HashMapStats stats = map.stats();
+    BOOST_CHECK_EQUAL(stats.size, 10000);
+    BOOST_CHECK(stats.load_factor <= 0.75);
+    BOOST_CHECK(stats.mean_probes >= 1.0 && stats.mean_probes < 4.0);
+
+    // states are numbered in the order of the samples: from, action, to
+    Samples<long, long> samples;
+    samples.add_initial(100);
+    std::default_random_engine gen(9);
+    std::uniform_int_distribution<long> state_dst(0, 5000), action_dst(-2, 2);
+    for (int i = 0; i < 20000; ++i)
+        samples.add_sample(state_dst(gen), action_dst(gen), state_dst(gen), 1.0, 1.0, 0,
+                           i);
+
+    std::unordered_map<long, long> states, actions;
+    std::map<pair<long, long>, long> sa_actions;
+    std::unordered_map<long, long> action_counts;
+    auto number = [](std::unordered_map<long, long>& ids, long key) {
+        return ids.emplace(key, long(ids.size())).first->second;
+    };
+    number(states, 100);
+    indvec from(samples.size()), action(samples.size()), sa_action(samples.size()),
+        to(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        from[i] = number(states, samples.get_states_from()[i]);
+        action[i] = number(actions, samples.get_actions()[i]);
+        const auto sa = make_pair(samples.get_states_from()[i], samples.get_actions()[i]);
+        if (sa_actions.count(sa) == 0)
+            sa_actions[sa] = action_counts[samples.get_states_from()[i]]++;
+        sa_action[i] = sa_actions[sa];
+        to[i] = number(states, samples.get_states_to()[i]);
+    }
+
+    SampleDiscretizerSI<long, long> si;
+    si.add_samples(samples);
+    BOOST_CHECK(si.get_discrete()->get_states_from() == from);
+    BOOST_CHECK(si.get_discrete()->get_actions() == action);
+    BOOST_CHECK(si.get_discrete()->get_states_to() == to);
+    BOOST_CHECK_EQUAL(si.get_discrete()->get_initial()[0], 0);
+    BOOST_CHECK_EQUAL(si.state_map_stats().size, states.size());
+    BOOST_CHECK_EQUAL(si.action_map_stats().size, 5);
+
+    SampleDiscretizerSD<long, long, boost::hash<pair<long, long>>> sd;
+    sd.add_samples(samples);
+    BOOST_CHECK(sd.get_discrete()->get_states_from() == from);
+    BOOST_CHECK(sd.get_discrete()->get_actions() == sa_action);
+    BOOST_CHECK(sd.get_discrete()->get_states_to() == to);
+    BOOST_CHECK_EQUAL(sd.action_map_stats().size, sa_actions.size());
+
+    // the indexes do not depend on the chunk size
+    SampleDiscretizerSI<long, long> si_chunked;
+    si_chunked.add_samples(samples, 777);
+    BOOST_CHECK(si_chunked.get_discrete()->get_states_from() == from);
+    BOOST_CHECK(si_chunked.get_discrete()->get_actions() == action);
+    BOOST_CHECK(si_chunked.get_discrete()->get_states_to() == to);
+
+    SampleDiscretizerSD<long, long, boost::hash<pair<long, long>>> sd_chunked;
+    sd_chunked.add_samples(samples, 1);
+    BOOST_CHECK(sd_chunked.get_discrete()->get_states_from() == from);
+    BOOST_CHECK(sd_chunked.get_discrete()->get_actions() == sa_action);
+    BOOST_CHECK(sd_chunked.get_discrete()->get_states_to() == to);
+}
+
 template <class Model> Model create_test_mdp_sim() {
     Model rmdp(3);
 
@@ -366,9 +520,15 @@ BOOST_AUTO_TEST_CASE(simulate_mdp) {
 
     auto samples = simulate(ms, rp, 1000, 5, -1, 0.0, 10);
 
-    BOOST_CHECK_EQUAL(samples.size(), 49);
+    BOOST_CHECK_EQUAL(samples.size(), 85);
     // cout << "Number of samples " << samples.size() << endl;
 
+    // a copy shares the alias tables but has its own random number generator
+    ModelSimulator original(m, initial, 3);
+    ModelSimulator copy(original);
+    for (int i = 0; i < 20; i++)
+        BOOST_CHECK(copy.transition(0, 1) == original.transition(0, 1));
+
     SampledMDP smdp;
     smdp.add_samples(samples);
 
@@ -406,12 +566,35 @@ BOOST_AUTO_TEST_CASE(simulate_mdp) {
 
     auto randomized_samples = simulate(ms, rizedp, 1000, 5, -1, 0.0, 10);
 
-    BOOST_CHECK_CLOSE(randomized_samples.mean_return(0.9), 4.01147, 1e-3);
+    BOOST_CHECK_CLOSE(randomized_samples.mean_return(0.9), 2.87182, 1e-3);
     // cout << "Return of randomized samples " <<
     // randomized_samples.mean_return(0.9) << endl;
 }
 #endif // _cplusplus >= 201703L
 
+BOOST_AUTO_TEST_CASE(alias_tables_sampling) {
+    AliasTables tables;
+    tables.add({0.1, 0.2, 0.3}, 0.4);
+    tables.add({5.0, 1.0});
+    tables.add({1.0}, 0.0);
+    BOOST_CHECK_EQUAL(tables.size(), 3);
+    BOOST_CHECK_EQUAL(tables.outcome_count(0), 4);
+    BOOST_CHECK_EQUAL(tables.outcome_count(1), 2);
+
+    const vector<numvec> expected{{0.1, 0.2, 0.3, 0.4}, {5.0 / 6.0, 1.0 / 6.0}, {1.0}};
+
+    default_random_engine gen(7);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    const long samples = 100000;
+    for (size_t t = 0; t < tables.size(); t++) {
+        numvec frequencies(tables.outcome_count(t), 0.0);
+        for (long i = 0; i < samples; i++)
+            frequencies[tables.sample(t, uniform(gen))] += 1.0 / samples;
+        for (size_t o = 0; o < frequencies.size(); o++)
+            BOOST_CHECK_SMALL(frequencies[o] - expected[t][o], 0.01);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(inventory_simulator) {
     // make sure that solving an MDP constructed from simulation and samples
     // returns the same solution as the MDP that is constructed directly
@@ -521,3 +704,125 @@ BOOST_AUTO_TEST_CASE(population_simulator) {
     // TODO: enable a check here
     //BOOST_CHECK_CLOSE(solution.total_return(init), -0.4245, 1e-2);
 }
+
+BOOST_AUTO_TEST_CASE(parallel_simulation_reproducible) {
+    shared_ptr<MDP> m = make_shared<MDP>();
+    *m = create_test_mdp_sim<MDP>();
+    Transition initial({0}, {1.0});
+    ModelSimulator ms(m, initial, 13);
+
+    sim_policy_factory_t<ModelSimulator> make_policy =
+        [](const ModelSimulator& sim, random_device::result_type seed) {
+            return sim_policy_t<ModelSimulator>(ModelRandomizedPolicy(
+                sim, {{0.5, 0.5}, {0.5, 0.4, 0.1}, {0.5, 0.5}}, seed));
+        };
+
+    // runs the same simulation with a different number of threads
+    auto run_all = [&](int threads) {
+#ifdef _OPENMP
+        const int max_threads = omp_get_max_threads();
+        omp_set_num_threads(threads);
+#endif
+        auto samples = simulate_par(ms, make_policy, 20, 500, 0.05, 42);
+        auto returns = simulate_return_par(ms, 0.9, make_policy, 20, 500, 0.05, 42);
+#ifdef _OPENMP
+        omp_set_num_threads(max_threads);
+#endif
+        return make_pair(samples, returns);
+    };
+    auto [samples1, returns1] = run_all(1);
+    auto [samples4, returns4] = run_all(4);
+
+    BOOST_CHECK_GT(samples1.size(), 500);
+    BOOST_CHECK_EQUAL(samples1.get_initial().size(), 500);
+    BOOST_CHECK_EQUAL_COLLECTIONS(samples1.get_states_from().cbegin(),
+                                  samples1.get_states_from().cend(),
+                                  samples4.get_states_from().cbegin(),
+                                  samples4.get_states_from().cend());
+    BOOST_CHECK_EQUAL_COLLECTIONS(samples1.get_actions().cbegin(),
+                                  samples1.get_actions().cend(),
+                                  samples4.get_actions().cbegin(),
+                                  samples4.get_actions().cend());
+    BOOST_CHECK_EQUAL_COLLECTIONS(samples1.get_runs().cbegin(),
+                                  samples1.get_runs().cend(),
+                                  samples4.get_runs().cbegin(),
+                                  samples4.get_runs().cend());
+    BOOST_CHECK_EQUAL_COLLECTIONS(returns1.second.cbegin(), returns1.second.cend(),
+                                  returns4.second.cbegin(), returns4.second.cend());
+
+    // the runs are in order
+    BOOST_CHECK(is_sorted(samples1.get_runs().cbegin(), samples1.get_runs().cend()));
+
+    // the mean returns of the samples and the returns agree
+    BOOST_CHECK_CLOSE(samples1.mean_return(0.9),
+                      accumulate(returns1.second.cbegin(), returns1.second.cend(), 0.0) /
+                          500.0,
+                      1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_build_mdp_reproducible) {
+    const long carrying_capacity = 50;
+    numvecvec mean_rate = {numvec(1 + carrying_capacity, 1.03),
+                           numvec(1 + carrying_capacity, 0.95)};
+    numvecvec std_rate = {numvec(1 + carrying_capacity, 0.5),
+                          numvec(1 + carrying_capacity, 0.5)};
+    numvecvec rewards = {numvec(1 + carrying_capacity, -1.0),
+                         numvec(1 + carrying_capacity, 0.2)};
+    PopulationSim simulator(carrying_capacity, 10, 2, mean_rate, std_rate, rewards, 0,
+                            0, PopulationSim::Growth::Exponential, 7);
+
+    auto build = [&](int threads) {
+#ifdef _OPENMP
+        const int max_threads = omp_get_max_threads();
+        omp_set_num_threads(threads);
+#endif
+        MDP mdp = build_mdp_par(simulator, 20, 11);
+#ifdef _OPENMP
+        omp_set_num_threads(max_threads);
+#endif
+        return mdp;
+    };
+    MDP mdp1 = build(1), mdp4 = build(4);
+    BOOST_CHECK_EQUAL(mdp1.size(), mdp4.size());
+    std::stringstream csv1, csv4;
+    to_csv(mdp1, csv1);
+    to_csv(mdp4, csv4);
+    BOOST_CHECK_EQUAL(csv1.str(), csv4.str());
+    check_model(mdp1);
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_model_generators) {
+    const MDP random1 = bench::random_mdp(50, 3, 5, 11);
+    const MDP random2 = bench::random_mdp(50, 3, 5, 11);
+    check_model(random1);
+    BOOST_CHECK_EQUAL(random1.size(), 50);
+    BOOST_CHECK_EQUAL(random1[7].size(), 3);
+    BOOST_CHECK_EQUAL(random1[7][2].size(), 5);
+    // the generators are reproducible
+    std::stringstream csv1, csv2;
+    to_csv(random1, csv1);
+    to_csv(random2, csv2);
+    BOOST_CHECK_EQUAL(csv1.str(), csv2.str());
+
+    const MDP river = bench::riverswim(20);
+    check_model(river);
+    BOOST_CHECK_EQUAL(river.size(), 20);
+    // the prize is worth swimming to from the right end of the river
+    const auto sol = solve_mpi(river, 0.9);
+    BOOST_CHECK_EQUAL(sol.policy[19], 1);
+
+    const MDP inventory = bench::inventory_mdp(30);
+    check_model(inventory);
+    BOOST_CHECK_EQUAL(inventory.size(), 31);
+
+    const MDP population = bench::population_mdp(40, 10, 3);
+    check_model(population);
+    BOOST_CHECK_EQUAL(population.size(), 41);
+
+    const MDPO bayes = bench::bayesian_mdpo(30, 2, 4, 6, 20.0, 5);
+    check_model(bayes);
+    BOOST_CHECK_EQUAL(bayes.size(), 30);
+    BOOST_CHECK_EQUAL(bayes[3][1].size(), 6);
+    // all posterior samples share the support
+    BOOST_CHECK(bayes[3][1][0].get_indices() == bayes[3][1][5].get_indices());
+}